@@ -41,6 +41,7 @@
 #include "ServiceModules/SOSFilters.hpp"
 #include "ServiceModules/DirectivityTF.hpp"
 #include "Readers/SofaReader.hpp"
+#include "Readers/HRTFCache.hpp"
 #include "nlohmann/json.hpp"
 #include "Common/EnvelopeDetector.hpp"
 #include "EnvironmentModels/FreeFieldEnvironmentModel.hpp"
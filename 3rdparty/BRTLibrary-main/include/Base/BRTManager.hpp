@@ -23,8 +23,8 @@
 #ifndef _BRT_MANAGER_
 #define _BRT_MANAGER_
 
-#include <thread>
 #include <Connectivity/ExitPoint.hpp>
+#include "RenderExecutor.hpp"
 #include "SourceModels/SourceModelBase.hpp"
 #include "ListenerBase.hpp"
 #include "ListenerModels/ListenerModelBase.hpp"
@@ -32,6 +32,8 @@
 #include <BinauralFilter/BinauralFilterBase.hpp>
 #include <nlohmann/json.hpp>
 
+#define DEFAULT_MINIMUM_SOURCES_TO_FAN_OUT 4			///< Default number of sources from which ProcessAll uses the render threads
+
 namespace BRTBase {
 	using json = nlohmann::json;
 		
@@ -39,10 +41,32 @@ namespace BRTBase {
 
 	public:
 
-		CBRTManager() : initialized{ false }, setupModeActivated{ false } {
+		CBRTManager() : initialized{ false }, setupModeActivated{ false }, minimumSourcesToFanOut{ DEFAULT_MINIMUM_SOURCES_TO_FAN_OUT } {
 			commandsExitPoint = std::make_shared<BRTConnectivity::CExitPointCommand>(static_cast<std::string>(Common::COMMAND_EXIT_POINT_ID));
 		}
 
+		~CBRTManager() {
+			renderExecutor.Stop();
+		}
+
+		/**
+		 * @brief Configure the pool of render threads used by ProcessAll. The threads are created here and live until the next call or the destruction of the manager.
+		 * @param _numberOfWorkers Number of threads in addition to the one calling ProcessAll. With 0, all sources are rendered in the calling thread.
+		 * @param _minimumSourcesToFanOut Below this number of sources, the block is rendered in the calling thread even if there are workers
+		 * @param _pinWorkers Pin each worker to one core
+		*/
+		void SetRenderThreads(int _numberOfWorkers, int _minimumSourcesToFanOut = DEFAULT_MINIMUM_SOURCES_TO_FAN_OUT, bool _pinWorkers = false) {
+			renderExecutor.Start(_numberOfWorkers, _pinWorkers);
+			minimumSourcesToFanOut = _minimumSourcesToFanOut < 1 ? 1 : _minimumSourcesToFanOut;
+		}
+
+		/**
+		 * @brief Returns the number of render threads, not counting the one calling ProcessAll
+		*/
+		int GetRenderThreads() const {
+			return renderExecutor.GetNumberOfWorkers();
+		}
+
 		/**
 		 * @brief Starts the configuration mode, where you can create/destroy and connect/disconnect modules.
 		*/
@@ -813,12 +837,16 @@ namespace BRTBase {
 		/////////////////////
 
 		/**
-		 * @brief Start audio processing
+		 * @brief Start audio processing. Sources are rendered in the calling thread, or spread over the render threads when there are enough of them (see SetRenderThreads).
+		 * The outputs of the sources are summed in the order they were connected, so the result is the same whatever the number of threads.
 		*/
 		void ProcessAll() {
 			if (setupModeActivated) return;
-			std::thread thread1 = std::thread(&BRTBase::CBRTManager::ProcessAllThread, this);
-			thread1.join();
+			if (renderExecutor.GetNumberOfWorkers() > 0 && audioSources.size() >= static_cast<std::size_t>(minimumSourcesToFanOut)) {
+				renderExecutor.ParallelFor(audioSources.size(), [this](std::size_t _index) { audioSources[_index]->SetDataReady(); });
+			} else {
+				ProcessAllSources();
+			}
 		}
 		/**
 		 * @brief Executes the received command. To do so, it distributes it to all the connected modules, which are responsible for executing the relevant actions.
@@ -841,14 +869,17 @@ namespace BRTBase {
 		bool initialized;
 		bool setupModeActivated;
 
+		CRenderExecutor renderExecutor;			// Persistent render threads
+		int minimumSourcesToFanOut;				// Number of sources from which the block is spread over the render threads
+
 		/////////////////
 		// Methods
 		/////////////////
 		
 		/**
-		 * @brief Start processing on each of the sources.
+		 * @brief Start processing on each of the sources, one after the other.
 		*/
-		void ProcessAllThread() {
+		void ProcessAllSources() {
 			for (auto it = audioSources.begin(); it != audioSources.end(); it++) (*it)->SetDataReady();
 		}
 
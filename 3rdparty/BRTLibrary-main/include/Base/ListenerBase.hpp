@@ -37,11 +37,10 @@ namespace BRTBase {
 	class CListenerBase : public BRTConnectivity::CBRTConnectivity /*CCommandEntryPointManager, public CExitPointManager, public CEntryPointManager*/ {
 	public:
 		
-		CListenerBase(std::string _listenerID) : listenerID{ _listenerID }, 
-			leftDataReady{ false },	rightDataReady{ false } {
+		CListenerBase(std::string _listenerID) : listenerID{ _listenerID } {
 												
-			CreateSamplesEntryPoint("leftEar");
-			CreateSamplesEntryPoint("rightEar");									
+			leftEarPort = CreateSamplesEntryPoint("leftEar");
+			rightEarPort = CreateSamplesEntryPoint("rightEar");									
 			CreateTransformExitPoint();			
 			CreateIDExitPoint();
 			GetIDExitPoint()->sendData(listenerID);						
@@ -77,35 +76,17 @@ namespace BRTBase {
 		 * @param _rightBuffer Right ear sample buffer
 		*/
 		void GetBuffers(CMonoBuffer<float>& _leftBuffer, CMonoBuffer<float>& _rightBuffer) {						
-			if (leftDataReady) {
-				_leftBuffer = leftBuffer;
-				leftDataReady = false;
-			}
-			else {
-				_leftBuffer = CMonoBuffer<float>(globalParameters.GetBufferSize());
-			}
-			
-			if (rightDataReady) {
-				_rightBuffer = rightBuffer;
-				rightDataReady = false;
-			}
-			else {
-				_rightBuffer = CMonoBuffer<float>(globalParameters.GetBufferSize());
-			}
-
+			// The models are mixed in the order they were connected, whatever order they have finished in
+			MixEarBuffer(leftEarPort, _leftBuffer);
+			MixEarBuffer(rightEarPort, _rightBuffer);
 		}
 
 		/////////////////////		
 		// Update Callbacks
 		/////////////////////
 		
-		void UpdateEntryPointData(std::string id) override {
-			if (id == "leftEar") {
-				UpdateLeftBuffer();
-			}
-			else if (id == "rightEar") {
-				UpdateRightBuffer();
-			}
+		void UpdateEntryPointData(const std::string& id, int _port) override {
+			// Nothing to do, the ear buffers are mixed in GetBuffers
 		}
 		
 		void UpdateCommand() override {
@@ -125,45 +106,25 @@ namespace BRTBase {
 		/////////////////////////
 		
 		/**
-		 * @brief Mix the new buffer received for the left ear with the contents of the buffer.
+		 * @brief Replace the contents of the buffer with the mix of the buffers received at one ear entry point since the last call
 		*/
-		void UpdateLeftBuffer() {
-			if (!leftDataReady) {
-				leftBuffer = CMonoBuffer<float>(globalParameters.GetBufferSize());
-			}			
-			CMonoBuffer<float> buffer = GetSamplesEntryPoint("leftEar")->GetData();
-			if (buffer.size() != 0) {
-				leftBuffer += buffer;
-				leftDataReady = true;
-			}
+		void MixEarBuffer(int _entryPointPort, CMonoBuffer<float>& _buffer) {
+			_buffer.Fill(globalParameters.GetBufferSize(), 0.0f);
+			GetSamplesEntryPoint(_entryPointPort)->ForEachReceivedData([&_buffer](const CMonoBuffer<float>& _newBuffer) {
+				if (_newBuffer.size() == _buffer.size()) { _buffer += _newBuffer; }
+			});
 		}
-		/**
-		 * @brief Mix the new buffer received for the right ear with the contents of the buffer.
-		*/
-		void UpdateRightBuffer() {
-			if (!rightDataReady) {
-				rightBuffer = CMonoBuffer<float>(globalParameters.GetBufferSize());
-			}			
-			CMonoBuffer<float> buffer = GetSamplesEntryPoint("rightEar")->GetData();
-			if (buffer.size() != 0) {
-				rightBuffer += buffer;
-				rightDataReady = true;
-			}
-		}		
 
 
 		//////////////////////////
 		// Private Attributes
 		/////////////////////////
 		std::string listenerID;								// Store unique listener ID		
+		int leftEarPort;									// Indices of the ear entry points
+		int rightEarPort;
 		Common::CTransform listenerTransform;				// Transform matrix (position and orientation) of listener  	
 
 		Common::CGlobalParameters globalParameters;
-		CMonoBuffer<float> leftBuffer;
-		CMonoBuffer<float> rightBuffer;
-
-		bool leftDataReady;
-		bool rightDataReady;
 	};
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,270 @@
+/**
+* \class CRenderExecutor
+*
+* \brief Declaration of CRenderExecutor class
+* \date	June 2023
+*
+* \authors 3DI-DIANA Research Group (University of Malaga), in alphabetical order: M. Cuevas-Rodriguez, D. Gonzalez-Toledo, L. Molina-Tanco, F. Morales-Benitez ||
+* Coordinated by , A. Reyes-Lecuona (University of Malaga)||
+* \b Contact: areyes@uma.es
+*
+* \b Copyright: University of Malaga
+*
+* \b Contributions: (additional authors/contributors can be added here)
+*
+* \b Project: SONICOM ||
+* \b Website: https://www.sonicom.eu/
+*
+* \b Acknowledgement: This project has received funding from the European Union's Horizon 2020 research and innovation programme under grant agreement no.101017743
+*
+* \b Licence: This program is free software, you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+*/
+
+#ifndef _BRT_RENDER_EXECUTOR_
+#define _BRT_RENDER_EXECUTOR_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#define RENDER_EXECUTOR_SPIN_ITERATIONS 2000		///< Number of yields a worker does before parking on the condition variable
+
+namespace BRTBase {
+
+	/**
+	 * @brief Long-lived pool of render threads used by the manager to process one audio block.
+	 * Workers are created once and woken for every block through an atomic generation counter,
+	 * so no thread is created or destroyed in the audio path. The calling thread always takes part in the work,
+	 * which means that with zero workers the jobs are just executed inline.
+	 * The jobs of a block are split into one contiguous range per thread, so that each thread keeps rendering the same sources
+	 * from block to block. A thread that runs out of jobs steals them one by one from the end of the other ranges.
+	*/
+	class CRenderExecutor {
+	public:
+
+		CRenderExecutor() : running{ false }, generation{ 0 }, numberOfJobs{ 0 }, completedJobs{ 0 }, parkedWorkers{ 0 }, jobFunction{ nullptr }, jobContext{ nullptr } {}
+
+		~CRenderExecutor() {
+			Stop();
+		}
+
+		CRenderExecutor(const CRenderExecutor&) = delete;
+		CRenderExecutor& operator=(const CRenderExecutor&) = delete;
+
+		/**
+		 * @brief Create the worker threads. Any previous pool is stopped first.
+		 * @param _numberOfWorkers Number of threads to create in addition to the calling thread
+		 * @param _pinWorkers If true, each worker is pinned to its own core (only supported on Linux)
+		*/
+		void Start(int _numberOfWorkers, bool _pinWorkers = false) {
+			Stop();
+			if (_numberOfWorkers <= 0) return;
+
+			running.store(true);
+			jobRanges.reset(new TJobRange[_numberOfWorkers + 1]);
+			workers.reserve(_numberOfWorkers);
+			for (int i = 0; i < _numberOfWorkers; i++) {
+				workers.emplace_back(&CRenderExecutor::WorkerLoop, this, i + 1);
+				if (_pinWorkers) { PinThread(workers.back(), i + 1); }
+			}
+		}
+
+		/**
+		 * @brief Wake and join all the worker threads.
+		*/
+		void Stop() {
+			if (workers.empty()) return;
+			{
+				std::lock_guard<std::mutex> l(parkMutex);
+				running.store(false);
+			}
+			parkCondition.notify_all();
+			for (auto& worker : workers) {
+				if (worker.joinable()) worker.join();
+			}
+			workers.clear();
+			jobRanges.reset();
+		}
+
+		/**
+		 * @brief Returns the number of worker threads, not counting the caller
+		*/
+		int GetNumberOfWorkers() const {
+			return static_cast<int>(workers.size());
+		}
+
+		/**
+		 * @brief Execute _job(i) for every i in [0, _numberOfJobs) and wait until all of them have finished.
+		 * Jobs are shared out between the workers and the calling thread, so the order of execution is not defined.
+		 * @param _numberOfJobs Number of jobs
+		 * @param _job Callable with signature void(std::size_t)
+		*/
+		template <typename F>
+		void ParallelFor(std::size_t _numberOfJobs, F&& _job) {
+			if (_numberOfJobs == 0) return;
+			if (workers.empty() || _numberOfJobs == 1 || _numberOfJobs > RANGE_INDEX_MASK) {
+				for (std::size_t i = 0; i < _numberOfJobs; i++) { _job(i); }
+				return;
+			}
+
+			using TJob = typename std::remove_reference<F>::type;
+			jobFunction = [](void* _context, std::size_t _index) { (*static_cast<TJob*>(_context))(_index); };
+			jobContext = static_cast<void*>(&_job);
+			numberOfJobs.store(_numberOfJobs, std::memory_order_relaxed);
+			completedJobs.store(0, std::memory_order_relaxed);
+
+			// Give each thread its share of the jobs, then publish the new block
+			const uint32_t newGeneration = generation.load(std::memory_order_relaxed) + 1;
+			const std::size_t numberOfThreads = workers.size() + 1;
+			for (std::size_t i = 0; i < numberOfThreads; i++) {
+				jobRanges[i].state.store(PackRange(newGeneration, _numberOfJobs * i / numberOfThreads, _numberOfJobs * (i + 1) / numberOfThreads), std::memory_order_relaxed);
+			}
+			generation.store(newGeneration, std::memory_order_release);
+			if (parkedWorkers.load() > 0) {
+				{ std::lock_guard<std::mutex> l(parkMutex); }
+				parkCondition.notify_all();
+			}
+
+			RunJobs(0, newGeneration);
+			while (completedJobs.load(std::memory_order_acquire) < _numberOfJobs) {
+				std::this_thread::yield();
+			}
+		}
+
+	private:
+
+		/**
+		 * @brief Jobs of one thread that have not been claimed yet, [begin, end), tagged with the generation they belong to
+		*/
+		struct alignas(64) TJobRange {
+			std::atomic<uint64_t> state{ 0 };				// Generation (high 16 bits), begin (next 24 bits) and end (low 24 bits)
+		};
+
+		static constexpr uint64_t RANGE_INDEX_MASK = 0xFFFFFFu;
+
+		static uint64_t PackRange(uint32_t _generation, uint64_t _begin, uint64_t _end) {
+			return (static_cast<uint64_t>(_generation & 0xFFFFu) << 48) | (_begin << 24) | _end;
+		}
+		static uint32_t RangeGeneration(uint64_t _state) { return static_cast<uint32_t>(_state >> 48); }
+		static std::size_t RangeBegin(uint64_t _state) { return static_cast<std::size_t>((_state >> 24) & RANGE_INDEX_MASK); }
+		static std::size_t RangeEnd(uint64_t _state) { return static_cast<std::size_t>(_state & RANGE_INDEX_MASK); }
+
+		/**
+		 * @brief Main loop of each worker. Waits for a new generation and then helps to run its jobs.
+		 * @param _thread Index of the range of the worker, 0 being the one of the calling thread
+		*/
+		void WorkerLoop(std::size_t _thread) {
+			uint32_t seenGeneration = generation.load();
+			while (true) {
+				int spins = 0;
+				uint32_t currentGeneration;
+				while ((currentGeneration = generation.load(std::memory_order_acquire)) == seenGeneration) {
+					if (!running.load(std::memory_order_relaxed)) return;
+					if (++spins < RENDER_EXECUTOR_SPIN_ITERATIONS) {
+						std::this_thread::yield();
+						continue;
+					}
+					std::unique_lock<std::mutex> l(parkMutex);
+					parkedWorkers.fetch_add(1);
+					parkCondition.wait(l, [this, seenGeneration]() { return !running.load() || generation.load() != seenGeneration; });
+					parkedWorkers.fetch_sub(1);
+					spins = 0;
+				}
+				seenGeneration = currentGeneration;
+				RunJobs(_thread, currentGeneration);
+			}
+		}
+
+		/**
+		 * @brief Run the jobs of the given generation, first from the front of the own range and then from the end of the others, until there are none left.
+		 * Every claim is a CAS on a range tagged with its generation, so a late worker can never take a job from a newer block.
+		 * @param _thread Index of the own range
+		 * @param _generation Generation the caller has observed
+		*/
+		void RunJobs(std::size_t _thread, uint32_t _generation) {
+			const std::size_t numberOfThreads = workers.size() + 1;
+			const uint32_t tag = _generation & 0xFFFFu;
+			std::size_t job;
+			while (ClaimFront(jobRanges[_thread], tag, job) || Steal(_thread, numberOfThreads, tag, job)) {
+				jobFunction(jobContext, job);
+				completedJobs.fetch_add(1, std::memory_order_release);
+			}
+		}
+
+		/**
+		 * @brief Claim the first job of a range
+		 * @return False if the range is empty or belongs to another generation
+		*/
+		static bool ClaimFront(TJobRange& _range, uint32_t _tag, std::size_t& _job) {
+			uint64_t state = _range.state.load(std::memory_order_acquire);
+			while (RangeGeneration(state) == _tag && RangeBegin(state) < RangeEnd(state)) {
+				if (_range.state.compare_exchange_weak(state, state + (uint64_t{ 1 } << 24), std::memory_order_acq_rel, std::memory_order_acquire)) {
+					_job = RangeBegin(state);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/**
+		 * @brief Claim the last job of the first other range that still has some, looking from the next thread on
+		 * @return False if no range of the generation has jobs left
+		*/
+		bool Steal(std::size_t _thread, std::size_t _numberOfThreads, uint32_t _tag, std::size_t& _job) {
+			for (std::size_t i = 1; i < _numberOfThreads; i++) {
+				TJobRange& victim = jobRanges[(_thread + i) % _numberOfThreads];
+				uint64_t state = victim.state.load(std::memory_order_acquire);
+				while (RangeGeneration(state) == _tag && RangeBegin(state) < RangeEnd(state)) {
+					if (victim.state.compare_exchange_weak(state, state - 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+						_job = RangeEnd(state) - 1;
+						return true;
+					}
+				}
+			}
+			return false;
+		}
+
+		/**
+		 * @brief Pin a thread to one core. Best effort, errors are ignored.
+		 * @param _thread Thread to pin
+		 * @param _core Core index, wrapped to the number of available cores
+		*/
+		void PinThread(std::thread& _thread, int _core) {
+#if defined(__linux__)
+			unsigned int cores = std::thread::hardware_concurrency();
+			if (cores == 0) return;
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+			CPU_SET(_core % cores, &cpuSet);
+			pthread_setaffinity_np(_thread.native_handle(), sizeof(cpu_set_t), &cpuSet);
+#else
+			(void)_thread;
+			(void)_core;
+#endif
+		}
+
+		std::vector<std::thread> workers;					// Render threads
+		std::atomic<bool> running;							// False when the workers have to exit
+		std::atomic<uint32_t> generation;					// Number of the current block, workers wake up when it changes
+		std::unique_ptr<TJobRange[]> jobRanges;				// Unclaimed jobs of each thread, the calling thread first
+		std::atomic<std::size_t> numberOfJobs;				// Number of jobs in the current generation
+		std::atomic<std::size_t> completedJobs;				// Number of jobs finished in the current generation
+		std::atomic<int> parkedWorkers;						// Workers sleeping on the condition variable
+
+		std::mutex parkMutex;								// Only used to park idle workers, never in the hot path
+		std::condition_variable parkCondition;
+
+		void (*jobFunction)(void*, std::size_t);			// Type-erased job of the current generation
+		void* jobContext;
+	};
+}
+#endif
@@ -67,35 +67,12 @@ namespace BRTBinauralFilter {
 	private:
 		
 		
-		/**
-		 * @brief Implementation of CAdvancedEntryPointManager virtual method
-		 * @param _entryPointId entryPoint ID
-		*/
-
-		void OneEntryPointOneDataReceived(std::string _entryPointId) override {
-
-			if (_entryPointId == "leftEar") {
-				if (!leftDataReady) {
-					InitBuffer(leftBuffer);
-				}
-				CMonoBuffer<float> newBuffer = GetSamplesEntryPoint("leftEar")->GetData();
-				leftDataReady = MixEarBuffers(leftBuffer, newBuffer);
-			} else if (_entryPointId == "rightEar") {
-				if (!rightDataReady) {
-					InitBuffer(rightBuffer);
-				}
-				CMonoBuffer<float> newBuffer = GetSamplesEntryPoint("rightEar")->GetData();
-				rightDataReady = MixEarBuffers(rightBuffer, newBuffer);
-			} else {
-				//nothing
-			}
-		}
-
 		/**
 		 * @brief Implementation of CAdvancedEntryPointManager virtual method
 		*/
 		void AllEntryPointsAllDataReady() override {
 
+			MixEarBuffers();
 			GetSamplesExitPoint("leftEar")->sendData(leftBuffer);
 			GetSamplesExitPoint("rightEar")->sendData(rightBuffer);
 			leftDataReady = false;
@@ -113,22 +90,6 @@ namespace BRTBinauralFilter {
 		}
 
 
-		///**
-		// * @brief Mix the new buffer received with the contents of the buffer.
-		//*/
-		bool MixEarBuffers(CMonoBuffer<float> & buffer, const CMonoBuffer<float> & newBuffer) {
-			if (newBuffer.size() != 0) {
-				buffer += newBuffer;
-				return true;
-			}
-			return false;
-		}
-
-		void InitBuffer(CMonoBuffer<float> & buffer) {
-			buffer = CMonoBuffer<float>(globalParameters.GetBufferSize());
-		}
-
-
 		// Attributes
 		Common::CGlobalParameters globalParameters;	
 	
@@ -136,6 +97,31 @@ namespace BRTBinauralFilter {
 
 		void SendMyID() { GetIDExitPoint()->sendData(modelID); }
 
+		/**
+		 * @brief Replace the contents of the ear buffers with the mix of the buffers received during this block, in the order of the connections,
+		 * so that the result does not depend on the render threads
+		*/
+		void MixEarBuffers() {
+			leftDataReady = MixEarBuffer("leftEar", leftBuffer);
+			rightDataReady = MixEarBuffer("rightEar", rightBuffer);
+		}
+
+		/**
+		 * @brief Replace the contents of the buffer with the mix of the buffers received at one ear entry point
+		 * @return True if any buffer has been received
+		*/
+		bool MixEarBuffer(const std::string& _entryPointId, CMonoBuffer<float>& _buffer) {
+			bool received = false;
+			_buffer.Fill(globalParameters.GetBufferSize(), 0.0f);
+			GetSamplesEntryPoint(_entryPointId)->ForEachReceivedData([&_buffer, &received](const CMonoBuffer<float>& _newBuffer) {
+				if (_newBuffer.size() == _buffer.size()) {
+					_buffer += _newBuffer;
+					received = true;
+				}
+			});
+			return received;
+		}
+
 		CMonoBuffer<float> leftBuffer;
 		CMonoBuffer<float> rightBuffer;		
 		bool leftDataReady;
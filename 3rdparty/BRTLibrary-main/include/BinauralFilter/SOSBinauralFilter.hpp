@@ -205,7 +205,8 @@ namespace BRTBinauralFilter {
 
 			CMonoBuffer<float> outLeftBuffer;
 			CMonoBuffer<float> outRightBuffer;
-			if (leftBuffer.size() == 0 || rightBuffer.size() == 0) return;
+			MixEarBuffers();
+			if (!leftDataReady || !rightDataReady) return;
 			
 			binauralFilter.Process(leftBuffer, rightBuffer, outLeftBuffer, outRightBuffer);			
 
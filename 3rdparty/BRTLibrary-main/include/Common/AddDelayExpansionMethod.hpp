@@ -40,7 +40,7 @@ namespace Common {
 		 * @param delayBuffer buffer containing the information of the last frame. This buffer will also be updated.
 		 * @param newDelay Delay to be applied
 		*/
-		static void ProcessAddDelay_ExpansionMethod(CMonoBuffer<float>& input, CMonoBuffer<float>& output, CMonoBuffer<float>& delayBuffer, int newDelay)
+		static void ProcessAddDelay_ExpansionMethod(const CMonoBuffer<float>& input, CMonoBuffer<float>& output, CMonoBuffer<float>& delayBuffer, int newDelay)
 		{
 			//Prepare the outbuffer		
 			if (output.size() != input.size()) { output.resize(input.size()); }
@@ -102,20 +102,17 @@ namespace Common {
 				//if newDelay!=0 fill out the delay buffer
 				else
 				{
-					//Fill delay buffer 			
-					CMonoBuffer<float> temp;
-					temp.reserve(newDelay);
+					//Fill delay buffer, in place as its previous samples have all been output. It only allocates if it has no room for the new delay.
+					delayBuffer.resize(newDelay);
 					for (int i = 0; i < newDelay - 1; i++)
 					{
 						int j = int(position);
 						float rest = position - j;
-						temp.push_back(input[j] * (1 - rest) + input[j + 1] * rest);
+						delayBuffer[i] = input[j] * (1 - rest) + input[j + 1] * rest;
 						position += compressionFactor;
 					}
 					//Last element of the delay buffer that must be addressed in a special way
-					temp.push_back(input[input.size() - 1]);
-					//delayBuffer.swap(temp);				//To use in C++03
-					delayBuffer = std::move(temp);			//To use in C++11
+					delayBuffer[newDelay - 1] = input[input.size() - 1];
 				}
 			}
 		}
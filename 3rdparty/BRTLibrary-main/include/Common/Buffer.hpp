@@ -210,11 +210,11 @@ namespace Common {
 		/** \brief Fill nToFill samples of the buffer with the same value
 		*	\param [in] nToFill number of samples to fill
 		*	\param [in] value value to fill with
-		*   \eh On success, RESULT_OK is reported to the error handler.
+		*   \eh Nothing is reported to the error handler.
 		*/
 		void Fill(size_t nToFill, stored value)
 		{
-			SET_RESULT(RESULT_OK, "Buffer filled with single value succesfully");
+			//SET_RESULT(RESULT_OK, "Buffer filled with single value succesfully");
 			// Assign is the fastest implementation, after memset. See: http://stackoverflow.com/questions/8848575/fastest-way-to-reset-every-value-of-stdvectorint-to-0
 			this->assign(nToFill, value);
 		}
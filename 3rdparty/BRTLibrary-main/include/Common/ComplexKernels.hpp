@@ -0,0 +1,243 @@
+/**
+* \class CComplexKernels
+*
+* \brief Declaration of CComplexKernels class
+* \date	June 2023
+*
+* \authors 3DI-DIANA Research Group (University of Malaga), in alphabetical order: M. Cuevas-Rodriguez, D. Gonzalez-Toledo, L. Molina-Tanco, F. Morales-Benitez ||
+* Coordinated by , A. Reyes-Lecuona (University of Malaga)||
+* \b Contact: areyes@uma.es
+*
+* \b Copyright: University of Malaga
+*
+* \b Contributions: (additional authors/contributors can be added here)
+*
+* \b Project: SONICOM ||
+* \b Website: https://www.sonicom.eu/
+*
+* \b Acknowledgement: This project has received funding from the European Union's Horizon 2020 research and innovation programme under grant agreement no.101017743
+*
+* \b Licence: This program is free software, you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+*/
+
+#ifndef _COMPLEX_KERNELS_HPP_
+#define _COMPLEX_KERNELS_HPP_
+
+#include <cstddef>
+
+// Define BRT_DISABLE_SIMD to build only the portable kernels
+#if !defined(BRT_DISABLE_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+	#define BRT_SIMD_X86
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		#define BRT_TARGET(_isa)
+	#else
+		#define BRT_TARGET(_isa) __attribute__((target(_isa)))
+	#endif
+#elif !defined(BRT_DISABLE_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+	#define BRT_SIMD_NEON
+	#include <arm_neon.h>
+#endif
+
+namespace Common {
+
+	/** \details Frequency-domain kernels used by the partitioned convolvers, on buffers with real and imaginary parts interlaced
+	*	(x[2i] = Re[Xi], x[2i+1] = Img[Xi]) as produced by CFFTCalculator.
+	*	The fastest implementation the CPU supports (AVX-512, AVX2 with FMA, SSE2 or NEON) is chosen the first time a kernel is used.
+	*	Every implementation gives the same result as the scalar one, up to the rounding of fused multiply-adds: the difference
+	*	stays within a few units in the last place of the largest term summed, not of the result, which may cancel.
+	*/
+	class CComplexKernels {
+	public:
+		/** \brief Instruction sets the kernels can be run with
+		*/
+		enum class TInstructionSet { Scalar, SSE2, AVX2, AVX512, NEON };
+
+		typedef void (*TMultiplyAccumulate)(const float*, const float*, float*, std::size_t);
+
+		/** \brief Complex multiplication of x and h, added to y: y[i] += x[i] * h[i]
+		*	\param [in] x first factor
+		*	\param [in] h second factor
+		*	\param [in,out] y accumulator, may not alias x or h
+		*	\param [in] complexCount number of complex numbers in each buffer (half the number of floats)
+		*   \eh Nothing is reported to the error handler.
+		*/
+		static void MultiplyAccumulate(const float* x, const float* h, float* y, std::size_t complexCount) {
+			GetMultiplyAccumulate()(x, h, y, complexCount);
+		}
+
+		/** \brief Portable implementation of MultiplyAccumulate, used as reference
+		*/
+		static void MultiplyAccumulateScalar(const float* x, const float* h, float* y, std::size_t complexCount) {
+			for (std::size_t i = 0; i < complexCount; i++) {
+				float a = x[2 * i];
+				float b = x[2 * i + 1];
+				float c = h[2 * i];
+				float d = h[2 * i + 1];
+
+				y[2 * i] += a * c - b * d;
+				y[2 * i + 1] += a * d + b * c;
+			}
+		}
+
+		/** \brief Get the implementation of MultiplyAccumulate for the given instruction set, e.g. to compare it with the scalar one
+		*	\retval nullptr if this CPU or build can not run it
+		*/
+		static TMultiplyAccumulate GetMultiplyAccumulate(TInstructionSet _instructionSet) {
+			if (!IsSupported(_instructionSet)) {
+				return nullptr;
+			}
+			return SelectMultiplyAccumulate(_instructionSet);
+		}
+
+		/** \brief Get the instruction set the kernels run with on this CPU
+		*/
+		static TInstructionSet GetInstructionSet() {
+			static const TInstructionSet instructionSet = DetectInstructionSet();
+			return instructionSet;
+		}
+
+		/** \brief Get the name of the instruction set the kernels run with on this CPU
+		*/
+		static const char* GetInstructionSetName() {
+			switch (GetInstructionSet()) {
+				case TInstructionSet::SSE2: return "SSE2";
+				case TInstructionSet::AVX2: return "AVX2";
+				case TInstructionSet::AVX512: return "AVX-512";
+				case TInstructionSet::NEON: return "NEON";
+				default: return "scalar";
+			}
+		}
+
+	private:
+		static TMultiplyAccumulate GetMultiplyAccumulate() {
+			static const TMultiplyAccumulate kernel = SelectMultiplyAccumulate(GetInstructionSet());
+			return kernel;
+		}
+
+		static bool IsSupported(TInstructionSet _instructionSet) {
+			if (_instructionSet == TInstructionSet::Scalar) {
+				return true;
+			}
+#if defined(BRT_SIMD_X86)
+			// Every x86 instruction set includes the ones listed before it
+			return _instructionSet != TInstructionSet::NEON && static_cast<int>(_instructionSet) <= static_cast<int>(GetInstructionSet());
+#elif defined(BRT_SIMD_NEON)
+			return _instructionSet == TInstructionSet::NEON;
+#else
+			return false;
+#endif
+		}
+
+		static TMultiplyAccumulate SelectMultiplyAccumulate(TInstructionSet _instructionSet) {
+			switch (_instructionSet) {
+#if defined(BRT_SIMD_X86)
+				case TInstructionSet::AVX512: return MultiplyAccumulateAVX512;
+				case TInstructionSet::AVX2: return MultiplyAccumulateAVX2;
+				case TInstructionSet::SSE2: return MultiplyAccumulateSSE2;
+#elif defined(BRT_SIMD_NEON)
+				case TInstructionSet::NEON: return MultiplyAccumulateNEON;
+#endif
+				default: return MultiplyAccumulateScalar;
+			}
+		}
+
+#if defined(BRT_SIMD_X86)
+		static TInstructionSet DetectInstructionSet() {
+	#if defined(_MSC_VER) && !defined(__clang__)
+			int info[4];
+			__cpuid(info, 0);
+			const int maxLeaf = info[0];
+			__cpuid(info, 1);
+			const bool sse2 = (info[3] & (1 << 26)) != 0;
+			const bool fma = (info[2] & (1 << 12)) != 0;
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx2 = false, avx512 = false;
+			if (osxsave && maxLeaf >= 7) {
+				// The OS must save the YMM (and ZMM) registers on context switches
+				const unsigned long long xcr0 = _xgetbv(0);
+				__cpuidex(info, 7, 0);
+				avx2 = fma && (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+				avx512 = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+			}
+	#else
+			__builtin_cpu_init();
+			const bool sse2 = __builtin_cpu_supports("sse2");
+			const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+			const bool avx512 = __builtin_cpu_supports("avx512f");
+	#endif
+			if (avx512) { return TInstructionSet::AVX512; }
+			if (avx2) { return TInstructionSet::AVX2; }
+			if (sse2) { return TInstructionSet::SSE2; }
+			return TInstructionSet::Scalar;
+		}
+
+		BRT_TARGET("sse2")
+		static void MultiplyAccumulateSSE2(const float* x, const float* h, float* y, std::size_t complexCount) {
+			const __m128 sign = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+			std::size_t i = 0;
+			for (; i + 2 <= complexCount; i += 2) {
+				__m128 a = _mm_loadu_ps(x + 2 * i);
+				__m128 b = _mm_loadu_ps(h + 2 * i);
+				__m128 bRe = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0));
+				__m128 bIm = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1));
+				__m128 aSwapped = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+				__m128 product = _mm_add_ps(_mm_mul_ps(a, bRe), _mm_mul_ps(_mm_mul_ps(aSwapped, bIm), sign));
+				_mm_storeu_ps(y + 2 * i, _mm_add_ps(_mm_loadu_ps(y + 2 * i), product));
+			}
+			MultiplyAccumulateScalar(x + 2 * i, h + 2 * i, y + 2 * i, complexCount - i);
+		}
+
+		BRT_TARGET("avx2,fma")
+		static void MultiplyAccumulateAVX2(const float* x, const float* h, float* y, std::size_t complexCount) {
+			std::size_t i = 0;
+			for (; i + 4 <= complexCount; i += 4) {
+				__m256 a = _mm256_loadu_ps(x + 2 * i);
+				__m256 b = _mm256_loadu_ps(h + 2 * i);
+				__m256 aSwapped = _mm256_permute_ps(a, 0xB1);
+				__m256 crossTerms = _mm256_mul_ps(aSwapped, _mm256_movehdup_ps(b));
+				// Even lanes: Re(a)Re(b) - Im(a)Im(b), odd lanes: Im(a)Re(b) + Re(a)Im(b)
+				__m256 product = _mm256_fmaddsub_ps(a, _mm256_moveldup_ps(b), crossTerms);
+				_mm256_storeu_ps(y + 2 * i, _mm256_add_ps(_mm256_loadu_ps(y + 2 * i), product));
+			}
+			MultiplyAccumulateScalar(x + 2 * i, h + 2 * i, y + 2 * i, complexCount - i);
+		}
+
+		BRT_TARGET("avx512f")
+		static void MultiplyAccumulateAVX512(const float* x, const float* h, float* y, std::size_t complexCount) {
+			std::size_t i = 0;
+			for (; i + 8 <= complexCount; i += 8) {
+				__m512 a = _mm512_loadu_ps(x + 2 * i);
+				__m512 b = _mm512_loadu_ps(h + 2 * i);
+				__m512 aSwapped = _mm512_permute_ps(a, 0xB1);
+				__m512 crossTerms = _mm512_mul_ps(aSwapped, _mm512_movehdup_ps(b));
+				__m512 product = _mm512_fmaddsub_ps(a, _mm512_moveldup_ps(b), crossTerms);
+				_mm512_storeu_ps(y + 2 * i, _mm512_add_ps(_mm512_loadu_ps(y + 2 * i), product));
+			}
+			MultiplyAccumulateScalar(x + 2 * i, h + 2 * i, y + 2 * i, complexCount - i);
+		}
+#elif defined(BRT_SIMD_NEON)
+		static TInstructionSet DetectInstructionSet() { return TInstructionSet::NEON; }
+
+		static void MultiplyAccumulateNEON(const float* x, const float* h, float* y, std::size_t complexCount) {
+			std::size_t i = 0;
+			for (; i + 4 <= complexCount; i += 4) {
+				// Load with deinterlacing, val[0] holds the real parts and val[1] the imaginary ones
+				float32x4x2_t a = vld2q_f32(x + 2 * i);
+				float32x4x2_t b = vld2q_f32(h + 2 * i);
+				float32x4x2_t sum = vld2q_f32(y + 2 * i);
+				sum.val[0] = vmlaq_f32(sum.val[0], a.val[0], b.val[0]);
+				sum.val[0] = vmlsq_f32(sum.val[0], a.val[1], b.val[1]);
+				sum.val[1] = vmlaq_f32(sum.val[1], a.val[0], b.val[1]);
+				sum.val[1] = vmlaq_f32(sum.val[1], a.val[1], b.val[0]);
+				vst2q_f32(y + 2 * i, sum);
+			}
+			MultiplyAccumulateScalar(x + 2 * i, h + 2 * i, y + 2 * i, complexCount - i);
+		}
+#else
+		static TInstructionSet DetectInstructionSet() { return TInstructionSet::Scalar; }
+#endif
+	};
+}
+#endif
@@ -0,0 +1,141 @@
+/**
+* \class CEpochProtectedPtr
+*
+* \brief Declaration of CEpochProtectedPtr class
+* \date	June 2023
+*
+* \authors 3DI-DIANA Research Group (University of Malaga), in alphabetical order: M. Cuevas-Rodriguez, D. Gonzalez-Toledo, L. Molina-Tanco, F. Morales-Benitez ||
+* Coordinated by , A. Reyes-Lecuona (University of Malaga)||
+* \b Contact: areyes@uma.es
+*
+* \b Copyright: University of Malaga
+*
+* \b Contributions: (additional authors/contributors can be added here)
+*
+* \b Project: SONICOM ||
+* \b Website: https://www.sonicom.eu/
+*
+* \b Acknowledgement: This project has received funding from the European Union's Horizon 2020 research and innovation programme under grant agreement no.101017743
+*
+* \b Licence: This program is free software, you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+*/
+
+#ifndef _EPOCH_PROTECTED_PTR_HPP_
+#define _EPOCH_PROTECTED_PTR_HPP_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Common {
+
+	/** \details Owning pointer to immutable data that is read from the audio thread and replaced from a control thread.
+	*	Readers never block nor allocate: they register in the current epoch, read the pointer and leave.
+	*	Writers publish a new object and wait, outside of the audio thread, until every reader that could still
+	*	see the previous object has left before deleting it (read-copy-update with two epochs).
+	*	\warning A thread must not publish while it holds a read lock on the same object.
+	*/
+	template <typename T>
+	class CEpochProtectedPtr {
+	public:
+
+		/** \brief RAII read section. The pointer returned by Get() is valid while the guard is alive.
+		*/
+		class CReadGuard {
+		public:
+			CReadGuard(const CEpochProtectedPtr<T>& _owner) : owner{ _owner }, token{ _owner.ReadLock() } {}
+			~CReadGuard() { owner.ReadUnlock(token); }
+
+			CReadGuard(const CReadGuard&) = delete;
+			CReadGuard& operator=(const CReadGuard&) = delete;
+
+			const T* Get() const { return owner.Get(); }
+
+		private:
+			const CEpochProtectedPtr<T>& owner;
+			int token;
+		};
+
+		CEpochProtectedPtr() : current{ nullptr }, epoch{ 0 } {
+			readers[0].store(0);
+			readers[1].store(0);
+		}
+
+		~CEpochProtectedPtr() {
+			delete current.load();
+		}
+
+		CEpochProtectedPtr(const CEpochProtectedPtr&) = delete;
+		CEpochProtectedPtr& operator=(const CEpochProtectedPtr&) = delete;
+
+		/** \brief Enter a read section
+		*	\retval token value to be passed to ReadUnlock
+		*   \eh Nothing is reported to the error handler.
+		*/
+		int ReadLock() const {
+			while (true) {
+				unsigned int e = epoch.load();
+				int token = static_cast<int>(e & 1u);
+				readers[token].fetch_add(1);
+				if (epoch.load() == e) { return token; }
+				// The writer flipped the epoch in between, register again in the new one
+				readers[token].fetch_sub(1);
+			}
+		}
+
+		/** \brief Leave a read section
+		*	\param [in] _token value returned by ReadLock
+		*   \eh Nothing is reported to the error handler.
+		*/
+		void ReadUnlock(int _token) const {
+			readers[_token].fetch_sub(1, std::memory_order_release);
+		}
+
+		/** \brief Get the current object. Must be called inside a read section.
+		*	\retval data pointer to the current object, may be null
+		*   \eh Nothing is reported to the error handler.
+		*/
+		const T* Get() const {
+			return current.load(std::memory_order_acquire);
+		}
+
+		/** \brief Replace the current object and delete the previous one once no reader can see it
+		*	\param [in] _newData new object, may be null
+		*   \eh Nothing is reported to the error handler.
+		*/
+		void Publish(std::unique_ptr<T> _newData) {
+			std::lock_guard<std::mutex> l(writerMutex);
+			T* oldData = current.exchange(_newData.release());
+			if (oldData == nullptr) return;
+			Synchronize();
+			delete oldData;
+		}
+
+		/** \brief Remove the current object
+		*   \eh Nothing is reported to the error handler.
+		*/
+		void Reset() {
+			Publish(nullptr);
+		}
+
+	private:
+
+		/** \brief Wait until all the readers registered before the last exchange have left
+		*/
+		void Synchronize() {
+			for (int i = 0; i < 2; i++) {
+				unsigned int e = epoch.fetch_add(1);
+				while (readers[e & 1u].load(std::memory_order_acquire) != 0) {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		std::atomic<T*> current;						// Object seen by new readers
+		std::atomic<unsigned int> epoch;				// Parity selects the reader counter
+		mutable std::atomic<int> readers[2];			// Readers registered in each epoch parity
+		std::mutex writerMutex;							// Serialises writers
+	};
+}
+#endif
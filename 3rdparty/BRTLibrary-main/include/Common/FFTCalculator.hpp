@@ -27,6 +27,7 @@
 
 //#include "Buffer.h"
 //#include <math.h>
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <cmath>
@@ -46,6 +47,17 @@ namespace Common {
 
 	public:
 
+		/** \brief Scratch memory and tables of the Takuya OOURA library for transforms of one size
+		*	\details The transforms taking one reuse it from call to call. A convolver keeping one transforms block after block without
+		*	allocating, and the tables are only computed by its first transform.
+		*/
+		struct TFFTWorkspace {
+			int FFTBufferSize = 0;			// Size it has been prepared for, 0 if none
+			std::vector<int> ip;			// Work area for bit reversal
+			std::vector<double> w;			// Cos/sin table
+			std::vector<double> data;		// Transformed in place
+		};
+
 		/** \brief Default constructor
 		*/
 		CFFTCalculator() : inputSize{ 0 }, IRSize{ 0 }, FFTBufferSize{ 0 }, setupDone{ false }, ip_size {0}, normalizeCoef{0}, w_size{0}
@@ -58,6 +70,17 @@ namespace Common {
 		*	\param [out] outputAudioBuffer_frequency FFT of the input signal. Have a size of B * 2, because contains the real and imaginary parts of each B point.
 		*/
 		static void CalculateFFT(const std::vector<float>& inputAudioBuffer_time, std::vector<float>& outputAudioBuffer_frequency)		
+		{
+			TFFTWorkspace workspace;
+			CalculateFFT(inputAudioBuffer_time, outputAudioBuffer_frequency, workspace);
+		}
+
+		/** \brief Calculate the FFT of B points the input signal, like CalculateFFT(), with the scratch memory and tables of the given workspace
+		*	\param [in] inputAudioBuffer_time vector containing the samples of input signal in time-domain. N is this buffer size.
+		*	\param [out] outputAudioBuffer_frequency FFT of the input signal. Nothing is allocated if it has the size of B * 2 already.
+		*	\param [in,out] workspace workspace, nothing is allocated if it has been prepared for B * 2
+		*/
+		static void CalculateFFT(const std::vector<float>& inputAudioBuffer_time, std::vector<float>& outputAudioBuffer_frequency, TFFTWorkspace& workspace)
 		{
 			int inputBufferSize = inputAudioBuffer_time.size();
 
@@ -74,30 +97,22 @@ namespace Common {
 					FFTBufferSize = CalculateNextPowerOfTwo(FFTBufferSize);
 				}
 				FFTBufferSize *= 2;							//We multiplicate by 2 because we need to store real and imaginary part
-
-				///////////////////////////////////////////////////////////////////////////////
-				// Calculate auxiliary arrays size, necessary to use the Takuya OOURA library
-				///////////////////////////////////////////////////////////////////////////////
-				int ip_size = std::sqrt(FFTBufferSize / 2) + 2;		//Size of the auxiliary array w. This come from lib documentation/examples.
-				int w_size = FFTBufferSize * 5 / 4;					//Size of the auxiliary array w. This come from lib documentation/examples.
-				std::vector<int> ip(ip_size);						//Define the auxiliary array ip 
-				std::vector<double> w(w_size);						//Define the auxiliary array w			
-				ip[0] = 0;											//w[],ip[] are initialized if ip[0] == 0.
+				PrepareWorkspace(workspace, FFTBufferSize);
 
 				//////////////
 				// Make FFT //
 				//////////////			
-				std::vector<double> inputAudioBuffer_frequency(FFTBufferSize, 0.0f);			//Initialize the vector of doubles to store the FFT					
-				ProcessAddImaginaryPart(inputAudioBuffer_time, inputAudioBuffer_frequency);			//Copy the input vector into an vector of doubles and insert the imaginary part.											
-				cdft(FFTBufferSize, 1, inputAudioBuffer_frequency.data(), ip.data(), w.data());	//Make the FFT
+				std::fill(workspace.data.begin(), workspace.data.end(), 0.0);										//Zero padding and imaginary part
+				ProcessAddImaginaryPart(inputAudioBuffer_time, workspace.data);										//Copy the input vector into the vector of doubles
+				cdft(FFTBufferSize, 1, workspace.data.data(), workspace.ip.data(), workspace.w.data());				//Make the FFT
 
 				////////////////////
 				// Prepare Output //
 				////////////////////	
 				//Copy to the output float vector			
 				if (outputAudioBuffer_frequency.size() != FFTBufferSize) { outputAudioBuffer_frequency.resize(FFTBufferSize); }
-				for (int i = 0; i < inputAudioBuffer_frequency.size(); i++) {
-					outputAudioBuffer_frequency[i] = static_cast<float>(inputAudioBuffer_frequency[i]);
+				for (int i = 0; i < FFTBufferSize; i++) {
+					outputAudioBuffer_frequency[i] = static_cast<float>(workspace.data[i]);
 				}
 			}
 		}
@@ -161,6 +176,17 @@ namespace Common {
 		*   \throws May throw exceptions and errors to debugger
 		*/
 		static void CalculateIFFT(const std::vector<float>& inputAudioBuffer_frequency, std::vector<float>& outputAudioBuffer_time)		       
+		{
+			TFFTWorkspace workspace;
+			CalculateIFFT(inputAudioBuffer_frequency, outputAudioBuffer_time, workspace);
+		}
+
+		/** \brief Get the IFFT of K points of the input signal buffer, like CalculateIFFT(), with the scratch memory and tables of the given workspace
+		*   \param [in] inputAudioBuffer_frequency Vector of samples storing the output signal in frecuency domain. This buffers has to be size of K
+		*   \param [out] outputAudioBuffer_time IFFT of the input, nothing is allocated if it has the size of K/2 already.
+		*	\param [in,out] workspace workspace, nothing is allocated if it has been prepared for K
+		*/
+		static void CalculateIFFT(const std::vector<float>& inputAudioBuffer_frequency, std::vector<float>& outputAudioBuffer_time, TFFTWorkspace& workspace)
 		{
 			int inputBufferSize = inputAudioBuffer_frequency.size();
 			ASSERT(inputBufferSize > 0, RESULT_ERROR_BADSIZE, "Bad input size", "");
@@ -171,21 +197,13 @@ namespace Common {
 				// Calculate output size	//
 				//////////////////////////////
 				int FFTBufferSize = inputBufferSize;
-
-				///////////////////////////////////////////////////////////////////////////////
-				// Calculate auxiliary arrays size, necessary to use the Takuya OOURA library
-				///////////////////////////////////////////////////////////////////////////////
-				int ip_size = std::sqrt(FFTBufferSize / 2) + 2;		//Size of the auxiliary array w. This come from lib documentation/examples.
-				int w_size = FFTBufferSize * 5 / 4;					//Size of the auxiliary array w. This come from lib documentation/examples.																				
-				std::vector<int> ip(ip_size);						//Define the auxiliary array ip 
-				std::vector<double> w(w_size);						//Define the auxiliary array w			
-				ip[0] = 0;											//w[],ip[] are initialized if ip[0] == 0.
+				PrepareWorkspace(workspace, FFTBufferSize);
 
 				///////////////
 				// Make IFFT //
 				///////////////																
-				std::vector<double> outBuffer_temp(inputAudioBuffer_frequency.begin(), inputAudioBuffer_frequency.end());	//Convert to double
-				cdft(FFTBufferSize, -1, outBuffer_temp.data(), ip.data(), w.data());										//Make the IFFT
+				std::copy(inputAudioBuffer_frequency.begin(), inputAudioBuffer_frequency.end(), workspace.data.begin());	//Convert to double
+				cdft(FFTBufferSize, -1, workspace.data.data(), workspace.ip.data(), workspace.w.data());					//Make the IFFT
 
 				////////////////////
 				// Prepare Output //
@@ -195,11 +213,30 @@ namespace Common {
 				float normalizeCoef = 2.0f / FFTBufferSize;			//Store the normalize coef for the FFT-1	
 				//Fill out the output signal buffer
 				for (int i = 0; i < outBufferSize; i++) {
-					outputAudioBuffer_time[i] = static_cast<float>(CalculateRoundToZero(outBuffer_temp[2 * i] * normalizeCoef));
+					outputAudioBuffer_time[i] = static_cast<float>(CalculateRoundToZero(workspace.data[2 * i] * normalizeCoef));
 				}
 			}
 		}
 
+		/** \brief Prepare a workspace for transforms of the given size. Nothing is done if it has been prepared for it already.
+		*	\param [in,out] workspace workspace to prepare
+		*	\param [in] FFTBufferSize size of the transforms, real and imaginary parts interlaced
+		*/
+		static void PrepareWorkspace(TFFTWorkspace& workspace, int FFTBufferSize)
+		{
+			if (workspace.FFTBufferSize == FFTBufferSize) { return; }
+
+			///////////////////////////////////////////////////////////////////////////////
+			// Calculate auxiliary arrays size, necessary to use the Takuya OOURA library
+			///////////////////////////////////////////////////////////////////////////////
+			int ip_size = std::sqrt(FFTBufferSize / 2) + 2;		//Size of the auxiliary array w. This come from lib documentation/examples.
+			int w_size = FFTBufferSize * 5 / 4;					//Size of the auxiliary array w. This come from lib documentation/examples.
+			workspace.ip.assign(ip_size, 0);					//w[],ip[] are initialized by the first transform, as ip[0] == 0
+			workspace.w.assign(w_size, 0.0);
+			workspace.data.assign(FFTBufferSize, 0.0);
+			workspace.FFTBufferSize = FFTBufferSize;
+		}
+
 		/** \brief Process complex multiplication between the elements of two vectors.
 		*   \details This method makes the complex multiplication of vector samples: (a+bi)(c+di) = (ac-bd)+i(ad+bc)
 		*   \param [in] x Vector of samples that has real and imaginary parts interlaced. x[i] = Re[Xj], x[i+1] = Img[Xj]
@@ -58,12 +58,12 @@ namespace BRTConnectivity {
          * For example, if its multiplicity is two, this method will be called when the second of the data is received.         
          * @param entryPointID 
         */
-        virtual void OneEntryPointAllDataReady(std::string entryPointID) {};
+        virtual void OneEntryPointAllDataReady(const std::string& entryPointID) {};
         /**
          * @brief This method shall be called whenever data is received at an entry point, with non-zero multiplicity. 
          * @param entryPointID 
         */
-        virtual void OneEntryPointOneDataReceived(std::string entryPointID) {};                      
+        virtual void OneEntryPointOneDataReceived(const std::string& entryPointID) {};                      
                 
        
     private:                                                 
@@ -73,8 +73,8 @@ namespace BRTConnectivity {
          * @brief In this method, notification is received that new data has been received at any entry point with multiplicity greater than zero.
          * @param entryPointID 
         */
-        void UpdateEntryPointData(std::string entryPointID) override {                        
-            UpdateEntryPointWaitingList(entryPointID);                
+        void UpdateEntryPointData(const std::string& entryPointID, int _port) override {                        
+            UpdateEntryPointWaitingList(entryPointID, _port);                
         }
 
         /**
@@ -82,10 +82,14 @@ namespace BRTConnectivity {
          * @param _id  EntryPoint ID
          * @param _multiplicity EntryPoint multiplicity
         */
-        void EntryPointCreated(std::string _entryPointID, bool _notify) override {
+        void EntryPointCreated(std::string _entryPointID, bool _notify, int _port) override {
             if (_notify) {
                 CDataWaitingEntryPoint temp(_entryPointID);
                 entryPointsWaitingList.push_back(temp);
+                if (_port >= 0) {
+                    if (static_cast<int>(waitingListIndices.size()) <= _port) { waitingListIndices.resize(_port + 1, -1); }
+                    waitingListIndices[_port] = static_cast<int>(entryPointsWaitingList.size()) - 1;
+                }
             }
         }
         
@@ -101,6 +105,9 @@ namespace BRTConnectivity {
             });
             if (it != entryPointsWaitingList.end()) {
                 it->connections = _numberOfConnections;
+                // Data received while connecting (attach sends the current data) must not count towards the next block
+                it->timesReceived = 0;
+                it->received = false;
             }
         };
                 
@@ -110,11 +117,17 @@ namespace BRTConnectivity {
 		 * @brief Update the waiting list of entry points
 		 * @param _entryPointID 
 		*/
-        void UpdateEntryPointWaitingList(std::string _entryPointID) {
-            std::vector<CDataWaitingEntryPoint>::iterator it;
-            it = std::find_if(entryPointsWaitingList.begin(), entryPointsWaitingList.end(), [&_entryPointID](CDataWaitingEntryPoint const& obj) {
-                return obj.id == _entryPointID;
-            });
+        void UpdateEntryPointWaitingList(const std::string& _entryPointID, int _port) {
+            // The entry is found through the port of the entry point, IDs are only compared for entry points created without one
+            std::vector<CDataWaitingEntryPoint>::iterator it = entryPointsWaitingList.end();
+            if (_port >= 0 && _port < static_cast<int>(waitingListIndices.size()) && waitingListIndices[_port] >= 0) {
+                it = entryPointsWaitingList.begin() + waitingListIndices[_port];
+            }
+            else {
+                it = std::find_if(entryPointsWaitingList.begin(), entryPointsWaitingList.end(), [&_entryPointID](CDataWaitingEntryPoint const& obj) {
+                    return obj.id == _entryPointID;
+                });
+            }
 
             if (it != entryPointsWaitingList.end()) {                                               
                 
@@ -163,6 +176,7 @@ namespace BRTConnectivity {
 		
         // Attributes
 		std::vector<CDataWaitingEntryPoint> entryPointsWaitingList;    
+        std::vector<int> waitingListIndices;        // Index in entryPointsWaitingList of each port, -1 if it does not notify
 
     };
 }
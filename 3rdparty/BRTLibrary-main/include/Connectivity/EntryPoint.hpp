@@ -23,7 +23,10 @@
 #ifndef _ENTRY_POINT_
 #define _ENTRY_POINT_
 
+#include <algorithm>
 #include <functional>
+#include <mutex>
+#include <vector>
 #include <Connectivity/ExitPoint.hpp>
 #include <Connectivity/ObserverBase.hpp>
 #include <Common/Buffer.hpp>
@@ -37,41 +40,127 @@ namespace BRTConnectivity {
     template <class T>
     class CEntryPointBase : public Observer {
     public:
-        CEntryPointBase(std::function<void(std::string)> _callBack, std::string _id, bool _notify) : callBackUpdate{ _callBack }, id{ _id }, notify{ _notify }, connections{ 0 } {}
+        /**
+         * @param _callBack Called with the ID and the port of this entry point when data is received, if _notify is true
+         * @param _id Entry point ID
+         * @param _notify Whether the owner module is told when data is received
+         * @param _moduleMutex Mutex of the module owning this entry point, may be null
+         * @param _port Index of this entry point among all those of its module, handed back through _callBack
+        */
+        CEntryPointBase(std::function<void(const std::string&, int)> _callBack, std::string _id, bool _notify, std::recursive_mutex* _moduleMutex = nullptr, int _port = -1) : callBackUpdate{ _callBack }, id{ _id }, notify{ _notify }, connections{ 0 }, moduleMutex{ _moduleMutex }, port{ _port }, lastSender{ -1 } {}
         ~CEntryPointBase() {}
 
         void Update(Subject* subject) {
-            CExitPointBase<T>* _subject = (static_cast<CExitPointBase<T>*>(subject));
-            Update(_subject);
+            Update(subject, -1);
         };
 
-        void Update(CExitPointBase<T>* subject)
+        void Update(Subject* subject, int _slot) override {
+            Update(static_cast<CExitPointBase<T>*>(subject), _slot);
+        }
+
+        /**
+         * @brief Receive data from an exit point
+         * @param subject Exit point sending the data
+         * @param _slot Index of the exit point in the connections of this entry point, or -1 if it is not connected through AddConnection(_exitPoint).
+         * Connected exit points are not copied from, their data is read in place until they send again or are disconnected.
+        */
+        void Update(CExitPointBase<T>* subject, int _slot)
         {
-            this->SetData(subject->GetData());
-            if (notify) { callBackUpdate(this->GetID()); }
+            // Sources may be rendered from several threads, so the data and the notification
+            // to the owner module must be handled as one step for modules where several chains converge
+            std::unique_lock<std::recursive_mutex> l;
+            if (moduleMutex != nullptr) { l = std::unique_lock<std::recursive_mutex>(*moduleMutex); }
+            if (_slot >= 0 && _slot < static_cast<int>(connectedExitPoints.size()) && connectedExitPoints[_slot] == subject) {
+                receivedFrom[_slot] = true;
+                lastSender = _slot;
+            }
+            else {
+                this->SetData(subject->GetDataRef());
+            }
+            if (notify) { callBackUpdate(id, port); }
         }
         
         int AddConnection() { 
             connections++; 
             return connections;
         }
+        /**
+         * @brief Count a new connection and remember the exit point, see ForEachReceivedData
+         * @param _exitPoint Exit point this entry point has just been attached to
+         * @return New number of connections
+        */
+        int AddConnection(CExitPointBase<T>* _exitPoint) {
+            connectedExitPoints.push_back(_exitPoint);
+            receivedFrom.push_back(false);
+            _exitPoint->SetObserverSlot(this, static_cast<int>(connectedExitPoints.size()) - 1);
+            return AddConnection();
+        }
         int RemoveConnection() { 
             if (connections > 0) { connections--; }
             return connections;
         }
+        /**
+         * @brief Count a connection less and forget the exit point
+         * @param _exitPoint Exit point this entry point has just been detached from
+         * @return New number of connections
+        */
+        int RemoveConnection(CExitPointBase<T>* _exitPoint) {
+            auto it = std::find(connectedExitPoints.begin(), connectedExitPoints.end(), _exitPoint);
+            if (it != connectedExitPoints.end()) {
+                const int removed = static_cast<int>(it - connectedExitPoints.begin());
+                // Keep the last data received, it is no longer readable in place
+                if (lastSender == removed) { data = _exitPoint->GetDataRef(); }
+                lastSender = (lastSender == removed) ? -1 : (lastSender > removed ? lastSender - 1 : lastSender);
+                receivedFrom.erase(receivedFrom.begin() + removed);
+                connectedExitPoints.erase(it);
+                // The exit points after the removed one have moved down one slot
+                for (std::size_t i = removed; i < connectedExitPoints.size(); i++) {
+                    connectedExitPoints[i]->SetObserverSlot(this, static_cast<int>(i));
+                }
+            }
+            return RemoveConnection();
+        }
+
+        /**
+         * @brief Call _function with the data of every exit point that has sent some since the last call, in the order the connections were made.
+         * Where several chains converge, mixing this way gives the same result whatever order they have been processed in.
+         * Must not run while data can still arrive, so call it from the notification callback of the owning module or once the whole frame has been processed.
+         * @param _function Callable with signature void(const T&)
+        */
+        template <typename F>
+        void ForEachReceivedData(F&& _function) {
+            for (std::size_t i = 0; i < connectedExitPoints.size(); i++) {
+                if (!receivedFrom[i]) { continue; }
+                receivedFrom[i] = false;
+                _function(connectedExitPoints[i]->GetDataRef());
+            }
+        }
         int GetConnections() { return connections; }
         
         std::string GetID() { return id; };
+        /**
+         * @brief Get the index of this entry point among all those of its module
+        */
+        int GetPort() const { return port; }
 
-        void SetData(const T& _data) { data = _data; }
-        T GetData() { return data; }
+        void SetData(const T& _data) { data = _data; lastSender = -1; }
+        T GetData() { return GetDataRef(); }
+        /**
+         * @brief Get the data last received without copying it. The reference is valid until the next data is received.
+        */
+        const T& GetDataRef() const { return lastSender >= 0 ? connectedExitPoints[lastSender]->GetDataRef() : data; }
 
     private:
         // Vars
-        std::function<void(std::string)> callBackUpdate;
+        std::function<void(const std::string&, int)> callBackUpdate;
         std::string id;
         int connections;          
         bool notify;
+        std::recursive_mutex* moduleMutex;      // Mutex of the module owning this entry point, may be null
+        int port;                               // Index of this entry point in its module
+        std::vector<CExitPointBase<T>*> connectedExitPoints;   // Exit points attached through AddConnection(_exitPoint), in connection order
+        std::vector<bool> receivedFrom;                     // Whether each of them has sent data since the last ForEachReceivedData
+        int lastSender;                                     // Connected exit point holding the current data, or -1 if it is in data
         
         T data;
     };
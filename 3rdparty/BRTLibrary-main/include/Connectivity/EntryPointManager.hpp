@@ -32,71 +32,86 @@ namespace BRTConnectivity {
 
     public:
 
-        virtual void UpdateEntryPointData(std::string entryPointID) = 0;
-        virtual void EntryPointCreated(std::string _entryPointID, bool _notify) {};
+        CEntryPointManager() : numberOfEntryPoints{ 0 } {}
+
+        /**
+         * @brief Called when data is received at an entry point with notification
+         * @param entryPointID ID of the entry point
+         * @param _port Index of the entry point among all those of this module, in order of creation
+        */
+        virtual void UpdateEntryPointData(const std::string& entryPointID, int _port) = 0;
+        virtual void EntryPointCreated(std::string _entryPointID, bool _notify, int _port) {};
         virtual void UpdateEntryPointConnections(std::string _entryPointID, int _numberOfConnections) {};
         
-       void CreateSamplesEntryPoint(std::string entryPointID, bool _notify = true) {
+       int CreateSamplesEntryPoint(std::string entryPointID, bool _notify = true) {
             //std::shared_ptr<BRTBase::CEntryPointSamplesVector> _newEntryPoint = std::make_shared<BRTBase::CEntryPointSamplesVector >(std::bind(&CEntryPointManager::updateFromEntryPoint, this, std::placeholders::_1), entryPointID, _multiplicity);            
             std::shared_ptr<BRTConnectivity::CEntryPointSamplesVector> _newEntryPoint = CreateGenericEntryPoint<BRTConnectivity::CEntryPointSamplesVector>(entryPointID, _notify);
             
             samplesEntryPoints.push_back(_newEntryPoint);
-            EntryPointCreated(entryPointID, _notify);
+            EntryPointCreated(entryPointID, _notify, _newEntryPoint->GetPort());
+            return static_cast<int>(samplesEntryPoints.size()) - 1;
         }
 
-        void CreateMultipleChannelsEntryPoint(std::string entryPointID, bool _notify) {
+        int CreateMultipleChannelsEntryPoint(std::string entryPointID, bool _notify) {
             //std::shared_ptr<BRTBase::CEntryPointMultipleSamplesVector> _newEntryPoint = std::make_shared<BRTBase::CEntryPointMultipleSamplesVector >(std::bind(&CEntryPointManager::updateFromEntryPoint, this, std::placeholders::_1), entryPointID, _multiplicity);
 			std::shared_ptr<BRTConnectivity::CEntryPointMultipleSamplesVector> _newEntryPoint = CreateGenericEntryPoint<BRTConnectivity::CEntryPointMultipleSamplesVector>(entryPointID, _notify);
             
             multipleSamplesVectorEntryPoints.push_back(_newEntryPoint);                        
-            EntryPointCreated(entryPointID, _notify);
+            EntryPointCreated(entryPointID, _notify, _newEntryPoint->GetPort());                        
+            return static_cast<int>(multipleSamplesVectorEntryPoints.size()) - 1;
         }
 
-        void CreatePositionEntryPoint(std::string entryPointID, bool _notify = false) {
+        int CreatePositionEntryPoint(std::string entryPointID, bool _notify = false) {
             //std::shared_ptr<BRTBase::CEntryPointTransform> _newEntryPoint = std::make_shared<BRTBase::CEntryPointTransform >(std::bind(&CEntryPointManager::updateFromEntryPoint, this, std::placeholders::_1), entryPointID, _multiplicity);
 			std::shared_ptr<BRTConnectivity::CEntryPointTransform> _newEntryPoint = CreateGenericEntryPoint<BRTConnectivity::CEntryPointTransform>(entryPointID, _notify);
             positionEntryPoints.push_back(_newEntryPoint);
-            EntryPointCreated(entryPointID, _notify);
+            EntryPointCreated(entryPointID, _notify, _newEntryPoint->GetPort());
+            return static_cast<int>(positionEntryPoints.size()) - 1;
         }
 
-        void CreateIDEntryPoint(std::string entryPointID, bool _notify = false) {
+        int CreateIDEntryPoint(std::string entryPointID, bool _notify = false) {
             //std::shared_ptr<BRTBase::CEntryPointID> _newEntryPoint = std::make_shared<BRTBase::CEntryPointID >(std::bind(&CEntryPointManager::updateFromEntryPoint, this, std::placeholders::_1), entryPointID, _multiplicity);
 			std::shared_ptr<BRTConnectivity::CEntryPointID> _newEntryPoint = CreateGenericEntryPoint<BRTConnectivity::CEntryPointID>(entryPointID, _notify);
             
             idEntryPoints.push_back(_newEntryPoint);
-            EntryPointCreated(entryPointID, _notify);
+            EntryPointCreated(entryPointID, _notify, _newEntryPoint->GetPort());
+            return static_cast<int>(idEntryPoints.size()) - 1;
         }
 
-        void CreateHRTFPtrEntryPoint(std::string entryPointID, bool _notify = false) {
+        int CreateHRTFPtrEntryPoint(std::string entryPointID, bool _notify = false) {
             //std::shared_ptr<BRTBase::CEntryPointHRTFPtr> _newEntryPoint = std::make_shared<BRTBase::CEntryPointHRTFPtr>(std::bind(&CEntryPointManager::updateFromEntryPoint, this, std::placeholders::_1), entryPointID, _multiplicity);
 			std::shared_ptr<BRTConnectivity::CEntryPointHRTFPtr> _newEntryPoint = CreateGenericEntryPoint<BRTConnectivity::CEntryPointHRTFPtr>(entryPointID, _notify);
             hrtfPtrEntryPoints.push_back(_newEntryPoint);
-            EntryPointCreated(entryPointID, _notify);
+            EntryPointCreated(entryPointID, _notify, _newEntryPoint->GetPort());
+            return static_cast<int>(hrtfPtrEntryPoints.size()) - 1;
         }
 
-        void CreateILDPtrEntryPoint(std::string entryPointID, bool _notify = false) {
+        int CreateILDPtrEntryPoint(std::string entryPointID, bool _notify = false) {
             //std::shared_ptr<BRTBase::CEntryPointILDPtr> _newEntryPoint = std::make_shared<BRTBase::CEntryPointILDPtr>(std::bind(&CEntryPointManager::updateFromEntryPoint, this, std::placeholders::_1), entryPointID, _multiplicity);
 			std::shared_ptr<BRTConnectivity::CEntryPointILDPtr> _newEntryPoint = CreateGenericEntryPoint<BRTConnectivity::CEntryPointILDPtr>(entryPointID, _notify);
             ildPtrEntryPoints.push_back(_newEntryPoint);
-            EntryPointCreated(entryPointID, _notify);
+            EntryPointCreated(entryPointID, _notify, _newEntryPoint->GetPort());
+            return static_cast<int>(ildPtrEntryPoints.size()) - 1;
         }
 
-        void CreateABIRPtrEntryPoint(std::string entryPointID, bool _notify = false) {            
+        int CreateABIRPtrEntryPoint(std::string entryPointID, bool _notify = false) {            
             std::shared_ptr<BRTConnectivity::CEntryPointABIRPtr> _newEntryPoint = CreateGenericEntryPoint<BRTConnectivity::CEntryPointABIRPtr>(entryPointID, _notify);
             abirPtrEntryPoints.push_back(_newEntryPoint);
-            EntryPointCreated(entryPointID, _notify);
+            EntryPointCreated(entryPointID, _notify, _newEntryPoint->GetPort());
+            return static_cast<int>(abirPtrEntryPoints.size()) - 1;
         }
 
-        void CreateHRBRIRPtrEntryPoint(std::string entryPointID, bool _notify = false) {            
+        int CreateHRBRIRPtrEntryPoint(std::string entryPointID, bool _notify = false) {            
             std::shared_ptr<BRTConnectivity::CEntryPointHRBRIRPtr> _newEntryPoint = CreateGenericEntryPoint<BRTConnectivity::CEntryPointHRBRIRPtr>(entryPointID, _notify);
             hrbrirPtrEntryPoints.push_back(_newEntryPoint);
-            EntryPointCreated(entryPointID, _notify);
+            EntryPointCreated(entryPointID, _notify, _newEntryPoint->GetPort());
+            return static_cast<int>(hrbrirPtrEntryPoints.size()) - 1;
         }
 
 
         template <class T>
         std::shared_ptr<T> CreateGenericEntryPoint(std::string entryPointID, bool _notify) {
-            std::shared_ptr<T> _newEntryPoint = std::make_shared<T>(std::bind(&CEntryPointManager::UpdateEntryPointData, this, std::placeholders::_1), entryPointID, _notify);
+            std::shared_ptr<T> _newEntryPoint = std::make_shared<T>(std::bind(&CEntryPointManager::UpdateEntryPointData, this, std::placeholders::_1, std::placeholders::_2), entryPointID, _notify, &entryPointsMutex, numberOfEntryPoints++);
             return _newEntryPoint;
         }
                        
@@ -106,7 +121,7 @@ namespace BRTConnectivity {
 			std::shared_ptr<BRTConnectivity::CEntryPointSamplesVector> _entryPoint2 = GetSamplesEntryPoint(entryPointID);
             if (_entryPoint2) {
                 _exitPoint->attach(*_entryPoint2.get());                
-                UpdateEntryPointConnections(entryPointID, _entryPoint2->AddConnection());
+                UpdateEntryPointConnections(entryPointID, _entryPoint2->AddConnection(_exitPoint.get()));
                 SET_RESULT(RESULT_OK, "Connection done correctly with this entry point " + entryPointID);
             }
             else {
@@ -118,7 +133,7 @@ namespace BRTConnectivity {
 			std::shared_ptr<BRTConnectivity::CEntryPointSamplesVector> _entryPoint2 = GetSamplesEntryPoint(entryPointID);
             if (_entryPoint2) {
                 _exitPoint->detach(_entryPoint2.get());                
-                UpdateEntryPointConnections(entryPointID, _entryPoint2->RemoveConnection());
+                UpdateEntryPointConnections(entryPointID, _entryPoint2->RemoveConnection(_exitPoint.get()));
                 SET_RESULT(RESULT_OK, "Disconnection done correctly with this entry point " + entryPointID);
             }
             else {
@@ -130,7 +145,7 @@ namespace BRTConnectivity {
 			std::shared_ptr<BRTConnectivity::CEntryPointMultipleSamplesVector> _entryPoint2 = GetMultipleSamplesVectorEntryPoint(entryPointID);
             if (_entryPoint2) {
                 _exitPoint->attach(*_entryPoint2.get());                
-                UpdateEntryPointConnections(entryPointID, _entryPoint2->AddConnection());
+                UpdateEntryPointConnections(entryPointID, _entryPoint2->AddConnection(_exitPoint.get()));
                 SET_RESULT(RESULT_OK, "Connection done correctly with this entry point " + entryPointID);
             }
             else {
@@ -142,7 +157,7 @@ namespace BRTConnectivity {
 			std::shared_ptr<BRTConnectivity::CEntryPointMultipleSamplesVector> _entryPoint2 = GetMultipleSamplesVectorEntryPoint(entryPointID);
             if (_entryPoint2) {
                 _exitPoint->detach(_entryPoint2.get());                
-                UpdateEntryPointConnections(entryPointID, _entryPoint2->RemoveConnection());
+                UpdateEntryPointConnections(entryPointID, _entryPoint2->RemoveConnection(_exitPoint.get()));
                 SET_RESULT(RESULT_OK, "Disconnection done correctly with this entry point " + entryPointID);
             }
             else {
@@ -354,6 +369,16 @@ namespace BRTConnectivity {
         }
         
 
+        // Find entry points by the index returned when they were created, without comparing IDs. Meant for the audio path.
+        const std::shared_ptr<BRTConnectivity::CEntryPointSamplesVector>& GetSamplesEntryPoint(int _index) const { return samplesEntryPoints[_index]; }
+        const std::shared_ptr<BRTConnectivity::CEntryPointMultipleSamplesVector>& GetMultipleSamplesVectorEntryPoint(int _index) const { return multipleSamplesVectorEntryPoints[_index]; }
+        const std::shared_ptr<BRTConnectivity::CEntryPointTransform>& GetPositionEntryPoint(int _index) const { return positionEntryPoints[_index]; }
+        const std::shared_ptr<BRTConnectivity::CEntryPointHRTFPtr>& GetHRTFPtrEntryPoint(int _index) const { return hrtfPtrEntryPoints[_index]; }
+        const std::shared_ptr<BRTConnectivity::CEntryPointHRBRIRPtr>& GetHRBRIRPtrEntryPoint(int _index) const { return hrbrirPtrEntryPoints[_index]; }
+        const std::shared_ptr<BRTConnectivity::CEntryPointILDPtr>& GetILDPtrEntryPoint(int _index) const { return ildPtrEntryPoints[_index]; }
+        const std::shared_ptr<BRTConnectivity::CEntryPointABIRPtr>& GetABIRPtrEntryPoint(int _index) const { return abirPtrEntryPoints[_index]; }
+        const std::shared_ptr<BRTConnectivity::CEntryPointID>& GetIDEntryPoint(int _index) const { return idEntryPoints[_index]; }
+
     private:
 
         std::vector<std::shared_ptr <BRTConnectivity::CEntryPointSamplesVector>> samplesEntryPoints;
@@ -364,6 +389,9 @@ namespace BRTConnectivity {
         std::vector<std::shared_ptr <BRTConnectivity::CEntryPointABIRPtr>> abirPtrEntryPoints;
         std::vector<std::shared_ptr <BRTConnectivity::CEntryPointID> > idEntryPoints;
         std::vector<std::shared_ptr <BRTConnectivity::CEntryPointHRBRIRPtr>> hrbrirPtrEntryPoints;
+
+        std::recursive_mutex entryPointsMutex;     // Serialises the data received by this module when sources are rendered in parallel
+        int numberOfEntryPoints;                   // Entry points created so far, of any type
         
     };
 };
@@ -44,6 +44,10 @@ namespace BRTConnectivity {
         std::string GetID() { return id; };
         void SetData(const T& _data) { data = _data; }        
         T GetData() { return data; }
+        /**
+         * @brief Get the data last sent without copying it. The reference is valid until the next send.
+        */
+        const T& GetDataRef() const { return data; }
 
         void sendData(T& _data) {
             this->SetData(_data);
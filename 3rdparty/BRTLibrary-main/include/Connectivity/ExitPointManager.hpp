@@ -58,12 +58,13 @@ namespace BRTConnectivity {
         /////////////////////
         /** \brief Creates a new exit point of type samples and saves it
         *	\param [in] Identifier to be given to the exit point
-        *	\retval void
+        *	\retval index index of the new exit point, to find it without comparing IDs
         *   \eh On error, an error code is reported to the error handler.
         */
-        void CreateSamplesExitPoint(std::string exitPointID) {
+        int CreateSamplesExitPoint(std::string exitPointID) {
 			std::shared_ptr<BRTConnectivity::CExitPointSamplesVector> _newExitPoint = std::make_shared<BRTConnectivity::CExitPointSamplesVector>(exitPointID);
             samplesExitPoints.push_back(_newExitPoint);
+            return static_cast<int>(samplesExitPoints.size()) - 1;
         }
         
         /** \brief Returns a pointer to the exit point
@@ -79,10 +80,24 @@ namespace BRTConnectivity {
             return nullptr;
         }
 
+        /** \brief Returns the exit point created with the given index, without comparing IDs. Meant for the audio path.
+        *	\param [in] Index returned by CreateSamplesExitPoint
+        *	\retval The exit point
+        *   \eh Nothing is reported to the error handler.
+        */
+        const std::shared_ptr<BRTConnectivity::CExitPointSamplesVector>& GetSamplesExitPoint(int _index) const {
+            return samplesExitPoints[_index];
+        }
+
 
-        void CreateMultipleSamplesExitPoint(std::string exitPointID) {
+        int CreateMultipleSamplesExitPoint(std::string exitPointID) {
 			std::shared_ptr<BRTConnectivity::CExitPointMultipleSamplesVector> _newExitPoint = std::make_shared<BRTConnectivity::CExitPointMultipleSamplesVector>(exitPointID);
             multipleSamplesVectorExitPoints.push_back(_newExitPoint);
+            return static_cast<int>(multipleSamplesVectorExitPoints.size()) - 1;
+        }
+
+        const std::shared_ptr<BRTConnectivity::CExitPointMultipleSamplesVector>& GetMultipleSamplesVectorExitPoint(int _index) const {
+            return multipleSamplesVectorExitPoints[_index];
         }
 
         std::shared_ptr<BRTConnectivity::CExitPointMultipleSamplesVector> GetMultipleSamplesVectorExitPoint(std::string exitPointID) {
@@ -23,6 +23,7 @@
 #ifndef _OBSERVER_BASE_
 #define _OBSERVER_BASE_
 
+#include <algorithm>
 #include <vector>
 #include <iostream>
 
@@ -36,6 +37,10 @@ namespace BRTConnectivity {
         Observer() {}
         virtual ~Observer() {}
         virtual void Update(Subject* subject) = 0;
+        /**
+         * @brief Notification with the slot the observer has given to the subject, see Subject::SetObserverSlot
+        */
+        virtual void Update(Subject* subject, int _slot) { Update(subject); }
     };
 
     
@@ -46,25 +51,39 @@ namespace BRTConnectivity {
         virtual ~Subject() {}
         void attach(Observer& observer)
         {
-            observers.push_back(&observer);
+            observers.push_back({ &observer, -1 });
             notify(observer);
         }
         void detach(Observer *observer) {           
-            auto it = (std::find(observers.begin(), observers.end(), observer));
+            auto it = std::find_if(observers.begin(), observers.end(), [observer](const TObserver& _item) { return _item.observer == observer; });
             if (it != observers.end())
                 observers.erase(it);            
         }
         void notify()
         {
-            typename std::vector<Observer*>::iterator it;
             //for (it = observers.begin(); it != observers.end(); it++) (*it)->Update(static_cast<T*>(this));
-            for (it = observers.begin(); it != observers.end(); it++) (*it)->Update(this);                        
+            for (const TObserver& it : observers) it.observer->Update(this, it.slot);
+        }
+
+        /**
+         * @brief Store an index the observer wants back with every notification, so that it does not have to look the subject up
+         * @param observer Attached observer
+         * @param _slot Index to pass to Observer::Update, -1 for none
+        */
+        void SetObserverSlot(Observer* observer, int _slot) {
+            for (TObserver& it : observers) {
+                if (it.observer == observer) { it.slot = _slot; }
+            }
         }
       
     private:
-        std::vector<Observer*> observers;
+        struct TObserver {
+            Observer* observer;
+            int slot;
+        };
+        std::vector<TObserver> observers;
 
-        void notify(Observer& observer) { observer.Update(this); }
+        void notify(Observer& observer) { observer.Update(this, -1); }
     };
 
     /*template <class T>
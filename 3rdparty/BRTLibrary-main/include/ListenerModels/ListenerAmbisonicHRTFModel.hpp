@@ -136,16 +136,66 @@ namespace BRTListenerModel {
 				SET_RESULT(RESULT_ERROR_NOTSET, "This HRTF has not been assigned to the listener. The sample rate of the HRTF does not match the one set in the library Global Parameters.");
 				return false;
 			}			
-			listenerHRTF = _listenerHRTF;									
-			InitListenerAmbisonicIR();
+			return SetHRTF(_listenerHRTF, CreateAmbisonicIR(_listenerHRTF, ambisonicOrder, ambisonicNormalization));
+		}
+
+		/** \brief SET HRTF of listener together with the ambisonic IRs built from it beforehand, see CreateAmbisonicIR
+		*	\details Nothing is computed here, so that the HRTF can be switched while rendering. The convolvers fade from the
+		*	previous IRs into the new ones. The order of the IRs becomes the ambisonic order of the listener.
+		*	\param[in] pointer to HRTF to be stored
+		*	\param[in] pointer to the ambisonic IRs of the HRTF
+		*   \eh On error, an error code is reported to the error handler.
+		*/
+		bool SetHRTF(std::shared_ptr<BRTServices::CHRTF> _listenerHRTF, std::shared_ptr<BRTServices::CAmbisonicBIR> _listenerAmbisonicIR) {
+
+			if (_listenerHRTF->GetSamplingRate() != globalParameters.GetSampleRate()) {
+				SET_RESULT(RESULT_ERROR_NOTSET, "This HRTF has not been assigned to the listener. The sample rate of the HRTF does not match the one set in the library Global Parameters.");
+				return false;
+			}
+			if (!_listenerAmbisonicIR || !_listenerAmbisonicIR->IsReady() || _listenerAmbisonicIR->GetAmbisonicNormalization() != ambisonicNormalization) {
+				SET_RESULT(RESULT_ERROR_NOTSET, "This HRTF has not been assigned to the listener. The ambisonic IRs have not been set up for the normalization of the listener.");
+				return false;
+			}
+			
+			listenerHRTF = _listenerHRTF;
+			listenerAmbisonicIR = _listenerAmbisonicIR;
+			if (_listenerAmbisonicIR->GetAmbisonicOrder() != ambisonicOrder) {
+				ambisonicOrder = _listenerAmbisonicIR->GetAmbisonicOrder();
+				SetConfigurationInALLSourcesProcessors();
+				leftAmbisonicDomainConvolverProcessor->SetAmbisonicOrder(ambisonicOrder);
+				rightAmbisonicDomainConvolverProcessor->SetAmbisonicOrder(ambisonicOrder);
+			}
 
 			GetHRTFExitPoint()->sendDataPtr(listenerHRTF);
 			GetABIRExitPoint()->sendDataPtr(listenerAmbisonicIR);
-						
-			ResetProcessorBuffers();
 			return true;
 		}
 
+		/** \brief Build the ambisonic IRs of an HRTF, for instance on another thread than the one rendering
+		*	\param[in] pointer to the HRTF
+		*	\param[in] ambisonic order of the IRs
+		*	\param[in] ambisonic normalization of the IRs
+		*	\retval pointer to the IRs, nullptr if they could not be built
+		*   \eh On error, an error code is reported to the error handler.
+		*/
+		static std::shared_ptr<BRTServices::CAmbisonicBIR> CreateAmbisonicIR(std::shared_ptr<BRTServices::CHRTF> _listenerHRTF, int _ambisonicOrder, BRTProcessing::TAmbisonicNormalization _ambisonicNormalization) {
+			std::shared_ptr<BRTServices::CAmbisonicBIR> ambisonicIR = std::make_shared<BRTServices::CAmbisonicBIR>();
+			ambisonicIR->BeginSetup(_ambisonicOrder, _ambisonicNormalization);
+			if (!ambisonicIR->AddImpulseResponsesFromHRIR(_listenerHRTF)) {
+				SET_RESULT(RESULT_ERROR_UNKNOWN, "It has not been possible to initialise the ambisonic IR of the associated listener.");
+				return nullptr;
+			}
+			ambisonicIR->EndSetup();
+			return ambisonicIR;
+		}
+
+		/** \brief Get the ambisonic IRs the listener renders with
+		*	\retval pointer to the current ambisonic IRs
+		*/
+		std::shared_ptr<BRTServices::CAmbisonicBIR> GetAmbisonicIR() const {
+			return listenerAmbisonicIR;
+		}
+
 		/** \brief Get HRTF of listener
 		*	\retval HRTF pointer to current listener HRTF
 		*   \eh On error, an error code is reported to the error handler.
@@ -512,15 +562,13 @@ namespace BRTListenerModel {
 			return control;
 		};
 
+		/// Build new IRs rather than setting up the current ones again, which the convolvers may be reading
 		void InitListenerAmbisonicIR(){
-			std::lock_guard<std::mutex> l(mutex);
-			listenerAmbisonicIR->BeginSetup(ambisonicOrder, ambisonicNormalization);
-			bool control = listenerAmbisonicIR->AddImpulseResponsesFromHRIR(listenerHRTF);
-			if (control) {
-				listenerAmbisonicIR->EndSetup();
-			}
-			else {
-				ASSERT(false, RESULT_ERROR_UNKNOWN, "It has not been possible to initialise the ambisonic IR of the associated listener.", "");
+			std::shared_ptr<BRTServices::CAmbisonicBIR> ambisonicIR = CreateAmbisonicIR(listenerHRTF, ambisonicOrder, ambisonicNormalization);
+			if (ambisonicIR) {
+				std::lock_guard<std::mutex> l(mutex);
+				listenerAmbisonicIR = ambisonicIR;
+				GetABIRExitPoint()->sendDataPtr(listenerAmbisonicIR);
 			}
 		}
 
@@ -579,11 +627,15 @@ namespace BRTListenerModel {
 			control = control && brtManager->ConnectModulesMultipleSamplesVectors(_newSourceProcessors.bilateralAmbisonicEncoderProcessor, "leftAmbisonicChannels", leftAmbisonicDomainConvolverProcessor, "inputChannels");
 			control = control && brtManager->ConnectModulesMultipleSamplesVectors(_newSourceProcessors.bilateralAmbisonicEncoderProcessor, "rightAmbisonicChannels", rightAmbisonicDomainConvolverProcessor, "inputChannels");
 
-			control = control && brtManager->ConnectModulesSamples(leftAmbisonicDomainConvolverProcessor, "outSamples", this, "leftEar");
-			control = control && brtManager->ConnectModulesSamples(rightAmbisonicDomainConvolverProcessor, "outSamples", this, "rightEar");
+			// The convolvers mix all the sources, so they are connected to the ears only once. Otherwise every source would add the mix again.
+			if (sourcesConnectedProcessors.empty()) {
+				control = control && brtManager->ConnectModulesSamples(leftAmbisonicDomainConvolverProcessor, "outSamples", this, "leftEar");
+				control = control && brtManager->ConnectModulesSamples(rightAmbisonicDomainConvolverProcessor, "outSamples", this, "rightEar");
+			}
 
 			if (control) {
 				SetSourceProcessorsConfiguration(_newSourceProcessors);
+				if (!enableModel) { _newSourceProcessors.SetEnableProcessor(false); }
 				sourcesConnectedProcessors.push_back(std::move(_newSourceProcessors));
 				return true;
 			}
@@ -610,8 +662,11 @@ namespace BRTListenerModel {
 			auto it = std::find_if(sourcesConnectedProcessors.begin(), sourcesConnectedProcessors.end(), [&_sourceID](CSourceToBeProcessed& sourceProcessorItem) { return sourceProcessorItem.sourceID == _sourceID; });
 			if (it != sourcesConnectedProcessors.end()) {
 
-				bool control = brtManager->DisconnectModulesSamples(leftAmbisonicDomainConvolverProcessor, "outSamples", this, "leftEar");
-				control = control && brtManager->DisconnectModulesSamples(rightAmbisonicDomainConvolverProcessor, "outSamples", this, "rightEar");
+				bool control = true;
+				if (sourcesConnectedProcessors.size() == 1) {
+					control = brtManager->DisconnectModulesSamples(leftAmbisonicDomainConvolverProcessor, "outSamples", this, "leftEar");
+					control = control && brtManager->DisconnectModulesSamples(rightAmbisonicDomainConvolverProcessor, "outSamples", this, "rightEar");
+				}
 
 				control = control && brtManager->DisconnectModulesMultipleSamplesVectors(it->bilateralAmbisonicEncoderProcessor, "leftAmbisonicChannels", leftAmbisonicDomainConvolverProcessor, "inputChannels");
 				control = control && brtManager->DisconnectModulesMultipleSamplesVectors(it->bilateralAmbisonicEncoderProcessor, "rightAmbisonicChannels", rightAmbisonicDomainConvolverProcessor, "inputChannels");
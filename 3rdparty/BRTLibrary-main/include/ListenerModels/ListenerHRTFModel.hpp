@@ -42,7 +42,7 @@ namespace BRTListenerModel {
 		class CSourceProcessors {
 		public:
 			
-			CSourceProcessors(std::string _sourceID, BRTBase::CBRTManager* brtManager) : sourceID{ _sourceID} {
+			CSourceProcessors(std::string _sourceID, BRTBase::CBRTManager* brtManager) : sourceID{ _sourceID}, renderingTier{ BRTProcessing::TRenderingTier::Full } {
 				binauralConvolverProcessor = brtManager->CreateProcessor <BRTProcessing::CHRTFConvolverProcessor>();
 				nearFieldEffectProcessor = brtManager->CreateProcessor<BRTProcessing::CNearFieldEffectProcessor>();
 			}	
@@ -62,8 +62,10 @@ namespace BRTListenerModel {
 			 * @param enableSpatialization Spatialization state
 			 * @param enableInterpolation Interpolation state
 			 * @param enableNearFieldEffect Nearfield state
+			 * @param HRIRTolerance Angular tolerance within which the HRIRs are reused, in degrees
+			 * @param frequencyDomainMixer Mixer to add the output spectra to, nullptr to output time signals
 			*/
-			void SetConfiguration(bool enableSpatialization, bool enableInterpolation, bool enableNearFieldEffect, bool enableITD, bool enableParallaxCorrection) {
+			void SetConfiguration(bool enableSpatialization, bool enableInterpolation, bool enableNearFieldEffect, bool enableITD, bool enableParallaxCorrection, float HRIRTolerance, std::shared_ptr<BRTProcessing::CFrequencyDomainMixer> frequencyDomainMixer) {
 				if (enableSpatialization) { binauralConvolverProcessor->EnableSpatialization(); }
 				else { binauralConvolverProcessor->DisableSpatialization(); }
 
@@ -81,6 +83,9 @@ namespace BRTListenerModel {
 
 				if (enableParallaxCorrection) {binauralConvolverProcessor->EnableParallaxCorrection();}
 				else {binauralConvolverProcessor->DisableParallaxCorrection();}
+
+				binauralConvolverProcessor->SetHRIRTolerance(HRIRTolerance);
+				binauralConvolverProcessor->SetFrequencyDomainMixer(frequencyDomainMixer);
 			}
 
 			/**
@@ -107,6 +112,7 @@ namespace BRTListenerModel {
 			}
 
 			std::string sourceID;
+			BRTProcessing::TRenderingTier renderingTier;	// Level of detail, the near field effect is only applied in the full tier
 			std::shared_ptr <BRTProcessing::CHRTFConvolverProcessor> binauralConvolverProcessor;
 			std::shared_ptr <BRTProcessing::CNearFieldEffectProcessor> nearFieldEffectProcessor;
 		};
@@ -119,8 +125,11 @@ namespace BRTListenerModel {
 			, enableInterpolation{ true }
 			, enableNearFieldEffect{ false }
 			, enableParallaxCorrection{ true }
-			, enableITDSimulation{ true }  {
+			, enableITDSimulation{ true }
+			, enableFrequencyDomainMixing{ false }
+			, HRIRTolerance{ 0.0f }  {
 			
+			frequencyDomainMixer = std::make_shared<BRTProcessing::CFrequencyDomainMixer>();
 			
 			//listenerHRTF = std::make_shared<BRTServices::CHRTF>();	// Create a empty HRTF		
 			listenerHRTF = nullptr;
@@ -141,8 +150,9 @@ namespace BRTListenerModel {
 				return false;
 			}
 			listenerHRTF = _listenerHRTF;			
+			listenerHRTF->SetHRIRCacheResolution(HRIRTolerance);
+			// No reset here: the convolvers notice the new HRTF on their next block and crossfade into it
 			GetHRTFExitPoint()->sendDataPtr(listenerHRTF);	
-			ResetProcessorBuffers();
 						
 			return true;
 		}
@@ -340,6 +350,29 @@ namespace BRTListenerModel {
 		*/
 		bool IsParallaxCorrectionEnabled() override { return enableParallaxCorrection; }
 
+		/**
+		 * @brief Enable frequency domain mixing. The spectra of all the sources are added up and only two inverse FFTs are made per block.
+		 * The ITD is then applied as a linear phase, limited by the room the buffer size leaves in the FFT (none if it is a power of two).
+		 * It has no effect while the near field effect is enabled, because that is applied to each source in the time domain.
+		*/
+		void EnableFrequencyDomainMixing() override {
+			enableFrequencyDomainMixing = true;
+			SetConfigurationInALLSourcesProcessors();
+		}
+
+		/**
+		 * @brief Disable frequency domain mixing
+		*/
+		void DisableFrequencyDomainMixing() override {
+			enableFrequencyDomainMixing = false;
+			SetConfigurationInALLSourcesProcessors();
+		}
+
+		/**
+		* @brief Get frequency domain mixing state
+		*/
+		bool IsFrequencyDomainMixingEnabled() override { return enableFrequencyDomainMixing; }
+
 		/**
 		 * @brief Enable model
 		 */
@@ -348,6 +381,7 @@ namespace BRTListenerModel {
 			enableModel = true;			
 			for (auto& it : sourcesConnectedProcessors) {
 				it.SetEnableProcessor(true);
+				SetSourceProcessorsConfiguration(it);		// The near field effect may have been disabled
 			}
 		};
 
@@ -363,6 +397,43 @@ namespace BRTListenerModel {
 		};
 
 
+		/**
+		 * @brief Set the angular tolerance of the HRIR lookups. Each source reuses its HRIRs while it moves less than the tolerance,
+		 * and the run-time interpolation is done at directions rounded to the tolerance, whose HRIRs are cached by the HRTF.
+		 * @param _degrees tolerance in degrees, 0 to look the HRIRs up at the exact direction every time it changes
+		*/
+		void SetHRIRTolerance(float _degrees) {
+			HRIRTolerance = std::max(_degrees, 0.0f);
+			if (listenerHRTF) { listenerHRTF->SetHRIRCacheResolution(HRIRTolerance); }
+			SetConfigurationInALLSourcesProcessors();
+		}
+
+		/**
+		 * @brief Get the angular tolerance of the HRIR lookups
+		 * @return tolerance in degrees
+		*/
+		float GetHRIRTolerance() const { return HRIRTolerance; }
+
+		/**
+		 * @brief Set the level of detail a source is rendered with, see BRTProcessing::TRenderingTier.
+		 * The convolver crossfades between tiers, but the near field effect is switched on and off at once.
+		 * @param _sourceID ID of the source
+		 * @param _tier new rendering tier
+		 * @return True if the source is connected to this model
+		*/
+		bool SetSourceRenderingTier(const std::string& _sourceID, BRTProcessing::TRenderingTier _tier) {
+			std::lock_guard<std::mutex> l(mutex);
+			auto it = std::find_if(sourcesConnectedProcessors.begin(), sourcesConnectedProcessors.end(), [&_sourceID](CSourceProcessors& sourceProcessorItem) { return sourceProcessorItem.sourceID == _sourceID; });
+			if (it == sourcesConnectedProcessors.end()) { return false; }
+
+			if (it->renderingTier != _tier) {
+				it->renderingTier = _tier;
+				it->binauralConvolverProcessor->SetRenderingTier(_tier);
+				if (enableModel) { SetSourceProcessorsConfiguration(*it); }
+			}
+			return true;
+		}
+
 		/**
 		 * @brief Reset all processor buffers
 		*/
@@ -450,11 +521,25 @@ namespace BRTListenerModel {
 					} else {
 						DisableParallaxCorrection();
 					}
+				} else if (command.GetCommand() == "/listener/enableFrequencyDomainMixing") {
+					if (command.GetBoolParameter("enable")) {
+						EnableFrequencyDomainMixing();
+					} else {
+						DisableFrequencyDomainMixing();
+					}
 				} else if (command.GetCommand() == "/listener/resetBuffers") {
 					ResetProcessorBuffers();
 				}
 			}
 		}
+	protected:
+		/**
+		 * @brief Make the inverse FFTs of the spectra the sources have added up during this block
+		 */
+		void MixFrequencyDomainOutputs(CMonoBuffer<float>& _leftBuffer, CMonoBuffer<float>& _rightBuffer) override {
+			frequencyDomainMixer->MixInto(_leftBuffer, _rightBuffer);
+		}
+
 	private:
 
 		/**
@@ -524,7 +609,9 @@ namespace BRTListenerModel {
 		 * @param sourceProcessor 
 		*/
 		void SetSourceProcessorsConfiguration(CSourceProcessors& sourceProcessor) {			
-			sourceProcessor.SetConfiguration(enableSpatialization, enableInterpolation, enableNearFieldEffect, enableITDSimulation, enableParallaxCorrection);
+			std::shared_ptr<BRTProcessing::CFrequencyDomainMixer> mixer = (enableFrequencyDomainMixing && !enableNearFieldEffect) ? frequencyDomainMixer : nullptr;
+			const bool sourceNearFieldEffect = enableNearFieldEffect && sourceProcessor.renderingTier == BRTProcessing::TRenderingTier::Full;
+			sourceProcessor.SetConfiguration(enableSpatialization, enableInterpolation, sourceNearFieldEffect, enableITDSimulation, enableParallaxCorrection, HRIRTolerance, mixer);
 		}
 
 		
@@ -568,6 +655,7 @@ namespace BRTListenerModel {
 
 			if (control) {
 				SetSourceProcessorsConfiguration(_newSourceProcessors);
+				if (!enableModel) { _newSourceProcessors.SetEnableProcessor(false); }
 				sourcesConnectedProcessors.push_back(std::move(_newSourceProcessors));
 				return true;
 			}
@@ -634,6 +722,9 @@ namespace BRTListenerModel {
 		bool enableNearFieldEffect;     // Enables/Disables the Near Field Effect
 		bool enableParallaxCorrection;	// Enable parallax correction
 		bool enableITDSimulation;		// Enable ITD simulation 
+		bool enableFrequencyDomainMixing;	// Add up the spectra of all the sources before the inverse FFTs
+		std::shared_ptr<BRTProcessing::CFrequencyDomainMixer> frequencyDomainMixer;	// Sums of the spectra of the sources
+		float HRIRTolerance;			// Angular tolerance of the HRIR lookups, in degrees
 
 		std::vector<std::shared_ptr<BRTEnvironmentModel::CEnviromentModelBase>> environmentModelsConnected; // Listener models connected to the listener
 	};
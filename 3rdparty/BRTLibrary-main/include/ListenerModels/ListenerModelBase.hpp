@@ -108,6 +108,10 @@ namespace BRTListenerModel {
 		virtual void DisableParallaxCorrection() {};
 		virtual bool IsParallaxCorrectionEnabled() { return false; }
 
+		virtual void EnableFrequencyDomainMixing() {};
+		virtual void DisableFrequencyDomainMixing() {};
+		virtual bool IsFrequencyDomainMixingEnabled() { return false; }
+
 		virtual bool SetAmbisonicOrder(int _ambisonicOrder) { return false; }
 		virtual int GetAmbisonicOrder() { return 0; }
 		virtual bool SetAmbisonicNormalization(BRTProcessing::TAmbisonicNormalization _ambisonicNormalization) { return false; }
@@ -131,17 +135,15 @@ namespace BRTListenerModel {
 		// Class Methods
 		CListenerModelBase(std::string _listenerModelID, TListenerModelcharacteristics _listenerCharacteristics) 
 			: CModelBase(_listenerModelID)
-			, listenerCharacteristics{ _listenerCharacteristics }
-			, leftDataReady { false }
-			, rightDataReady { false } {
+			, listenerCharacteristics{ _listenerCharacteristics } {
 												
-			CreateSamplesEntryPoint("leftEar");		// TODO is this necessary?
-			CreateSamplesEntryPoint("rightEar");	// TODO is this necessary?								
+			leftEarInPort = CreateSamplesEntryPoint("leftEar");		// TODO is this necessary?
+			rightEarInPort = CreateSamplesEntryPoint("rightEar");	// TODO is this necessary?								
 			CreateTransformExitPoint();				// TODO is this necessary?
 			CreateIDExitPoint();
 			
-			CreateSamplesExitPoint("leftEar");
-			CreateSamplesExitPoint("rightEar");
+			leftEarOutPort = CreateSamplesExitPoint("leftEar");
+			rightEarOutPort = CreateSamplesExitPoint("rightEar");
 			CreateIDEntryPoint("listenerID");
 			CreateIDEntryPoint("binauralFilterID");
 			GetIDExitPoint()->sendData(modelID);						
@@ -172,41 +174,20 @@ namespace BRTListenerModel {
 		// Update Callbacks
 		/////////////////////
 				
-		/**
-		 * @brief Implementation of CAdvancedEntryPointManager virtual method
-		 * @param _entryPointId entryPoint ID
-		*/
-		
-		void OneEntryPointOneDataReceived(std::string _entryPointId) override{
-						
-			if (_entryPointId == "leftEar") {				
-				if (!leftDataReady) { InitBuffer(leftBuffer); }				
-				CMonoBuffer<float> newBuffer = GetSamplesEntryPoint("leftEar")->GetData();				
-				leftDataReady = MixEarBuffers(leftBuffer, newBuffer);									
-			}
-			else if (_entryPointId == "rightEar") {
-				if (!rightDataReady) { InitBuffer(rightBuffer); }
-				CMonoBuffer<float> newBuffer = GetSamplesEntryPoint("rightEar")->GetData();				
-				rightDataReady = MixEarBuffers(rightBuffer, newBuffer);				
-			} else {			
-				//nothing
-			}
-
-
-		}
-
 		/**
 		 * @brief Implementation of CAdvancedEntryPointManager virtual method
 		*/
 		void AllEntryPointsAllDataReady() override{
 			
+			// Mixed once everything has arrived and in the order of the connections, so that the result does not depend on the render threads
+			MixEarBuffers(leftEarInPort, leftBuffer);
+			MixEarBuffers(rightEarInPort, rightBuffer);
+			MixFrequencyDomainOutputs(leftBuffer, rightBuffer);
 			leftBuffer.ApplyGain(gain);
 			rightBuffer.ApplyGain(gain);
 
-			GetSamplesExitPoint("leftEar")->sendData(leftBuffer);
-			GetSamplesExitPoint("rightEar")->sendData(rightBuffer);
-			leftDataReady = false;
-			rightDataReady = false;
+			GetSamplesExitPoint(leftEarOutPort)->sendData(leftBuffer);
+			GetSamplesExitPoint(rightEarOutPort)->sendData(rightBuffer);
 						           
 		}
 		
@@ -222,6 +203,14 @@ namespace BRTListenerModel {
 				
 		}
 
+
+	protected:
+		/**
+		 * @brief Add the outputs that the source processors have left in the frequency domain to the ear buffers, once all of them are done
+		 * @param _leftBuffer mix of the left ear
+		 * @param _rightBuffer mix of the right ear
+		 */
+		virtual void MixFrequencyDomainOutputs(CMonoBuffer<float>& _leftBuffer, CMonoBuffer<float>& _rightBuffer) {}
 		
 	private:		
 		TListenerModelcharacteristics listenerCharacteristics;
@@ -229,9 +218,11 @@ namespace BRTListenerModel {
 		Common::CGlobalParameters globalParameters;		
 		CMonoBuffer<float> leftBuffer;
 		CMonoBuffer<float> rightBuffer;
-		
-		bool leftDataReady;
-		bool rightDataReady;	
+		int leftEarInPort;								// Indices of the ear entry and exit points
+		int rightEarInPort;
+		int leftEarOutPort;
+		int rightEarOutPort;
+
 				
 		//////////////////////////
 		// Private Methods
@@ -260,19 +251,14 @@ namespace BRTListenerModel {
 			return false;
 		}
 		
-		///**
-		// * @brief Mix the new buffer received with the contents of the buffer.
-		//*/				
-		bool MixEarBuffers(CMonoBuffer<float>& buffer, const CMonoBuffer<float>& newBuffer) {			
-			if (newBuffer.size() != 0) {
-				buffer += newBuffer;
-				return true;
-			}
-			return false;
-		}
-
-		void InitBuffer(CMonoBuffer<float>& buffer) {
-			buffer = CMonoBuffer<float>(globalParameters.GetBufferSize());
+		/**
+		 * @brief Replace the contents of the buffer with the mix of the buffers received at one ear entry point during this block
+		*/
+		void MixEarBuffers(int _entryPointPort, CMonoBuffer<float>& _buffer) {
+			_buffer.Fill(globalParameters.GetBufferSize(), 0.0f);
+			GetSamplesEntryPoint(_entryPointPort)->ForEachReceivedData([&_buffer](const CMonoBuffer<float>& _newBuffer) {
+				if (_newBuffer.size() == _buffer.size()) { _buffer += _newBuffer; }
+			});
 		}
 	};
 }
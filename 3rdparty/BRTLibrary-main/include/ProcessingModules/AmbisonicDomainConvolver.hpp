@@ -37,11 +37,12 @@
 #define EPSILON 0.0001f
 #define ELEVATION_SINGULAR_POINT_UP 90.0
 #define ELEVATION_SINGULAR_POINT_DOWN 270.0
+#define AMBISONIC_BIR_CROSSFADE_BLOCKS 2		///< Number of blocks over which the output of the previous ambisonic IRs is faded into the new ones
 
 namespace BRTProcessing {
 	class CAmbisonicDomainConvolver  {
 	public:
-		CAmbisonicDomainConvolver(Common::T_ear _earToProcess) : enableProcessor{ true }, earToProcess { _earToProcess }, convolutionBuffersInitialized{ false }, numberOfAmbisonicChannels{ 4 } { }
+		CAmbisonicDomainConvolver(Common::T_ear _earToProcess) : earToProcess { _earToProcess }, numberOfAmbisonicChannels{ 4 }, convolutionBuffersInitialized{ false }, enableProcessor{ true }, crossfadeActive{ false }, crossfadeBlocksDone{ 0 } { }
 
 
 		/**
@@ -106,27 +107,17 @@ namespace BRTProcessing {
 				return;
 			}
 
-			// First time - Initialize convolution buffers
+			// First time - Initialize convolution buffers. If the IRs have been replaced since, fade from the previous ones.
 			if (!convolutionBuffersInitialized) { InitializedSourceConvolutionBuffers(_listenerAmbisonicBIR); }
+			else if (convolutionBIR.lock() != _listenerAmbisonicBIR) { BeginBIRCrossfade(_listenerAmbisonicBIR); }
 			
 			// Process
-			std::vector<CMonoBuffer<float>> allChannelsBuffersConvolved (numberOfAmbisonicChannels);
-			for (int nChannel = 0; nChannel < _inChannelsBuffers.size(); nChannel++) {				
-				
-				std::vector<CMonoBuffer<float>>	oneChannel_ABIR_partitioned = _listenerAmbisonicBIR->GetChannelPartitionedIR_OneEar(nChannel, earToProcess, _listenerTransform); // GET ABIR								
-				if (oneChannel_ABIR_partitioned.size() == 0) {
-					SET_RESULT(RESULT_ERROR_BADSIZE, "Failure to obtain an IR from AmbisonicIR. This usually occurs because the ambisonic order has been changed during reproduction.");
-					outBuffer.Fill(globalParameters.GetBufferSize(), 0.0f);
-					return;
-				}
-				channelsUPConvolutionVector[nChannel]->ProcessUPConvolutionWithMemory(_inChannelsBuffers[nChannel], oneChannel_ABIR_partitioned, allChannelsBuffersConvolved[nChannel], false);
+			if (!ProcessConvolution(_inChannelsBuffers, _listenerAmbisonicBIR, channelsUPConvolutionVector, _listenerTransform, outBuffer)) {
+				SET_RESULT(RESULT_ERROR_BADSIZE, "Failure to obtain an IR from AmbisonicIR. This usually occurs because the ambisonic order has been changed during reproduction.");
+				outBuffer.Fill(globalParameters.GetBufferSize(), 0.0f);
+				return;
 			}
-			// Mixer
-			CMonoBuffer<float> mixedChannels;
-			mixedChannels.SetFromMix({ allChannelsBuffersConvolved });			
-			mixedChannels.ApplyGain(1.0f / numberOfAmbisonicChannels);
-			// InverseFFT
-			BRTProcessing::CUniformPartitionedConvolution::CalculateIFFT(mixedChannels, outBuffer);			
+			if (crossfadeActive) { ProcessBIRCrossfade(_inChannelsBuffers, _listenerTransform, outBuffer); }
 		}
 		
 		/**
@@ -145,10 +136,21 @@ namespace BRTProcessing {
 		Common::CGlobalParameters globalParameters;		
 		std::vector<std::shared_ptr<BRTProcessing::CUniformPartitionedConvolution>> channelsUPConvolutionVector; // Object to make the inverse fft of the left channel with the UPC method				
 		
+		std::vector<std::shared_ptr<BRTProcessing::CUniformPartitionedConvolution>> fadingChannelsUPConvolutionVector; // Convolvers of the previous IRs, only used during a crossfade
+		std::weak_ptr<BRTServices::CAmbisonicBIR> convolutionBIR;	// IRs the convolvers have been set up for
+		std::weak_ptr<BRTServices::CAmbisonicBIR> fadingBIR;		// Previous IRs, faded out during a crossfade
+		CMonoBuffer<float> fadingOutBuffer;					// Output of the previous IRs during a crossfade
+		CMonoBuffer<float> channelConvolved;				// Spectrum of one convolved channel, reused every block
+		CMonoBuffer<float> mixedChannels;					// Mix of the spectra of all the channels, reused every block
+		std::vector<float> ifftBuffer;						// Output of the inverse FFT, reused every block
+		Common::CFFTCalculator::TFFTWorkspace fftWorkspace;	// Scratch memory of the inverse FFT, reused every block
+		
 		Common::T_ear earToProcess;							// Ear to process
 		int numberOfAmbisonicChannels;						// Number of ambisonic channels
 		bool convolutionBuffersInitialized;					// Flag to check if the convolution buffers are initialized
 		bool enableProcessor;								// Flag to enable the processor
+		bool crossfadeActive;								// True while the previous IRs are being faded out
+		int crossfadeBlocksDone;							// Number of blocks of the current crossfade already processed
 
 
 		/////////////////////
@@ -158,22 +160,98 @@ namespace BRTProcessing {
 		/// Initialize convolvers and convolition buffers		
 		void InitializedSourceConvolutionBuffers(std::shared_ptr<BRTServices::CAmbisonicBIR>& _listenerAmbisonicBIR) {
 
+			SetupConvolvers(channelsUPConvolutionVector, _listenerAmbisonicBIR);
+			// Declare variable
+			convolutionBuffersInitialized = true;
+			convolutionBIR = _listenerAmbisonicBIR;
+			EndBIRCrossfade();
+		}
+
+		/// Set up one convolver per ambisonic channel for the given IRs, reusing the convolvers there are
+		void SetupConvolvers(std::vector<std::shared_ptr<BRTProcessing::CUniformPartitionedConvolution>>& _convolvers, std::shared_ptr<BRTServices::CAmbisonicBIR>& _listenerAmbisonicBIR) {
 			int numOfSubfilters = _listenerAmbisonicBIR->GetIRNumberOfSubfilters();
 			int subfilterLength = _listenerAmbisonicBIR->GetIRSubfilterLength();
-			
-			for (int nChannel = 0; nChannel < numberOfAmbisonicChannels; nChannel++) {								
-				std::shared_ptr<BRTProcessing::CUniformPartitionedConvolution> channelUPConvolver = std::make_shared<BRTProcessing::CUniformPartitionedConvolution>();				
+
+			_convolvers.resize(numberOfAmbisonicChannels);
+			for (std::shared_ptr<BRTProcessing::CUniformPartitionedConvolution>& channelUPConvolver : _convolvers) {
+				if (!channelUPConvolver) { channelUPConvolver = std::make_shared<BRTProcessing::CUniformPartitionedConvolution>(); }
 				channelUPConvolver->Setup(globalParameters.GetBufferSize(), subfilterLength, numOfSubfilters, true);
-				channelsUPConvolutionVector.push_back(channelUPConvolver);				
-			}			
-			// Declare variable
-			convolutionBuffersInitialized = true;
+			}
+		}
+
+		/// Convolve every ambisonic channel with its IR, mix them and transform the mix back to the time domain.
+		/// Returns false if the IRs do not provide an IR for every channel.
+		bool ProcessConvolution(std::vector<CMonoBuffer<float>>& _inChannelsBuffers, std::shared_ptr<BRTServices::CAmbisonicBIR>& _listenerAmbisonicBIR,
+			std::vector<std::shared_ptr<BRTProcessing::CUniformPartitionedConvolution>>& _convolvers, Common::CTransform& _listenerTransform, CMonoBuffer<float>& outBuffer) {
+
+			for (int nChannel = 0; nChannel < static_cast<int>(_inChannelsBuffers.size()); nChannel++) {				
+				
+				const std::vector<CMonoBuffer<float>>& oneChannel_ABIR_partitioned = _listenerAmbisonicBIR->GetChannelPartitionedIR_OneEar(nChannel, earToProcess, _listenerTransform); // GET ABIR								
+				if (oneChannel_ABIR_partitioned.size() == 0) { return false; }
+				_convolvers[nChannel]->ProcessUPConvolutionWithMemory(_inChannelsBuffers[nChannel], oneChannel_ABIR_partitioned, channelConvolved, false);
+				// Mixer, the spectra are added up as the channels are convolved
+				if (nChannel == 0) { mixedChannels = channelConvolved; }
+				else { mixedChannels += channelConvolved; }
+			}
+			mixedChannels.ApplyGain(1.0f / numberOfAmbisonicChannels);
+			// InverseFFT
+			BRTProcessing::CUniformPartitionedConvolution::CalculateIFFT(mixedChannels, outBuffer, ifftBuffer, fftWorkspace);			
+			return true;
+		}
+
+		/// Keep the convolvers of the current IRs running for the previous ones and set up new convolvers for the new IRs
+		void BeginBIRCrossfade(std::shared_ptr<BRTServices::CAmbisonicBIR>& _newAmbisonicBIR) {
+			std::shared_ptr<BRTServices::CAmbisonicBIR> previousAmbisonicBIR = convolutionBIR.lock();
+			// IRs of another order do not match the channels coming in
+			if (!previousAmbisonicBIR || previousAmbisonicBIR->GetAmbisonicOrder() != _newAmbisonicBIR->GetAmbisonicOrder() || AMBISONIC_BIR_CROSSFADE_BLOCKS <= 0) {
+				InitializedSourceConvolutionBuffers(_newAmbisonicBIR);
+				return;
+			}
+
+			std::swap(channelsUPConvolutionVector, fadingChannelsUPConvolutionVector);
+			SetupConvolvers(channelsUPConvolutionVector, _newAmbisonicBIR);
+
+			convolutionBIR = _newAmbisonicBIR;
+			fadingBIR = previousAmbisonicBIR;
+			crossfadeActive = true;
+			crossfadeBlocksDone = 0;
+		}
+
+		/// Convolve the input with the previous IRs too and fade their output into the output of the new IRs
+		void ProcessBIRCrossfade(std::vector<CMonoBuffer<float>>& _inChannelsBuffers, Common::CTransform& _listenerTransform, CMonoBuffer<float>& outBuffer) {
+			std::shared_ptr<BRTServices::CAmbisonicBIR> previousAmbisonicBIR = fadingBIR.lock();
+			if (!previousAmbisonicBIR || !previousAmbisonicBIR->IsReady() || !ProcessConvolution(_inChannelsBuffers, previousAmbisonicBIR, fadingChannelsUPConvolutionVector, _listenerTransform, fadingOutBuffer)) {
+				// The previous IRs are gone already, just continue with the new ones
+				EndBIRCrossfade();
+				return;
+			}
+
+			// Linear crossfade across all the blocks of the transition
+			const std::size_t blockSize = outBuffer.size();
+			const float totalSamples = static_cast<float>(AMBISONIC_BIR_CROSSFADE_BLOCKS * blockSize);
+			const float firstSample = static_cast<float>(crossfadeBlocksDone * blockSize);
+			for (std::size_t i = 0; i < blockSize && i < fadingOutBuffer.size(); i++) {
+				float newGain = (firstSample + static_cast<float>(i + 1)) / totalSamples;
+				outBuffer[i] = outBuffer[i] * newGain + fadingOutBuffer[i] * (1.0f - newGain);
+			}
+
+			if (++crossfadeBlocksDone >= AMBISONIC_BIR_CROSSFADE_BLOCKS) { EndBIRCrossfade(); }
+		}
+
+		/// Forget the previous IRs. Their convolvers keep their memory until the next crossfade sets them up again.
+		void EndBIRCrossfade() {
+			crossfadeActive = false;
+			crossfadeBlocksDone = 0;
+			fadingBIR.reset();
 		}
 		
 		/// Reset convolution buffers
 		void ResetBuffers() {			
 			convolutionBuffersInitialized = false;
 			channelsUPConvolutionVector.clear();
+			fadingChannelsUPConvolutionVector.clear();
+			convolutionBIR.reset();
+			EndBIRCrossfade();
 		}
 
 	};
@@ -38,40 +38,33 @@ namespace BRTProcessing {
 		
     public:
 		CAmbisonicDomainConvolverProcessor(Common::T_ear _earToProcess) : CAmbisonicDomainConvolver(_earToProcess) {
-			CreateMultipleChannelsEntryPoint("inputChannels", 1);            
-			CreateABIRPtrEntryPoint("listenerAmbisonicBIR");
-			CreateIDEntryPoint("sourceID");
-			CreateIDEntryPoint("listenerID");
-			CreatePositionEntryPoint("listenerPosition");
-            CreateSamplesExitPoint("outSamples");			            
+			inputChannelsPort = CreateMultipleChannelsEntryPoint("inputChannels", 1);            
+			listenerAmbisonicBIRPort = CreateABIRPtrEntryPoint("listenerAmbisonicBIR");
+			sourceIDPort = CreateIDEntryPoint("sourceID");
+			listenerIDPort = CreateIDEntryPoint("listenerID");
+			listenerPositionPort = CreatePositionEntryPoint("listenerPosition");
+            outSamplesPort = CreateSamplesExitPoint("outSamples");			            
         }
 		
-		/**
-		 * @brief Implementation of CProcessorBase virtual method
-		 * @param _entryPointId entryPoint ID
-		*/
-		void OneEntryPointOneDataReceived(std::string _entryPointId) {
-			std::lock_guard<std::mutex> l(mutex);
-			if (_entryPointId == "inputChannels") {				
-				std::vector<CMonoBuffer<float>> inputChannels = GetMultipleSamplesVectorEntryPoint("inputChannels")->GetData();
-				if (inputChannels.size() != 0) { MixChannelsBuffer(inputChannels); }
-			}
-		}
-        
 		/**
 		 * @brief Implementation of CProcessorBase virtual method
 		*/
 		void AllEntryPointsAllDataReady() {
 			
 			std::lock_guard<std::mutex> l(mutex);
-			if (channelsBuffer.size() == 0) { return;	}
-			CMonoBuffer<float> outBuffer;			
+			// The sources are mixed in the order they were connected, whatever order they have been rendered in
+			bool channelsReceived = false;
+			GetMultipleSamplesVectorEntryPoint(inputChannelsPort)->ForEachReceivedData([this, &channelsReceived](const std::vector<CMonoBuffer<float>>& _inputChannels) {
+				if (_inputChannels.size() == 0) { return; }
+				MixChannelsBuffer(_inputChannels, !channelsReceived);
+				channelsReceived = true;
+			});
+			if (!channelsReceived) { return; }
 							
-			std::weak_ptr<BRTServices::CAmbisonicBIR> listenerABIR = GetABIRPtrEntryPoint("listenerAmbisonicBIR")->GetData();
-			Common::CTransform _listenerTransform = GetPositionEntryPoint("listenerPosition")->GetData();
+			std::weak_ptr<BRTServices::CAmbisonicBIR> listenerABIR = GetABIRPtrEntryPoint(listenerAmbisonicBIRPort)->GetData();
+			Common::CTransform _listenerTransform = GetPositionEntryPoint(listenerPositionPort)->GetData();
 			Process(channelsBuffer, outBuffer, listenerABIR, _listenerTransform);
-			GetSamplesExitPoint("outSamples")->sendData(outBuffer);					
-			channelsBuffer.clear();
+			GetSamplesExitPoint(outSamplesPort)->sendData(outBuffer);					
 			
 			
         }
@@ -102,19 +95,28 @@ namespace BRTProcessing {
        
 		mutable std::mutex mutex;				
 		std::vector<CMonoBuffer<float>> channelsBuffer;		// To store the mix of the ambisonic channels before doing the process.
+		CMonoBuffer<float> outBuffer;						// Output, its storage is reused from block to block
+		int inputChannelsPort;								// Indices of the entry and exit points
+		int listenerAmbisonicBIRPort;
+		int sourceIDPort;
+		int listenerIDPort;
+		int listenerPositionPort;
+		int outSamplesPort;
 				
 		/**
 		 * @brief Mix new channes with buffer channesl
 		 * @param inputChannels Vector of CMonoBuffer to be mixed with the buffer
+		 * @param _first true to overwrite the buffer, for the first source of the frame
 		*/
-		void MixChannelsBuffer(std::vector<CMonoBuffer<float>> inputChannels) {
+		void MixChannelsBuffer(const std::vector<CMonoBuffer<float>>& inputChannels, bool _first) {
 			
 			if (channelsBuffer.size() != inputChannels.size()) {
 				channelsBuffer = std::vector<CMonoBuffer<float>>(inputChannels.size(), CMonoBuffer<float>(inputChannels[0].size()));
 			}
 
 			for (int nChannel = 0; nChannel < inputChannels.size(); nChannel++) {
-				channelsBuffer[nChannel] += inputChannels[nChannel];
+				if (_first) { channelsBuffer[nChannel].assign(inputChannels[nChannel].begin(), inputChannels[nChannel].end()); }
+				else { channelsBuffer[nChannel] += inputChannels[nChannel]; }
 			}
 		}
 
@@ -123,24 +125,16 @@ namespace BRTProcessing {
 		 * @param _sourceID Source ID
 		 * @return true if yes
 		*/
-		bool IsToMySoundSource(std::string _sourceID) {
-			std::string mySourceID = GetIDEntryPoint("sourceID")->GetData();
-			return mySourceID == _sourceID;
+		bool IsToMySoundSource(const std::string& _sourceID) const {
+			return GetIDEntryPoint(sourceIDPort)->GetDataRef() == _sourceID;
 		}
 		/**
 		 * @brief Check if this module is connected to the indicated listener.
 		 * @param _listenerID Listener ID
 		 * @return true if yes
 		*/
-		bool IsToMyListener(std::string _listenerID) {						
-			std::shared_ptr<BRTConnectivity::CEntryPointID> _listenerIDEntryPoint = GetIDEntryPoint("listenerID");
-			if (_listenerIDEntryPoint != nullptr) {
-				std::string myListenerID = _listenerIDEntryPoint->GetData();
-				return myListenerID == _listenerID;
-			}
-			else {
-				return false;
-			}			
+		bool IsToMyListener(const std::string& _listenerID) const {						
+			return GetIDEntryPoint(listenerIDPort)->GetDataRef() == _listenerID;
 		}
     };
 }
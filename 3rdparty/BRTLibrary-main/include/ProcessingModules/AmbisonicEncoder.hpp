@@ -90,7 +90,7 @@ namespace BRTProcessing {
 
 		
 		/**
-		 * @brief Init ambisonic channels 
+		 * @brief Init ambisonic channels, silent. Nothing is allocated if they have the right number and size already.
 		 * @return vector of as many CMonoBuffers as ambisonic channels
 		*/
 		void InitAmbisonicChannels(std::vector< CMonoBuffer<float>>& channelsBuffers, int bufferSize) {
@@ -99,7 +99,10 @@ namespace BRTProcessing {
 				channelsBuffers = std::vector< CMonoBuffer<float> >();
 			}
 
-			channelsBuffers = std::vector< CMonoBuffer<float>>(GetTotalChannels(), CMonoBuffer<float>(bufferSize, 0.0f));			
+			channelsBuffers.resize(GetTotalChannels());
+			for (CMonoBuffer<float>& channelBuffer : channelsBuffers) {
+				channelBuffer.assign(bufferSize, 0.0f);
+			}
 		}
 
 		/**
@@ -116,7 +119,7 @@ namespace BRTProcessing {
 				return; 
 			}			
 			
-			std::vector<double> ambisonicFactors = GetRealSphericalHarmonics(DegreesToRadians(_azimuthDegress), DegreesToRadians(_elevationDegress));
+			GetRealSphericalHarmonics(DegreesToRadians(_azimuthDegress), DegreesToRadians(_elevationDegress), ambisonicFactors);
 			
 			for (int nChannel = 0; nChannel < GetTotalChannels(); nChannel++) {				
 				for (int nSample = 0; nSample < inBuffer.size(); nSample++)	{							
@@ -125,6 +128,44 @@ namespace BRTProcessing {
 			}
 		}
 		
+		/**
+		 * @brief Performs coding of all ambisonic channels as a function of azimuth and elevation, ramping the factors across the buffer
+		 * from those of the previous call, so that a change of direction does not make the output jump
+		 * @param inBuffer Input samples
+		 * @param outVectorOfBuffers vector of as many CMonoBuffers as ambisonic channels
+		 * @param azimuth source azimuth
+		 * @param elevation source elevetaion
+		 * @param previousFactors factors of the previous call, empty if there is none. Receives the factors of this call.
+		*/
+		void EncodedIR(const CMonoBuffer<float>& inBuffer, std::vector< CMonoBuffer<float> >& channelsOutBuffers, float _azimuthDegress, float _elevationDegress, std::vector<double>& previousFactors) {
+
+			if (!initialized) {
+				SET_RESULT(RESULT_ERROR_NOTSET, "AmbisonicEncoder class not initialised");
+				return;
+			}
+
+			GetRealSphericalHarmonics(DegreesToRadians(_azimuthDegress), DegreesToRadians(_elevationDegress), ambisonicFactors);
+
+			if (previousFactors.size() != ambisonicFactors.size() || previousFactors == ambisonicFactors) {
+				for (int nChannel = 0; nChannel < GetTotalChannels(); nChannel++) {
+					for (int nSample = 0; nSample < inBuffer.size(); nSample++) {
+						channelsOutBuffers[nChannel][nSample] += inBuffer[nSample] * ambisonicFactors[nChannel];
+					}
+				}
+			}
+			else {
+				const double bufferSize = static_cast<double>(inBuffer.size());
+				for (int nChannel = 0; nChannel < GetTotalChannels(); nChannel++) {
+					const double step = (ambisonicFactors[nChannel] - previousFactors[nChannel]) / bufferSize;
+					for (int nSample = 0; nSample < inBuffer.size(); nSample++) {
+						channelsOutBuffers[nChannel][nSample] += inBuffer[nSample] * (previousFactors[nChannel] + step * (nSample + 1));
+					}
+				}
+			}
+
+			previousFactors.assign(ambisonicFactors.begin(), ambisonicFactors.end());
+		}
+
 		void EncodedPartitionedIR(const std::vector<CMonoBuffer<float>>& inPartitionedBuffer, std::vector<std::vector< CMonoBuffer<float>>>& partitionedChannelsOutBuffers, float _azimuthDegress, float _elevationDegress) {
 
 			if (!initialized) {
@@ -156,6 +197,7 @@ namespace BRTProcessing {
 		int ambisonicOrder;
 		int numberOfChannels;
 		TAmbisonicNormalization normalization;
+		std::vector<double> ambisonicFactors;		// Factors of the last EncodedIR() call, reused every block
 	
 
 		/////////////////////
@@ -169,9 +211,21 @@ namespace BRTProcessing {
 		 * @return Vector of floats containing the factors in order, the size of the vector will depend on the order [4, 9, 16].
 		*/
 		std::vector<double> GetRealSphericalHarmonics(double _ambisonicAzimut, double _ambisonicElevation) {
-			if (!initialized) { return std::vector<double>(); }
+			std::vector<double> _factors;
+			GetRealSphericalHarmonics(_ambisonicAzimut, _ambisonicElevation, _factors);
+			return _factors;
+		}
+
+		/**
+		 * @brief Get the ambisonic factors like GetRealSphericalHarmonics(), into the given vector
+		 * @param _ambisonicAzimut azimuth to calculate the factors
+		 * @param _ambisonicElevation elevation to calculate the factors
+		 * @param _factors Receives the factors in order. Nothing is allocated if it has room for them already.
+		*/
+		void GetRealSphericalHarmonics(double _ambisonicAzimut, double _ambisonicElevation, std::vector<double>& _factors) {
+			if (!initialized) { _factors.clear(); return; }
 
-			std::vector<double> _factors(GetTotalChannels());	// Init
+			_factors.assign(GetTotalChannels(), 0.0);	// Init
 			
 			switch (GetOrder())
 			{
@@ -204,8 +258,6 @@ namespace BRTProcessing {
 
 			if (normalization == TAmbisonicNormalization::SN3D) { ConvertN3DtoSN3D(_factors); }
 			else if (normalization == TAmbisonicNormalization::maxN) { ConvertN3DtoMaxN(_factors); }
-			
-			return _factors;
 		}
 		/**
 		 * @brief Apply a normalisation to the ambisonic factors
@@ -121,7 +121,7 @@ namespace BRTProcessing {
 		 * @param _listenerHRTFWeak Weak smart pointer to the listener HRTF
 		 * @param _listenerILDWeak Weak smart pointer to the listener ILD
 		*/
-		void Process(CMonoBuffer<float>& _inBuffer, std::vector<CMonoBuffer<float>>& leftChannelsBuffers, std::vector<CMonoBuffer<float>>& rightChannelsBuffers, Common::CTransform& sourceTransform, Common::CTransform& listenerTransform, std::weak_ptr<BRTServices::CServicesBase>& _listenerHRTFWeak, std::weak_ptr<BRTServices::CSOSFilters>& _listenerILDWeak) {
+		void Process(const CMonoBuffer<float>& _inBuffer, std::vector<CMonoBuffer<float>>& leftChannelsBuffers, std::vector<CMonoBuffer<float>>& rightChannelsBuffers, Common::CTransform& sourceTransform, Common::CTransform& listenerTransform, std::weak_ptr<BRTServices::CServicesBase>& _listenerHRTFWeak, std::weak_ptr<BRTServices::CSOSFilters>& _listenerILDWeak) {
 
 			std::lock_guard<std::mutex> l(mutex);
 			
@@ -132,9 +132,7 @@ namespace BRTProcessing {
 
 			// Check if the processor is enabled
 			if (!enableProcessor) {
-				ambisonicEncoder.EncodedIR(CMonoBuffer<float>(globalParameters.GetBufferSize(), 0.0f), leftChannelsBuffers, 0, 0);
-				ambisonicEncoder.EncodedIR(CMonoBuffer<float>(globalParameters.GetBufferSize(), 0.0f), rightChannelsBuffers, 0, 0);
-				return;
+				return;		// The channels are silent already
 			}
 
 			// Check listener HRTF
@@ -150,10 +148,7 @@ namespace BRTProcessing {
 			if (distanceToListener <= _listenerHRTF->GetHeadRadius())
 			{
 				SET_RESULT(RESULT_WARNING, "The source is inside the listener's head.");
-				
-				ambisonicEncoder.EncodedIR(CMonoBuffer<float>(globalParameters.GetBufferSize(), 0.0f), leftChannelsBuffers, 0, 0);
-				ambisonicEncoder.EncodedIR(CMonoBuffer<float>(globalParameters.GetBufferSize(), 0.0f), rightChannelsBuffers, 0, 0);				
-				return;
+				return;		// The channels are silent already
 			}
 						
 			// Calculate Source coordinates taking into account Source and Listener transforms
@@ -180,19 +175,15 @@ namespace BRTProcessing {
 				rightDelay = 0;
 			}
 			// ADD Delay
-			CMonoBuffer<float> delayedLeftEarBuffer;
-			CMonoBuffer<float> delayedRightEarBuffer;			
 			Common::CAddDelayExpansionMethod::ProcessAddDelay_ExpansionMethod(_inBuffer, delayedLeftEarBuffer, leftChannelDelayBuffer, leftDelay);
 			Common::CAddDelayExpansionMethod::ProcessAddDelay_ExpansionMethod(_inBuffer, delayedRightEarBuffer, rightChannelDelayBuffer, rightDelay);
 			
 			// Near Field Proccess
-			CMonoBuffer<float> nearFilteredLeftEarBuffer;
-			CMonoBuffer<float> nearFilteredRightEarBuffer;			
 			nearFieldEffectProcess.Process(delayedLeftEarBuffer, delayedRightEarBuffer, nearFilteredLeftEarBuffer, nearFilteredRightEarBuffer, sourceTransform, listenerTransform, _listenerILDWeak);
 
-			// Ambisonic Encoder						
-			ambisonicEncoder.EncodedIR(nearFilteredLeftEarBuffer, leftChannelsBuffers, leftAzimuth, leftElevation);
-			ambisonicEncoder.EncodedIR(nearFilteredRightEarBuffer, rightChannelsBuffers, rightAzimuth, rightElevation);
+			// Ambisonic Encoder, gliding from the direction of the previous block so that moving sources and head rotation do not zipper
+			ambisonicEncoder.EncodedIR(nearFilteredLeftEarBuffer, leftChannelsBuffers, leftAzimuth, leftElevation, previousLeftFactors);
+			ambisonicEncoder.EncodedIR(nearFilteredRightEarBuffer, rightChannelsBuffers, rightAzimuth, rightElevation, previousRightFactors);
 		}
 
 		/// Reset convolvers and convolution buffers
@@ -202,6 +193,8 @@ namespace BRTProcessing {
 			leftChannelDelayBuffer.clear();
 			rightChannelDelayBuffer.clear();
 			nearFieldEffectProcess.ResetProcessBuffers();
+			previousLeftFactors.clear();
+			previousRightFactors.clear();
 		}
 
 	private:
@@ -215,6 +208,12 @@ namespace BRTProcessing {
 
 		CMonoBuffer<float> leftChannelDelayBuffer;				// To store the delay of the left channel of the expansion method
 		CMonoBuffer<float> rightChannelDelayBuffer;				// To store the delay of the right channel of the expansion method
+		CMonoBuffer<float> delayedLeftEarBuffer;				// Input with the delay of each ear, reused every block
+		CMonoBuffer<float> delayedRightEarBuffer;
+		CMonoBuffer<float> nearFilteredLeftEarBuffer;			// Delayed input after the near field effect, reused every block
+		CMonoBuffer<float> nearFilteredRightEarBuffer;
+		std::vector<double> previousLeftFactors;				// Ambisonic factors of the last block, ramped from
+		std::vector<double> previousRightFactors;
 		int ambisonicOrder;
 		BRTProcessing::TAmbisonicNormalization ambisonicNormalization;
 		
@@ -39,19 +39,19 @@ class CBilateralAmbisonicEncoderProcessor : public BRTConnectivity::CBRTConnecti
 		
     public:
 		CBilateralAmbisonicEncoderProcessor() {
-            CreateSamplesEntryPoint("inputSamples");
+            inputSamplesPort = CreateSamplesEntryPoint("inputSamples");
 
-            CreatePositionEntryPoint("sourcePosition");
-			CreatePositionEntryPoint("listenerPosition");           
-			CreateHRTFPtrEntryPoint("listenerHRTF");
-			CreateHRBRIRPtrEntryPoint("listenerHRBRIR");
-			CreateILDPtrEntryPoint("listenerILD");
+            sourcePositionPort = CreatePositionEntryPoint("sourcePosition");
+			listenerPositionPort = CreatePositionEntryPoint("listenerPosition");           
+			listenerHRTFPort = CreateHRTFPtrEntryPoint("listenerHRTF");
+			listenerHRBRIRPort = CreateHRBRIRPtrEntryPoint("listenerHRBRIR");
+			listenerILDPort = CreateILDPtrEntryPoint("listenerILD");
 
-			CreateIDEntryPoint("sourceID");
-			CreateIDEntryPoint("listenerID");
+			sourceIDPort = CreateIDEntryPoint("sourceID");
+			listenerIDPort = CreateIDEntryPoint("listenerID");
 
-			CreateMultipleSamplesExitPoint("leftAmbisonicChannels");
-			CreateMultipleSamplesExitPoint("rightAmbisonicChannels");
+			leftAmbisonicChannelsPort = CreateMultipleSamplesExitPoint("leftAmbisonicChannels");
+			rightAmbisonicChannelsPort = CreateMultipleSamplesExitPoint("rightAmbisonicChannels");
         }
 
 		/**
@@ -61,18 +61,15 @@ class CBilateralAmbisonicEncoderProcessor : public BRTConnectivity::CBRTConnecti
 			
 			//std::lock_guard<std::mutex> l(mutex);
 
-			std::vector<CMonoBuffer<float>> leftAmbisonicChannelsBuffers;
-			std::vector<CMonoBuffer<float>> rightAmbisonicChannelsBuffers;
-			CMonoBuffer<float> outRightBuffer;
-			
-			CMonoBuffer<float> buffer = GetSamplesEntryPoint("inputSamples")->GetData();
+			// The input is read in place, from the exit point of the source
+			const CMonoBuffer<float>& buffer = GetSamplesEntryPoint(inputSamplesPort)->GetDataRef();
 			if (buffer.size() == 0) { return; }
 
-			Common::CTransform sourcePosition = GetPositionEntryPoint("sourcePosition")->GetData();
-			Common::CTransform listenerPosition = GetPositionEntryPoint("listenerPosition")->GetData();												
-			std::weak_ptr<BRTServices::CServicesBase> listenerHRTF = GetHRTFPtrEntryPoint("listenerHRTF")->GetData();
-			std::weak_ptr<BRTServices::CServicesBase> listenerHRBRIR = GetHRBRIRPtrEntryPoint("listenerHRBRIR")->GetData();
-			std::weak_ptr<BRTServices::CSOSFilters> listenerNFCFilters = GetILDPtrEntryPoint("listenerILD")->GetData();
+			Common::CTransform sourcePosition = GetPositionEntryPoint(sourcePositionPort)->GetData();
+			Common::CTransform listenerPosition = GetPositionEntryPoint(listenerPositionPort)->GetData();												
+			std::weak_ptr<BRTServices::CServicesBase> listenerHRTF = GetHRTFPtrEntryPoint(listenerHRTFPort)->GetData();
+			std::weak_ptr<BRTServices::CServicesBase> listenerHRBRIR = GetHRBRIRPtrEntryPoint(listenerHRBRIRPort)->GetData();
+			std::weak_ptr<BRTServices::CSOSFilters> listenerNFCFilters = GetILDPtrEntryPoint(listenerILDPort)->GetData();
 			
 			if (listenerHRTF.lock() != nullptr) {
 				Process(buffer, leftAmbisonicChannelsBuffers, rightAmbisonicChannelsBuffers, sourcePosition, listenerPosition, listenerHRTF, listenerNFCFilters);
@@ -84,8 +81,8 @@ class CBilateralAmbisonicEncoderProcessor : public BRTConnectivity::CBRTConnecti
 				SET_RESULT(RESULT_ERROR_NOTSET, "Bilateral Ambisonic Encoder Processor ERROR: No HRTF or HRBRIR data available");
 				return;
 			}								
-			GetMultipleSamplesVectorExitPoint("leftAmbisonicChannels")->sendData(leftAmbisonicChannelsBuffers);
-			GetMultipleSamplesVectorExitPoint("rightAmbisonicChannels")->sendData(rightAmbisonicChannelsBuffers);										
+			GetMultipleSamplesVectorExitPoint(leftAmbisonicChannelsPort)->sendData(leftAmbisonicChannelsBuffers);
+			GetMultipleSamplesVectorExitPoint(rightAmbisonicChannelsPort)->sendData(rightAmbisonicChannelsBuffers);										
         }
 
 		/**
@@ -135,16 +132,28 @@ class CBilateralAmbisonicEncoderProcessor : public BRTConnectivity::CBRTConnecti
 
     private:       				
 		/// Check Source ID
-		bool IsToMySoundSource(std::string _sourceID) {
-			std::string mySourceID = GetIDEntryPoint("sourceID")->GetData();
-			return mySourceID == _sourceID;
+		bool IsToMySoundSource(const std::string& _sourceID) const {
+			return GetIDEntryPoint(sourceIDPort)->GetDataRef() == _sourceID;
 		}
 		
 		/// Check Listener ID
-		bool IsToMyListener(std::string _listenerID) {
-			std::string myListenerID = GetIDEntryPoint("listenerID")->GetData();
-			return myListenerID == _listenerID;
+		bool IsToMyListener(const std::string& _listenerID) const {
+			return GetIDEntryPoint(listenerIDPort)->GetDataRef() == _listenerID;
 		}
+
+		int inputSamplesPort;							// Indices of the entry and exit points
+		int sourcePositionPort;
+		int listenerPositionPort;
+		int listenerHRTFPort;
+		int listenerHRBRIRPort;
+		int listenerILDPort;
+		int sourceIDPort;
+		int listenerIDPort;
+		int leftAmbisonicChannelsPort;
+		int rightAmbisonicChannelsPort;
+
+		std::vector<CMonoBuffer<float>> leftAmbisonicChannelsBuffers;	// Ambisonic channels of each ear, reused every block
+		std::vector<CMonoBuffer<float>> rightAmbisonicChannelsBuffers;
     };
 }
 #endif
\ No newline at end of file
@@ -108,7 +108,7 @@ namespace BRTProcessing {
 		 * @param listenerTransform listener position and orientation
 		 * @param _SOSFilterWeakPtr pointer to SOS filter 
 		 */
-		void Process(CMonoBuffer<float>& _inLeftBuffer, CMonoBuffer<float>& _inRightBuffer, CMonoBuffer<float>& outLeftBuffer, CMonoBuffer<float>& outRightBuffer, Common::CTransform& sourceTransform, Common::CTransform& listenerTransform, std::weak_ptr<BRTServices::CSOSFilters>& _SOSFilterWeakPtr)
+		void Process(const CMonoBuffer<float>& _inLeftBuffer, const CMonoBuffer<float>& _inRightBuffer, CMonoBuffer<float>& outLeftBuffer, CMonoBuffer<float>& outRightBuffer, Common::CTransform& sourceTransform, Common::CTransform& listenerTransform, std::weak_ptr<BRTServices::CSOSFilters>& _SOSFilterWeakPtr)
 		{
 			outLeftBuffer = _inLeftBuffer;
 			outRightBuffer = _inRightBuffer;
@@ -168,7 +168,7 @@ namespace BRTProcessing {
 		 * @param outLeftBuffer out left ear buffer
 		 * @param outRightBuffer out right ear buffer
 		 */
-		void Process(CMonoBuffer<float> & _inLeftBuffer, CMonoBuffer<float> & _inRightBuffer, CMonoBuffer<float> & outLeftBuffer, CMonoBuffer<float> & outRightBuffer)
+		void Process(const CMonoBuffer<float> & _inLeftBuffer, const CMonoBuffer<float> & _inRightBuffer, CMonoBuffer<float> & outLeftBuffer, CMonoBuffer<float> & outRightBuffer)
 		{
 			outLeftBuffer = _inLeftBuffer;
 			outRightBuffer = _inRightBuffer;
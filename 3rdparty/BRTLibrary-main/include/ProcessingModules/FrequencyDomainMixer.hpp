@@ -0,0 +1,153 @@
+/**
+* \class CFrequencyDomainMixer
+*
+* \brief Declaration of CFrequencyDomainMixer class interface.
+* \date	June 2023
+*
+* \authors 3DI-DIANA Research Group (University of Malaga), in alphabetical order: M. Cuevas-Rodriguez, D. Gonzalez-Toledo, L. Molina-Tanco, F. Morales-Benitez ||
+* Coordinated by , A. Reyes-Lecuona (University of Malaga)||
+* \b Contact: areyes@uma.es
+*
+* \b Copyright: University of Malaga
+*
+* \b Contributions: (additional authors/contributors can be added here)
+*
+* \b Project: SONICOM ||
+* \b Website: https://www.sonicom.eu/
+*
+* \b Acknowledgement: This project has received funding from the European Union's Horizon 2020 research and innovation programme under grant agreement no.101017743
+*
+* \b Licence: This program is free software, you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+*/
+
+
+#ifndef _C_FREQUENCY_DOMAIN_MIXER_HPP_
+#define _C_FREQUENCY_DOMAIN_MIXER_HPP_
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <Common/Buffer.hpp>
+#include <ProcessingModules/StereoUniformPartitionedConvolution.hpp>
+
+namespace BRTProcessing {
+
+	/** \details Sum of the output spectra of the convolvers of all the sources of a listener.
+	*	The convolvers register their spectra once and mark them as ready during the block, possibly from several render threads.
+	*	The listener sums them at the end of the block, in registration order so that the result does not depend on the order the
+	*	sources have been rendered in, and turns the sums into time signals with only one inverse FFT per ear, whatever the number of sources.
+	*/
+	class CFrequencyDomainMixer
+	{
+	public:
+		/** \brief Default constructor
+		*   \eh Nothing is reported to the error handler.
+		*/
+		CFrequencyDomainMixer() : inputSize{ 0 }, hasData{ false } { }
+
+		/** \brief Register the output spectra of one convolver. They are read by MixInto, so they must outlive the registration. Thread-safe.
+		*	\param [in] _leftSpectrum left output spectrum, see CStereoUniformPartitionedConvolution::AccumulateUPConvolutionWithMemory()
+		*	\param [in] _rightSpectrum right output spectrum
+		*	\retval contributor identifier to pass to Add and RemoveContributor
+		*   \eh Nothing is reported to the error handler.
+		*/
+		int AddContributor(const CMonoBuffer<float>* _leftSpectrum, const CMonoBuffer<float>* _rightSpectrum) {
+			std::lock_guard<std::mutex> l(mutex);
+			auto freeSlot = std::find_if(contributors.begin(), contributors.end(), [](const TContributor& _contributor) { return _contributor.leftSpectrum == nullptr; });
+			if (freeSlot == contributors.end()) { freeSlot = contributors.insert(contributors.end(), TContributor()); }
+			freeSlot->leftSpectrum = _leftSpectrum;
+			freeSlot->rightSpectrum = _rightSpectrum;
+			freeSlot->ready = false;
+			return static_cast<int>(freeSlot - contributors.begin());
+		}
+
+		/** \brief Unregister the spectra of one convolver. Thread-safe.
+		*	\param [in] _contributor identifier returned by AddContributor
+		*   \eh Nothing is reported to the error handler.
+		*/
+		void RemoveContributor(int _contributor) {
+			std::lock_guard<std::mutex> l(mutex);
+			if (_contributor < 0 || _contributor >= static_cast<int>(contributors.size())) { return; }
+			contributors[_contributor] = TContributor();
+		}
+
+		/** \brief Tell the mixer that the registered spectra of one convolver hold its output for this block. Thread-safe.
+		*	\details All the convolvers of a block must have the same sizes. Spectra of another size are left out of the mix.
+		*	\param [in] _contributor identifier returned by AddContributor
+		*	\param [in] _inputSize size of the output signals (B size)
+		*   \eh Nothing is reported to the error handler.
+		*/
+		void Add(int _contributor, int _inputSize) {
+			std::lock_guard<std::mutex> l(mutex);
+			if (_contributor < 0 || _contributor >= static_cast<int>(contributors.size())) { return; }
+			inputSize = _inputSize;
+			contributors[_contributor].ready = true;
+			hasData = true;
+		}
+
+		/** \brief Add the time signals of the sums to the given buffers and start the next block
+		*	\param [in,out] _leftBuffer left signal of B size
+		*	\param [in,out] _rightBuffer right signal of B size
+		*   \eh Nothing is reported to the error handler.
+		*/
+		void MixInto(CMonoBuffer<float>& _leftBuffer, CMonoBuffer<float>& _rightBuffer) {
+			std::lock_guard<std::mutex> l(mutex);
+			if (!hasData) { return; }
+
+			bool first = true;
+			for (TContributor& contributor : contributors) {
+				if (!contributor.ready) { continue; }
+				contributor.ready = false;
+				if (first) {
+					leftSum.assign(contributor.leftSpectrum->begin(), contributor.leftSpectrum->end());
+					rightSum.assign(contributor.rightSpectrum->begin(), contributor.rightSpectrum->end());
+					first = false;
+				}
+				else if (contributor.leftSpectrum->size() == leftSum.size() && contributor.rightSpectrum->size() == rightSum.size()) {
+					leftSum += *contributor.leftSpectrum;
+					rightSum += *contributor.rightSpectrum;
+				}
+			}
+			hasData = false;
+			if (first || leftSum.size() != rightSum.size()) { return; }
+
+			MixSum(leftSum, _leftBuffer);
+			MixSum(rightSum, _rightBuffer);
+		}
+
+		/** \brief Drop the spectra of the current block
+		*/
+		void Reset() {
+			std::lock_guard<std::mutex> l(mutex);
+			for (TContributor& contributor : contributors) { contributor.ready = false; }
+			hasData = false;
+		}
+
+	private:
+		struct TContributor {
+			const CMonoBuffer<float>* leftSpectrum = nullptr;		// nullptr while the slot is free
+			const CMonoBuffer<float>* rightSpectrum = nullptr;
+			bool ready = false;									// True if the spectra have been filled since the last mix
+		};
+
+		/// Add the time signal of one sum to the buffer
+		void MixSum(CMonoBuffer<float>& _sum, CMonoBuffer<float>& _buffer) {
+			CStereoUniformPartitionedConvolution::CalculateOutputIFFT(_sum, outputBuffer, ifftBuffer, fftWorkspace, inputSize);
+			if (_buffer.size() != outputBuffer.size()) {
+				_buffer.assign(outputBuffer.size(), 0.0f);
+			}
+			_buffer += outputBuffer;
+		}
+
+		int inputSize;							// Size of the output signals
+		bool hasData;							// True if any convolver has added its output since the last mix
+		std::mutex mutex;						// The sources may be rendered in parallel
+		std::vector<TContributor> contributors;	// Spectra of the convolvers, summed in this order
+		CMonoBuffer<float> leftSum;				// Sums of the output spectra of all the sources
+		CMonoBuffer<float> rightSum;
+		CMonoBuffer<float> outputBuffer;		// Time signal of one of the sums, reused every block
+		std::vector<float> ifftBuffer;			// Output of the IFFT, reused every block
+		Common::CFFTCalculator::TFFTWorkspace fftWorkspace;	// Scratch memory of the IFFT, reused every block
+	};
+}
+#endif
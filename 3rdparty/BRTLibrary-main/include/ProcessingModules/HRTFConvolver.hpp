@@ -25,7 +25,8 @@
 #ifndef _HRTF_CONVOLVER_
 #define _HRTF_CONVOLVER_
 
-#include <ProcessingModules/UniformPartitionedConvolution.hpp>
+#include <ProcessingModules/StereoUniformPartitionedConvolution.hpp>
+#include <ProcessingModules/FrequencyDomainMixer.hpp>
 #include <Common/Buffer.hpp>
 #include <Common/AddDelayExpansionMethod.hpp>
 #include <Common/SourceListenerRelativePositionCalculation.hpp>
@@ -34,15 +35,35 @@
 #include <memory>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+
+#define HRTF_CROSSFADE_BLOCKS 2				///< Number of blocks over which the output of the previous HRTF is faded into the new one
+#define RENDERING_TIER_CROSSFADE_BLOCKS 2	///< Number of blocks over which the output of the previous rendering tier is faded into the new one
+#define PANNING_ILD_DEPTH 0.5f				///< Gain added to the near ear, and removed from the far one, by the panning tier for a fully lateral source
 
 //#define EPSILON 0.0001f
 //#define ELEVATION_SINGULAR_POINT_UP 90.0
 //#define ELEVATION_SINGULAR_POINT_DOWN 270.0
 
 namespace BRTProcessing {
+
+	/** \brief Level of detail a source is rendered with, from the most expensive to the cheapest
+	*/
+	enum class TRenderingTier {
+		Full,		///< Convolution with interpolated HRIRs, followed by the near field effect if it is enabled
+		Reduced,	///< Convolution with the nearest HRIRs, without interpolation nor near field effect
+		Panning,	///< No convolution, only a level difference between the ears and the ITD
+		Culled		///< Not rendered, the output is silence
+	};
+
 	class CHRTFConvolver  {
 	public:
-		CHRTFConvolver() : enableProcessor{true}, enableInterpolation{true}, enableSpatialization{true}, enableITDSimulation{true}, enableParallaxCorrection{true}, convolutionBuffersInitialized{false} { }
+		CHRTFConvolver() : frequencyDomainMixerContributor{-1}, HRIRTolerance{0.0f}, enableProcessor{true}, enableSpatialization{true}, enableInterpolation{true}, enableITDSimulation{true}, enableParallaxCorrection{true}, convolutionBuffersInitialized{false}, crossfadeActive{false}, crossfadeBlocksDone{0},
+			renderingTier{TRenderingTier::Full}, fadingRenderingTier{TRenderingTier::Full}, tierCrossfadeActive{false}, tierCrossfadeBlocksDone{0}, convolutionIdle{false}, panningIdle{true}, previousLeftPanningGain{1.0f}, previousRightPanningGain{1.0f}, silentInputBlocks{0}, delayBuffersIdle{false}, convolvedLastBlock{false}, previousLeftDelay{0}, previousRightDelay{0} { }
+
+		~CHRTFConvolver() {
+			if (frequencyDomainMixer) { frequencyDomainMixer->RemoveContributor(frequencyDomainMixerContributor); }
+		}
 
 		/**
 		 * @brief Enable processor
@@ -115,6 +136,62 @@ namespace BRTProcessing {
 		 * @return true if Parallax Correction is enabled, false otherwise
 		 */
 		bool IsParallaxCorrectionEnabled() { return enableParallaxCorrection; }
+
+		/**
+		 * @brief Set how far the source can move, relative to each ear, before its HRIRs are looked up again.
+		 * While it stays within the tolerance of the direction the interpolated HRIRs were obtained for, they are reused as they are.
+		 * @param _degrees tolerance in degrees of azimuth and of elevation, 0 only reuses them for the very same direction
+		 */
+		void SetHRIRTolerance(float _degrees) { HRIRTolerance = std::max(_degrees, 0.0f); }
+		/**
+		 * @brief Get the tolerance within which the HRIRs are reused.
+		 * @return tolerance in degrees
+		 */
+		float GetHRIRTolerance() { return HRIRTolerance; }
+
+		/**
+		 * @brief Add the output spectra of this convolver to the given mixer instead of making the inverse FFTs here.
+		 * The ITD is then applied in the frequency domain, as a linear phase of the HRIRs, and changes from block to block
+		 * instead of being stretched. It is limited to CStereoUniformPartitionedConvolution::GetMaxFrequencyDomainDelay().
+		 * The time outputs carry silence while the spectra are mixed, or the whole signal during an HRTF crossfade.
+		 * Switching between both modes resets the convolution buffers.
+		 * @param _mixer mixer shared by all the sources of the listener, nullptr to output time signals
+		 */
+		void SetFrequencyDomainMixer(std::shared_ptr<CFrequencyDomainMixer> _mixer) {
+			const bool modeChanged = (_mixer == nullptr) != (frequencyDomainMixer == nullptr);
+			if (_mixer == frequencyDomainMixer) { return; }
+			if (frequencyDomainMixer) { frequencyDomainMixer->RemoveContributor(frequencyDomainMixerContributor); }
+			frequencyDomainMixer = _mixer;
+			frequencyDomainMixerContributor = _mixer ? _mixer->AddContributor(&leftSpectrum, &rightSpectrum) : -1;
+			if (modeChanged) { ResetSourceConvolutionBuffers(); }
+		}
+		/**
+		 * @brief Get the flag to know if the output spectra are added to a frequency domain mixer.
+		 * @return true if frequency domain mixing is enabled, false otherwise
+		 */
+		bool IsFrequencyDomainMixingEnabled() { return frequencyDomainMixer != nullptr; }
+
+		/**
+		 * @brief Set the level of detail this source is rendered with. The output of the previous tier is faded into the new one
+		 * over RENDERING_TIER_CROSSFADE_BLOCKS blocks, except between the full and the reduced tiers, which only differ in the
+		 * interpolation of the HRIRs. The near field effect is not part of the convolver, it has to be switched by the caller.
+		 * @param _tier new rendering tier
+		 */
+		void SetRenderingTier(TRenderingTier _tier) {
+			if (_tier == renderingTier) { return; }
+			if (!IsConvolutionTier(_tier) || !IsConvolutionTier(renderingTier)) {
+				// A change during a crossfade starts a new one from the tier that was being faded in
+				fadingRenderingTier = renderingTier;
+				tierCrossfadeActive = RENDERING_TIER_CROSSFADE_BLOCKS > 0;
+				tierCrossfadeBlocksDone = 0;
+			}
+			renderingTier = _tier;
+		}
+		/**
+		 * @brief Get the level of detail this source is rendered with.
+		 * @return rendering tier of the source
+		 */
+		TRenderingTier GetRenderingTier() { return renderingTier; }
 		
 		/** \brief Process data from input buffer to generate spatialization by convolution
 		*	\param [in] inBuffer input buffer with anechoic audio
@@ -126,8 +203,12 @@ namespace BRTProcessing {
 		*   \eh The error handler is informed if the size of the input buffer differs from that stored in the global
 		*       parameters and if the HRTF of the listener is null.		   
 		*/		
-		void Process(CMonoBuffer<float>& _inBuffer, CMonoBuffer<float>& outLeftBuffer, CMonoBuffer<float>& outRightBuffer, Common::CTransform& sourceTransform, Common::CTransform& listenerTransform, std::weak_ptr<BRTServices::CServicesBase>& _listenerHRTFWeak) {
+		void Process(const CMonoBuffer<float>& _inBuffer, CMonoBuffer<float>& outLeftBuffer, CMonoBuffer<float>& outRightBuffer, Common::CTransform& sourceTransform, Common::CTransform& listenerTransform, std::weak_ptr<BRTServices::CServicesBase>& _listenerHRTFWeak) {
 			ASSERT(_inBuffer.size() == globalParameters.GetBufferSize(), RESULT_ERROR_BADSIZE, "InBuffer size has to be equal to the input size indicated by the BRT::GlobalParameters method", "");
+
+			// Only HRIRs the convolution has run with in the previous block can be faded from
+			bool canFadeFromPreviousHRIR = convolvedLastBlock;
+			convolvedLastBlock = false;
 			
 			// Check processor flag
 			if (!enableProcessor) { 
@@ -153,6 +234,15 @@ namespace BRTProcessing {
 				outRightBuffer.Fill(globalParameters.GetBufferSize(), 0.0f);
 				return;
 			}
+
+			// A culled source is not rendered at all once the previous tier has been faded out
+			if (renderingTier == TRenderingTier::Culled && !tierCrossfadeActive) {
+				convolutionIdle = true;
+				panningIdle = true;
+				outLeftBuffer.Fill(globalParameters.GetBufferSize(), 0.0f);
+				outRightBuffer.Fill(globalParameters.GetBufferSize(), 0.0f);
+				return;
+			}
 			
 			//Check if the source is in the same position as the listener head. If yes, do not apply spatialization
 			float distanceToListener = Common::CSourceListenerRelativePositionCalculation::CalculateSourceListenerDistance(sourceTransform, listenerTransform);
@@ -164,8 +254,20 @@ namespace BRTProcessing {
 				return;
 			}
 
-			// First time - Initialize convolution buffers
-			if (!convolutionBuffersInitialized) { InitializedSourceConvolutionBuffers(_listenerHRTF); }
+			// First time - Initialize convolution buffers. If the HRTF has been replaced since, fade from the previous one.
+			if (!convolutionBuffersInitialized) { InitializedSourceConvolutionBuffers(_listenerHRTF); canFadeFromPreviousHRIR = false; }
+			else if (convolutionHRTF.lock() != _listenerHRTF) { BeginHRTFCrossfade(_listenerHRTF); canFadeFromPreviousHRIR = false; }
+
+			// Once the last sound has left the convolution, silence gives silence and nothing needs to be computed
+			silentInputBlocks = IsSilent(_inBuffer) ? silentInputBlocks + 1 : 0;
+			if (silentInputBlocks > 0 && IsDrained()) {
+				// Resume with the gains and delays of the current position instead of ramping from where the silence began
+				if (renderingTier == TRenderingTier::Panning) { panningIdle = true; }
+				else { delayBuffersIdle = true; }
+				outLeftBuffer.Fill(globalParameters.GetBufferSize(), 0.0f);
+				outRightBuffer.Fill(globalParameters.GetBufferSize(), 0.0f);
+				return;
+			}
 
 			// Calculate Source coordinates taking into account Source and Listener transforms
 			float leftAzimuth;
@@ -178,26 +280,22 @@ namespace BRTProcessing {
 
 			Common::CSourceListenerRelativePositionCalculation::CalculateSourceListenerRelativePositions(sourceTransform, listenerTransform, _listenerHRTF, enableParallaxCorrection,leftElevation, leftAzimuth, rightElevation, rightAzimuth, centerElevation, centerAzimuth, interauralAzimuth);
 
-			// GET HRTF
-			std::vector<CMonoBuffer<float>>  leftHRIR_partitioned;
-			std::vector<CMonoBuffer<float>>  rightHRIR_partitioned;
+			// Tiers rendered in this block. At most one of them convolves, the full and reduced tiers are never faded into each other.
+			const bool convolve = IsConvolutionTier(renderingTier) || (tierCrossfadeActive && IsConvolutionTier(fadingRenderingTier));
+			const bool pan = renderingTier == TRenderingTier::Panning || (tierCrossfadeActive && fadingRenderingTier == TRenderingTier::Panning);
+			const TRenderingTier convolutionTier = IsConvolutionTier(renderingTier) ? renderingTier : fadingRenderingTier;
+			// Only the full tier interpolates
+			const bool interpolate = enableInterpolation && convolutionTier == TRenderingTier::Full;
 
-			leftHRIR_partitioned = _listenerHRTF->GetHRIRPartitioned(Common::T_ear::LEFT, leftAzimuth, leftElevation, enableInterpolation, listenerTransform);
-			rightHRIR_partitioned = _listenerHRTF->GetHRIRPartitioned(Common::T_ear::RIGHT, rightAzimuth, rightElevation, enableInterpolation, listenerTransform);
+			// The HRTF table is borrowed while the guard is alive
+			BRTServices::CServicesReadGuard hrtfReadGuard(*_listenerHRTF);
 						
-			// DO CONVOLUTION			
-			CMonoBuffer<float> leftChannel_withoutDelay;
-			CMonoBuffer<float> rightChannel_withoutDelay;
-			//UPC algorithm with memory
-			outputLeftUPConvolution.ProcessUPConvolutionWithMemory(_inBuffer, leftHRIR_partitioned, leftChannel_withoutDelay);
-			outputRightUPConvolution.ProcessUPConvolutionWithMemory(_inBuffer, rightHRIR_partitioned, rightChannel_withoutDelay);
-
 			// GET DELAY
 			uint64_t leftDelay; 				///< Delay, in number of samples
 			uint64_t rightDelay;				///< Delay, in number of samples
 
 			if (enableITDSimulation){
-				BRTServices::THRIRPartitionedStruct delays = _listenerHRTF->GetHRIRDelay(Common::T_ear::BOTH, centerAzimuth, centerElevation, enableInterpolation, listenerTransform);
+				BRTServices::THRIRPartitionedStruct delays = _listenerHRTF->GetHRIRDelay(Common::T_ear::BOTH, centerAzimuth, centerElevation, interpolate, listenerTransform);
 				leftDelay = delays.leftDelay;
 				rightDelay = delays.rightDelay;
 			}
@@ -205,38 +303,147 @@ namespace BRTProcessing {
 				leftDelay = 0;
 				rightDelay = 0;
 			}
+
+			if (pan) { ProcessPanning(_inBuffer, interauralAzimuth, leftDelay, rightDelay); }
+			else { panningIdle = true; }
+
+			if (!convolve) {
+				convolutionIdle = true;
+				ProcessRenderingTierOutput(outLeftBuffer, outRightBuffer);
+				return;
+			}
+			if (convolutionIdle) {
+				// The convolution is faded in from silence, what it was fed before it stopped must not come out
+				outputUPConvolution.ClearMemory();
+				EndHRTFCrossfade();
+				delayBuffersIdle = true;
+				convolutionIdle = false;
+			}
+
+			// GET HRTF
+			const THRIRMemo previousLeftHRIRMemo = leftHRIRMemo;
+			const THRIRMemo previousRightHRIRMemo = rightHRIRMemo;
+			const std::vector<CMonoBuffer<float>>& leftHRIR_partitioned = GetHRIR(_listenerHRTF, Common::T_ear::LEFT, leftAzimuth, leftElevation, interpolate, listenerTransform, leftHRIRScratch, leftHRIRMemo);
+			const std::vector<CMonoBuffer<float>>& rightHRIR_partitioned = GetHRIR(_listenerHRTF, Common::T_ear::RIGHT, rightAzimuth, rightElevation, interpolate, listenerTransform, rightHRIRScratch, rightHRIRMemo);
+
+			// Moving sources and head rotation change the HRIRs between blocks. The new ones are faded in across the block rather than
+			// switched to at its start, which would zipper at small block sizes.
+			const bool HRIRChanged = !IsSameHRIR(previousLeftHRIRMemo, leftHRIRMemo) || !IsSameHRIR(previousRightHRIRMemo, rightHRIRMemo);
+			convolvedLastBlock = true;
+
+			if (frequencyDomainMixer) {
+				// The delays are part of the impulse responses in the frequency domain, they are faded like them
+				const bool delaysChanged = leftDelay != previousLeftDelay || rightDelay != previousRightDelay;
+				previousLeftDelay = leftDelay;
+				previousRightDelay = rightDelay;
+				// During a tier crossfade the output is needed in the time domain
+				ProcessFrequencyDomain(_inBuffer, leftHRIR_partitioned, rightHRIR_partitioned, static_cast<int>(leftDelay), static_cast<int>(rightDelay), leftAzimuth, leftElevation, rightAzimuth, rightElevation, interpolate, listenerTransform,
+					canFadeFromPreviousHRIR && (HRIRChanged || delaysChanged), outLeftBuffer, outRightBuffer);
+				if (tierCrossfadeActive) { ProcessRenderingTierOutput(outLeftBuffer, outRightBuffer); }
+				return;
+			}
+						
+			// DO CONVOLUTION			
+			//UPC algorithm with memory
+			outputUPConvolution.ProcessUPConvolutionWithMemory(_inBuffer, leftHRIR_partitioned, rightHRIR_partitioned, leftChannelWithoutDelay, rightChannelWithoutDelay);
+			if (canFadeFromPreviousHRIR && HRIRChanged) { outputUPConvolution.FadeFromPreviousImpulseResponses(leftChannelWithoutDelay, rightChannelWithoutDelay); }
+
+			if (crossfadeActive) {
+				ProcessHRTFCrossfade(_inBuffer, leftAzimuth, leftElevation, rightAzimuth, rightElevation, 0, 0, interpolate, listenerTransform, leftChannelWithoutDelay, rightChannelWithoutDelay);
+			}
+
 			// ADD Delay
-			Common::CAddDelayExpansionMethod::ProcessAddDelay_ExpansionMethod(leftChannel_withoutDelay, outLeftBuffer, leftChannelDelayBuffer, leftDelay);
-			Common::CAddDelayExpansionMethod::ProcessAddDelay_ExpansionMethod(rightChannel_withoutDelay, outRightBuffer, rightChannelDelayBuffer, rightDelay);			
+			if (delayBuffersIdle) {
+				// They only hold silence, start them at the current delay instead of stretching from the previous one
+				leftChannelDelayBuffer.assign(leftDelay, 0.0f);
+				rightChannelDelayBuffer.assign(rightDelay, 0.0f);
+				delayBuffersIdle = false;
+			}
+			Common::CAddDelayExpansionMethod::ProcessAddDelay_ExpansionMethod(leftChannelWithoutDelay, outLeftBuffer, leftChannelDelayBuffer, leftDelay);
+			Common::CAddDelayExpansionMethod::ProcessAddDelay_ExpansionMethod(rightChannelWithoutDelay, outRightBuffer, rightChannelDelayBuffer, rightDelay);			
+
+			if (tierCrossfadeActive) { ProcessRenderingTierOutput(outLeftBuffer, outRightBuffer); }
 		}
 
 		/// Reset convolvers and convolution buffers
 		void ResetSourceConvolutionBuffers() {
 			convolutionBuffersInitialized = false;
 			// Reset convolver classes
-			outputLeftUPConvolution.Reset();
-			outputRightUPConvolution.Reset();
+			outputUPConvolution.Reset();
+			EndHRTFCrossfade();
 			//Init buffer to store delay to be used in the ProcessAddDelay_ExpansionMethod method
 			leftChannelDelayBuffer.clear();
 			rightChannelDelayBuffer.clear();
+			panningIdle = true;
+			convolvedLastBlock = false;
 		}
 	private:
 
 		// Atributes
 		Common::CGlobalParameters globalParameters;
 
-		BRTProcessing::CUniformPartitionedConvolution outputLeftUPConvolution; // Object to make the inverse fft of the left channel with the UPC method
-		BRTProcessing::CUniformPartitionedConvolution outputRightUPConvolution; // Object to make the inverse fft of the rigth channel with the UPC method
+		BRTProcessing::CStereoUniformPartitionedConvolution outputUPConvolution;	// Object to make the convolution of both channels with the UPC method, sharing the input FFT
+		BRTProcessing::CStereoUniformPartitionedConvolution fadingUPConvolution;	// Convolver of the previous HRTF, only used during a crossfade
+		std::shared_ptr<CFrequencyDomainMixer> frequencyDomainMixer;				// Mixer the output spectra are added to, if any
+		int frequencyDomainMixerContributor;										// Identifier of leftSpectrum and rightSpectrum in the mixer
+
+		std::weak_ptr<BRTServices::CServicesBase> convolutionHRTF;	// HRTF the convolvers have been set up for
+		std::weak_ptr<BRTServices::CServicesBase> fadingHRTF;		// Previous HRTF, faded out during a crossfade
+
+		std::vector<CMonoBuffer<float>> leftHRIRScratch;	// Storage for interpolated HRIRs, reused every block
+		std::vector<CMonoBuffer<float>> rightHRIRScratch;
+		std::vector<CMonoBuffer<float>> fadingLeftHRIRScratch;
+		std::vector<CMonoBuffer<float>> fadingRightHRIRScratch;
+
+		/** \brief Direction the HRIR held in a scratch buffer has been obtained for
+		*/
+		struct THRIRMemo {
+			uint64_t tableVersion = 0;						// Version of the HRTF table, 0 if the scratch holds nothing reusable
+			float azimuth = 0.0f;
+			float elevation = 0.0f;
+			bool interpolated = false;
+		};
+		THRIRMemo leftHRIRMemo;
+		THRIRMemo rightHRIRMemo;
+		float HRIRTolerance;								// Angular distance within which the HRIRs in the scratch buffers are reused, in degrees
+		CMonoBuffer<float> leftChannelWithoutDelay;			// Output of the convolution before the delays are added, reused every block
+		CMonoBuffer<float> rightChannelWithoutDelay;
+		CMonoBuffer<float> fadingLeftChannel;				// Output of the previous HRTF during a crossfade
+		CMonoBuffer<float> fadingRightChannel;
+		CMonoBuffer<float> leftSpectrum;					// Output spectra handed to the frequency domain mixer, reused every block
+		CMonoBuffer<float> rightSpectrum;
 
 		CMonoBuffer<float> leftChannelDelayBuffer;			// To store the delay of the left channel of the expansion method
 		CMonoBuffer<float> rightChannelDelayBuffer;			// To store the delay of the right channel of the expansion method
 
+		CMonoBuffer<float> panningLeftInput;				// Input with the panning gains applied, reused every block
+		CMonoBuffer<float> panningRightInput;
+		CMonoBuffer<float> panningLeftChannel;				// Output of the panning tier
+		CMonoBuffer<float> panningRightChannel;
+		CMonoBuffer<float> leftPanningDelayBuffer;			// Delays of the expansion method for the panning tier, which has its own
+		CMonoBuffer<float> rightPanningDelayBuffer;
+
 		bool enableProcessor;								// Flag to enable the processor
 		bool enableSpatialization;							// Flags for independent control of processes
 		bool enableInterpolation;							// Enables/Disables the interpolation on run time
 		bool enableITDSimulation;							// Enables/Disables the ITD on run time
 		bool enableParallaxCorrection;						// Enables/Disables the parallax correction on run time
 		bool convolutionBuffersInitialized;					// Flag to check if the convolution buffers have been initialized		
+		bool crossfadeActive;								// True while the previous HRTF is being faded out
+		int crossfadeBlocksDone;							// Number of blocks of the current crossfade already processed
+		TRenderingTier renderingTier;						// Level of detail the source is rendered with
+		TRenderingTier fadingRenderingTier;					// Previous level of detail, faded out during a tier crossfade
+		bool tierCrossfadeActive;							// True while the previous rendering tier is being faded out
+		int tierCrossfadeBlocksDone;						// Number of blocks of the current tier crossfade already processed
+		bool convolutionIdle;								// True if the convolution has not run in the last block
+		bool panningIdle;									// True if the panning has not run in the last block
+		float previousLeftPanningGain;						// Panning gains of the last block, ramped from
+		float previousRightPanningGain;
+		int silentInputBlocks;								// Number of consecutive blocks with a silent input, including the current one
+		bool delayBuffersIdle;								// True if the delay buffers of the convolution only hold silence, whatever their size
+		bool convolvedLastBlock;							// True if the convolution has run in the last block, with the HRIRs in the memos
+		uint64_t previousLeftDelay;							// Delays the convolution has run with in the last block
+		uint64_t previousRightDelay;
 
 		/////////////////////
 		/// PRIVATE Methods        
@@ -250,15 +457,227 @@ namespace BRTProcessing {
 			int subfilterLength = _listenerHRTF->GetHRIRSubfilterLength();
 
 			//Common::CGlobalParameters globalParameters;
-			outputLeftUPConvolution.Setup(globalParameters.GetBufferSize(), subfilterLength, numOfSubfilters, true);
-			outputRightUPConvolution.Setup(globalParameters.GetBufferSize(), subfilterLength, numOfSubfilters, true);
-			//Init buffer to store delay to be used in the ProcessAddDelay_ExpansionMethod method
+			const int bufferSize = globalParameters.GetBufferSize();
+			outputUPConvolution.Setup(bufferSize, subfilterLength, numOfSubfilters);
+			leftChannelWithoutDelay.assign(bufferSize, 0.0f);
+			rightChannelWithoutDelay.assign(bufferSize, 0.0f);
+			//Init buffer to store delay to be used in the ProcessAddDelay_ExpansionMethod method. The delays never exceed a block, room for
+			//them is made now so that they can change without allocating.
 			leftChannelDelayBuffer.clear();
 			rightChannelDelayBuffer.clear();
+			leftChannelDelayBuffer.reserve(bufferSize);
+			rightChannelDelayBuffer.reserve(bufferSize);
+			leftPanningDelayBuffer.reserve(bufferSize);
+			rightPanningDelayBuffer.reserve(bufferSize);
 
 			// Declare variable
 			convolutionBuffersInitialized = true;
-		}		
+			convolutionHRTF = _listenerHRTF;
+			EndHRTFCrossfade();
+		}
+
+		/// Get the HRIR of one ear, reusing the one in the scratch buffer while the direction stays within the tolerance
+		const std::vector<CMonoBuffer<float>>& GetHRIR(std::shared_ptr<BRTServices::CServicesBase>& _listenerHRTF, Common::T_ear _ear, float _azimuth, float _elevation, bool _interpolate,
+			Common::CTransform& _listenerTransform, std::vector<CMonoBuffer<float>>& _scratch, THRIRMemo& _memo) {
+			// Read before the HRIR, so that a table replaced in between is noticed on the next block rather than missed
+			const uint64_t tableVersion = _listenerHRTF->GetTableVersion();
+			if (tableVersion != 0 && _memo.tableVersion == tableVersion && _memo.interpolated == _interpolate &&
+				AngularDistance(_azimuth, _memo.azimuth) <= HRIRTolerance && AngularDistance(_elevation, _memo.elevation) <= HRIRTolerance) {
+				return _scratch;
+			}
+
+			const std::vector<CMonoBuffer<float>>& HRIR = _listenerHRTF->GetHRIRPartitionedRef(_ear, _azimuth, _elevation, _interpolate, _listenerTransform, _scratch);
+			// HRIRs found in the table are not worth keeping, the scratch buffer is only reused when it holds the result
+			const bool reusable = &HRIR == &_scratch && !_scratch.empty();
+			_memo.tableVersion = reusable ? tableVersion : 0;
+			_memo.azimuth = _azimuth;
+			_memo.elevation = _elevation;
+			_memo.interpolated = _interpolate;
+			return HRIR;
+		}
+
+		/// Whether the memos describe the same HRIR, in which case the convolution continues with the one of the last block
+		static bool IsSameHRIR(const THRIRMemo& _memo1, const THRIRMemo& _memo2) {
+			return _memo1.tableVersion == _memo2.tableVersion && _memo1.azimuth == _memo2.azimuth && _memo1.elevation == _memo2.elevation && _memo1.interpolated == _memo2.interpolated;
+		}
+
+		/// Distance between two angles in degrees, the short way round
+		static float AngularDistance(float _angle1, float _angle2) {
+			float distance = std::fmod(std::fabs(_angle1 - _angle2), 360.0f);
+			return distance > 180.0f ? 360.0f - distance : distance;
+		}
+
+		/// Convolve with the delays applied in the frequency domain and add the result to the mixer. During a crossfade, output time signals instead.
+		/// A fade from the previous HRIRs is output as a time signal, on top of the spectra added to the mixer.
+		void ProcessFrequencyDomain(const CMonoBuffer<float>& _inBuffer, const std::vector<CMonoBuffer<float>>& _leftHRIR, const std::vector<CMonoBuffer<float>>& _rightHRIR, int _leftDelay, int _rightDelay,
+			float _leftAzimuth, float _leftElevation, float _rightAzimuth, float _rightElevation, bool _interpolate, Common::CTransform& _listenerTransform, bool _fadeFromPreviousHRIR, CMonoBuffer<float>& outLeftBuffer, CMonoBuffer<float>& outRightBuffer) {
+
+			if (crossfadeActive || tierCrossfadeActive) {
+				outputUPConvolution.ProcessUPConvolutionWithMemory(_inBuffer, _leftHRIR, _rightHRIR, _leftDelay, _rightDelay, outLeftBuffer, outRightBuffer);
+				if (_fadeFromPreviousHRIR) { outputUPConvolution.FadeFromPreviousImpulseResponses(outLeftBuffer, outRightBuffer); }
+				if (crossfadeActive) {
+					ProcessHRTFCrossfade(_inBuffer, _leftAzimuth, _leftElevation, _rightAzimuth, _rightElevation, _leftDelay, _rightDelay, _interpolate, _listenerTransform, outLeftBuffer, outRightBuffer);
+				}
+				return;
+			}
+
+			// The expensive part is done on this convolver's own sums, the mixer only reads them at the end of the block
+			leftSpectrum.assign(outputUPConvolution.GetSpectrumSize(), 0.0f);
+			rightSpectrum.assign(outputUPConvolution.GetSpectrumSize(), 0.0f);
+			const bool accumulated = outputUPConvolution.AccumulateUPConvolutionWithMemory(_inBuffer, _leftHRIR, _rightHRIR, _leftDelay, _rightDelay, leftSpectrum, rightSpectrum);
+			if (accumulated) {
+				frequencyDomainMixer->Add(frequencyDomainMixerContributor, globalParameters.GetBufferSize());
+			}
+			outLeftBuffer.Fill(globalParameters.GetBufferSize(), 0.0f);
+			outRightBuffer.Fill(globalParameters.GetBufferSize(), 0.0f);
+			if (accumulated && _fadeFromPreviousHRIR) { outputUPConvolution.FadeFromPreviousImpulseResponses(outLeftBuffer, outRightBuffer); }
+		}
+
+		/// Keep the convolvers of the current HRTF running for the previous one and set up new convolvers for the new HRTF
+		void BeginHRTFCrossfade(std::shared_ptr<BRTServices::CServicesBase>& _newHRTF) {
+			std::shared_ptr<BRTServices::CServicesBase> previousHRTF = convolutionHRTF.lock();
+			if (!previousHRTF || HRTF_CROSSFADE_BLOCKS <= 0) {
+				InitializedSourceConvolutionBuffers(_newHRTF);
+				return;
+			}
+
+			std::swap(outputUPConvolution, fadingUPConvolution);
+			outputUPConvolution.Setup(globalParameters.GetBufferSize(), _newHRTF->GetHRIRSubfilterLength(), _newHRTF->GetHRIRNumberOfSubfilters());
+
+			convolutionHRTF = _newHRTF;
+			fadingHRTF = previousHRTF;
+			crossfadeActive = true;
+			crossfadeBlocksDone = 0;
+		}
+
+		/// Convolve the input with the previous HRTF too and fade its output into the output of the new HRTF
+		void ProcessHRTFCrossfade(const CMonoBuffer<float>& _inBuffer, float _leftAzimuth, float _leftElevation, float _rightAzimuth, float _rightElevation, int _leftDelay, int _rightDelay, bool _interpolate, Common::CTransform& _listenerTransform, CMonoBuffer<float>& _leftChannel, CMonoBuffer<float>& _rightChannel) {
+			std::shared_ptr<BRTServices::CServicesBase> previousHRTF = fadingHRTF.lock();
+			if (!previousHRTF) {
+				// The previous HRTF is gone already, just continue with the new one
+				EndHRTFCrossfade();
+				return;
+			}
+
+			{
+				BRTServices::CServicesReadGuard previousReadGuard(*previousHRTF);
+				const std::vector<CMonoBuffer<float>>& leftHRIR_partitioned = previousHRTF->GetHRIRPartitionedRef(Common::T_ear::LEFT, _leftAzimuth, _leftElevation, _interpolate, _listenerTransform, fadingLeftHRIRScratch);
+				const std::vector<CMonoBuffer<float>>& rightHRIR_partitioned = previousHRTF->GetHRIRPartitionedRef(Common::T_ear::RIGHT, _rightAzimuth, _rightElevation, _interpolate, _listenerTransform, fadingRightHRIRScratch);
+				fadingUPConvolution.ProcessUPConvolutionWithMemory(_inBuffer, leftHRIR_partitioned, rightHRIR_partitioned, _leftDelay, _rightDelay, fadingLeftChannel, fadingRightChannel);
+			}
+
+			// Linear crossfade across all the blocks of the transition
+			const std::size_t blockSize = _leftChannel.size();
+			const float totalSamples = static_cast<float>(HRTF_CROSSFADE_BLOCKS * blockSize);
+			const float firstSample = static_cast<float>(crossfadeBlocksDone * blockSize);
+			for (std::size_t i = 0; i < blockSize && i < fadingLeftChannel.size() && i < fadingRightChannel.size(); i++) {
+				float newGain = (firstSample + static_cast<float>(i + 1)) / totalSamples;
+				_leftChannel[i] = _leftChannel[i] * newGain + fadingLeftChannel[i] * (1.0f - newGain);
+				_rightChannel[i] = _rightChannel[i] * newGain + fadingRightChannel[i] * (1.0f - newGain);
+			}
+
+			if (++crossfadeBlocksDone >= HRTF_CROSSFADE_BLOCKS) { EndHRTFCrossfade(); }
+		}
+
+		/// Forget the previous HRTF. Its convolvers keep their memory until the next crossfade sets them up again.
+		void EndHRTFCrossfade() {
+			crossfadeActive = false;
+			crossfadeBlocksDone = 0;
+			fadingHRTF.reset();
+		}
+
+		/// Whether all the samples of the buffer are zero
+		static bool IsSilent(const CMonoBuffer<float>& _buffer) {
+			return std::all_of(_buffer.begin(), _buffer.end(), [](float sample) { return sample == 0.0f; });
+		}
+
+		/// Whether a silent input gives a silent output without running the convolution nor the panning
+		bool IsDrained() {
+			if (crossfadeActive || tierCrossfadeActive) { return false; }
+			if (renderingTier == TRenderingTier::Panning) {
+				return IsSilent(leftPanningDelayBuffer) && IsSilent(rightPanningDelayBuffer);
+			}
+			// The last sound stays in the convolution for GetTailBlocks() blocks, then in the delay buffers of the time domain
+			if (silentInputBlocks < outputUPConvolution.GetTailBlocks()) { return false; }
+			return frequencyDomainMixer || (IsSilent(leftChannelDelayBuffer) && IsSilent(rightChannelDelayBuffer));
+		}
+
+		/// Whether the given tier renders the source by convolution
+		static bool IsConvolutionTier(TRenderingTier _tier) {
+			return _tier == TRenderingTier::Full || _tier == TRenderingTier::Reduced;
+		}
+
+		/// Render the panning tier: the input with a level difference between the ears, delayed by the ITD
+		void ProcessPanning(const CMonoBuffer<float>& _inBuffer, float _interauralAzimuth, uint64_t _leftDelay, uint64_t _rightDelay) {
+			// -1 for a source fully on the left, 1 fully on the right
+			const float lateral = std::sin(_interauralAzimuth * static_cast<float>(M_PI) / 180.0f);
+			const float leftGain = 1.0f - PANNING_ILD_DEPTH * lateral;
+			const float rightGain = 1.0f + PANNING_ILD_DEPTH * lateral;
+
+			if (panningIdle) {
+				// The panning starts from silence, at the current delays
+				leftPanningDelayBuffer.assign(_leftDelay, 0.0f);
+				rightPanningDelayBuffer.assign(_rightDelay, 0.0f);
+				previousLeftPanningGain = leftGain;
+				previousRightPanningGain = rightGain;
+				panningIdle = false;
+			}
+
+			// Ramp the gains from the last block, so that moving sources do not click
+			const std::size_t blockSize = _inBuffer.size();
+			panningLeftInput.resize(blockSize);
+			panningRightInput.resize(blockSize);
+			for (std::size_t i = 0; i < blockSize; i++) {
+				const float position = static_cast<float>(i + 1) / static_cast<float>(blockSize);
+				panningLeftInput[i] = _inBuffer[i] * (previousLeftPanningGain + (leftGain - previousLeftPanningGain) * position);
+				panningRightInput[i] = _inBuffer[i] * (previousRightPanningGain + (rightGain - previousRightPanningGain) * position);
+			}
+			previousLeftPanningGain = leftGain;
+			previousRightPanningGain = rightGain;
+
+			Common::CAddDelayExpansionMethod::ProcessAddDelay_ExpansionMethod(panningLeftInput, panningLeftChannel, leftPanningDelayBuffer, _leftDelay);
+			Common::CAddDelayExpansionMethod::ProcessAddDelay_ExpansionMethod(panningRightInput, panningRightChannel, rightPanningDelayBuffer, _rightDelay);
+		}
+
+		/// Combine the outputs of the tiers rendered in this block. The channels hold the output of the convolution, if it has run, and receive the result.
+		void ProcessRenderingTierOutput(CMonoBuffer<float>& _leftChannel, CMonoBuffer<float>& _rightChannel) {
+			if (!tierCrossfadeActive) {
+				if (renderingTier == TRenderingTier::Panning) {
+					_leftChannel = panningLeftChannel;
+					_rightChannel = panningRightChannel;
+				}
+				return;
+			}
+
+			// Weight of each tier at the start and at the end of the crossfade
+			const float convolutionIn = IsConvolutionTier(renderingTier) ? 1.0f : 0.0f;
+			const float convolutionOut = IsConvolutionTier(fadingRenderingTier) ? 1.0f : 0.0f;
+			const float panningIn = renderingTier == TRenderingTier::Panning ? 1.0f : 0.0f;
+			const float panningOut = fadingRenderingTier == TRenderingTier::Panning ? 1.0f : 0.0f;
+			const bool panned = panningIn + panningOut > 0.0f;
+
+			const std::size_t blockSize = globalParameters.GetBufferSize();
+			if (convolutionIn + convolutionOut == 0.0f) {
+				_leftChannel.Fill(blockSize, 0.0f);
+				_rightChannel.Fill(blockSize, 0.0f);
+			}
+
+			// Linear crossfade across all the blocks of the transition
+			const float totalSamples = static_cast<float>(RENDERING_TIER_CROSSFADE_BLOCKS * blockSize);
+			const float firstSample = static_cast<float>(tierCrossfadeBlocksDone * blockSize);
+			for (std::size_t i = 0; i < blockSize && i < _leftChannel.size() && i < _rightChannel.size(); i++) {
+				const float newGain = (firstSample + static_cast<float>(i + 1)) / totalSamples;
+				const float convolutionGain = convolutionIn * newGain + convolutionOut * (1.0f - newGain);
+				const float panningGain = panningIn * newGain + panningOut * (1.0f - newGain);
+				_leftChannel[i] = _leftChannel[i] * convolutionGain + (panned ? panningLeftChannel[i] * panningGain : 0.0f);
+				_rightChannel[i] = _rightChannel[i] * convolutionGain + (panned ? panningRightChannel[i] * panningGain : 0.0f);
+			}
+
+			if (++tierCrossfadeBlocksDone >= RENDERING_TIER_CROSSFADE_BLOCKS) {
+				tierCrossfadeActive = false;
+				tierCrossfadeBlocksDone = 0;
+			}
+		}
 	};
 }
 #endif
\ No newline at end of file
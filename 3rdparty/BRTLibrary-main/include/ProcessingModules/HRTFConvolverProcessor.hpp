@@ -39,18 +39,18 @@ class CHRTFConvolverProcessor : public BRTConnectivity::CBRTConnectivity, public
 		
     public:
 		CHRTFConvolverProcessor() {
-            CreateSamplesEntryPoint("inputSamples");
+            inputSamplesPort = CreateSamplesEntryPoint("inputSamples");
 
-            CreatePositionEntryPoint("sourcePosition");
-			CreatePositionEntryPoint("listenerPosition");           
-			CreateHRTFPtrEntryPoint("listenerHRTF");
-			CreateHRBRIRPtrEntryPoint("listenerHRBRIR");
+            sourcePositionPort = CreatePositionEntryPoint("sourcePosition");
+			listenerPositionPort = CreatePositionEntryPoint("listenerPosition");           
+			listenerHRTFPort = CreateHRTFPtrEntryPoint("listenerHRTF");
+			listenerHRBRIRPort = CreateHRBRIRPtrEntryPoint("listenerHRBRIR");
 
-			CreateIDEntryPoint("sourceID");
-			CreateIDEntryPoint("listenerID");
+			sourceIDPort = CreateIDEntryPoint("sourceID");
+			listenerIDPort = CreateIDEntryPoint("listenerID");
 
-            CreateSamplesExitPoint("leftEar");
-            CreateSamplesExitPoint("rightEar");   									
+            leftEarPort = CreateSamplesExitPoint("leftEar");
+            rightEarPort = CreateSamplesExitPoint("rightEar");   									
         }
 
 		/**
@@ -60,16 +60,13 @@ class CHRTFConvolverProcessor : public BRTConnectivity::CBRTConnectivity, public
 
 			std::lock_guard<std::mutex> l(mutex);
 
-			CMonoBuffer<float> outLeftBuffer;
-			CMonoBuffer<float> outRightBuffer;
-
-			//if (_entryPointId == "inputSamples") {
-			CMonoBuffer<float> buffer = GetSamplesEntryPoint("inputSamples")->GetData();
+			// The input is read in place, from the exit point of the source
+			const CMonoBuffer<float>& buffer = GetSamplesEntryPoint(inputSamplesPort)->GetDataRef();
 
 			if (buffer.size() == 0) { return; }
 
-			Common::CTransform sourcePosition = GetPositionEntryPoint("sourcePosition")->GetData();
-			Common::CTransform listenerPosition = GetPositionEntryPoint("listenerPosition")->GetData();
+			Common::CTransform sourcePosition = GetPositionEntryPoint(sourcePositionPort)->GetData();
+			Common::CTransform listenerPosition = GetPositionEntryPoint(listenerPositionPort)->GetData();
 			
 			// Check process flag
 			if (!CHRTFConvolver::IsSpatializationEnabled())
@@ -78,9 +75,12 @@ class CHRTFConvolverProcessor : public BRTConnectivity::CBRTConnectivity, public
 				outRightBuffer = buffer;				
 			}
 			else {
-				std::weak_ptr<BRTServices::CServicesBase> listenerHRTF = GetHRTFPtrEntryPoint("listenerHRTF")->GetData();
-				std::weak_ptr<BRTServices::CServicesBase> listenerHRBRIR = GetHRBRIRPtrEntryPoint("listenerHRBRIR")->GetData();
+				std::weak_ptr<BRTServices::CServicesBase> listenerHRTF = GetHRTFPtrEntryPoint(listenerHRTFPort)->GetData();
+				std::weak_ptr<BRTServices::CServicesBase> listenerHRBRIR = GetHRBRIRPtrEntryPoint(listenerHRBRIRPort)->GetData();
 
+				// Some paths of the convolver only write part of the outputs, which must not keep the previous block
+				outLeftBuffer.clear();
+				outRightBuffer.clear();
 				if (listenerHRTF.lock() != nullptr) { 
 					Process(buffer, outLeftBuffer, outRightBuffer, sourcePosition, listenerPosition, listenerHRTF);
 				} else if (listenerHRBRIR.lock() != nullptr) {				
@@ -90,8 +90,8 @@ class CHRTFConvolverProcessor : public BRTConnectivity::CBRTConnectivity, public
 					return;
 				}
 			}	
-			GetSamplesExitPoint("leftEar")->sendData(outLeftBuffer);
-			GetSamplesExitPoint("rightEar")->sendData(outRightBuffer);				
+			GetSamplesExitPoint(leftEarPort)->sendData(outLeftBuffer);
+			GetSamplesExitPoint(rightEarPort)->sendData(outRightBuffer);				
         }
 
 		void UpdateCommand() override {					
@@ -124,15 +124,18 @@ class CHRTFConvolverProcessor : public BRTConnectivity::CBRTConnectivity, public
     private:
        
 		mutable std::mutex mutex;
-
-		bool IsToMySoundSource(std::string _sourceID) {
-			std::string mySourceID = GetIDEntryPoint("sourceID")->GetData();
-			return mySourceID == _sourceID;
+		// Indices of the entry and exit points, so that they are not looked up by ID on every block
+		int inputSamplesPort, sourcePositionPort, listenerPositionPort, listenerHRTFPort, listenerHRBRIRPort, sourceIDPort, listenerIDPort;
+		int leftEarPort, rightEarPort;
+		CMonoBuffer<float> outLeftBuffer;				// Outputs, their storage is reused from block to block
+		CMonoBuffer<float> outRightBuffer;
+
+		bool IsToMySoundSource(const std::string& _sourceID) {
+			return GetIDEntryPoint(sourceIDPort)->GetDataRef() == _sourceID;
 		}
 		
-		bool IsToMyListener(std::string _listenerID) {
-			std::string myListenerID = GetIDEntryPoint("listenerID")->GetData();
-			return myListenerID == _listenerID;
+		bool IsToMyListener(const std::string& _listenerID) {
+			return GetIDEntryPoint(listenerIDPort)->GetDataRef() == _listenerID;
 		}
     };
 }
@@ -36,17 +36,17 @@ class CNearFieldEffectProcessor : public BRTConnectivity::CBRTConnectivity, publ
 		
     public:
 		CNearFieldEffectProcessor() {
-            CreateSamplesEntryPoint("leftEar");
-			CreateSamplesEntryPoint("rightEar");
+            leftEarInPort = CreateSamplesEntryPoint("leftEar");
+			rightEarInPort = CreateSamplesEntryPoint("rightEar");
 
-            CreatePositionEntryPoint("sourcePosition");
-			CreatePositionEntryPoint("listenerPosition");           			
+            sourcePositionPort = CreatePositionEntryPoint("sourcePosition");
+			listenerPositionPort = CreatePositionEntryPoint("listenerPosition");           			
 			
-			CreateIDEntryPoint("sourceID");
-			CreateILDPtrEntryPoint("listenerILD");
+			sourceIDPort = CreateIDEntryPoint("sourceID");
+			listenerILDPort = CreateILDPtrEntryPoint("listenerILD");
 
-            CreateSamplesExitPoint("leftEar");
-            CreateSamplesExitPoint("rightEar");
+            leftEarOutPort = CreateSamplesExitPoint("leftEar");
+            rightEarOutPort = CreateSamplesExitPoint("rightEar");
 
 			Setup(2);
         }
@@ -57,19 +57,18 @@ class CNearFieldEffectProcessor : public BRTConnectivity::CBRTConnectivity, publ
         void AllEntryPointsAllDataReady() override {
 			std::lock_guard<std::mutex> l(mutex);
 						
-			CMonoBuffer<float> leftBuffer = GetSamplesEntryPoint("leftEar")->GetData();
-			CMonoBuffer<float> rightBuffer = GetSamplesEntryPoint("rightEar")->GetData();
+			// The inputs are read in place and the outputs reuse their storage from block to block
+			const CMonoBuffer<float>& leftBuffer = GetSamplesEntryPoint(leftEarInPort)->GetDataRef();
+			const CMonoBuffer<float>& rightBuffer = GetSamplesEntryPoint(rightEarInPort)->GetDataRef();
 
-			Common::CTransform sourcePosition = GetPositionEntryPoint("sourcePosition")->GetData();
-			Common::CTransform listenerPosition = GetPositionEntryPoint("listenerPosition")->GetData();												
-			std::weak_ptr<BRTServices::CSOSFilters> listenerNFCFilters = GetILDPtrEntryPoint("listenerILD")->GetData();
+			Common::CTransform sourcePosition = GetPositionEntryPoint(sourcePositionPort)->GetData();
+			Common::CTransform listenerPosition = GetPositionEntryPoint(listenerPositionPort)->GetData();												
+			std::weak_ptr<BRTServices::CSOSFilters> listenerNFCFilters = GetILDPtrEntryPoint(listenerILDPort)->GetData();
 				
 			if (leftBuffer.size() != 0  || rightBuffer.size() !=0)  {
-				CMonoBuffer<float> outLeftBuffer;
-				CMonoBuffer<float> outRightBuffer;
 				Process(leftBuffer, rightBuffer, outLeftBuffer, outRightBuffer, sourcePosition, listenerPosition, listenerNFCFilters);
-				GetSamplesExitPoint("leftEar")->sendData(outLeftBuffer);
-				GetSamplesExitPoint("rightEar")->sendData(outRightBuffer);
+				GetSamplesExitPoint(leftEarOutPort)->sendData(outLeftBuffer);
+				GetSamplesExitPoint(rightEarOutPort)->sendData(outRightBuffer);
 			}							
         }
 
@@ -99,9 +98,14 @@ class CNearFieldEffectProcessor : public BRTConnectivity::CBRTConnectivity, publ
       
     private:
 		mutable std::mutex mutex;
-		bool IsToMySoundSource(std::string _sourceID) {
-			std::string mySourceID = GetIDEntryPoint("sourceID")->GetData();
-			return mySourceID == _sourceID;
+		// Indices of the entry and exit points, so that they are not looked up by ID on every block
+		int leftEarInPort, rightEarInPort, sourcePositionPort, listenerPositionPort, sourceIDPort, listenerILDPort;
+		int leftEarOutPort, rightEarOutPort;
+		CMonoBuffer<float> outLeftBuffer;
+		CMonoBuffer<float> outRightBuffer;
+
+		bool IsToMySoundSource(const std::string& _sourceID) {
+			return GetIDEntryPoint(sourceIDPort)->GetDataRef() == _sourceID;
 		}
 		bool IsToMyListener(std::string _listenerID) {
 			std::shared_ptr<BRTConnectivity::CEntryPointID> _listenerIDEntryPoint = GetIDEntryPoint("listenerID");
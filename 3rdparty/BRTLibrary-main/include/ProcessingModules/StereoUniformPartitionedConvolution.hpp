@@ -0,0 +1,398 @@
+/**
+* \class CStereoUniformPartitionedConvolution
+*
+* \brief Declaration of CStereoUniformPartitionedConvolution class interface.
+* \date	June 2023
+*
+* \authors 3DI-DIANA Research Group (University of Malaga), in alphabetical order: M. Cuevas-Rodriguez, D. Gonzalez-Toledo, L. Molina-Tanco, F. Morales-Benitez ||
+* Coordinated by , A. Reyes-Lecuona (University of Malaga)||
+* \b Contact: areyes@uma.es
+*
+* \b Copyright: University of Malaga
+*
+* \b Contributions: (additional authors/contributors can be added here)
+*
+* \b Project: SONICOM ||
+* \b Website: https://www.sonicom.eu/
+*
+* \b Acknowledgement: This project has received funding from the European Union's Horizon 2020 research and innovation programme under grant agreement no.101017743
+*
+* \b Licence: This program is free software, you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+*/
+
+#ifndef _C_STEREO_UNIFORM_PARTITIONED_CONVOLUTION_HPP_
+#define _C_STEREO_UNIFORM_PARTITIONED_CONVOLUTION_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <Common/FFTCalculator.hpp>
+#include <Common/ComplexKernels.hpp>
+#include <Common/Buffer.hpp>
+#include <Common/CommonDefinitions.hpp>
+#include <Common/ErrorHandler.hpp>
+#include <ProcessingModules/UniformPartitionedConvolution.hpp>
+
+namespace BRTProcessing {
+
+	/** \details Uniformly partitioned convolution (with impulse response memory) of one mono signal with a pair of impulse responses, one per ear.
+	*	It does the same as two CUniformPartitionedConvolution objects fed with the same input, but transforms the input only once
+	*	and keeps a single history of input spectra for both ears.
+	*	It can also delay each ear by a whole number of samples in the frequency domain, applying a linear phase to the impulse responses,
+	*	and leave the output in the frequency domain, so that the outputs of many sources can be added up before a single inverse FFT.
+	*	When the impulse responses change from one block to the next, the output of a block can be faded in from what the previous ones
+	*	would have given, see FadeFromPreviousImpulseResponses().
+	*/
+	class CStereoUniformPartitionedConvolution
+	{
+	public:
+		/** \brief Default constructor
+		*   \eh Nothing is reported to the error handler.
+		*/
+		CStereoUniformPartitionedConvolution()
+			: setupDone{ false }
+			, inputSize{ 0 }
+			, impulseResponseNumberOfSubfilters{ 0 }
+			, impulseResponse_Frequency_Block_Size{ 0 }
+			, storageInput_bufferSize{ 0 }
+			, historySize{ 0 }
+			, historyHead{ 0 }
+			, leftRampDelay{ 0 }
+			, rightRampDelay{ 0 }
+		{
+		}
+
+		/** \brief Initialize the class and allocate memory.
+		*	\param [in] _inputSize size of the input signal buffer (B size)
+		*	\param [in] _IR_Frequency_Block_Size size of the FTT Impulse Response blocks, this number is (2*B + k) = 2^n
+		*	\param [in] _IR_Block_Number number of blocks in which is divided each impluse response
+		*   \eh On success, RESULT_OK is reported to the error handler.
+		*/
+		void Setup(int _inputSize, int _IR_Frequency_Block_Size, int _IR_Block_Number)
+		{
+			inputSize = _inputSize;
+			impulseResponse_Frequency_Block_Size = _IR_Frequency_Block_Size;
+			impulseResponseNumberOfSubfilters = _IR_Block_Number;
+
+			if (Common::CalculateIsPowerOfTwo(inputSize)) {
+				storageInput_bufferSize = inputSize;
+			} else {
+				storageInput_bufferSize = 2 * Common::CalculateNextPowerOfTwo(inputSize) - inputSize;
+			}
+
+			storageInput_buffer.assign(storageInput_bufferSize, 0.0f);
+			inBuffer_Time_dobleSize.assign(storageInput_bufferSize + inputSize, 0.0f);
+
+			// One input spectrum and one pair of impulse responses per block of history, stored at the same position. One block more than
+			// the subfilters need, so that the impulse responses of the previous block are still there to fade from.
+			historySize = impulseResponseNumberOfSubfilters + 1;
+			storageInputFFT_buffer.assign(historySize, std::vector<float>(impulseResponse_Frequency_Block_Size, 0.0f));
+			storageLeftIR_buffer.assign(historySize, THRIR_partitioned(impulseResponseNumberOfSubfilters, CMonoBuffer<float>(impulseResponse_Frequency_Block_Size, 0.0f)));
+			storageRightIR_buffer.assign(historySize, THRIR_partitioned(impulseResponseNumberOfSubfilters, CMonoBuffer<float>(impulseResponse_Frequency_Block_Size, 0.0f)));
+			historyHead = 0;
+
+			leftSum.assign(impulseResponse_Frequency_Block_Size, 0.0f);
+			rightSum.assign(impulseResponse_Frequency_Block_Size, 0.0f);
+			outputBuffer_temp.assign(impulseResponse_Frequency_Block_Size / 2, 0.0f);
+			fadeOutput.assign(inputSize, 0.0f);
+			Common::CFFTCalculator::PrepareWorkspace(fftWorkspace, impulseResponse_Frequency_Block_Size);
+
+			// Twiddle factors of the FFT, every delay ramp is built by picking from them
+			const int fftSize = impulseResponse_Frequency_Block_Size / 2;
+			delayTwiddles.resize(impulseResponse_Frequency_Block_Size);
+			for (int k = 0; k < fftSize; k++) {
+				const double phase = 2.0 * M_PI * k / fftSize;
+				delayTwiddles[2 * k] = static_cast<float>(std::cos(phase));
+				delayTwiddles[2 * k + 1] = static_cast<float>(std::sin(phase));
+			}
+			leftRamp.assign(impulseResponse_Frequency_Block_Size, 0.0f);
+			rightRamp.assign(impulseResponse_Frequency_Block_Size, 0.0f);
+			leftRampDelay = 0;
+			rightRampDelay = 0;
+
+			setupDone = true;
+			SET_RESULT(RESULT_OK, "Stereo UPC convolver successfully set");
+		}
+
+		/** \brief Convolve the input signal with both impulse responses, using the impulse responses of the last blocks for the tails (method with memory)
+		*   \details *Wefers, F. (2015). Partitioned convolution algorithms for real-time auralization (Vol. 20). Logos Verlag Berlin GmbH.
+		*	\param [in] inBuffer_Time input signal buffer of B size
+		*	\param [in] leftIR left impulse response divided in subfilters, each subfilter has HRIR_Frequency_Block_Size size = 2*B
+		*	\param [in] rightIR right impulse response divided in subfilters
+		*	\param [out] leftOutBuffer left output signal of B size
+		*	\param [out] rightOutBuffer right output signal of B size
+		*   \eh On error, an error code is reported to the error handler.
+		*/
+		void ProcessUPConvolutionWithMemory(const CMonoBuffer<float>& inBuffer_Time, const std::vector<CMonoBuffer<float>>& leftIR, const std::vector<CMonoBuffer<float>>& rightIR,
+			CMonoBuffer<float>& leftOutBuffer, CMonoBuffer<float>& rightOutBuffer)
+		{
+			ProcessUPConvolutionWithMemory(inBuffer_Time, leftIR, rightIR, 0, 0, leftOutBuffer, rightOutBuffer);
+		}
+
+		/** \brief Convolve the input signal with both impulse responses delayed in the frequency domain (method with memory)
+		*	\param [in] inBuffer_Time input signal buffer of B size
+		*	\param [in] leftIR left impulse response divided in subfilters
+		*	\param [in] rightIR right impulse response divided in subfilters
+		*	\param [in] leftDelay delay of the left ear, in samples. It is limited to GetMaxFrequencyDomainDelay().
+		*	\param [in] rightDelay delay of the right ear, in samples. It is limited to GetMaxFrequencyDomainDelay().
+		*	\param [out] leftOutBuffer left output signal of B size
+		*	\param [out] rightOutBuffer right output signal of B size
+		*   \eh On error, an error code is reported to the error handler.
+		*/
+		void ProcessUPConvolutionWithMemory(const CMonoBuffer<float>& inBuffer_Time, const std::vector<CMonoBuffer<float>>& leftIR, const std::vector<CMonoBuffer<float>>& rightIR,
+			int leftDelay, int rightDelay, CMonoBuffer<float>& leftOutBuffer, CMonoBuffer<float>& rightOutBuffer)
+		{
+			if (!setupDone || static_cast<int>(inBuffer_Time.size()) != inputSize) {
+				SET_RESULT(RESULT_ERROR_NOTSET, "HRTF storage buffer to perform UP convolution with memory has not been initialized");
+				leftOutBuffer.assign(inBuffer_Time.size(), 0.0f);
+				rightOutBuffer.assign(inBuffer_Time.size(), 0.0f);
+				return;
+			}
+
+			std::fill(leftSum.begin(), leftSum.end(), 0.0f);
+			std::fill(rightSum.begin(), rightSum.end(), 0.0f);
+			if (!AccumulateUPConvolutionWithMemory(inBuffer_Time, leftIR, rightIR, leftDelay, rightDelay, leftSum, rightSum)) {
+				leftOutBuffer.assign(inBuffer_Time.size(), 0.0f);
+				rightOutBuffer.assign(inBuffer_Time.size(), 0.0f);
+				return;
+			}
+
+			// Make the IFFTs, only the last B samples are significant
+			CalculateIFFT(leftSum, leftOutBuffer);
+			CalculateIFFT(rightSum, rightOutBuffer);
+		}
+
+		/** \brief Convolve the input signal with both impulse responses delayed in the frequency domain, adding the output spectra to the given ones
+		*	\details The output spectra of several convolvers set up with the same sizes can be added up and turned into time signals
+		*	with a single inverse FFT per ear, see CFrequencyDomainMixer.
+		*	\param [in] inBuffer_Time input signal buffer of B size
+		*	\param [in] leftIR left impulse response divided in subfilters
+		*	\param [in] rightIR right impulse response divided in subfilters
+		*	\param [in] leftDelay delay of the left ear, in samples. It is limited to GetMaxFrequencyDomainDelay().
+		*	\param [in] rightDelay delay of the right ear, in samples. It is limited to GetMaxFrequencyDomainDelay().
+		*	\param [in,out] leftSpectrumSum left output spectrum, of GetSpectrumSize() size, the output of this convolver is added to it
+		*	\param [in,out] rightSpectrumSum right output spectrum, of GetSpectrumSize() size
+		*	\retval true if the spectra have been accumulated, false if the sizes do not match the setup
+		*   \eh On error, an error code is reported to the error handler.
+		*/
+		bool AccumulateUPConvolutionWithMemory(const CMonoBuffer<float>& inBuffer_Time, const std::vector<CMonoBuffer<float>>& leftIR, const std::vector<CMonoBuffer<float>>& rightIR,
+			int leftDelay, int rightDelay, CMonoBuffer<float>& leftSpectrumSum, CMonoBuffer<float>& rightSpectrumSum)
+		{
+			ASSERT(inBuffer_Time.size() == inputSize, RESULT_ERROR_BADSIZE, "Bad input size, don't match with the size setting up in the setup method", "");
+			ASSERT(impulseResponseNumberOfSubfilters == leftIR.size() && impulseResponseNumberOfSubfilters == rightIR.size(), RESULT_ERROR_BADSIZE, "Bad input size, the number of impulse response partitions does not correspond to what is expected.", "Has this class been initialised correctly?");
+
+			if (!setupDone) {
+				SET_RESULT(RESULT_ERROR_NOTSET, "HRTF storage buffer to perform UP convolution with memory has not been initialized");
+				return false;
+			}
+			if (static_cast<int>(inBuffer_Time.size()) != inputSize || static_cast<int>(leftIR.size()) != impulseResponseNumberOfSubfilters || static_cast<int>(rightIR.size()) != impulseResponseNumberOfSubfilters
+				|| static_cast<int>(leftSpectrumSum.size()) != impulseResponse_Frequency_Block_Size || static_cast<int>(rightSpectrumSum.size()) != impulseResponse_Frequency_Block_Size) {
+				SET_RESULT(RESULT_ERROR_BADSIZE, "The input buffer size is not correct or there is not a valid HRTF loded");
+				return false;
+			}
+
+			//Step 1- extend the input time signal buffer in order to have double length, then keep its end for the next block
+			std::copy(storageInput_buffer.begin(), storageInput_buffer.end(), inBuffer_Time_dobleSize.begin());
+			std::copy(inBuffer_Time.begin(), inBuffer_Time.end(), inBuffer_Time_dobleSize.begin() + storageInput_bufferSize);
+			std::copy(inBuffer_Time_dobleSize.end() - storageInput_bufferSize, inBuffer_Time_dobleSize.end(), storageInput_buffer.begin());
+
+			//Step 2,3 - FFT of the input signal, shared by both ears, and store it with the current (delayed) impulse responses
+			Common::CFFTCalculator::CalculateFFT(inBuffer_Time_dobleSize, storageInputFFT_buffer[historyHead], fftWorkspace);
+			StoreDelayedIR(leftIR, leftDelay, leftRamp, leftRampDelay, storageLeftIR_buffer[historyHead]);
+			StoreDelayedIR(rightIR, rightDelay, rightRamp, rightRampDelay, storageRightIR_buffer[historyHead]);
+
+			//Step 4, 5 - Multiplications and sums: subfilter i of the impulse responses of i blocks ago with the input of i blocks ago
+			int block = historyHead;
+			for (int i = 0; i < impulseResponseNumberOfSubfilters; i++) {
+				MultiplyAccumulate(storageInputFFT_buffer[block], storageLeftIR_buffer[block][i], leftSpectrumSum);
+				MultiplyAccumulate(storageInputFFT_buffer[block], storageRightIR_buffer[block][i], rightSpectrumSum);
+				block = PreviousBlock(block);
+			}
+			historyHead = (historyHead == historySize - 1) ? 0 : historyHead + 1;
+			return true;
+		}
+
+		/** \brief Fade the output of the last block in from the output the impulse responses of the block before would have given
+		*	\details The impulse responses stored with a block are only applied to the input of that block, so the output of a block
+		*	continues the previous one except for the first subfilter applied to the new input. When the impulse responses change, for
+		*	example because the source or the listener moves, that part jumps at the start of the block. This replaces it with a linear
+		*	crossfade across the block, from the first subfilters of the previous block to the current ones, at the cost of one more
+		*	complex multiplication and inverse FFT per ear. To be called right after ProcessUPConvolutionWithMemory() or
+		*	AccumulateUPConvolutionWithMemory(), and only when the impulse responses have changed.
+		*	\param [in,out] leftOutBuffer left output signal of B size, the correction is added to it. It can hold silence if the output
+		*	spectra have been accumulated.
+		*	\param [in,out] rightOutBuffer right output signal of B size
+		*   \eh Nothing is reported to the error handler.
+		*/
+		void FadeFromPreviousImpulseResponses(CMonoBuffer<float>& leftOutBuffer, CMonoBuffer<float>& rightOutBuffer) {
+			if (!setupDone || static_cast<int>(leftOutBuffer.size()) != inputSize || static_cast<int>(rightOutBuffer.size()) != inputSize) { return; }
+
+			const int current = PreviousBlock(historyHead);
+			const int previous = PreviousBlock(current);
+			AddFadeFromPreviousSubfilter(storageInputFFT_buffer[current], storageLeftIR_buffer[previous][0], storageLeftIR_buffer[current][0], leftOutBuffer);
+			AddFadeFromPreviousSubfilter(storageInputFFT_buffer[current], storageRightIR_buffer[previous][0], storageRightIR_buffer[current][0], rightOutBuffer);
+		}
+
+		/** \brief Get the largest delay that can be applied in the frequency domain without time aliasing
+		*	\details The input is transformed together with the last samples of the previous blocks. Those samples beyond the B needed by
+		*	the subfilters leave room to shift the output. When B is a power of two there is no such room.
+		*	\retval maximum delay, in samples
+		*/
+		int GetMaxFrequencyDomainDelay() const {
+			if (!setupDone) { return 0; }
+			return storageInput_bufferSize - inputSize;
+		}
+
+		/** \brief Get the number of blocks an input stays in the convolution
+		*	\details The input is transformed together with the last samples of the previous blocks and its spectrum is kept for one block per subfilter.
+		*	After this many blocks of silence the output is silent, and blocks of silence that are not processed leave the convolver as if they had been.
+		*	\retval number of blocks, 0 if the convolver has not been set up
+		*/
+		int GetTailBlocks() const {
+			if (!setupDone || inputSize == 0) { return 0; }
+			return impulseResponseNumberOfSubfilters + (storageInput_bufferSize + inputSize - 1) / inputSize;
+		}
+
+		/** \brief Get the size of the output spectra, real and imaginary parts interlaced
+		*/
+		int GetSpectrumSize() const { return impulseResponse_Frequency_Block_Size; }
+
+		/** \brief Transform an output spectrum back to the time domain
+		*	\param [in] _sum output spectrum, for example the sum of the spectra of several convolvers
+		*	\param [out] _outBuffer output signal of B size
+		*	\param [out] _ifftBuffer scratch buffer for the whole inverse FFT
+		*	\param [in,out] _fftWorkspace scratch memory of the inverse FFT
+		*	\param [in] _inputSize B
+		*/
+		static void CalculateOutputIFFT(const CMonoBuffer<float>& _sum, CMonoBuffer<float>& _outBuffer, std::vector<float>& _ifftBuffer, Common::CFFTCalculator::TFFTWorkspace& _fftWorkspace, int _inputSize) {
+			Common::CFFTCalculator::CalculateIFFT(_sum, _ifftBuffer, _fftWorkspace);
+			// Only the last B samples are significant
+			_outBuffer.assign(_ifftBuffer.end() - _inputSize, _ifftBuffer.end());
+		}
+
+		/** \brief Reset class state and clean convolution buffers
+		*   \details After calling this method it is necessary to do a setup again.
+		*/
+		void Reset() {
+			if (setupDone) {
+				setupDone = false;
+				storageInput_buffer.clear();
+				inBuffer_Time_dobleSize.clear();
+				storageInputFFT_buffer.clear();
+				storageLeftIR_buffer.clear();
+				storageRightIR_buffer.clear();
+				leftSum.clear();
+				rightSum.clear();
+				delayTwiddles.clear();
+				leftRamp.clear();
+				rightRamp.clear();
+				leftRampDelay = 0;
+				rightRampDelay = 0;
+				fadeOutput.clear();
+				inputSize = 0;
+				impulseResponseNumberOfSubfilters = 0;
+				impulseResponse_Frequency_Block_Size = 0;
+				historySize = 0;
+				historyHead = 0;
+			}
+		}
+
+		/** \brief Forget the previous inputs, as if the convolver had been fed silence. The setup is kept and nothing is allocated.
+		*/
+		void ClearMemory() {
+			std::fill(storageInput_buffer.begin(), storageInput_buffer.end(), 0.0f);
+			for (std::vector<float>& inputFFT : storageInputFFT_buffer) {
+				std::fill(inputFFT.begin(), inputFFT.end(), 0.0f);
+			}
+		}
+
+	private:
+		/// Add the product of one input spectrum and one impulse response subfilter to the output spectrum
+		static void MultiplyAccumulate(const std::vector<float>& _inputFFT, const CMonoBuffer<float>& _subfilter, CMonoBuffer<float>& _sum) {
+			ASSERT(_inputFFT.size() == _subfilter.size() && _sum.size() == _subfilter.size(), RESULT_ERROR_BADSIZE, "Complex multiplication in frequency convolver requires two vectors of the same size", "");
+			if (_inputFFT.size() == _subfilter.size() && _sum.size() == _subfilter.size()) {	//Just in case error handler is off
+				Common::CComplexKernels::MultiplyAccumulate(_inputFFT.data(), _subfilter.data(), _sum.data(), _sum.size() / 2);
+			}
+		}
+
+		/// Position of the block before the given one in the history buffers
+		int PreviousBlock(int _block) const {
+			return (_block == 0) ? historySize - 1 : _block - 1;
+		}
+
+		/// Add the output of the previous first subfilter minus that of the current one, faded out across the block
+		void AddFadeFromPreviousSubfilter(const std::vector<float>& _inputFFT, const CMonoBuffer<float>& _previousSubfilter, const CMonoBuffer<float>& _currentSubfilter, CMonoBuffer<float>& _outBuffer) {
+			// The sums are free again once the outputs of the block are out
+			std::fill(leftSum.begin(), leftSum.end(), 0.0f);
+			std::fill(rightSum.begin(), rightSum.end(), 0.0f);
+			MultiplyAccumulate(_inputFFT, _previousSubfilter, leftSum);
+			MultiplyAccumulate(_inputFFT, _currentSubfilter, rightSum);
+			for (std::size_t i = 0; i < leftSum.size(); i++) {
+				leftSum[i] -= rightSum[i];
+			}
+			CalculateIFFT(leftSum, fadeOutput);
+
+			// The weight of the previous subfilter goes from 1 right before the block to 0 at its last sample
+			for (int i = 0; i < inputSize; i++) {
+				const float previousGain = 1.0f - static_cast<float>(i + 1) / static_cast<float>(inputSize);
+				_outBuffer[i] += fadeOutput[i] * previousGain;
+			}
+		}
+
+		/// Transform one output spectrum back and keep the last inputSize samples
+		void CalculateIFFT(const CMonoBuffer<float>& _sum, CMonoBuffer<float>& _outBuffer) {
+			CalculateOutputIFFT(_sum, _outBuffer, outputBuffer_temp, fftWorkspace, inputSize);
+		}
+
+		/// Store the impulse response in the history, multiplied by the linear phase of the delay
+		void StoreDelayedIR(const THRIR_partitioned& _IR, int _delay, CMonoBuffer<float>& _ramp, int& _rampDelay, THRIR_partitioned& _storedIR) {
+			_delay = std::max(0, std::min(_delay, GetMaxFrequencyDomainDelay()));
+			if (_delay == 0) {
+				_storedIR = _IR;
+				return;
+			}
+
+			// The ramp only changes when the delay does
+			if (_delay != _rampDelay) {
+				const int fftSize = impulseResponse_Frequency_Block_Size / 2;
+				for (int k = 0; k < fftSize; k++) {
+					const int twiddle = static_cast<int>((static_cast<long long>(_delay) * k) % fftSize);
+					_ramp[2 * k] = delayTwiddles[2 * twiddle];
+					_ramp[2 * k + 1] = delayTwiddles[2 * twiddle + 1];
+				}
+				_rampDelay = _delay;
+			}
+
+			for (int i = 0; i < impulseResponseNumberOfSubfilters; i++) {
+				std::fill(_storedIR[i].begin(), _storedIR[i].end(), 0.0f);
+				MultiplyAccumulate(_IR[i], _ramp, _storedIR[i]);
+			}
+		}
+
+		// ATTRIBUTES
+		bool setupDone;								//It's true when setup has been called at least once
+		int inputSize;								//Size of the inputs buffer
+		int impulseResponseNumberOfSubfilters;		//Number of blocks in which each impulse response is divided
+		int impulseResponse_Frequency_Block_Size;	//Size of each impulse response block
+		int storageInput_bufferSize;				//Number of samples to be saved in each audio loop
+		int historySize;							//Number of blocks kept in the history buffers
+		int historyHead;							//Position of the current block in the history buffers
+		int leftRampDelay;							//Delays the ramps have been built for
+		int rightRampDelay;
+
+		std::vector<float> storageInput_buffer;				//To store the last input signal
+		std::vector<float> inBuffer_Time_dobleSize;			//Last and current input, transformed every block
+		std::vector<std::vector<float>> storageInputFFT_buffer;	//History of input signal FFTs, shared by both ears
+		std::vector<THRIR_partitioned> storageLeftIR_buffer;	//History of the left impulse responses
+		std::vector<THRIR_partitioned> storageRightIR_buffer;	//History of the right impulse responses
+		CMonoBuffer<float> leftSum;							//Output spectra, reused every block
+		CMonoBuffer<float> rightSum;
+		std::vector<float> outputBuffer_temp;				//Output of the IFFT, reused every block
+		Common::CFFTCalculator::TFFTWorkspace fftWorkspace;	//Scratch memory of the FFTs, reused every block
+		CMonoBuffer<float> fadeOutput;						//Correction added by FadeFromPreviousImpulseResponses()
+		std::vector<float> delayTwiddles;					//exp(2*pi*i*k/N) for every bin k of the FFT of size N
+		CMonoBuffer<float> leftRamp;						//Linear phase of the current delay of each ear
+		CMonoBuffer<float> rightRamp;
+	};
+}
+#endif
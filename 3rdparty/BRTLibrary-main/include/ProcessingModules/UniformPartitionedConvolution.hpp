@@ -27,7 +27,9 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <Common/FFTCalculator.hpp>
+#include <Common/ComplexKernels.hpp>
 #include <Common/Buffer.hpp>
 #include <Common/CommonDefinitions.hpp>
 
@@ -95,6 +97,12 @@ namespace BRTProcessing {
 			}
 			it_storageInputFFT = storageInputFFT_buffer.begin();
 
+			//Scratch memory of the method with memory, reused every block
+			inBuffer_Time_dobleSize.assign(storageInput_bufferSize + inputSize, 0.0f);
+			sum.assign(impulseResponse_Frequency_Block_Size, 0.0f);
+			outputBuffer_temp.assign(impulseResponse_Frequency_Block_Size / 2, 0.0f);
+			Common::CFFTCalculator::PrepareWorkspace(fftWorkspace, impulseResponse_Frequency_Block_Size);
+
 			//Preparing the vector of buffers that is going to store the history of the HRIR	
 			if (impulseResponseMemory)
 			{
@@ -127,7 +135,6 @@ namespace BRTProcessing {
 		{
 			CMonoBuffer<float> sum;
 			sum.resize(impulseResponse_Frequency_Block_Size, 0.0f);
-			CMonoBuffer<float> temp;
 
 			if (!setupDone) { 
 				SET_RESULT(RESULT_ERROR_NOTSET, "Storage buffer to perform UP convolution has not been initialized");
@@ -152,8 +159,7 @@ namespace BRTProcessing {
 				auto it_product = it_storageInputFFT;
 
 				for (int i = 0; i < impulseResponseNumberOfSubfilters; i++) {
-					Common::CFFTCalculator::ProcessComplexMultiplication(*it_product, IR[i], temp);
-					sum += temp;
+					MultiplyAccumulate(*it_product, IR[i], sum);
 					if (it_product == storageInputFFT_buffer.begin()) {
 						it_product = storageInputFFT_buffer.end() - 1;
 					}
@@ -194,9 +200,7 @@ namespace BRTProcessing {
 		//void ProcessUPConvolutionWithMemory(const CMonoBuffer<float>& inBuffer_Time, const std::vector<CMonoBuffer<float>>& IR, CMonoBuffer<float>& outBuffer)
 		void ProcessUPConvolutionWithMemory(const CMonoBuffer<float>& inBuffer_Time, const std::vector<CMonoBuffer<float>>& IR, CMonoBuffer<float>& outBuffer, bool _doIFFT = true)
 		{			
-			CMonoBuffer<float> sum;
-			sum.resize(impulseResponse_Frequency_Block_Size, 0.0f);
-			CMonoBuffer<float> temp;
+			std::fill(sum.begin(), sum.end(), 0.0f);
 
 			ASSERT(inBuffer_Time.size() == inputSize, RESULT_ERROR_BADSIZE, "Bad input size, don't match with the size setting up in the setup method", "");
 			ASSERT(impulseResponseNumberOfSubfilters == IR.size(), RESULT_ERROR_BADSIZE, "Bad input size, the number of impulse response partitions does not correspond to what is expected.", "Has this class been initialised correctly?");
@@ -206,24 +210,14 @@ namespace BRTProcessing {
 				if (inBuffer_Time.size() == inputSize && IR.size() != 0)
 				{
 					//Step 1- extend the input time signal buffer in order to have double length
-					std::vector<float> inBuffer_Time_dobleSize;
-					inBuffer_Time_dobleSize.reserve(inputSize + storageInput_bufferSize );
-					inBuffer_Time_dobleSize.insert(inBuffer_Time_dobleSize.begin(), storageInput_buffer.begin(), storageInput_buffer.end());
-					inBuffer_Time_dobleSize.insert(inBuffer_Time_dobleSize.end(), inBuffer_Time.begin(), inBuffer_Time.end());
+					std::copy(storageInput_buffer.begin(), storageInput_buffer.end(), inBuffer_Time_dobleSize.begin());
+					std::copy(inBuffer_Time.begin(), inBuffer_Time.end(), inBuffer_Time_dobleSize.begin() + storageInput_bufferSize);
 					
-					//Store current input signal
-					//storageInput_buffer = inBuffer_Time;					
-					std::vector<float> tempStorageInput;
-					tempStorageInput.reserve(storageInput_bufferSize);
-					tempStorageInput.insert(tempStorageInput.begin(), storageInput_buffer.end() -(storageInput_bufferSize - inputSize), storageInput_buffer.end());
-					tempStorageInput.insert(tempStorageInput.end(), inBuffer_Time.begin(), inBuffer_Time.end());
-					storageInput_buffer = tempStorageInput;
-
-					//Step 2,3 - FFT of the input signal
-					CMonoBuffer<float> inBuffer_Frequency;
-					Common::CFFTCalculator::CalculateFFT(inBuffer_Time_dobleSize, inBuffer_Frequency);
-					//Store the new input FFT into the first FTT history buffers
-					*it_storageInputFFT = inBuffer_Frequency;
+					//Store current input signal, the last storageInput_bufferSize samples
+					std::copy(inBuffer_Time_dobleSize.end() - storageInput_bufferSize, inBuffer_Time_dobleSize.end(), storageInput_buffer.begin());
+
+					//Step 2,3 - FFT of the input signal, stored into the first FTT history buffers
+					Common::CFFTCalculator::CalculateFFT(inBuffer_Time_dobleSize, *it_storageInputFFT, fftWorkspace);
 
 					//Store the HRIR input signal in the storage HRIR matrix
 					*it_storageHRIR = IR;
@@ -233,8 +227,7 @@ namespace BRTProcessing {
 					auto it_HRIR_multiplicationFactor = it_storageHRIR;
 
 					for (int i = 0; i < impulseResponseNumberOfSubfilters; i++) {
-						Common::CFFTCalculator::ProcessComplexMultiplication(*it_product, (*it_HRIR_multiplicationFactor)[i], temp);
-						sum += temp;
+						MultiplyAccumulate(*it_product, (*it_HRIR_multiplicationFactor)[i], sum);
 						if (it_product == storageInputFFT_buffer.begin()) {
 							it_product = storageInputFFT_buffer.end() - 1;
 						}
@@ -267,15 +260,12 @@ namespace BRTProcessing {
 
 					if (_doIFFT) {
 						// Make the IIF
-						CMonoBuffer<float> ouputBuffer_temp;
-						Common::CFFTCalculator::CalculateIFFT(sum, ouputBuffer_temp);
-						//We are left only with the final half of the result
-						//int halfsize = (int)(ouputBuffer_temp.size() * 0.5f);
-						CMonoBuffer<float> temp_OutputBlock(ouputBuffer_temp.end() - inputSize, ouputBuffer_temp.end());
-						outBuffer = std::move(temp_OutputBlock);			//To use in C++11
+						Common::CFFTCalculator::CalculateIFFT(sum, outputBuffer_temp, fftWorkspace);
+						//We are left only with the last inputSize samples of the result
+						outBuffer.assign(outputBuffer_temp.end() - inputSize, outputBuffer_temp.end());
 					}
 					else {
-						outBuffer = std::move(sum);			//To use in C++11	
+						outBuffer = sum;			//Copied, sum is reused by the next block
 					}										
 				}
 				else
@@ -293,13 +283,23 @@ namespace BRTProcessing {
 		
 		static void CalculateIFFT(const CMonoBuffer<float>& _inBuffer, CMonoBuffer<float> &_outBuffer) {
 
-			CMonoBuffer<float> outBuffer_temp;
-			Common::CFFTCalculator::CalculateIFFT(_inBuffer, outBuffer_temp);
-			//We are left only with the final half of the result
-			int halfsize = (int)(outBuffer_temp.size() * 0.5f);
+			std::vector<float> outBuffer_temp;
+			Common::CFFTCalculator::TFFTWorkspace fftWorkspace;
+			CalculateIFFT(_inBuffer, _outBuffer, outBuffer_temp, fftWorkspace);
+		}
 
-			CMonoBuffer<float> outBufferTempHalf(outBuffer_temp.begin() + halfsize, outBuffer_temp.end());
-			_outBuffer = std::move(outBufferTempHalf);			//To use in C++11
+		/** \brief Transform an output spectrum back to the time domain and keep the final half, like CalculateIFFT(), with the given scratch memory
+		*	\param [in] _inBuffer output spectrum
+		*	\param [out] _outBuffer final half of the output signal, nothing is allocated if it has this size already
+		*	\param [out] _ifftBuffer scratch buffer for the whole inverse FFT
+		*	\param [in,out] _fftWorkspace scratch memory of the inverse FFT
+		*/
+		static void CalculateIFFT(const CMonoBuffer<float>& _inBuffer, CMonoBuffer<float>& _outBuffer, std::vector<float>& _ifftBuffer, Common::CFFTCalculator::TFFTWorkspace& _fftWorkspace) {
+
+			Common::CFFTCalculator::CalculateIFFT(_inBuffer, _ifftBuffer, _fftWorkspace);
+			//We are left only with the final half of the result
+			const std::size_t halfsize = _ifftBuffer.size() / 2;
+			_outBuffer.assign(_ifftBuffer.begin() + halfsize, _ifftBuffer.end());
 		}
 
 		/** \brief Reset class state and clean convolution buffers 
@@ -320,6 +320,14 @@ namespace BRTProcessing {
 		}
 
 	private:
+		/// Add the product of one input spectrum and one impulse response subfilter to the output spectrum
+		static void MultiplyAccumulate(const std::vector<float>& _inputFFT, const CMonoBuffer<float>& _subfilter, CMonoBuffer<float>& _sum) {
+			ASSERT(_inputFFT.size() == _subfilter.size() && _sum.size() == _subfilter.size(), RESULT_ERROR_BADSIZE, "Complex multiplication in frequency convolver requires two vectors of the same size", "");
+			if (_inputFFT.size() == _subfilter.size() && _sum.size() == _subfilter.size()) {	//Just in case error handler is off
+				Common::CComplexKernels::MultiplyAccumulate(_inputFFT.data(), _subfilter.data(), _sum.data(), _sum.size() / 2);
+			}
+		}
+
 		// ATTRIBUTES	
 		int inputSize;								//Size of the inputs buffer				
 		int impulseResponse_Frequency_Block_Size;	//Size of the HRIR buffer
@@ -333,6 +341,11 @@ namespace BRTProcessing {
 		std::vector<std::vector<float>>::iterator it_storageInputFFT;	//Declare a general iterator to keep the head of the FTTs buffer
 		std::vector<THRIR_partitioned> storageHRIR_buffer;			//To store the HRIR of the orientation of the previous frames
 		std::vector<THRIR_partitioned>::iterator it_storageHRIR;		//Declare a general iterator to keep the head of the storageHRIR_buffer		
+
+		std::vector<float> inBuffer_Time_dobleSize;					//Stored and current input signal, reused every block
+		CMonoBuffer<float> sum;										//Output spectrum, reused every block
+		std::vector<float> outputBuffer_temp;						//Output of the IFFT, reused every block
+		Common::CFFTCalculator::TFFTWorkspace fftWorkspace;			//Scratch memory of the FFTs, reused every block
 	};
 }
 #endif
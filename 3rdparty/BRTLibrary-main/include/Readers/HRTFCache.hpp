@@ -0,0 +1,351 @@
+/**
+* \class CHRTFCache
+*
+* \brief Declaration of CHRTFCache class
+* \date	June 2023
+*
+* \authors 3DI-DIANA Research Group (University of Malaga), in alphabetical order: M. Cuevas-Rodriguez, D. Gonzalez-Toledo, L. Molina-Tanco, F. Morales-Benitez ||
+* Coordinated by , A. Reyes-Lecuona (University of Malaga)||
+* \b Contact: areyes@uma.es
+*
+* \b Copyright: University of Malaga
+*
+* \b Contributions: (additional authors/contributors can be added here)
+*
+* \b Project: SONICOM ||
+* \b Website: https://www.sonicom.eu/
+*
+* \b Acknowledgement: This project has received funding from the European Union's Horizon 2020 research and innovation programme under grant agreement no.101017743
+*
+* \b Licence: This program is free software, you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+*/
+
+#ifndef _HRTF_CACHE_HPP_
+#define _HRTF_CACHE_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <ServiceModules/HRTF.hpp>
+#include <Common/ErrorHandler.hpp>
+
+#define HRTF_CACHE_VERSION 1		///< Increment whenever the layout of the cache or the resampling algorithms change
+
+namespace BRTReaders {
+
+	/** \details Stores the resampled, partitioned and FFT transformed HRIR table of a CHRTF in a binary file, so that the
+	*	expensive CHRTF::EndSetup() pipeline only has to run once per SOFA file and configuration.
+	*	The file is read from a memory block (typically a mapping of the file), which must stay valid only during Load().
+	*	The layout uses the native byte order and is only meant to be shared between programs running on the same host.
+	*	The raw HRIR table read from the SOFA file is not stored, so CHRTF::GetRawHRTFTable() is empty for cached HRTFs.
+	*/
+	class CHRTFCache {
+	public:
+		/** \brief Everything the resampled table depends on. A cache file is only used if its key is identical.
+		*/
+		struct TKey {
+			std::string sofaHash;		///< Hash of the content of the SOFA file, in any format chosen by the caller
+			int32_t samplingRate;		///< Sample rate the HRTF is used at
+			int32_t bufferSize;			///< Buffer size the HRIRs have been partitioned for
+			int32_t resamplingStep;		///< Grid step of the resampled table, in degrees
+
+			TKey() : samplingRate{ 0 }, bufferSize{ 0 }, resamplingStep{ 0 } {}
+			TKey(const std::string& _sofaHash, int32_t _samplingRate, int32_t _bufferSize, int32_t _resamplingStep)
+				: sofaHash{ _sofaHash }, samplingRate{ _samplingRate }, bufferSize{ _bufferSize }, resamplingStep{ _resamplingStep } {}
+		};
+
+		/** \brief Write the table of a completely set up HRTF to a cache file
+		*	\details The file is written next to its final location and renamed at the end, so that concurrent readers never see a partial file.
+		*	\param [in] _path path of the cache file
+		*	\param [in] _hrtf HRTF whose setup has finished
+		*	\param [in] _key key the HRTF has been created with
+		*	\retval success true if the file has been written
+		*   \eh On error, an error code is reported to the error handler.
+		*/
+		static bool Save(const std::string& _path, BRTServices::CHRTF& _hrtf, const TKey& _key) {
+			BRTServices::CServicesReadGuard guard(_hrtf);
+			const BRTServices::CHRTF::TResampledData* data = _hrtf.resampledData.Get();
+			if (data == nullptr || data->table.empty()) {
+				SET_RESULT(RESULT_ERROR_NOTSET, "The HRTF has not been set up, it can not be cached");
+				return false;
+			}
+
+			const std::string temporaryPath = _path + ".tmp";
+			{
+				std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+				if (!file) {
+					SET_RESULT(RESULT_ERROR_FILE, "The HRTF cache file could not be created: " + temporaryPath);
+					return false;
+				}
+
+				WriteHeader(file, _key);
+				Write<int32_t>(file, _hrtf.HRIRLength);
+				Write<int32_t>(file, data->numberOfSubfilters);
+				Write<int32_t>(file, data->subfilterLength);
+				Write<int32_t>(file, _hrtf.gridSamplingStep);
+				Write<int32_t>(file, static_cast<int32_t>(_hrtf.extrapolationMethod));
+				Write<float>(file, _hrtf.distanceOfMeasurement);
+				Write<int32_t>(file, _hrtf.samplingRate);
+				WriteVector(file, _hrtf.cranialGeometry.GetLeftEarLocalPosition());
+				WriteVector(file, _hrtf.cranialGeometry.GetRightEarLocalPosition());
+				WriteString(file, _hrtf.fileName);
+				WriteString(file, _hrtf.title);
+				WriteString(file, _hrtf.databaseName);
+				WriteString(file, _hrtf.listenerShortName);
+
+				Write<uint64_t>(file, data->stepVector.size());
+				for (const auto& step : data->stepVector) {
+					WriteOrientation(file, step.first);
+					Write<float>(file, step.second);
+				}
+
+				Write<uint64_t>(file, data->table.size());
+				for (const auto& entry : data->table) {
+					WriteOrientation(file, entry.first);
+					Write<uint64_t>(file, entry.second.leftDelay);
+					Write<uint64_t>(file, entry.second.rightDelay);
+					if (!WritePartitions(file, entry.second.leftHRIR_Partitioned, data->numberOfSubfilters, data->subfilterLength) ||
+						!WritePartitions(file, entry.second.rightHRIR_Partitioned, data->numberOfSubfilters, data->subfilterLength)) {
+						file.close();
+						std::error_code ignored;
+						std::filesystem::remove(temporaryPath, ignored);
+						SET_RESULT(RESULT_ERROR_INVALID_PARAM, "The partitioned HRIRs do not all have the same size, they can not be cached");
+						return false;
+					}
+				}
+
+				if (!file.good()) {
+					file.close();
+					std::error_code ignored;
+					std::filesystem::remove(temporaryPath, ignored);
+					SET_RESULT(RESULT_ERROR_FILE, "The HRTF cache file could not be written: " + temporaryPath);
+					return false;
+				}
+			}
+
+			std::error_code error;
+			std::filesystem::rename(temporaryPath, _path, error);
+			if (error) {
+				std::filesystem::remove(temporaryPath, error);
+				SET_RESULT(RESULT_ERROR_FILE, "The HRTF cache file could not be renamed: " + _path);
+				return false;
+			}
+
+			SET_RESULT(RESULT_OK, "HRTF cache file written succesfully");
+			return true;
+		}
+
+		/** \brief Set up an HRTF from the content of a cache file
+		*	\param [in] _data content of the cache file
+		*	\param [in] _size size of the content, in bytes
+		*	\param [in] _hrtf HRTF to set up, must not have been set up yet
+		*	\param [in] _key key the HRTF is wanted for
+		*	\retval success false if the file is damaged or has been created for another key, in which case _hrtf is unchanged
+		*   \eh On error, an error code is reported to the error handler.
+		*/
+		static bool Load(const char* _data, std::size_t _size, std::shared_ptr<BRTServices::CHRTF> _hrtf, const TKey& _key) {
+			CReader reader(_data, _size);
+			if (!ReadHeader(reader, _key)) {
+				SET_RESULT(RESULT_ERROR_NOTSET, "The HRTF cache file does not match the requested HRTF");
+				return false;
+			}
+
+			int32_t HRIRLength = reader.Read<int32_t>();
+			int32_t numberOfSubfilters = reader.Read<int32_t>();
+			int32_t subfilterLength = reader.Read<int32_t>();
+			int32_t gridSamplingStep = reader.Read<int32_t>();
+			int32_t extrapolationMethod = reader.Read<int32_t>();
+			float distanceOfMeasurement = reader.Read<float>();
+			int32_t samplingRate = reader.Read<int32_t>();
+			Common::CVector3 leftEarPosition = ReadVector(reader);
+			Common::CVector3 rightEarPosition = ReadVector(reader);
+			std::string fileName = reader.ReadString();
+			std::string title = reader.ReadString();
+			std::string databaseName = reader.ReadString();
+			std::string listenerShortName = reader.ReadString();
+			if (!reader.IsValid() || numberOfSubfilters <= 0 || subfilterLength <= 0 ||
+				static_cast<uint64_t>(numberOfSubfilters) * static_cast<uint64_t>(subfilterLength) * sizeof(float) > _size) {
+				SET_RESULT(RESULT_ERROR_INVALID_PARAM, "The HRTF cache file is damaged");
+				return false;
+			}
+
+			std::unique_ptr<BRTServices::CHRTF::TResampledData> newResampledData = std::make_unique<BRTServices::CHRTF::TResampledData>();
+			newResampledData->numberOfSubfilters = numberOfSubfilters;
+			newResampledData->subfilterLength = subfilterLength;
+			newResampledData->HRIRCache.Setup(HRIR_CACHE_CAPACITY, numberOfSubfilters, subfilterLength);
+
+			uint64_t numberOfSteps = reader.Read<uint64_t>();
+			for (uint64_t i = 0; i < numberOfSteps && reader.IsValid(); i++) {
+				orientation stepOrientation = ReadOrientation(reader);
+				newResampledData->stepVector.emplace(stepOrientation, reader.Read<float>());
+			}
+
+			uint64_t numberOfOrientations = reader.Read<uint64_t>();
+			newResampledData->table.reserve(static_cast<std::size_t>(std::min<uint64_t>(numberOfOrientations, _size)));
+			for (uint64_t i = 0; i < numberOfOrientations && reader.IsValid(); i++) {
+				orientation hrirOrientation = ReadOrientation(reader);
+				BRTServices::THRIRPartitionedStruct hrir;
+				hrir.leftDelay = reader.Read<uint64_t>();
+				hrir.rightDelay = reader.Read<uint64_t>();
+				ReadPartitions(reader, hrir.leftHRIR_Partitioned, numberOfSubfilters, subfilterLength);
+				ReadPartitions(reader, hrir.rightHRIR_Partitioned, numberOfSubfilters, subfilterLength);
+				newResampledData->table.emplace(hrirOrientation, std::move(hrir));
+			}
+
+			if (!reader.IsValid() || !reader.IsAtEnd() || newResampledData->table.empty()) {
+				SET_RESULT(RESULT_ERROR_INVALID_PARAM, "The HRTF cache file is damaged");
+				return false;
+			}
+
+			std::lock_guard<std::mutex> l(_hrtf->mutex);
+			_hrtf->HRIRLength = HRIRLength;
+			_hrtf->HRIR_partitioned_NumberOfSubfilters = numberOfSubfilters;
+			_hrtf->HRIR_partitioned_SubfilterLength = subfilterLength;
+			_hrtf->bufferSize = _key.bufferSize;
+			_hrtf->gridSamplingStep = gridSamplingStep;
+			_hrtf->extrapolationMethod = static_cast<BRTServices::TEXTRAPOLATION_METHOD>(extrapolationMethod);
+			_hrtf->distanceOfMeasurement = distanceOfMeasurement;
+			_hrtf->cranialGeometry.SetLeftEarPosition(leftEarPosition);
+			_hrtf->cranialGeometry.SetRightEarPosition(rightEarPosition);
+			_hrtf->fileName = fileName;
+			_hrtf->title = title;
+			_hrtf->databaseName = databaseName;
+			_hrtf->listenerShortName = listenerShortName;
+			_hrtf->samplingRate = samplingRate;
+			_hrtf->t_HRTF_DataBase.clear();
+			_hrtf->resampledData.Publish(std::move(newResampledData));
+			_hrtf->setupInProgress = false;
+			_hrtf->HRTFLoaded = true;
+
+			SET_RESULT(RESULT_OK, "HRTF loaded from cache succesfully");
+			return true;
+		}
+
+	private:
+		/** \brief Bounds checked sequential reading of a memory block. Once a read has failed, every following read returns zero.
+		*/
+		class CReader {
+		public:
+			CReader(const char* _data, std::size_t _size) : data{ _data }, size{ _size }, position{ 0 }, valid{ _data != nullptr } {}
+
+			template <typename T>
+			T Read() {
+				T value{};
+				ReadBytes(&value, sizeof(T));
+				return value;
+			}
+
+			std::string ReadString() {
+				uint32_t length = Read<uint32_t>();
+				if (!valid || length > size - position) {
+					valid = false;
+					return std::string();
+				}
+				std::string value(data + position, length);
+				position += length;
+				return value;
+			}
+
+			void ReadBytes(void* _destination, std::size_t _bytes) {
+				if (!valid || _bytes > size - position) {
+					valid = false;
+					return;
+				}
+				std::memcpy(_destination, data + position, _bytes);
+				position += _bytes;
+			}
+
+			bool IsValid() const { return valid; }
+			bool IsAtEnd() const { return position == size; }
+
+		private:
+			const char* data;
+			std::size_t size;
+			std::size_t position;
+			bool valid;
+		};
+
+		static constexpr char magic[8] = { 'B', 'R', 'T', 'H', 'R', 'T', 'F', 'C' };
+
+		template <typename T>
+		static void Write(std::ofstream& _file, const T& _value) {
+			_file.write(reinterpret_cast<const char*>(&_value), sizeof(T));
+		}
+
+		static void WriteString(std::ofstream& _file, const std::string& _value) {
+			Write<uint32_t>(_file, static_cast<uint32_t>(_value.size()));
+			_file.write(_value.data(), _value.size());
+		}
+
+		static void WriteVector(std::ofstream& _file, const Common::CVector3& _value) {
+			Write<float>(_file, _value.x);
+			Write<float>(_file, _value.y);
+			Write<float>(_file, _value.z);
+		}
+
+		static Common::CVector3 ReadVector(CReader& _reader) {
+			float x = _reader.Read<float>();
+			float y = _reader.Read<float>();
+			float z = _reader.Read<float>();
+			return Common::CVector3(x, y, z);
+		}
+
+		static void WriteOrientation(std::ofstream& _file, const orientation& _value) {
+			Write<double>(_file, _value.azimuth);
+			Write<double>(_file, _value.elevation);
+			Write<double>(_file, _value.distance);
+		}
+
+		static orientation ReadOrientation(CReader& _reader) {
+			double azimuth = _reader.Read<double>();
+			double elevation = _reader.Read<double>();
+			double distance = _reader.Read<double>();
+			return orientation(azimuth, elevation, distance);
+		}
+
+		static void WriteHeader(std::ofstream& _file, const TKey& _key) {
+			_file.write(magic, sizeof(magic));
+			Write<uint32_t>(_file, HRTF_CACHE_VERSION);
+			Write<uint32_t>(_file, sizeof(float));
+			WriteString(_file, _key.sofaHash);
+			Write<int32_t>(_file, _key.samplingRate);
+			Write<int32_t>(_file, _key.bufferSize);
+			Write<int32_t>(_file, _key.resamplingStep);
+		}
+
+		static bool ReadHeader(CReader& _reader, const TKey& _key) {
+			char fileMagic[sizeof(magic)];
+			_reader.ReadBytes(fileMagic, sizeof(fileMagic));
+			if (!_reader.IsValid() || std::memcmp(fileMagic, magic, sizeof(magic)) != 0) { return false; }
+			if (_reader.Read<uint32_t>() != HRTF_CACHE_VERSION) { return false; }
+			if (_reader.Read<uint32_t>() != sizeof(float)) { return false; }
+			if (_reader.ReadString() != _key.sofaHash) { return false; }
+			if (_reader.Read<int32_t>() != _key.samplingRate) { return false; }
+			if (_reader.Read<int32_t>() != _key.bufferSize) { return false; }
+			if (_reader.Read<int32_t>() != _key.resamplingStep) { return false; }
+			return _reader.IsValid();
+		}
+
+		static bool WritePartitions(std::ofstream& _file, const std::vector<CMonoBuffer<float>>& _partitions, int32_t _numberOfSubfilters, int32_t _subfilterLength) {
+			if (_partitions.size() != static_cast<std::size_t>(_numberOfSubfilters)) { return false; }
+			for (const CMonoBuffer<float>& subfilter : _partitions) {
+				if (subfilter.size() != static_cast<std::size_t>(_subfilterLength)) { return false; }
+				_file.write(reinterpret_cast<const char*>(subfilter.data()), subfilter.size() * sizeof(float));
+			}
+			return true;
+		}
+
+		static void ReadPartitions(CReader& _reader, std::vector<CMonoBuffer<float>>& _partitions, int32_t _numberOfSubfilters, int32_t _subfilterLength) {
+			_partitions.resize(_numberOfSubfilters);
+			for (CMonoBuffer<float>& subfilter : _partitions) {
+				subfilter.resize(_subfilterLength);
+				_reader.ReadBytes(subfilter.data(), subfilter.size() * sizeof(float));
+			}
+		}
+	};
+}
+#endif
@@ -58,7 +58,7 @@ namespace BRTServices
 
 		/** \brief Default constructor.
 		*/
-		CAmbisonicBIR() : AmbisonicBIRLoaded{ false }, setupInProgress{ false }, impulseResponseLength { 0 }, IRNumberOfSubFilters{ 0 }, IRSubfilterLength{ 0 }
+		CAmbisonicBIR() : AmbisonicBIRLoaded{ false }, setupInProgress{ false }, impulseResponseLength { 0 }, IRNumberOfSubFilters{ 0 }, IRSubfilterLength{ 0 }, ambisonicOrder{ 0 }, ambisonicNormalization{ BRTProcessing::TAmbisonicNormalization::N3D }
 		{			
 		}
 
@@ -108,6 +108,8 @@ namespace BRTServices
 
             Reset();								
 			setupInProgress = true;
+			ambisonicOrder = _ambisonicOrder;
+			ambisonicNormalization = _ambisonicNormalization;
 			ambisonicEncoder.Setup(_ambisonicOrder, _ambisonicNormalization);			
 			virtualSpeakers.Setup(_ambisonicOrder);			
 		}
@@ -128,6 +130,7 @@ namespace BRTServices
 			AmbisonicBIRLoaded = false;			
 			setupInProgress = false;
 			impulseResponseLength = 0;
+			ambisonicOrder = 0;
 			
 			IRSubfilterLength = 0;
 			IRNumberOfSubFilters = 0;
@@ -142,6 +145,15 @@ namespace BRTServices
 
 		bool IsReady() { return AmbisonicBIRLoaded; }
 
+		/** \brief Get the ambisonic order the IRs have been set up for
+		*	\retval order Ambisonic order, 0 if the setup has not been done
+		*/
+		int GetAmbisonicOrder() const { return ambisonicOrder; }
+
+		/** \brief Get the ambisonic normalization the IRs have been set up for
+		*/
+		BRTProcessing::TAmbisonicNormalization GetAmbisonicNormalization() const { return ambisonicNormalization; }
+
 		//////////////////////////////////////////////////////
 
 		/** \brief Add impulse response for one BFormat channel on one virtual speaker
@@ -280,14 +292,22 @@ namespace BRTServices
 			
 			if (!AmbisonicBIRLoaded || setupInProgress) {
 				SET_RESULT(RESULT_ERROR_NOTSET, "Error trying to get Ambisonic IR data from a ambisonicIRPartitioned Table. The necessary setup of the class has not been carried out.");
-				return std::vector<CMonoBuffer<float>>(); 
+				return emptyPartitionedIR;
 			}
 
 			std::lock_guard<std::mutex> l(mutex);
 
 			// Find Table to use
+			if (ambisonicIRPartitionedTable_ListenerPositions.empty()) {
+				SET_RESULT(RESULT_ERROR_NOTSET, "Error trying to get Ambisonic IR data from a ambisonicIRPartitioned Table. No IR has been added.");
+				return emptyPartitionedIR;
+			}
 			Common::CVector3 nearestListenerPosition = FindNearestListenerPosition(_listenerLocation.GetPosition());			
 			auto selectedTable = ambisonicIRPartitionedTable.find(TVector3(nearestListenerPosition));
+			if (selectedTable == ambisonicIRPartitionedTable.end()) {
+				SET_RESULT(RESULT_ERROR_OUTOFRANGE, "Error trying to get Ambisonic IR data from a ambisonicIRPartitioned Table. There is no table for the listener position.");
+				return emptyPartitionedIR;
+			}
 			
 			// Find channel into the selected table
 			auto it = selectedTable->second.find(channel);
@@ -301,7 +321,7 @@ namespace BRTServices
 				}
 			}
 			SET_RESULT(RESULT_ERROR_OUTOFRANGE, "Error trying to get Ambisonic IR data from a ambisonicIRPartitioned Table. Either the channel is not found or the requested ear did not have a valid parameter.");
-			return std::vector<CMonoBuffer<float>>(); 
+			return emptyPartitionedIR;
 		}
 
 
@@ -574,6 +594,9 @@ namespace BRTServices
 		int IRSubfilterLength;					// Data length of one block of the FFT partitioned impulse response in time domain
 		//int impulseResponseBlockLength_time;	// Data length of one block of the FFT partitioned impulse response in frequency domain		
 		int IRNumberOfSubFilters;		// Number of blocks of the partitioned IR 
+		int ambisonicOrder;						// Ambisonic order of the IRs
+		BRTProcessing::TAmbisonicNormalization ambisonicNormalization;	// Ambisonic normalization of the IRs
+		const std::vector<CMonoBuffer<float>> emptyPartitionedIR;		// Returned by reference when there is no IR to return
 		
 			
 		TAmbisonicIRTable ambisonicIRTable;								// IR data (usally in time domain)
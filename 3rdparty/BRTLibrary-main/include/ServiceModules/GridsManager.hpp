@@ -163,7 +163,18 @@ namespace BRTServices
 		template <typename T, typename U>
 		static U FindNearest(const T& table, const std::unordered_map<orientation, float>& stepMap, /*Common::T_ear ear,*/ float _azimuth, float _elevation)
 		{
-			U emptyData;
+			const U* nearest = FindNearestPtr<T, U>(table, stepMap, _azimuth, _elevation);
+			if (nearest == nullptr) { return U(); }
+			return *nearest;
+		}
+
+		/**
+		 * @brief Same as FindNearest, but returns a pointer to the table entry instead of a copy
+		 * @return Pointer to the nearest entry of the table, or nullptr if it is not found
+		 */
+		template <typename T, typename U>
+		static const U* FindNearestPtr(const T& table, const std::unordered_map<orientation, float>& stepMap, float _azimuth, float _elevation)
+		{
 			float eleStep = stepMap.find(orientation(-1, -1))->second;
 
 			float nearestElevation = (round(_elevation / eleStep) * eleStep);
@@ -173,7 +184,7 @@ namespace BRTServices
 			auto nearestElevationStep = stepMap.find(orientation(0, nearestElevation));
 			if (nearestElevationStep == stepMap.end()) {
 				SET_RESULT(RESULT_ERROR_OUTOFRANGE, "Error rounding the elevation looking in the GRID, this should not happen, it is a coding error.");
-				return emptyData;
+				return nullptr;
 			}			
 			float aziStep = nearestElevationStep->second;
 
@@ -188,12 +199,12 @@ namespace BRTServices
 			auto it = table.find(orientation(nearestAzimuth, nearestElevation));
 			if (it != table.end())
 			{				
-				return it->second;
+				return &it->second;
 			}
 			else
 			{
 				SET_RESULT(RESULT_ERROR_NOTSET, "Not found a TF close to the azimuth and elevation given in the GRID, this should not happen, it is a coding error.");				
-				return emptyData;
+				return nullptr;
 			}
 
 		}
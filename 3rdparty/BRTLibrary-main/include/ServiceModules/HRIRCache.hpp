@@ -0,0 +1,130 @@
+/**
+* \class CHRIRCache
+*
+* \brief Declaration of CHRIRCache class
+* \date	June 2023
+*
+* \authors 3DI-DIANA Research Group (University of Malaga), in alphabetical order: M. Cuevas-Rodriguez, D. Gonzalez-Toledo, L. Molina-Tanco, F. Morales-Benitez ||
+* Coordinated by , A. Reyes-Lecuona (University of Malaga)||
+* \b Contact: areyes@uma.es
+*
+* \b Copyright: University of Malaga
+*
+* \b Contributions: (additional authors/contributors can be added here)
+*
+* \b Project: SONICOM ||
+* \b Website: https://www.sonicom.eu/
+*
+* \b Acknowledgement: This project has received funding from the European Union's Horizon 2020 research and innovation programme under grant agreement no.101017743
+*
+* \b Licence: This program is free software, you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+*/
+
+#ifndef _CHRIR_CACHE_HPP_
+#define _CHRIR_CACHE_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <Common/Buffer.hpp>
+#include <Common/CommonDefinitions.hpp>
+
+#define HRIR_CACHE_CAPACITY 64		// Number of HRIRs (one ear each) kept by the cache of an HRTF table
+
+namespace BRTServices {
+
+	/** \details Least recently used set of run-time interpolated HRIRs, shared by every source rendered with the same HRTF table.
+	*	Entries are keyed on the ear and on the direction quantized to a whole number of steps, and all of their storage is
+	*	allocated up front, so that the audio threads never allocate. Threads never wait for each other either: if the cache
+	*	is busy, the lookup misses and the caller interpolates by itself.
+	*/
+	class CHRIRCache {
+	public:
+		CHRIRCache() : useCounter{ 0 } {}
+
+		/** \brief Allocate the entries, dropping everything stored before
+		*	\param [in] _capacity number of HRIRs that can be stored
+		*	\param [in] _numberOfSubfilters number of subfilters of each HRIR
+		*	\param [in] _subfilterLength length of each subfilter
+		*   \eh Nothing is reported to the error handler.
+		*/
+		void Setup(int _capacity, int32_t _numberOfSubfilters, int32_t _subfilterLength) {
+			std::lock_guard<std::mutex> l(mutex);
+			entries.assign(_capacity, TEntry());
+			for (TEntry& entry : entries) {
+				entry.HRIR.assign(_numberOfSubfilters, CMonoBuffer<float>(_subfilterLength, 0.0f));
+			}
+			useCounter = 0;
+		}
+
+		/** \brief Copy the HRIR stored for a quantized direction
+		*	\param [in] _ear ear of the HRIR
+		*	\param [in] _azimuthStep azimuth, in number of quantization steps
+		*	\param [in] _elevationStep elevation, in number of quantization steps
+		*	\param [out] _HRIR copy of the stored HRIR, its capacity is reused
+		*	\retval found true if the HRIR was stored and the cache was not busy
+		*   \eh Nothing is reported to the error handler.
+		*/
+		bool Find(Common::T_ear _ear, int32_t _azimuthStep, int32_t _elevationStep, std::vector<CMonoBuffer<float>>& _HRIR) {
+			std::unique_lock<std::mutex> l(mutex, std::try_to_lock);
+			if (!l.owns_lock()) { return false; }
+
+			for (TEntry& entry : entries) {
+				if (entry.lastUse != 0 && entry.ear == _ear && entry.azimuthStep == _azimuthStep && entry.elevationStep == _elevationStep) {
+					entry.lastUse = ++useCounter;
+					_HRIR.resize(entry.HRIR.size());
+					for (std::size_t i = 0; i < entry.HRIR.size(); i++) {
+						_HRIR[i].assign(entry.HRIR[i].begin(), entry.HRIR[i].end());
+					}
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/** \brief Store the HRIR of a quantized direction in place of the least recently used one
+		*	\details Nothing is stored if the cache is busy or if the HRIR does not have the size given to Setup.
+		*	\param [in] _ear ear of the HRIR
+		*	\param [in] _azimuthStep azimuth, in number of quantization steps
+		*	\param [in] _elevationStep elevation, in number of quantization steps
+		*	\param [in] _HRIR HRIR to be stored
+		*   \eh Nothing is reported to the error handler.
+		*/
+		void Insert(Common::T_ear _ear, int32_t _azimuthStep, int32_t _elevationStep, const std::vector<CMonoBuffer<float>>& _HRIR) {
+			std::unique_lock<std::mutex> l(mutex, std::try_to_lock);
+			if (!l.owns_lock() || entries.empty()) { return; }
+
+			TEntry* oldest = &entries.front();
+			for (TEntry& entry : entries) {
+				if (entry.lastUse < oldest->lastUse) { oldest = &entry; }
+			}
+			if (oldest->HRIR.size() != _HRIR.size()) { return; }
+			for (std::size_t i = 0; i < _HRIR.size(); i++) {
+				if (oldest->HRIR[i].size() != _HRIR[i].size()) { return; }
+			}
+
+			for (std::size_t i = 0; i < _HRIR.size(); i++) {
+				std::copy(_HRIR[i].begin(), _HRIR[i].end(), oldest->HRIR[i].begin());
+			}
+			oldest->ear = _ear;
+			oldest->azimuthStep = _azimuthStep;
+			oldest->elevationStep = _elevationStep;
+			oldest->lastUse = ++useCounter;
+		}
+
+	private:
+		struct TEntry {
+			Common::T_ear ear = Common::T_ear::NONE;
+			int32_t azimuthStep = 0;
+			int32_t elevationStep = 0;
+			uint64_t lastUse = 0;						// 0 while the entry is empty
+			std::vector<CMonoBuffer<float>> HRIR;
+		};
+
+		std::mutex mutex;
+		std::vector<TEntry> entries;
+		uint64_t useCounter;
+	};
+}
+#endif
@@ -31,6 +31,7 @@
 #include <utility>
 #include <list>
 #include <cstdint>
+#include <atomic>
 #include <Common/Buffer.hpp>
 #include <Common/ErrorHandler.hpp>
 #include <Common/FFTCalculator.hpp>
@@ -38,6 +39,8 @@
 #include <Common/CommonDefinitions.hpp>
 #include <Common/CranicalGeometry.hpp>
 #include <ServiceModules/ServicesBase.hpp>
+#include <ServiceModules/HRIRCache.hpp>
+#include <Common/EpochProtectedPtr.hpp>
 #include <ServiceModules/HRTFDefinitions.hpp>
 #include <ServiceModules/HRTFAuxiliarMethods.hpp>
 #include <ServiceModules/OnlineInterpolation.hpp>
@@ -48,6 +51,7 @@
 #include <ServiceModules/InterpolationAuxiliarMethods.hpp>
 
 namespace BRTBase { class CListener; }
+namespace BRTReaders { class CHRTFCache; }
 
 namespace BRTServices
 {	
@@ -61,10 +65,11 @@ namespace BRTServices
 		*   \eh Nothing is reported to the error handler.
 		*/
 		CHRTF()
-			:enableWoodworthITD{ false }, gridSamplingStep{ DEFAULT_GRIDSAMPLING_STEP }, gapThreshold{ DEFAULT_GAP_THRESHOLD }, HRIRLength{ 0 }, fileName{ "" },
+			:enableWoodworthITD{ false }, gridSamplingStep{ DEFAULT_GRIDSAMPLING_STEP }, gapThreshold{ DEFAULT_GAP_THRESHOLD }, HRIRLength{ 0 }, bufferSize{ 0 }, fileName{ "" },
 			HRTFLoaded{ false }, setupInProgress{ false }, distanceOfMeasurement{ DEFAULT_HRTF_MEASURED_DISTANCE },
 			azimuthMin{ DEFAULT_MIN_AZIMUTH }, azimuthMax{ DEFAULT_MAX_AZIMUTH }, elevationMin{ DEFAULT_MIN_ELEVATION }, elevationMax{ DEFAULT_MAX_ELEVATION }, sphereBorder{ SPHERE_BORDER },
-			epsilon_sewing{ EPSILON_SEWING }, samplingRate{ -1 }, elevationNorth{ 0 }, elevationSouth{ 0 }, extrapolationMethod{ TEXTRAPOLATION_METHOD::nearest_point }
+			epsilon_sewing{ EPSILON_SEWING }, samplingRate{ -1 }, elevationNorth{ 0 }, elevationSouth{ 0 }, extrapolationMethod{ TEXTRAPOLATION_METHOD::nearest_point },
+			HRIRCacheResolution{ 0.0f }
 		{ }
 
 		/** \brief Get size of each HRIR buffer
@@ -103,13 +108,13 @@ namespace BRTServices
 			HRTFLoaded = false;
 			//Clear every table			
 			t_HRTF_DataBase.clear();
-			t_HRTF_Resampled_partitioned.clear();
-			stepVector.clear();
+			resampledData.Reset();						// Waits until no reader is using the previous table
 
 			//Update parameters			
 			HRIRLength = _HRIRLength;				
 			extrapolationMethod = _extrapolationMethod;
-			float partitions = (float)HRIRLength / (float)globalParameters.GetBufferSize();
+			bufferSize = globalParameters.GetBufferSize();		// Kept, the table is partitioned for it even if the global one changes meanwhile
+			float partitions = (float)HRIRLength / (float)bufferSize;
 			HRIR_partitioned_NumberOfSubfilters = static_cast<int>(std::ceil(partitions));
 			elevationNorth = CInterpolationAuxiliarMethods::GetPoleElevation(TPole::north);
 			elevationSouth = CInterpolationAuxiliarMethods::GetPoleElevation(TPole::south);
@@ -161,12 +166,17 @@ namespace BRTServices
 					offlineInterpolation.CalculateTF_SphericalCaps<T_HRTFTable, BRTServices::THRIRStruct>(t_HRTF_DataBase, HRIRLength, gapThreshold, gridSamplingStep, CHRTFAuxiliarMethods::CalculateHRIRFromBarycentrics_OfflineInterpolation());
 					//Creation and filling of resampling HRTF table
 					//_orientationList = offlineInterpolation.CalculateListOfOrientations(t_HRTF_DataBase);
-					CQuasiUniformSphereDistribution::CreateGrid<T_HRTFPartitionedTable, THRIRPartitionedStruct>(t_HRTF_Resampled_partitioned, stepVector, gridSamplingStep);
-					offlineInterpolation.FillResampledTable<T_HRTFTable, T_HRTFPartitionedTable, BRTServices::THRIRStruct, BRTServices::THRIRPartitionedStruct> (t_HRTF_DataBase, t_HRTF_Resampled_partitioned, globalParameters.GetBufferSize(), HRIRLength, HRIR_partitioned_NumberOfSubfilters, CHRTFAuxiliarMethods::SplitAndGetFFT_HRTFData(), CHRTFAuxiliarMethods::CalculateHRIRFromBarycentrics_OfflineInterpolation());					
+					std::unique_ptr<TResampledData> newResampledData = std::make_unique<TResampledData>();
+					CQuasiUniformSphereDistribution::CreateGrid<T_HRTFPartitionedTable, THRIRPartitionedStruct>(newResampledData->table, newResampledData->stepVector, gridSamplingStep);
+					offlineInterpolation.FillResampledTable<T_HRTFTable, T_HRTFPartitionedTable, BRTServices::THRIRStruct, BRTServices::THRIRPartitionedStruct> (t_HRTF_DataBase, newResampledData->table, bufferSize, HRIRLength, HRIR_partitioned_NumberOfSubfilters, CHRTFAuxiliarMethods::SplitAndGetFFT_HRTFData(), CHRTFAuxiliarMethods::CalculateHRIRFromBarycentrics_OfflineInterpolation());					
 
 					//Setup values
-					auto it = t_HRTF_Resampled_partitioned.begin();
+					auto it = newResampledData->table.begin();
 					HRIR_partitioned_SubfilterLength = it->second.leftHRIR_Partitioned[0].size();
+					newResampledData->numberOfSubfilters = HRIR_partitioned_NumberOfSubfilters;
+					newResampledData->subfilterLength = HRIR_partitioned_SubfilterLength;
+					newResampledData->HRIRCache.Setup(HRIR_CACHE_CAPACITY, HRIR_partitioned_NumberOfSubfilters, HRIR_partitioned_SubfilterLength);
+					resampledData.Publish(std::move(newResampledData));
 					setupInProgress = false;
 					HRTFLoaded = true;
 
@@ -197,6 +207,19 @@ namespace BRTServices
 		*   \eh Nothing is reported to the error handler.
 		*/
 		bool IsWoodworthITDEnabled() {	return enableWoodworthITD;	}
+
+		/** \brief Set the resolution of the run-time interpolation
+		*	\details Directions are rounded to a multiple of the resolution before the HRIR is interpolated, and the interpolated HRIRs
+		*	are kept in a small cache shared by every source, so that sources that do not move relative to the listener never interpolate again.
+		*	\param [in] _degrees resolution in degrees, 0 interpolates at the exact direction without caching
+		*   \eh Nothing is reported to the error handler.
+		*/
+		void SetHRIRCacheResolution(float _degrees) { HRIRCacheResolution = std::max(_degrees, 0.0f); }
+
+		/** \brief Get the resolution of the run-time interpolation, in degrees
+		*   \eh Nothing is reported to the error handler.
+		*/
+		float GetHRIRCacheResolution() const { return HRIRCacheResolution; }
 		
 
 		/** \brief Get interpolated and partitioned HRIR buffer with Delay, for one ear
@@ -209,24 +232,75 @@ namespace BRTServices
 		*   \eh On error, an error code is reported to the error handler.
 		*       Warnings may be reported to the error handler.
 		*/
-		const std::vector<CMonoBuffer<float>> GetHRIRPartitioned(Common::T_ear ear, float _azimuth, float _elevation, bool runTimeInterpolation, const Common::CTransform& /* _listenerLocation*/ ) const override
+		const std::vector<CMonoBuffer<float>> GetHRIRPartitioned(Common::T_ear ear, float _azimuth, float _elevation, bool runTimeInterpolation, const Common::CTransform& _listenerLocation) const override
 		{
-			std::lock_guard<std::mutex> l(mutex);
+			CServicesReadGuard guard(*this);
 			std::vector<CMonoBuffer<float>> newHRIR;
-			if (ear == Common::T_ear::BOTH || ear == Common::T_ear::NONE)
-			{
-				SET_RESULT(RESULT_ERROR_NOTALLOWED, "Attempt to get HRIR for a wrong ear (BOTH or NONE)");
-				return newHRIR;
-			}
+			return GetHRIRPartitionedRef(ear, _azimuth, _elevation, runTimeInterpolation, _listenerLocation, newHRIR);
+		}
 
-			if (setupInProgress) {
+		/** \brief Get interpolated and partitioned HRIR buffer without delay, for one ear, without copying it
+		*	\details Neither blocks nor allocates if the HRIR is in the table. The caller must hold a CServicesReadGuard on this HRTF while using the reference.
+		*	\param [in] ear for which ear we want to get the HRIR
+		*	\param [in] _azimuth azimuth angle in degrees
+		*	\param [in] _elevation elevation angle in degrees
+		*	\param [in] runTimeInterpolation switch run-time interpolation
+		*	\param [in] _scratch buffer used when the HRIR has to be interpolated
+		*	\retval HRIR reference to the table entry or to _scratch
+		*   \eh On error, an error code is reported to the error handler.
+		*       Warnings may be reported to the error handler.
+		*/
+		const std::vector<CMonoBuffer<float>>& GetHRIRPartitionedRef(Common::T_ear ear, float _azimuth, float _elevation, bool runTimeInterpolation, const Common::CTransform& /* _listenerLocation*/, std::vector<CMonoBuffer<float>>& _scratch) const override
+		{
+			const TResampledData* data = resampledData.Get();
+			if (data == nullptr) {
 				SET_RESULT(RESULT_ERROR_NOTSET, "GetHRIR_partitioned: HRTF Setup in progress return empty");
-				return newHRIR;
+				_scratch.clear();
+				return _scratch;
+			}
 
+			const float resolution = HRIRCacheResolution;
+			if (!runTimeInterpolation || resolution <= 0.0f || (ear != Common::T_ear::LEFT && ear != Common::T_ear::RIGHT)) {
+				return CHRTFAuxiliarMethods::GetHRIRRefFromPartitionedTable(data->table, ear, _azimuth, _elevation, runTimeInterpolation,
+					data->numberOfSubfilters, data->subfilterLength, data->stepVector, _scratch);
 			}
 
-			return CHRTFAuxiliarMethods::GetHRIRFromPartitionedTable(t_HRTF_Resampled_partitioned, ear, _azimuth, _elevation, runTimeInterpolation, 
-				HRIR_partitioned_NumberOfSubfilters, HRIR_partitioned_SubfilterLength, stepVector);										
+			// The HRIR only depends on the quantized direction, whether it comes from the cache or not
+			const int32_t azimuthStep = static_cast<int32_t>(std::lround(_azimuth / resolution));
+			const int32_t elevationStep = static_cast<int32_t>(std::lround(_elevation / resolution));
+			if (data->HRIRCache.Find(ear, azimuthStep, elevationStep, _scratch)) {
+				return _scratch;
+			}
+			const std::vector<CMonoBuffer<float>>& HRIR = CHRTFAuxiliarMethods::GetHRIRRefFromPartitionedTable(data->table, ear, azimuthStep * resolution, elevationStep * resolution,
+				runTimeInterpolation, data->numberOfSubfilters, data->subfilterLength, data->stepVector, _scratch);
+			// Table entries are cheap to find, only what has been interpolated is worth keeping
+			if (&HRIR == &_scratch && !_scratch.empty()) {
+				data->HRIRCache.Insert(ear, azimuthStep, elevationStep, _scratch);
+			}
+			return HRIR;
+		}
+
+		/** \brief Get the version of the resampled table, which changes every time the table is replaced
+		*	\retval version unique among every HRTF, 0 while there is no table
+		*   \eh Nothing is reported to the error handler.
+		*/
+		uint64_t GetTableVersion() const override {
+			const TResampledData* data = resampledData.Get();
+			return data == nullptr ? 0 : data->version;
+		}
+
+		/** \brief Enter a read section on the resampled table, see CServicesReadGuard
+		*   \eh Nothing is reported to the error handler.
+		*/
+		int BeginRead() const override {
+			return resampledData.ReadLock();
+		}
+
+		/** \brief Leave a read section on the resampled table
+		*   \eh Nothing is reported to the error handler.
+		*/
+		void EndRead(int _token) const override {
+			resampledData.ReadUnlock(_token);
 		}
 				
 
@@ -241,10 +315,11 @@ namespace BRTServices
 		*/
 		THRIRPartitionedStruct GetHRIRDelay(Common::T_ear ear, float _azimuthCenter, float _elevationCenter, bool runTimeInterpolation,	Common::CTransform& _listenerLocation)
 		{			
-			std::lock_guard<std::mutex> l(mutex);
+			CServicesReadGuard guard(*this);
+			const TResampledData* resampled = resampledData.Get();
 			THRIRPartitionedStruct data;
 			
-			if (setupInProgress)
+			if (resampled == nullptr)
 			{
 				SET_RESULT(RESULT_ERROR_NOTSET, "GetHRIRDelay: HRTF Setup in progress return empty");
 				return data;
@@ -258,8 +333,8 @@ namespace BRTServices
 				return data;
 			}
 
-			return CHRTFAuxiliarMethods::GetHRIRDelayFromPartitioned(t_HRTF_Resampled_partitioned, ear, _azimuthCenter, _elevationCenter, runTimeInterpolation,
-				HRIR_partitioned_NumberOfSubfilters, HRIR_partitioned_SubfilterLength, stepVector);													
+			return CHRTFAuxiliarMethods::GetHRIRDelayFromPartitioned(resampled->table, ear, _azimuthCenter, _elevationCenter, runTimeInterpolation,
+				resampled->numberOfSubfilters, resampled->subfilterLength, resampled->stepVector);													
 		}
 		
 
@@ -279,6 +354,15 @@ namespace BRTServices
 			return HRIR_partitioned_SubfilterLength;
 		}
 
+		/** \brief	Get the size of the input buffers the HRIRs have been partitioned for
+		*	\details The convolvers can only use the HRTF while the buffer size of the global parameters is the same
+		*	\retval size Buffer size, in samples, or 0 if the HRTF has not been set up
+		*   \eh Nothing is reported to the error handler.
+		*/
+		const int32_t GetHRIRPartitionedBufferSize() const {
+			return bufferSize;
+		}
+
 		/** \brief	Get if the HRTF has been loaded
 		*	\retval isLoadead bool var that is true if the HRTF has been loaded
 		*   \eh Nothing is reported to the error handler.
@@ -430,7 +514,7 @@ namespace BRTServices
 		mutable std::mutex mutex;								// Thread management
 
 		int32_t HRIRLength;								// HRIR vector length
-		//int32_t bufferSize;								// Input signal buffer size		
+		int32_t bufferSize;								// Input signal buffer size the HRIRs have been partitioned for
 		int32_t HRIR_partitioned_NumberOfSubfilters;	// Number of subfilters (blocks) for the UPC algorithm
 		int32_t HRIR_partitioned_SubfilterLength;		// Size of one HRIR subfilter
 		float distanceOfMeasurement;					// Distance where the HRIR have been measurement		
@@ -461,8 +545,23 @@ namespace BRTServices
 
 		// HRTF tables							
 		T_HRTFTable				t_HRTF_DataBase;				// Store original data, normally read from SOFA file
-		T_HRTFPartitionedTable	t_HRTF_Resampled_partitioned;	// Data in our grid, interpolated 
-		std::unordered_map<orientation, float> stepVector;		// Store hrtf interpolated grids steps
+		/** \brief Resampled table and everything needed to read it, replaced as a whole at the end of each setup
+		*/
+		struct TResampledData {
+			T_HRTFPartitionedTable	table;								// Data in our grid, interpolated 
+			std::unordered_map<orientation, float> stepVector;			// Store hrtf interpolated grids steps
+			int32_t numberOfSubfilters = 0;
+			int32_t subfilterLength = 0;
+			const uint64_t version = NextTableVersion();
+			mutable CHRIRCache HRIRCache;								// Interpolated HRIRs, shared by every reader of the table
+		};
+		std::atomic<float> HRIRCacheResolution;							// Quantization of the interpolated directions, in degrees
+
+		static uint64_t NextTableVersion() {
+			static std::atomic<uint64_t> lastVersion{ 0 };
+			return ++lastVersion;
+		}
+		Common::CEpochProtectedPtr<TResampledData> resampledData;		// Read by the audio thread without locking
 
 		// Empty object to return in some methods
 		THRIRStruct						emptyHRIR;
@@ -476,6 +575,7 @@ namespace BRTServices
 		CExtrapolation extrapolation;		
 
 		friend class CHRTFTester;
+		friend class BRTReaders::CHRTFCache;
 				
 		
 		/////////////
@@ -547,7 +647,7 @@ namespace BRTServices
 
 			//Clear every table			
 			t_HRTF_DataBase.clear();			
-			t_HRTF_Resampled_partitioned.clear();
+			resampledData.Reset();
 
 			//Update parameters			
 			HRIRLength = 0;			
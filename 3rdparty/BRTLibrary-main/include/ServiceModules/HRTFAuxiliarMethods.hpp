@@ -64,7 +64,29 @@ namespace BRTServices {
 		 *       Warnings may be reported to the error handler.
 		 */
 		static const std::vector<CMonoBuffer<float>> GetHRIRFromPartitionedTable(const T_HRTFPartitionedTable& table, Common::T_ear ear, float _azimuth, float _elevation,
-			bool runTimeInterpolation, int32_t _numberOfSubfilters, int32_t _subfilterLength, std::unordered_map<orientation, float> stepVector)
+			bool runTimeInterpolation, int32_t _numberOfSubfilters, int32_t _subfilterLength, const std::unordered_map<orientation, float>& stepVector)
+		{
+			std::vector<CMonoBuffer<float>> newHRIR;
+			return GetHRIRRefFromPartitionedTable(table, ear, _azimuth, _elevation, runTimeInterpolation, _numberOfSubfilters, _subfilterLength, stepVector, newHRIR);
+		}
+
+		/**
+		 * @brief Get interpolated and partitioned HRIR buffer for one ear, without delay, avoiding copies
+		 * @param table Table with the HRIR data
+		 * @param ear ear for which ear we want to get the HRIR
+		 * @param _azimuth azimuth angle in degrees
+		 * @param _elevation elevation angle in degrees
+		 * @param runTimeInterpolation switch run-time interpolation
+		 * @param _numberOfSubfilters number of subfilters in which the HRIR is divided
+		 * @param _subfilterLength subfilter length
+		 * @param stepVector steps of the oofline interpolation grid
+		 * @param _scratch buffer where the HRIR is written when it has to be interpolated, its capacity is reused
+		 * @return Reference to the HRIR in the table, or to _scratch if it has been interpolated or not found
+		 *   \eh On error, an error code is reported to the error handler.
+		 *       Warnings may be reported to the error handler.
+		 */
+		static const std::vector<CMonoBuffer<float>>& GetHRIRRefFromPartitionedTable(const T_HRTFPartitionedTable& table, Common::T_ear ear, float _azimuth, float _elevation,
+			bool runTimeInterpolation, int32_t _numberOfSubfilters, int32_t _subfilterLength, const std::unordered_map<orientation, float>& stepVector, std::vector<CMonoBuffer<float>>& _scratch)
 		{
 
 			float sphereBorder = SPHERE_BORDER;
@@ -74,17 +96,19 @@ namespace BRTServices {
 			float elevationNorth = CInterpolationAuxiliarMethods::GetPoleElevation(TPole::north);
 			float elevationSouth = CInterpolationAuxiliarMethods::GetPoleElevation(TPole::south);
 
-			std::vector<CMonoBuffer<float>> newHRIR;
-						
+			if (ear != Common::T_ear::LEFT && ear != Common::T_ear::RIGHT) {
+				SET_RESULT(RESULT_ERROR_NOTALLOWED, "Attempt to get HRIR for a wrong ear (BOTH or NONE)");
+				_scratch.clear();
+				return _scratch;
+			}
 
 			if (!runTimeInterpolation) {
-				THRIRPartitionedStruct temp = CQuasiUniformSphereDistribution::FindNearest<T_HRTFPartitionedTable, THRIRPartitionedStruct>(table, stepVector, _azimuth, _elevation);
-
-				if (ear == Common::T_ear::LEFT) { newHRIR = temp.leftHRIR_Partitioned; }
-				else if (ear == Common::T_ear::RIGHT) { newHRIR = temp.rightHRIR_Partitioned; }
-				else { SET_RESULT(RESULT_ERROR_NOTALLOWED, "Attempt to get HRIR for a wrong ear (BOTH or NONE)"); }
-
-				return newHRIR;
+				const THRIRPartitionedStruct* nearest = CQuasiUniformSphereDistribution::FindNearestPtr<T_HRTFPartitionedTable, THRIRPartitionedStruct>(table, stepVector, _azimuth, _elevation);
+				if (nearest == nullptr) {
+					_scratch.clear();
+					return _scratch;
+				}
+				return ear == Common::T_ear::LEFT ? nearest->leftHRIR_Partitioned : nearest->rightHRIR_Partitioned;
 			}
 
 			//  We have to do the run time interpolation -- (runTimeInterpolation = true)
@@ -96,35 +120,25 @@ namespace BRTServices {
 			// Check if we are at a pole
 			int ielevation = static_cast<int>(round(_elevation));
 			if ((ielevation == elevationNorth) || (ielevation == elevationSouth)) {
-				GetPoleHRIRFromPartitionedTable(table, newHRIR, ear, ielevation, azimuthMin);
-				return newHRIR;
+				auto it = table.find(orientation(azimuthMin, ielevation));
+				if (it == table.end()) {
+					SET_RESULT(RESULT_WARNING, "Orientations in GetHRIR_partitioned() not found");
+					_scratch.clear();
+					return _scratch;
+				}
+				return ear == Common::T_ear::LEFT ? it->second.leftHRIR_Partitioned : it->second.rightHRIR_Partitioned;
 			}
 
 			// We search if the point already exists
 			auto it = table.find(orientation(_azimuth, _elevation));
 			if (it != table.end())
 			{
-				if (ear == Common::T_ear::LEFT)
-				{
-					newHRIR = it->second.leftHRIR_Partitioned;
-				}
-				else
-				{
-					newHRIR = it->second.rightHRIR_Partitioned;
-				}
-				return newHRIR;
+				return ear == Common::T_ear::LEFT ? it->second.leftHRIR_Partitioned : it->second.rightHRIR_Partitioned;
 			}
 
-			// ONLINE Interpolation 	
-			if (ear == Common::T_ear::LEFT) {
-				const THRIRPartitionedStruct data = CSlopesMethodOnlineInterpolator::CalculateTF_OnlineMethod<T_HRTFPartitionedTable, THRIRPartitionedStruct>(table, _numberOfSubfilters, _subfilterLength, _azimuth, _elevation, stepVector, CHRTFAuxiliarMethods::CalculatePartitionedHRIR_FromBarycentricCoordinates_LeftEar());
-				return data.leftHRIR_Partitioned;
-			}
-			else
-			{
-				const THRIRPartitionedStruct data = CSlopesMethodOnlineInterpolator::CalculateTF_OnlineMethod<T_HRTFPartitionedTable, THRIRPartitionedStruct>(table, _numberOfSubfilters, _subfilterLength, _azimuth, _elevation, stepVector, CHRTFAuxiliarMethods::CalculatePartitionedHRIR_FromBarycentricCoordinates_RightEar());
-				return data.rightHRIR_Partitioned;
-			}
+			// ONLINE Interpolation, written directly into the scratch buffer
+			CSlopesMethodOnlineInterpolator::CalculateTF_OnlineMethod<T_HRTFPartitionedTable, THRIRPartitionedStruct>(table, _numberOfSubfilters, _subfilterLength, _azimuth, _elevation, stepVector, CHRTFAuxiliarMethods::CalculatePartitionedHRIR_FromBarycentricCoordinates_ToBuffer(ear, _scratch));
+			return _scratch;
 		}
 
 		/**
@@ -156,7 +170,7 @@ namespace BRTServices {
 
 
 		static THRIRPartitionedStruct GetHRIRDelayFromPartitioned(const T_HRTFPartitionedTable& table, Common::T_ear ear, float _azimuthCenter, float _elevationCenter,
-			bool runTimeInterpolation, int32_t _numberOfSubfilters, int32_t _subfilterLength, std::unordered_map<orientation, float> stepVector)
+			bool runTimeInterpolation, int32_t _numberOfSubfilters, int32_t _subfilterLength, const std::unordered_map<orientation, float>& stepVector)
 		{
 			float sphereBorder = SPHERE_BORDER;
 			float epsilon_sewing = EPSILON_SEWING;
@@ -171,7 +185,11 @@ namespace BRTServices {
 
 			if (!runTimeInterpolation)
 			{
-				data = CQuasiUniformSphereDistribution::FindNearest<T_HRTFPartitionedTable, THRIRPartitionedStruct>(table, stepVector, _azimuthCenter, _elevationCenter);
+				const THRIRPartitionedStruct* nearest = CQuasiUniformSphereDistribution::FindNearestPtr<T_HRTFPartitionedTable, THRIRPartitionedStruct>(table, stepVector, _azimuthCenter, _elevationCenter);
+				if (nearest != nullptr) {
+					data.leftDelay = nearest->leftDelay;
+					data.rightDelay = nearest->rightDelay;
+				}
 				return data;
 			}
 
@@ -348,6 +366,49 @@ namespace BRTServices {
 			}
 		};
 
+		/**
+		 * @brief Calculate HRIR subfilters of one ear using a barycentric coordinates of the three nearest orientation.
+		 * The result is written into the buffer given in the constructor, reusing its memory, and an empty struct is returned.
+		 * If no valid triangle is found the functor is not called, so the buffer keeps the previous HRIR.
+		*/
+		struct CalculatePartitionedHRIR_FromBarycentricCoordinates_ToBuffer {
+			CalculatePartitionedHRIR_FromBarycentricCoordinates_ToBuffer(Common::T_ear _ear, std::vector<CMonoBuffer<float>>& _output) : ear{ _ear }, output{ &_output } {}
+
+			const THRIRPartitionedStruct operator()(const T_HRTFPartitionedTable& t_HRTF_Resampled_partitioned, int32_t HRIR_partitioned_NumberOfSubfilters, int32_t HRIR_partitioned_SubfilterLength, TBarycentricCoordinatesStruct barycentricCoordinates, orientation orientation_pto1, orientation orientation_pto2, orientation orientation_pto3)
+			{
+				auto it1 = t_HRTF_Resampled_partitioned.find(orientation(orientation_pto1.azimuth, orientation_pto1.elevation));
+				auto it2 = t_HRTF_Resampled_partitioned.find(orientation(orientation_pto2.azimuth, orientation_pto2.elevation));
+				auto it3 = t_HRTF_Resampled_partitioned.find(orientation(orientation_pto3.azimuth, orientation_pto3.elevation));
+
+				if (it1 != t_HRTF_Resampled_partitioned.end() && it2 != t_HRTF_Resampled_partitioned.end() && it3 != t_HRTF_Resampled_partitioned.end())
+				{
+					const std::vector<CMonoBuffer<float>>& hrir1 = ear == Common::T_ear::LEFT ? it1->second.leftHRIR_Partitioned : it1->second.rightHRIR_Partitioned;
+					const std::vector<CMonoBuffer<float>>& hrir2 = ear == Common::T_ear::LEFT ? it2->second.leftHRIR_Partitioned : it2->second.rightHRIR_Partitioned;
+					const std::vector<CMonoBuffer<float>>& hrir3 = ear == Common::T_ear::LEFT ? it3->second.leftHRIR_Partitioned : it3->second.rightHRIR_Partitioned;
+
+					output->resize(HRIR_partitioned_NumberOfSubfilters);
+					for (int subfilterID = 0; subfilterID < HRIR_partitioned_NumberOfSubfilters; subfilterID++)
+					{
+						CMonoBuffer<float>& subfilter = (*output)[subfilterID];
+						subfilter.resize(HRIR_partitioned_SubfilterLength);
+						for (int i = 0; i < HRIR_partitioned_SubfilterLength; i++)
+						{
+							subfilter[i] = barycentricCoordinates.alpha * hrir1[subfilterID][i] + barycentricCoordinates.beta * hrir2[subfilterID][i] + barycentricCoordinates.gamma * hrir3[subfilterID][i];
+						}
+					}
+				}
+				else {
+					output->clear();
+					SET_RESULT(RESULT_WARNING, "Orientations in CalculatePartitionedHRIR_FromBarycentricCoordinates_ToBuffer() not found");
+				}
+				return THRIRPartitionedStruct();
+			}
+
+		private:
+			Common::T_ear ear;
+			std::vector<CMonoBuffer<float>>* output;
+		};
+
 		/**
 		 * @brief Calculate HRIR DELAY using a barycentric coordinates of the three nearest orientation, in number of samples
 		 * @param ear
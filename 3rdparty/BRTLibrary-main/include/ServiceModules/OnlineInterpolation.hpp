@@ -50,7 +50,7 @@ namespace BRTServices
 		 * @return 
 		*/
 		template <typename T, typename U, typename Functor>
-		U CalculateTF_OnlineMethod(const T& resampledTable, int32_t numberOfSubfilters, int32_t subfilterLength, float _azimuth, float _elevation, std::unordered_map<orientation, float> stepMap, Functor f) const
+		U CalculateTF_OnlineMethod(const T& resampledTable, int32_t numberOfSubfilters, int32_t subfilterLength, float _azimuth, float _elevation, const std::unordered_map<orientation, float>& stepMap, Functor f) const
 		{
 			U data;
 
@@ -162,7 +162,7 @@ namespace BRTServices
 		 * @param orientation_ptoP 
 		 * @param nearestElevations 
 		*/
-		void find_4Nearest_Points(float _azimuth, float _elevation, std::unordered_map<orientation, float> stepMap, orientation& orientation_ptoA, orientation& orientation_ptoB, orientation& orientation_ptoC, orientation& orientation_ptoD, orientation& orientation_ptoP, std::pair<float, float>& nearestElevations)const
+		void find_4Nearest_Points(float _azimuth, float _elevation, const std::unordered_map<orientation, float>& stepMap, orientation& orientation_ptoA, orientation& orientation_ptoB, orientation& orientation_ptoC, orientation& orientation_ptoD, orientation& orientation_ptoP, std::pair<float, float>& nearestElevations)const
 		{
 			float aziCeilBack, aziCeilFront, aziFloorBack, aziFloorFront;
 
@@ -248,7 +248,7 @@ namespace BRTServices
 		///**
 		// * @brief Calculate from resample table HRIR subfilters using a barycentric interpolation of the three nearest orientation.
 		template <typename T, typename U, typename Functor>
-		static U CalculateTF_OnlineMethod(const T& resampledTable, int32_t numberOfSubfilters, int32_t subfilterLength, float _azimuth, float _elevation, std::unordered_map<orientation, float> stepMap, Functor f)
+		static U CalculateTF_OnlineMethod(const T& resampledTable, int32_t numberOfSubfilters, int32_t subfilterLength, float _azimuth, float _elevation, const std::unordered_map<orientation, float>& stepMap, Functor f)
 		{
 			U data;
 			TBarycentricCoordinatesStruct barycentricCoordinates;
@@ -349,7 +349,7 @@ namespace BRTServices
 		 * @param orientation_ptoP 
 		 * @param nearestElevations 
 		*/
-		static void Find_4Nearest_Points(float _azimuth, float _elevation, std::unordered_map<orientation, float> stepMap, orientation& orientation_ptoA, orientation& orientation_ptoB, orientation& orientation_ptoC, orientation& orientation_ptoD, orientation& orientation_ptoP, std::pair<float, float>& nearestElevations)
+		static void Find_4Nearest_Points(float _azimuth, float _elevation, const std::unordered_map<orientation, float>& stepMap, orientation& orientation_ptoA, orientation& orientation_ptoB, orientation& orientation_ptoC, orientation& orientation_ptoD, orientation& orientation_ptoP, std::pair<float, float>& nearestElevations)
 		{
 			float azimuthCeilBack, azimuthCeilFront, azimuthFloorBack, azimuthFloorFront;
 			float azimuthStepCeil, azimuthStepFloor;
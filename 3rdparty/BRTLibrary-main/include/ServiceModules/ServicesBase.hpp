@@ -240,11 +240,58 @@ namespace BRTServices {
 			return std::vector < CMonoBuffer<float>>();
 		};
 		
+		/**
+		 * @brief Get a read-only reference to the partitioned HRIR of one ear, without copying it when possible.
+		 * The reference points either into the service tables or to _scratch, and it is valid while a CServicesReadGuard on this service is alive.
+		 * The default implementation copies the result of GetHRIRPartitioned into _scratch.
+		 * @param _scratch Buffer owned by the caller, used when the HRIR has to be calculated. Its capacity is reused between calls.
+		 */
+		virtual const std::vector<CMonoBuffer<float>>& GetHRIRPartitionedRef(Common::T_ear ear, float _azimuth, float _elevation, bool runTimeInterpolation, const Common::CTransform& _listenerLocation, std::vector<CMonoBuffer<float>>& _scratch) const
+		{
+			_scratch = GetHRIRPartitioned(ear, _azimuth, _elevation, runTimeInterpolation, _listenerLocation);
+			return _scratch;
+		};
+		
 		virtual THRIRPartitionedStruct GetHRIRDelay(Common::T_ear ear, float _azimuthCenter, float _elevationCenter, bool runTimeInterpolation,	Common::CTransform& _listenerLocation) {
 			return THRIRPartitionedStruct();
 		};	
 
+		/**
+		 * @brief Enter a read section on the service tables. Use CServicesReadGuard instead of calling it directly.
+		 * @return Token to be passed to EndRead
+		 */
+		virtual int BeginRead() const { return 0; }
+		/**
+		 * @brief Leave a read section on the service tables
+		 * @param _token Value returned by BeginRead
+		 */
+		virtual void EndRead(int _token) const {}
+
+		/**
+		 * @brief Get the version of the service tables. HRIRs obtained with the same non-zero version are the same.
+		 * @return Version that changes every time the tables are replaced, 0 if the service is not versioned
+		 */
+		virtual uint64_t GetTableVersion() const { return 0; }
+
 		virtual std::vector <Common::CVector3> GetListenerPositions() {	return std::vector <Common::CVector3>{Common::CVector3()};	}
-	};}
+	};
+
+	/**
+	 * @brief RAII read section on a service. While it is alive, the references returned by GetHRIRPartitionedRef remain valid
+	 * even if the service tables are being replaced from another thread.
+	 */
+	class CServicesReadGuard {
+	public:
+		CServicesReadGuard(const CServicesBase& _service) : service{ _service }, token{ _service.BeginRead() } {}
+		~CServicesReadGuard() { service.EndRead(token); }
+
+		CServicesReadGuard(const CServicesReadGuard&) = delete;
+		CServicesReadGuard& operator=(const CServicesReadGuard&) = delete;
+
+	private:
+		const CServicesBase& service;
+		int token;
+	};
+}
 
 #endif
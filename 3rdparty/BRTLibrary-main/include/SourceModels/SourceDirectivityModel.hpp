@@ -79,7 +79,7 @@ namespace BRTSourceModel {
 		 * @brief Update method of the Source directivity model
 		 * @param _entryPointID ID of the entry ponint to do the update
 		*/
-		void Update(std::string _entryPointID) override {
+		void Update(const std::string& _entryPointID) override {
 			std::lock_guard<std::mutex> l(mutex);
 
 			if (_entryPointID == "samples") {
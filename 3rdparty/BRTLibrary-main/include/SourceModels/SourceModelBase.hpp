@@ -37,7 +37,7 @@ namespace BRTSourceModel {
 	class CSourceModelBase : public BRTConnectivity::CBRTConnectivity {				
 	public:		
 		virtual ~CSourceModelBase() {}						
-		virtual void Update(std::string entryPointID) = 0;
+		virtual void Update(const std::string& entryPointID) = 0;
 		virtual void UpdateCommandSource() = 0;
 
 		virtual bool SetDirectivityTF(std::shared_ptr<BRTServices::CDirectivityTF> _sourceDirectivityTF) { return false; }
@@ -51,7 +51,7 @@ namespace BRTSourceModel {
 			, sourceID { _sourceID }
 			, sourceType { _sourceType } {
 			
-			CreateSamplesExitPoint("samples");
+			samplesExitPoint = CreateSamplesExitPoint("samples");
 			CreateTransformExitPoint();			
 			CreateIDExitPoint();
 			GetIDExitPoint()->sendData(sourceID);
@@ -120,7 +120,9 @@ namespace BRTSourceModel {
 		 */
 		void SetDataReady() {
 			if (!dataReady) {
-				SetBuffer(CMonoBuffer<float>(globalParameters.GetBufferSize())); // set and empty buffer to continue
+				// Set an empty buffer to continue, reusing the storage of the last one
+				samplesBuffer.Fill(globalParameters.GetBufferSize(), 0.0f);
+				dataReady = true;
 			}
 			Update("samples");
 		}
@@ -136,7 +138,7 @@ namespace BRTSourceModel {
 		* @brief Manages the reception of new data by an entry point. 
 		* Only entry points that have a notification make a call to this method.
 		*/
-		void UpdateEntryPointData(std::string entryPointID) override {
+		void UpdateEntryPointData(const std::string& entryPointID, int _port) override {
 			Update(entryPointID);
 		}
 
@@ -180,6 +182,7 @@ namespace BRTSourceModel {
 		TSourceType sourceType;
 
 		bool dataReady;
+		int samplesExitPoint;						// Index of the "samples" exit point
 		Common::CTransform sourceTransform;
 		CMonoBuffer<float> samplesBuffer;			
 		Common::CGlobalParameters globalParameters;
@@ -193,9 +196,16 @@ namespace BRTSourceModel {
 		 * @param _buffer Buffer to be sent
 		 */
 		void SendData(CMonoBuffer<float> & _buffer) {
-			GetSamplesExitPoint("samples")->sendData(_buffer);
+			GetSamplesExitPoint(samplesExitPoint)->sendData(_buffer);
 			dataReady = false;
 		}
+
+		/**
+		 * @brief Send the last audio frame buffer to the exit point as it is, without an intermediate copy
+		 */
+		void SendBuffer() {
+			SendData(samplesBuffer);
+		}
 		
 		/**
 		 * @brief Set the source type
@@ -210,8 +220,8 @@ namespace BRTSourceModel {
 		 * @param _sourceID Source ID
 		 * @return True if the command is for this source
 		 */
-		bool IsToMySoundSource(std::string _sourceID) {
-			return GetID() == _sourceID;
+		bool IsToMySoundSource(const std::string& _sourceID) const {
+			return sourceID == _sourceID;
 		}
 
 		mutable std::mutex mutex;		// To avoid access collisions
@@ -40,12 +40,11 @@ namespace BRTSourceModel {
 		 * @brief Actions when the entry points are ready
 		 * @param _entryPointID 
 		 */
-		void Update(std::string _entryPointID) override {
+		void Update(const std::string& _entryPointID) override {
 			std::lock_guard<std::mutex> l(mutex);
 
 			if (_entryPointID == "samples") {
-				CMonoBuffer<float> buffer = GetBuffer();
-				SendData(buffer);
+				SendBuffer();
 			}
 		}
 
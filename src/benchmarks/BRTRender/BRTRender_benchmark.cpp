@@ -0,0 +1,233 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include <benchmark/benchmark.h>
+
+#include "BRTLibrary.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Same configuration as AudioOutput
+constexpr int SAMPLE_RATE           = 48000;
+constexpr int HRTF_RESAMPLING_STEP  = 15;
+constexpr int MAX_ITD_MS            = 1;
+constexpr float HRIR_TOLERANCE      = 1.0f;
+constexpr const char *DEFAULT_SOFA  = "./3DTI_HRTF_IRC1008_256s_48000Hz.sofa";
+constexpr const char *SOFA_VARIABLE = "MUMBLE_BENCHMARK_SOFA";
+
+// Stand-in for the SOFA file when it can not be found, with the same length and grid as the one the client ships
+constexpr int SYNTHETIC_HRIR_LENGTH = 256;
+
+constexpr std::size_t SOURCE_COUNT_RANGE   = 0;
+constexpr std::size_t BUFFER_SIZE_RANGE    = 1;
+constexpr std::size_t INTERPOLATION_RANGE  = 2;
+constexpr std::size_t MOVING_SOURCES_RANGE = 3;
+
+constexpr int SOURCE_COUNT_MULTIPLIER = 2;
+constexpr int SOURCE_COUNT_BEGIN      = 1;
+constexpr int SOURCE_COUNT_END        = 128;
+
+/// How far (in degrees) a moving source travels around the listener in each block
+constexpr float MOVING_STEP_DEGREES = 1.5f;
+constexpr float SOURCE_DISTANCE     = 1.5f;
+
+std::mt19937 rng(42);
+std::uniform_real_distribution< float > random_sample(-0.5f, 0.5f);
+
+/// The HRIR tables are partitioned for the buffer size, so there is one for each of them
+std::map< int, std::shared_ptr< BRTServices::CHRTF > > hrtfs;
+
+std::shared_ptr< BRTServices::CHRTF > createSyntheticHRTF() {
+	std::shared_ptr< BRTServices::CHRTF > hrtf = std::make_shared< BRTServices::CHRTF >();
+	hrtf->SetSamplingRate(SAMPLE_RATE);
+	hrtf->SetGridSamplingStep(HRTF_RESAMPLING_STEP);
+	hrtf->BeginSetup(SYNTHETIC_HRIR_LENGTH, BRTServices::TEXTRAPOLATION_METHOD::nearest_point);
+
+	for (int azimuth = 0; azimuth < 360; azimuth += HRTF_RESAMPLING_STEP) {
+		for (int elevation = -90; elevation <= 90; elevation += HRTF_RESAMPLING_STEP) {
+			BRTServices::THRIRStruct hrir;
+			hrir.leftHRIR  = CMonoBuffer< float >(SYNTHETIC_HRIR_LENGTH);
+			hrir.rightHRIR = CMonoBuffer< float >(SYNTHETIC_HRIR_LENGTH);
+			for (int i = 0; i < SYNTHETIC_HRIR_LENGTH; ++i) {
+				hrir.leftHRIR[i]  = std::sin(0.1f * i + azimuth) * std::exp(-i / 40.0f);
+				hrir.rightHRIR[i] = std::cos(0.07f * i + elevation) * std::exp(-i / 40.0f);
+			}
+			// Up to about 0.7 ms of ITD, like a real head
+			hrir.leftDelay  = static_cast< uint64_t >(16.0f * (1.0f + std::sin(azimuth * 3.14159265f / 180.0f)));
+			hrir.rightDelay = static_cast< uint64_t >(16.0f * (1.0f - std::sin(azimuth * 3.14159265f / 180.0f)));
+
+			hrtf->AddHRIR(azimuth, elevation < 0 ? elevation + 360 : elevation, 1.95, Common::CVector3(0, 0, 0),
+						  std::move(hrir));
+		}
+	}
+
+	hrtf->EndSetup();
+	return hrtf;
+}
+
+/// Loads the SOFA file given in MUMBLE_BENCHMARK_SOFA or the one the client loads by default, and falls back to a
+/// synthetic table if there is none, so that the benchmark also runs where no SOFA file is around.
+std::shared_ptr< BRTServices::CHRTF > getHRTF(int bufferSize) {
+	auto it = hrtfs.find(bufferSize);
+	if (it != hrtfs.end()) {
+		return it->second;
+	}
+
+	const char *variable = std::getenv(SOFA_VARIABLE);
+	const std::string path = variable ? variable : DEFAULT_SOFA;
+
+	std::shared_ptr< BRTServices::CHRTF > hrtf = std::make_shared< BRTServices::CHRTF >();
+	BRTReaders::CSOFAReader reader;
+	if (!std::ifstream(path).good()
+		|| !reader.ReadHRTFFromSofa(path, hrtf, HRTF_RESAMPLING_STEP,
+									BRTServices::TEXTRAPOLATION_METHOD::nearest_point)) {
+		hrtf = createSyntheticHRTF();
+	}
+
+	hrtfs[bufferSize] = hrtf;
+	return hrtf;
+}
+
+Common::CTransform sourceTransform(float azimuthDegrees) {
+	const float azimuth = azimuthDegrees * 3.14159265f / 180.0f;
+
+	Common::CTransform transform;
+	transform.SetPosition(
+		Common::CVector3(SOURCE_DISTANCE * std::cos(azimuth), SOURCE_DISTANCE * std::sin(azimuth), 0.0f));
+	return transform;
+}
+
+/// A headless copy of the BRT graph of AudioOutput, with one speaker per source
+class Fixture : public ::benchmark::Fixture {
+public:
+	void SetUp(const ::benchmark::State &state) {
+		const int sourceCount = static_cast< int >(state.range(SOURCE_COUNT_RANGE));
+		bufferSize            = static_cast< int >(state.range(BUFFER_SIZE_RANGE));
+
+		globalParameters.SetSampleRate(SAMPLE_RATE);
+		globalParameters.SetBufferSize(bufferSize);
+
+		manager = std::make_unique< BRTBase::CBRTManager >();
+		manager->BeginSetup();
+		listenerModel = manager->CreateListenerModel< BRTListenerModel::CListenerHRTFModel >("listenerModel");
+		listener      = manager->CreateListener< BRTBase::CListener >("listener");
+		listener->ConnectListenerModel("listenerModel");
+		for (int i = 0; i < sourceCount; ++i) {
+			sources.push_back(
+				manager->CreateSoundSource< BRTSourceModel::CSourceSimpleModel >("source" + std::to_string(i)));
+			listenerModel->ConnectSoundSource(sources.back());
+		}
+		manager->EndSetup();
+
+		// Blocks whose FFT leaves room for the ITD are mixed in the frequency domain, see
+		// AudioOutput::updateFrequencyDomainMixing()
+		const int fftSize = 2
+							* (Common::CalculateIsPowerOfTwo(bufferSize) ? bufferSize
+																		 : Common::CalculateNextPowerOfTwo(bufferSize));
+		if (fftSize - 2 * bufferSize >= SAMPLE_RATE * MAX_ITD_MS / 1000) {
+			listenerModel->EnableFrequencyDomainMixing();
+		}
+
+		if (state.range(INTERPOLATION_RANGE)) {
+			listenerModel->EnableInterpolation();
+		} else {
+			listenerModel->DisableInterpolation();
+		}
+		listenerModel->SetHRIRTolerance(HRIR_TOLERANCE);
+		listener->SetHRTF(getHRTF(bufferSize));
+
+		// Spread the speakers around the listener, each of them with its own noise
+		for (int i = 0; i < sourceCount; ++i) {
+			azimuths.push_back(360.0f * i / sourceCount);
+			sources[i]->SetSourceTransform(sourceTransform(azimuths[i]));
+
+			CMonoBuffer< float > input(bufferSize);
+			for (float &sample : input) {
+				sample = random_sample(rng);
+			}
+			inputs.push_back(std::move(input));
+		}
+
+		leftOutput  = CMonoBuffer< float >(bufferSize);
+		rightOutput = CMonoBuffer< float >(bufferSize);
+	}
+
+	void TearDown(const ::benchmark::State &) {
+		listener->RemoveHRTF();
+		sources.clear();
+		listenerModel.reset();
+		listener.reset();
+		manager.reset();
+		azimuths.clear();
+		inputs.clear();
+	}
+
+	/// Renders one block the way AudioOutput::mix() does
+	void renderBlock(bool moving) {
+		for (std::size_t i = 0; i < sources.size(); ++i) {
+			if (moving) {
+				azimuths[i] += MOVING_STEP_DEGREES;
+				sources[i]->SetSourceTransform(sourceTransform(azimuths[i]));
+			}
+			sources[i]->SetBuffer(inputs[i]);
+		}
+
+		manager->ProcessAll();
+		listener->GetBuffers(leftOutput, rightOutput);
+	}
+
+	Common::CGlobalParameters globalParameters;
+	int bufferSize = 0;
+
+	std::unique_ptr< BRTBase::CBRTManager > manager;
+	std::shared_ptr< BRTListenerModel::CListenerHRTFModel > listenerModel;
+	std::shared_ptr< BRTBase::CListener > listener;
+	std::vector< std::shared_ptr< BRTSourceModel::CSourceSimpleModel > > sources;
+	std::vector< float > azimuths;
+	std::vector< CMonoBuffer< float > > inputs;
+	CMonoBuffer< float > leftOutput;
+	CMonoBuffer< float > rightOutput;
+};
+
+BENCHMARK_DEFINE_F(Fixture, BM_renderBlock)(::benchmark::State &state) {
+	const bool moving = state.range(MOVING_SOURCES_RANGE);
+
+	// The first blocks fill the convolution and delay buffers
+	for (int i = 0; i < 16; ++i) {
+		renderBlock(moving);
+	}
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (auto _ : state) {
+		renderBlock(moving);
+		benchmark::DoNotOptimize(leftOutput.data());
+		benchmark::DoNotOptimize(rightOutput.data());
+	}
+	const std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - start;
+
+	// Time spent rendering a block divided by the duration of the block. It has to stay well below 1, as the audio
+	// thread does more than rendering.
+	const double renderedSeconds      = static_cast< double >(state.iterations()) * bufferSize / SAMPLE_RATE;
+	state.counters["real-time factor"] = renderedSeconds > 0 ? elapsed.count() / renderedSeconds : 0;
+}
+
+// Render threads stay off, so that the numbers measure the work of a block and not how the machine schedules them
+BENCHMARK_REGISTER_F(Fixture, BM_renderBlock)
+	->ArgNames({ "sources", "buffer", "interpolation", "moving" })
+	->ArgsProduct({ benchmark::CreateRange(SOURCE_COUNT_BEGIN, SOURCE_COUNT_END, /*multi=*/SOURCE_COUNT_MULTIPLIER),
+					{ 240, 480, 960 },
+					{ 0, 1 },
+					{ 0, 1 } });
+
+
+BENCHMARK_MAIN();
@@ -27,6 +27,7 @@
 #include "CryptStateOCB2.h"
 #include "CryptographicRandom.h"
 
+#include <algorithm>
 #include <cstring>
 #include <openssl/rand.h>
 
@@ -38,6 +39,7 @@ CryptStateOCB2::CryptStateOCB2()
 	memset(raw_key, 0, AES_KEY_SIZE_BYTES);
 	memset(encrypt_iv, 0, AES_BLOCK_SIZE);
 	memset(decrypt_iv, 0, AES_BLOCK_SIZE);
+	scheduleKey();
 }
 
 CryptStateOCB2::~CryptStateOCB2() noexcept {
@@ -47,6 +49,20 @@ CryptStateOCB2::~CryptStateOCB2() noexcept {
 	EVP_CIPHER_CTX_free(dec_ctx_ocb_dec);
 }
 
+void CryptStateOCB2::scheduleKey() {
+	// Expanding the key once here spares every AES block of every packet from doing it again
+	EVP_CIPHER_CTX *contexts[] = { enc_ctx_ocb_enc, enc_ctx_ocb_dec };
+	for (EVP_CIPHER_CTX *ctx : contexts) {
+		EVP_EncryptInit_ex(ctx, EVP_aes_128_ecb(), NULL, raw_key, NULL);
+		EVP_CIPHER_CTX_set_padding(ctx, 0);
+	}
+	EVP_CIPHER_CTX *decryptContexts[] = { dec_ctx_ocb_enc, dec_ctx_ocb_dec };
+	for (EVP_CIPHER_CTX *ctx : decryptContexts) {
+		EVP_DecryptInit_ex(ctx, EVP_aes_128_ecb(), NULL, raw_key, NULL);
+		EVP_CIPHER_CTX_set_padding(ctx, 0);
+	}
+}
+
 bool CryptStateOCB2::isValid() const {
 	return bInit;
 }
@@ -55,6 +71,7 @@ void CryptStateOCB2::genKey() {
 	CryptographicRandom::fillBuffer(raw_key, AES_KEY_SIZE_BYTES);
 	CryptographicRandom::fillBuffer(encrypt_iv, AES_BLOCK_SIZE);
 	CryptographicRandom::fillBuffer(decrypt_iv, AES_BLOCK_SIZE);
+	scheduleKey();
 	bInit = true;
 }
 
@@ -63,6 +80,7 @@ bool CryptStateOCB2::setKey(const std::string &rkey, const std::string &eiv, con
 		memcpy(raw_key, rkey.data(), AES_KEY_SIZE_BYTES);
 		memcpy(encrypt_iv, eiv.data(), AES_BLOCK_SIZE);
 		memcpy(decrypt_iv, div.data(), AES_BLOCK_SIZE);
+		scheduleKey();
 		bInit = true;
 		return true;
 	}
@@ -72,6 +90,7 @@ bool CryptStateOCB2::setKey(const std::string &rkey, const std::string &eiv, con
 bool CryptStateOCB2::setRawKey(const std::string &rkey) {
 	if (rkey.length() == AES_KEY_SIZE_BYTES) {
 		memcpy(raw_key, rkey.data(), AES_KEY_SIZE_BYTES);
+		scheduleKey();
 		return true;
 	}
 	return false;
@@ -271,83 +290,107 @@ static void inline ZERO(keyblock &block) {
 		block[i] = 0;
 }
 
-#define AESencrypt_ctx(src, dst, key, enc_ctx)                                                      \
-	{                                                                                               \
-		int outlen = 0;                                                                             \
-		EVP_EncryptInit_ex(enc_ctx, EVP_aes_128_ecb(), NULL, key, NULL);                            \
-		EVP_CIPHER_CTX_set_padding(enc_ctx, 0);                                                     \
-		EVP_EncryptUpdate(enc_ctx, reinterpret_cast< unsigned char * >(dst), &outlen,               \
-						  reinterpret_cast< const unsigned char * >(src), AES_BLOCK_SIZE);          \
-		EVP_EncryptFinal_ex(enc_ctx, reinterpret_cast< unsigned char * >((dst) + outlen), &outlen); \
+/// Number of blocks handed to OpenSSL at once. The blocks of a packet do not depend on each other once their deltas
+/// are known, so OpenSSL can interleave them in its AES-NI (or VAES) pipeline instead of waiting for one after the
+/// other.
+static constexpr unsigned int PIPELINE_BLOCKS = 16;
+
+// The contexts have the key already set up by scheduleKey()
+#define AESencrypt_ctx(src, dst, blocks, enc_ctx)                                     \
+	{                                                                                 \
+		int outlen = 0;                                                               \
+		EVP_EncryptUpdate(enc_ctx, reinterpret_cast< unsigned char * >(dst), &outlen, \
+						  reinterpret_cast< const unsigned char * >(src),             \
+						  static_cast< int >((blocks) * AES_BLOCK_SIZE));             \
 	}
-#define AESdecrypt_ctx(src, dst, key, dec_ctx)                                                      \
-	{                                                                                               \
-		int outlen = 0;                                                                             \
-		EVP_DecryptInit_ex(dec_ctx, EVP_aes_128_ecb(), NULL, key, NULL);                            \
-		EVP_CIPHER_CTX_set_padding(dec_ctx, 0);                                                     \
-		EVP_DecryptUpdate(dec_ctx, reinterpret_cast< unsigned char * >(dst), &outlen,               \
-						  reinterpret_cast< const unsigned char * >(src), AES_BLOCK_SIZE);          \
-		EVP_DecryptFinal_ex(dec_ctx, reinterpret_cast< unsigned char * >((dst) + outlen), &outlen); \
+#define AESdecrypt_ctx(src, dst, blocks, dec_ctx)                                     \
+	{                                                                                 \
+		int outlen = 0;                                                               \
+		EVP_DecryptUpdate(dec_ctx, reinterpret_cast< unsigned char * >(dst), &outlen, \
+						  reinterpret_cast< const unsigned char * >(src),             \
+						  static_cast< int >((blocks) * AES_BLOCK_SIZE));             \
 	}
 
-#define AESencrypt(src, dst, key) AESencrypt_ctx(src, dst, key, enc_ctx_ocb_enc)
-#define AESdecrypt(src, dst, key) AESdecrypt_ctx(src, dst, key, dec_ctx_ocb_enc)
+#define AESencrypt(src, dst, blocks) AESencrypt_ctx(src, dst, blocks, enc_ctx_ocb_enc)
+#define AESdecrypt(src, dst, blocks) AESdecrypt_ctx(src, dst, blocks, dec_ctx_ocb_enc)
 
 bool CryptStateOCB2::ocb_encrypt(const unsigned char *plain, unsigned char *encrypted, unsigned int len,
 								 const unsigned char *nonce, unsigned char *tag, bool modifyPlainOnXEXStarAttack) {
 	keyblock checksum, delta, tmp, pad;
 	bool success = true;
 
+	keyblock blocks[PIPELINE_BLOCKS], deltas[PIPELINE_BLOCKS];
+
 	// Initialize
-	AESencrypt(nonce, delta, raw_key);
+	AESencrypt(nonce, delta, 1);
 	ZERO(checksum);
 
-	while (len > AES_BLOCK_SIZE) {
-		// Counter-cryptanalysis described in section 9 of https://eprint.iacr.org/2019/311
-		// For an attack, the second to last block (i.e. the last iteration of this loop)
-		// must be all 0 except for the last byte (which may be 0 - 128).
-		bool flipABit = false; // *plain is const, so we can't directly modify it
-		if (len - AES_BLOCK_SIZE <= AES_BLOCK_SIZE) {
-			unsigned char sum = 0;
-			for (int i = 0; i < AES_BLOCK_SIZE - 1; ++i) {
-				sum |= plain[i];
-			}
-			if (sum == 0) {
-				if (modifyPlainOnXEXStarAttack) {
-					// The assumption that critical packets do not turn up by pure chance turned out to be incorrect
-					// since digital silence appears to produce them in mass.
-					// So instead we now modify the packet in a way which should not affect the audio but will
-					// prevent the attack.
-					flipABit = true;
-				} else {
-					// This option still exists but only to allow us to test ocb_decrypt's detection.
-					success = false;
+	// All blocks but the last one are full. They go through AES in runs, the last run along with the pad of the
+	// last block.
+	unsigned int fullBlocks = (len > 0) ? (len - 1) / AES_BLOCK_SIZE : 0;
+	bool lastRun            = false;
+	while (!lastRun) {
+		const unsigned int count = std::min(fullBlocks, PIPELINE_BLOCKS - 1);
+		lastRun                  = (count == fullBlocks);
+
+		for (unsigned int i = 0; i < count; ++i) {
+			// Counter-cryptanalysis described in section 9 of https://eprint.iacr.org/2019/311
+			// For an attack, the second to last block (i.e. the last full block)
+			// must be all 0 except for the last byte (which may be 0 - 128).
+			bool flipABit = false; // *plain is const, so we can't directly modify it
+			if (len - AES_BLOCK_SIZE <= AES_BLOCK_SIZE) {
+				unsigned char sum = 0;
+				for (int j = 0; j < AES_BLOCK_SIZE - 1; ++j) {
+					sum |= plain[j];
+				}
+				if (sum == 0) {
+					if (modifyPlainOnXEXStarAttack) {
+						// The assumption that critical packets do not turn up by pure chance turned out to be
+						// incorrect since digital silence appears to produce them in mass.
+						// So instead we now modify the packet in a way which should not affect the audio but will
+						// prevent the attack.
+						flipABit = true;
+					} else {
+						// This option still exists but only to allow us to test ocb_decrypt's detection.
+						success = false;
+					}
 				}
 			}
-		}
 
-		S2(delta);
-		XOR(tmp, delta, reinterpret_cast< const subblock * >(plain));
-		if (flipABit) {
-			*reinterpret_cast< unsigned char * >(tmp) ^= 1;
+			S2(delta);
+			memcpy(deltas[i], delta, AES_BLOCK_SIZE);
+			XOR(blocks[i], delta, reinterpret_cast< const subblock * >(plain));
+			if (flipABit) {
+				*reinterpret_cast< unsigned char * >(blocks[i]) ^= 1;
+			}
+			XOR(checksum, checksum, reinterpret_cast< const subblock * >(plain));
+			if (flipABit) {
+				*reinterpret_cast< unsigned char * >(checksum) ^= 1;
+			}
+
+			len -= AES_BLOCK_SIZE;
+			plain += AES_BLOCK_SIZE;
 		}
-		AESencrypt(tmp, tmp, raw_key);
-		XOR(reinterpret_cast< subblock * >(encrypted), delta, tmp);
-		XOR(checksum, checksum, reinterpret_cast< const subblock * >(plain));
-		if (flipABit) {
-			*reinterpret_cast< unsigned char * >(checksum) ^= 1;
+
+		if (lastRun) {
+			S2(delta);
+			ZERO(blocks[count]);
+			blocks[count][BLOCKSIZE - 1] = SWAPPED(len * 8);
+			XOR(blocks[count], blocks[count], delta);
 		}
 
-		len -= AES_BLOCK_SIZE;
-		plain += AES_BLOCK_SIZE;
-		encrypted += AES_BLOCK_SIZE;
+		AESencrypt(blocks, blocks, count + (lastRun ? 1 : 0));
+
+		for (unsigned int i = 0; i < count; ++i) {
+			XOR(reinterpret_cast< subblock * >(encrypted), deltas[i], blocks[i]);
+			encrypted += AES_BLOCK_SIZE;
+		}
+		if (lastRun) {
+			memcpy(pad, blocks[count], AES_BLOCK_SIZE);
+		}
+		fullBlocks -= count;
 	}
 
-	S2(delta);
-	ZERO(tmp);
-	tmp[BLOCKSIZE - 1] = SWAPPED(len * 8);
-	XOR(tmp, tmp, delta);
-	AESencrypt(tmp, pad, raw_key);
 	memcpy(tmp, plain, len);
 	memcpy(reinterpret_cast< unsigned char * >(tmp) + len, reinterpret_cast< const unsigned char * >(pad) + len,
 		   AES_BLOCK_SIZE - len);
@@ -357,7 +400,7 @@ bool CryptStateOCB2::ocb_encrypt(const unsigned char *plain, unsigned char *encr
 
 	S3(delta);
 	XOR(tmp, delta, checksum);
-	AESencrypt(tmp, tag, raw_key);
+	AESencrypt(tmp, tag, 1);
 
 	return success;
 }
@@ -365,34 +408,48 @@ bool CryptStateOCB2::ocb_encrypt(const unsigned char *plain, unsigned char *encr
 #undef AESencrypt
 #undef AESdecrypt
 
-#define AESencrypt(src, dst, key) AESencrypt_ctx(src, dst, key, enc_ctx_ocb_dec)
-#define AESdecrypt(src, dst, key) AESdecrypt_ctx(src, dst, key, dec_ctx_ocb_dec)
+#define AESencrypt(src, dst, blocks) AESencrypt_ctx(src, dst, blocks, enc_ctx_ocb_dec)
+#define AESdecrypt(src, dst, blocks) AESdecrypt_ctx(src, dst, blocks, dec_ctx_ocb_dec)
 
 bool CryptStateOCB2::ocb_decrypt(const unsigned char *encrypted, unsigned char *plain, unsigned int len,
 								 const unsigned char *nonce, unsigned char *tag) {
 	keyblock checksum, delta, tmp, pad;
 	bool success = true;
 
+	keyblock blocks[PIPELINE_BLOCKS], deltas[PIPELINE_BLOCKS];
+
 	// Initialize
-	AESencrypt(nonce, delta, raw_key);
+	AESencrypt(nonce, delta, 1);
 	ZERO(checksum);
 
-	while (len > AES_BLOCK_SIZE) {
-		S2(delta);
-		XOR(tmp, delta, reinterpret_cast< const subblock * >(encrypted));
-		AESdecrypt(tmp, tmp, raw_key);
-		XOR(reinterpret_cast< subblock * >(plain), delta, tmp);
-		XOR(checksum, checksum, reinterpret_cast< const subblock * >(plain));
-		len -= AES_BLOCK_SIZE;
-		plain += AES_BLOCK_SIZE;
-		encrypted += AES_BLOCK_SIZE;
+	// All blocks but the last one are full and go through AES in runs
+	unsigned int fullBlocks = (len > 0) ? (len - 1) / AES_BLOCK_SIZE : 0;
+	while (fullBlocks > 0) {
+		const unsigned int count = std::min(fullBlocks, PIPELINE_BLOCKS);
+
+		for (unsigned int i = 0; i < count; ++i) {
+			S2(delta);
+			memcpy(deltas[i], delta, AES_BLOCK_SIZE);
+			XOR(blocks[i], delta, reinterpret_cast< const subblock * >(encrypted + i * AES_BLOCK_SIZE));
+		}
+
+		AESdecrypt(blocks, blocks, count);
+
+		for (unsigned int i = 0; i < count; ++i) {
+			XOR(reinterpret_cast< subblock * >(plain), deltas[i], blocks[i]);
+			XOR(checksum, checksum, reinterpret_cast< const subblock * >(plain));
+			plain += AES_BLOCK_SIZE;
+		}
+		len -= count * AES_BLOCK_SIZE;
+		encrypted += count * AES_BLOCK_SIZE;
+		fullBlocks -= count;
 	}
 
 	S2(delta);
 	ZERO(tmp);
 	tmp[BLOCKSIZE - 1] = SWAPPED(len * 8);
 	XOR(tmp, tmp, delta);
-	AESencrypt(tmp, pad, raw_key);
+	AESencrypt(tmp, pad, 1);
 	memset(tmp, 0, AES_BLOCK_SIZE);
 	memcpy(tmp, encrypted, len);
 	XOR(tmp, tmp, pad);
@@ -410,7 +467,7 @@ bool CryptStateOCB2::ocb_decrypt(const unsigned char *encrypted, unsigned char *
 
 	S3(delta);
 	XOR(tmp, delta, checksum);
-	AESencrypt(tmp, tag, raw_key);
+	AESencrypt(tmp, tag, 1);
 
 	return success;
 }
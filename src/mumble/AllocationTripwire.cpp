@@ -0,0 +1,148 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "AllocationTripwire.h"
+
+#ifdef MUMBLE_ALLOCATION_TRIPWIRE
+
+#	include <atomic>
+#	include <cstdio>
+#	include <cstdlib>
+#	include <new>
+
+#	if defined(_MSC_VER) && defined(_DEBUG)
+#		include <crtdbg.h>
+#	endif
+
+namespace {
+// Plain thread-locals of trivial types live in static TLS and never allocate themselves
+thread_local int armedDepth  = 0;
+thread_local int pausedDepth = 0;
+
+std::atomic< std::uint64_t > violations(0);
+std::atomic< bool > fatalViolations(true);
+
+void checkAllocation() {
+	if (armedDepth == 0 || pausedDepth != 0) {
+		return;
+	}
+
+	violations.fetch_add(1, std::memory_order_relaxed);
+	if (fatalViolations.load(std::memory_order_relaxed)) {
+		// Don't use anything that could allocate in here
+		std::fputs("AllocationTripwire: heap allocation inside a real-time section\n", stderr);
+		std::abort();
+	}
+}
+} // namespace
+
+namespace AllocationTripwire {
+
+Scope::Scope() {
+	++armedDepth;
+}
+
+Scope::~Scope() {
+	--armedDepth;
+}
+
+Pause::Pause() {
+	++pausedDepth;
+}
+
+Pause::~Pause() {
+	--pausedDepth;
+}
+
+std::uint64_t violationCount() {
+	return violations.load();
+}
+
+void resetViolationCount() {
+	violations.store(0);
+}
+
+void setFatal(bool fatal) {
+	fatalViolations.store(fatal);
+}
+
+} // namespace AllocationTripwire
+
+#	if defined(__GLIBC__)
+// Interpose the malloc family so that Qt's containers (which use malloc directly) are caught as well.
+// operator new ends up in malloc, so it does not need to be replaced.
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+
+void *malloc(std::size_t size) {
+	checkAllocation();
+	return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size) {
+	checkAllocation();
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, std::size_t size) {
+	checkAllocation();
+	return __libc_realloc(ptr, size);
+}
+}
+#	elif defined(_MSC_VER) && defined(_DEBUG)
+// The debug CRT reports every malloc/new through its allocation hook
+namespace {
+int crtAllocationHook(int allocType, void *, std::size_t, int, long, const unsigned char *, int) {
+	if (allocType != _HOOK_FREE) {
+		checkAllocation();
+	}
+	return TRUE;
+}
+
+const bool crtHookInstalled = (_CrtSetAllocHook(crtAllocationHook), true);
+} // namespace
+#	else
+// Fallback: only operator new can be observed
+void *operator new(std::size_t size) {
+	checkAllocation();
+	if (void *ptr = std::malloc(size ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+	checkAllocation();
+	return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {
+	return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+#	endif
+
+#endif // MUMBLE_ALLOCATION_TRIPWIRE
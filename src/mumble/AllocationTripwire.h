@@ -0,0 +1,66 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_ALLOCATIONTRIPWIRE_H_
+#define MUMBLE_MUMBLE_ALLOCATIONTRIPWIRE_H_
+
+#include <cstdint>
+
+/// Debug helper to verify that real-time code (e.g. AudioOutput::mix) does not touch the heap.
+///
+/// It is only compiled in when building with the "allocation-tripwire" option, which defines
+/// MUMBLE_ALLOCATION_TRIPWIRE. In all other builds every function in here is an inline no-op.
+namespace AllocationTripwire {
+
+#ifdef MUMBLE_ALLOCATION_TRIPWIRE
+/// While an instance is alive, every heap allocation made by the current thread is a violation.
+/// By default a violation aborts the program (see setFatal()).
+class Scope {
+public:
+	Scope();
+	~Scope();
+
+	Scope(const Scope &) = delete;
+	Scope &operator=(const Scope &) = delete;
+};
+
+/// Temporarily disarms the tripwire of the current thread, for code that is known to allocate
+/// and that is outside of what the armed scope is meant to verify.
+class Pause {
+public:
+	Pause();
+	~Pause();
+
+	Pause(const Pause &) = delete;
+	Pause &operator=(const Pause &) = delete;
+};
+
+/// @returns Whether the tripwire has been compiled in
+constexpr bool isEnabled() { return true; }
+/// @returns The number of allocations that happened inside an armed scope, on any thread
+std::uint64_t violationCount();
+void resetViolationCount();
+/// @param fatal Whether a violation aborts the program (the default) or is only counted
+void setFatal(bool fatal);
+#else
+class Scope {
+public:
+	Scope() {}
+};
+
+class Pause {
+public:
+	Pause() {}
+};
+
+constexpr bool isEnabled() { return false; }
+inline std::uint64_t violationCount() { return 0; }
+inline void resetViolationCount() {}
+inline void setFatal(bool) {}
+#endif
+
+} // namespace AllocationTripwire
+
+#endif // MUMBLE_MUMBLE_ALLOCATIONTRIPWIRE_H_
@@ -6,6 +6,7 @@
 #include "AudioInput.h"
 
 #include "API.h"
+#include "AudioKernels.h"
 #include "AudioOutput.h"
 #include "MainWindow.h"
 #include "MumbleProtocol.h"
@@ -329,12 +330,7 @@ bool AudioInput::isTransmitting() const {
 		const float m               = 1.0f / static_cast< float >(channels);                                 \
 		Q_UNUSED(N);                                                                                         \
 		Q_UNUSED(mask);                                                                                      \
-		for (unsigned int i = 0; i < nsamp; ++i) {                                                           \
-			float v = 0.0f;                                                                                  \
-			for (unsigned int j = 0; j < channels; ++j)                                                      \
-				v += input[i * channels + j];                                                                \
-			buffer[i] = v * m;                                                                               \
-		}                                                                                                    \
+		AudioKernels::downmix(buffer, input, nsamp, channels, m);                                            \
 	}
 
 #define IN_MIXER_SHORT(channels)                                                                             \
@@ -344,12 +340,7 @@ bool AudioInput::isTransmitting() const {
 		const float m               = 1.0f / (32768.f * static_cast< float >(channels));                     \
 		Q_UNUSED(N);                                                                                         \
 		Q_UNUSED(mask);                                                                                      \
-		for (unsigned int i = 0; i < nsamp; ++i) {                                                           \
-			float v = 0.0f;                                                                                  \
-			for (unsigned int j = 0; j < channels; ++j)                                                      \
-				v += static_cast< float >(input[i * channels + j]);                                          \
-			buffer[i] = v * m;                                                                               \
-		}                                                                                                    \
+		AudioKernels::downmix(buffer, input, nsamp, channels, m);                                            \
 	}
 
 static void inMixerFloatMask(float *RESTRICT buffer, const void *RESTRICT ipt, unsigned int nsamp, unsigned int N,
@@ -0,0 +1,648 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "AudioKernels.h"
+
+#include <algorithm>
+
+// Define MUMBLE_DISABLE_SIMD to build only the scalar kernels
+#if !defined(MUMBLE_DISABLE_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#	define MUMBLE_SIMD_X86
+#	include <immintrin.h>
+#	if defined(_MSC_VER) && !defined(__clang__)
+#		include <intrin.h>
+#		define MUMBLE_TARGET(isa)
+#	else
+#		define MUMBLE_TARGET(isa) __attribute__((target(isa)))
+#	endif
+#elif !defined(MUMBLE_DISABLE_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#	define MUMBLE_SIMD_NEON
+#	include <arm_neon.h>
+#endif
+
+namespace AudioKernels {
+
+namespace {
+
+	// Scalar reference implementations. The vectorized ones hand them the samples that do not fill a whole vector.
+
+	void foldStereoScalar(float *out, const float *in, unsigned int frames, float gain) {
+		for (unsigned int i = 0; i < frames; ++i) {
+			out[i] = (in[2 * i] + in[2 * i + 1]) * gain;
+		}
+	}
+
+	void addFoldedStereoScalar(float *out, const float *in, unsigned int frames, float gain) {
+		for (unsigned int i = 0; i < frames; ++i) {
+			out[i] += (in[2 * i] + in[2 * i + 1]) * gain;
+		}
+	}
+
+	/// Starts at the given frame, so that the ramp continues where a vectorized loop has left it
+	void addScaledFrom(unsigned int first, float *out, unsigned int stride, const float *in, unsigned int frames,
+					   float gain, float gainStep) {
+		for (unsigned int i = first; i < frames; ++i) {
+			out[i * stride] += in[i] * (gain + gainStep * static_cast< float >(i));
+		}
+	}
+
+	void addScaledScalar(float *out, unsigned int stride, const float *in, unsigned int frames, float gain,
+						 float gainStep) {
+		addScaledFrom(0, out, stride, in, frames, gain, gainStep);
+	}
+
+	void addPannedScalar(float *out, unsigned int stride, const float *in, unsigned int frames, float leftGain,
+						 float rightGain, float gain) {
+		for (unsigned int i = 0; i < frames; ++i) {
+			out[i * stride] += (in[2 * i] * leftGain + in[2 * i + 1] * rightGain) * gain;
+		}
+	}
+
+	void addStereoScalar(float *out, unsigned int stride, const float *left, const float *right,
+						 unsigned int frames) {
+		for (unsigned int i = 0; i < frames; ++i) {
+			out[i * stride] += left[i];
+			out[i * stride + 1] += right[i];
+		}
+	}
+
+	void clipScalar(float *buffer, unsigned int count) {
+		for (unsigned int i = 0; i < count; ++i) {
+			buffer[i] = std::max(-1.0f, std::min(buffer[i], 1.0f));
+		}
+	}
+
+	void toShortScalar(short *out, const float *in, unsigned int count) {
+		for (unsigned int i = 0; i < count; ++i) {
+			out[i] = static_cast< short >(std::max(-32768.0f, std::min(in[i] * 32768.0f, 32767.0f)));
+		}
+	}
+
+	void downmixFloatScalar(float *out, const float *in, unsigned int frames, unsigned int channels, float gain) {
+		for (unsigned int i = 0; i < frames; ++i) {
+			float v = 0.0f;
+			for (unsigned int j = 0; j < channels; ++j) {
+				v += in[i * channels + j];
+			}
+			out[i] = v * gain;
+		}
+	}
+
+	void downmixShortScalar(float *out, const short *in, unsigned int frames, unsigned int channels, float gain) {
+		for (unsigned int i = 0; i < frames; ++i) {
+			float v = 0.0f;
+			for (unsigned int j = 0; j < channels; ++j) {
+				v += static_cast< float >(in[i * channels + j]);
+			}
+			out[i] = v * gain;
+		}
+	}
+
+	const Kernels scalarKernels = { foldStereoScalar, addFoldedStereoScalar, addScaledScalar,
+									addPannedScalar,  addStereoScalar,       clipScalar,
+									toShortScalar,    downmixFloatScalar,    downmixShortScalar };
+
+#if defined(MUMBLE_SIMD_X86)
+	InstructionSet detectInstructionSet() {
+#	if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		const int maxLeaf = info[0];
+		__cpuid(info, 1);
+		const bool sse2    = (info[3] & (1 << 26)) != 0;
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx2          = false;
+		if (osxsave && maxLeaf >= 7) {
+			// The OS must save the YMM registers on context switches
+			const unsigned long long xcr0 = _xgetbv(0);
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+		}
+#	else
+		__builtin_cpu_init();
+		const bool sse2 = __builtin_cpu_supports("sse2");
+		const bool avx2 = __builtin_cpu_supports("avx2");
+#	endif
+		if (avx2) {
+			return InstructionSet::AVX2;
+		}
+		if (sse2) {
+			return InstructionSet::SSE2;
+		}
+		return InstructionSet::Scalar;
+	}
+
+	// SSE2, 4 samples at a time
+
+	/// out[k * stride] += v[k]
+	MUMBLE_TARGET("sse2") inline void accumulateSSE2(float *out, unsigned int stride, __m128 v) {
+		if (stride == 1) {
+			_mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), v));
+		} else {
+			alignas(16) float lanes[4];
+			_mm_store_ps(lanes, v);
+			for (unsigned int k = 0; k < 4; ++k) {
+				out[k * stride] += lanes[k];
+			}
+		}
+	}
+
+	/// Splits 4 stereo frames into their left and right samples
+	MUMBLE_TARGET("sse2") inline void deinterleaveSSE2(const float *in, __m128 &left, __m128 &right) {
+		const __m128 a = _mm_loadu_ps(in);
+		const __m128 b = _mm_loadu_ps(in + 4);
+		left           = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		right          = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+	}
+
+	MUMBLE_TARGET("sse2") void foldStereoSSE2(float *out, const float *in, unsigned int frames, float gain) {
+		const __m128 g = _mm_set1_ps(gain);
+		unsigned int i = 0;
+		for (; i + 4 <= frames; i += 4) {
+			__m128 left, right;
+			deinterleaveSSE2(in + 2 * i, left, right);
+			_mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(left, right), g));
+		}
+		foldStereoScalar(out + i, in + 2 * i, frames - i, gain);
+	}
+
+	MUMBLE_TARGET("sse2") void addFoldedStereoSSE2(float *out, const float *in, unsigned int frames, float gain) {
+		const __m128 g = _mm_set1_ps(gain);
+		unsigned int i = 0;
+		for (; i + 4 <= frames; i += 4) {
+			__m128 left, right;
+			deinterleaveSSE2(in + 2 * i, left, right);
+			accumulateSSE2(out + i, 1, _mm_mul_ps(_mm_add_ps(left, right), g));
+		}
+		addFoldedStereoScalar(out + i, in + 2 * i, frames - i, gain);
+	}
+
+	MUMBLE_TARGET("sse2")
+	void addScaledSSE2(float *out, unsigned int stride, const float *in, unsigned int frames, float gain,
+					   float gainStep) {
+		const __m128 g     = _mm_set1_ps(gain);
+		const __m128 step  = _mm_set1_ps(gainStep);
+		const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+		unsigned int i     = 0;
+		for (; i + 4 <= frames; i += 4) {
+			const __m128 index = _mm_add_ps(_mm_set1_ps(static_cast< float >(i)), lanes);
+			const __m128 ramp  = _mm_add_ps(g, _mm_mul_ps(step, index));
+			accumulateSSE2(out + i * stride, stride, _mm_mul_ps(_mm_loadu_ps(in + i), ramp));
+		}
+		addScaledFrom(i, out, stride, in, frames, gain, gainStep);
+	}
+
+	MUMBLE_TARGET("sse2")
+	void addPannedSSE2(float *out, unsigned int stride, const float *in, unsigned int frames, float leftGain,
+					   float rightGain, float gain) {
+		const __m128 l = _mm_set1_ps(leftGain);
+		const __m128 r = _mm_set1_ps(rightGain);
+		const __m128 g = _mm_set1_ps(gain);
+		unsigned int i = 0;
+		for (; i + 4 <= frames; i += 4) {
+			__m128 left, right;
+			deinterleaveSSE2(in + 2 * i, left, right);
+			const __m128 panned = _mm_add_ps(_mm_mul_ps(left, l), _mm_mul_ps(right, r));
+			accumulateSSE2(out + i * stride, stride, _mm_mul_ps(panned, g));
+		}
+		addPannedScalar(out + i * stride, stride, in + 2 * i, frames - i, leftGain, rightGain, gain);
+	}
+
+	MUMBLE_TARGET("sse2")
+	void addStereoSSE2(float *out, unsigned int stride, const float *left, const float *right, unsigned int frames) {
+		unsigned int i = 0;
+		if (stride == 2) {
+			for (; i + 4 <= frames; i += 4) {
+				const __m128 l = _mm_loadu_ps(left + i);
+				const __m128 r = _mm_loadu_ps(right + i);
+				accumulateSSE2(out + 2 * i, 1, _mm_unpacklo_ps(l, r));
+				accumulateSSE2(out + 2 * i + 4, 1, _mm_unpackhi_ps(l, r));
+			}
+		}
+		addStereoScalar(out + i * stride, stride, left + i, right + i, frames - i);
+	}
+
+	MUMBLE_TARGET("sse2") void clipSSE2(float *buffer, unsigned int count) {
+		const __m128 low  = _mm_set1_ps(-1.0f);
+		const __m128 high = _mm_set1_ps(1.0f);
+		unsigned int i    = 0;
+		for (; i + 4 <= count; i += 4) {
+			_mm_storeu_ps(buffer + i, _mm_max_ps(low, _mm_min_ps(_mm_loadu_ps(buffer + i), high)));
+		}
+		clipScalar(buffer + i, count - i);
+	}
+
+	MUMBLE_TARGET("sse2") inline __m128i toIntSSE2(const float *in) {
+		const __m128 scaled = _mm_mul_ps(_mm_loadu_ps(in), _mm_set1_ps(32768.0f));
+		return _mm_cvttps_epi32(_mm_max_ps(_mm_set1_ps(-32768.0f), _mm_min_ps(scaled, _mm_set1_ps(32767.0f))));
+	}
+
+	MUMBLE_TARGET("sse2") void toShortSSE2(short *out, const float *in, unsigned int count) {
+		unsigned int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			_mm_storeu_si128(reinterpret_cast< __m128i * >(out + i),
+							 _mm_packs_epi32(toIntSSE2(in + i), toIntSSE2(in + i + 4)));
+		}
+		toShortScalar(out + i, in + i, count - i);
+	}
+
+	MUMBLE_TARGET("sse2")
+	void downmixFloatSSE2(float *out, const float *in, unsigned int frames, unsigned int channels, float gain) {
+		const __m128 g = _mm_set1_ps(gain);
+		unsigned int i = 0;
+		if (channels == 1) {
+			for (; i + 4 <= frames; i += 4) {
+				_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), g));
+			}
+		} else if (channels == 2) {
+			for (; i + 4 <= frames; i += 4) {
+				__m128 left, right;
+				deinterleaveSSE2(in + 2 * i, left, right);
+				_mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(left, right), g));
+			}
+		}
+		downmixFloatScalar(out + i, in + i * channels, frames - i, channels, gain);
+	}
+
+	MUMBLE_TARGET("sse2")
+	void downmixShortSSE2(float *out, const short *in, unsigned int frames, unsigned int channels, float gain) {
+		const __m128 g = _mm_set1_ps(gain);
+		unsigned int i = 0;
+		if (channels == 1) {
+			for (; i + 8 <= frames; i += 8) {
+				const __m128i x = _mm_loadu_si128(reinterpret_cast< const __m128i * >(in + i));
+				// Sign extension to 32 bits
+				const __m128i low  = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+				const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+				_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(low), g));
+				_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), g));
+			}
+		} else if (channels == 2) {
+			const __m128i ones = _mm_set1_epi16(1);
+			for (; i + 4 <= frames; i += 4) {
+				// Sums of the pairs, exact in 32 bits just like in float
+				const __m128i x = _mm_loadu_si128(reinterpret_cast< const __m128i * >(in + 2 * i));
+				_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_madd_epi16(x, ones)), g));
+			}
+		}
+		downmixShortScalar(out + i, in + i * channels, frames - i, channels, gain);
+	}
+
+	const Kernels sse2Kernels = { foldStereoSSE2, addFoldedStereoSSE2, addScaledSSE2,
+								  addPannedSSE2,  addStereoSSE2,       clipSSE2,
+								  toShortSSE2,    downmixFloatSSE2,    downmixShortSSE2 };
+
+	// AVX2, 8 samples at a time. Without fused multiply-adds, which would round differently than the scalar kernels.
+
+	MUMBLE_TARGET("avx2") inline void accumulateAVX2(float *out, unsigned int stride, __m256 v) {
+		if (stride == 1) {
+			_mm256_storeu_ps(out, _mm256_add_ps(_mm256_loadu_ps(out), v));
+		} else {
+			alignas(32) float lanes[8];
+			_mm256_store_ps(lanes, v);
+			for (unsigned int k = 0; k < 8; ++k) {
+				out[k * stride] += lanes[k];
+			}
+		}
+	}
+
+	/// Splits 8 stereo frames into their left and right samples
+	MUMBLE_TARGET("avx2") inline void deinterleaveAVX2(const float *in, __m256 &left, __m256 &right) {
+		const __m256 a = _mm256_loadu_ps(in);
+		const __m256 b = _mm256_loadu_ps(in + 8);
+		// The shuffles work within 128 bit lanes, the permutation puts the 64 bit halves back in order
+		left  = _mm256_castpd_ps(_mm256_permute4x64_pd(
+			_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+		right = _mm256_castpd_ps(_mm256_permute4x64_pd(
+			_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	MUMBLE_TARGET("avx2") void foldStereoAVX2(float *out, const float *in, unsigned int frames, float gain) {
+		const __m256 g = _mm256_set1_ps(gain);
+		unsigned int i = 0;
+		for (; i + 8 <= frames; i += 8) {
+			__m256 left, right;
+			deinterleaveAVX2(in + 2 * i, left, right);
+			_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_add_ps(left, right), g));
+		}
+		foldStereoScalar(out + i, in + 2 * i, frames - i, gain);
+	}
+
+	MUMBLE_TARGET("avx2") void addFoldedStereoAVX2(float *out, const float *in, unsigned int frames, float gain) {
+		const __m256 g = _mm256_set1_ps(gain);
+		unsigned int i = 0;
+		for (; i + 8 <= frames; i += 8) {
+			__m256 left, right;
+			deinterleaveAVX2(in + 2 * i, left, right);
+			accumulateAVX2(out + i, 1, _mm256_mul_ps(_mm256_add_ps(left, right), g));
+		}
+		addFoldedStereoScalar(out + i, in + 2 * i, frames - i, gain);
+	}
+
+	MUMBLE_TARGET("avx2")
+	void addScaledAVX2(float *out, unsigned int stride, const float *in, unsigned int frames, float gain,
+					   float gainStep) {
+		const __m256 g     = _mm256_set1_ps(gain);
+		const __m256 step  = _mm256_set1_ps(gainStep);
+		const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+		unsigned int i     = 0;
+		for (; i + 8 <= frames; i += 8) {
+			const __m256 index = _mm256_add_ps(_mm256_set1_ps(static_cast< float >(i)), lanes);
+			const __m256 ramp  = _mm256_add_ps(g, _mm256_mul_ps(step, index));
+			accumulateAVX2(out + i * stride, stride, _mm256_mul_ps(_mm256_loadu_ps(in + i), ramp));
+		}
+		addScaledFrom(i, out, stride, in, frames, gain, gainStep);
+	}
+
+	MUMBLE_TARGET("avx2")
+	void addPannedAVX2(float *out, unsigned int stride, const float *in, unsigned int frames, float leftGain,
+					   float rightGain, float gain) {
+		const __m256 l = _mm256_set1_ps(leftGain);
+		const __m256 r = _mm256_set1_ps(rightGain);
+		const __m256 g = _mm256_set1_ps(gain);
+		unsigned int i = 0;
+		for (; i + 8 <= frames; i += 8) {
+			__m256 left, right;
+			deinterleaveAVX2(in + 2 * i, left, right);
+			const __m256 panned = _mm256_add_ps(_mm256_mul_ps(left, l), _mm256_mul_ps(right, r));
+			accumulateAVX2(out + i * stride, stride, _mm256_mul_ps(panned, g));
+		}
+		addPannedScalar(out + i * stride, stride, in + 2 * i, frames - i, leftGain, rightGain, gain);
+	}
+
+	MUMBLE_TARGET("avx2")
+	void addStereoAVX2(float *out, unsigned int stride, const float *left, const float *right, unsigned int frames) {
+		unsigned int i = 0;
+		if (stride == 2) {
+			for (; i + 8 <= frames; i += 8) {
+				const __m256 l = _mm256_loadu_ps(left + i);
+				const __m256 r = _mm256_loadu_ps(right + i);
+				// Interleaved within 128 bit lanes: l0 r0 l1 r1 | l4 r4 l5 r5 and l2 r2 l3 r3 | l6 r6 l7 r7
+				const __m256 low  = _mm256_unpacklo_ps(l, r);
+				const __m256 high = _mm256_unpackhi_ps(l, r);
+				accumulateAVX2(out + 2 * i, 1, _mm256_permute2f128_ps(low, high, 0x20));
+				accumulateAVX2(out + 2 * i + 8, 1, _mm256_permute2f128_ps(low, high, 0x31));
+			}
+		}
+		addStereoScalar(out + i * stride, stride, left + i, right + i, frames - i);
+	}
+
+	MUMBLE_TARGET("avx2") void clipAVX2(float *buffer, unsigned int count) {
+		const __m256 low  = _mm256_set1_ps(-1.0f);
+		const __m256 high = _mm256_set1_ps(1.0f);
+		unsigned int i    = 0;
+		for (; i + 8 <= count; i += 8) {
+			_mm256_storeu_ps(buffer + i, _mm256_max_ps(low, _mm256_min_ps(_mm256_loadu_ps(buffer + i), high)));
+		}
+		clipScalar(buffer + i, count - i);
+	}
+
+	MUMBLE_TARGET("avx2") inline __m256i toIntAVX2(const float *in) {
+		const __m256 scaled = _mm256_mul_ps(_mm256_loadu_ps(in), _mm256_set1_ps(32768.0f));
+		return _mm256_cvttps_epi32(
+			_mm256_max_ps(_mm256_set1_ps(-32768.0f), _mm256_min_ps(scaled, _mm256_set1_ps(32767.0f))));
+	}
+
+	MUMBLE_TARGET("avx2") void toShortAVX2(short *out, const float *in, unsigned int count) {
+		unsigned int i = 0;
+		for (; i + 16 <= count; i += 16) {
+			// Packs within 128 bit lanes, the permutation puts the 64 bit quarters back in order
+			const __m256i packed = _mm256_packs_epi32(toIntAVX2(in + i), toIntAVX2(in + i + 8));
+			_mm256_storeu_si256(reinterpret_cast< __m256i * >(out + i),
+								_mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+		}
+		toShortScalar(out + i, in + i, count - i);
+	}
+
+	MUMBLE_TARGET("avx2")
+	void downmixFloatAVX2(float *out, const float *in, unsigned int frames, unsigned int channels, float gain) {
+		const __m256 g = _mm256_set1_ps(gain);
+		unsigned int i = 0;
+		if (channels == 1) {
+			for (; i + 8 <= frames; i += 8) {
+				_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(in + i), g));
+			}
+		} else if (channels == 2) {
+			for (; i + 8 <= frames; i += 8) {
+				__m256 left, right;
+				deinterleaveAVX2(in + 2 * i, left, right);
+				_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_add_ps(left, right), g));
+			}
+		}
+		downmixFloatScalar(out + i, in + i * channels, frames - i, channels, gain);
+	}
+
+	MUMBLE_TARGET("avx2")
+	void downmixShortAVX2(float *out, const short *in, unsigned int frames, unsigned int channels, float gain) {
+		const __m256 g = _mm256_set1_ps(gain);
+		unsigned int i = 0;
+		if (channels == 1) {
+			for (; i + 8 <= frames; i += 8) {
+				const __m128i x = _mm_loadu_si128(reinterpret_cast< const __m128i * >(in + i));
+				_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(x)), g));
+			}
+		} else if (channels == 2) {
+			const __m256i ones = _mm256_set1_epi16(1);
+			for (; i + 8 <= frames; i += 8) {
+				const __m256i x = _mm256_loadu_si256(reinterpret_cast< const __m256i * >(in + 2 * i));
+				_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(x, ones)), g));
+			}
+		}
+		downmixShortScalar(out + i, in + i * channels, frames - i, channels, gain);
+	}
+
+	const Kernels avx2Kernels = { foldStereoAVX2, addFoldedStereoAVX2, addScaledAVX2,
+								  addPannedAVX2,  addStereoAVX2,       clipAVX2,
+								  toShortAVX2,    downmixFloatAVX2,    downmixShortAVX2 };
+#elif defined(MUMBLE_SIMD_NEON)
+	InstructionSet detectInstructionSet() {
+		return InstructionSet::NEON;
+	}
+
+	// NEON, 4 samples at a time. vmlaq_f32 is avoided as it may be fused.
+
+	/// out[k * stride] += v[k]
+	inline void accumulateNEON(float *out, unsigned int stride, float32x4_t v) {
+		if (stride == 1) {
+			vst1q_f32(out, vaddq_f32(vld1q_f32(out), v));
+		} else {
+			float lanes[4];
+			vst1q_f32(lanes, v);
+			for (unsigned int k = 0; k < 4; ++k) {
+				out[k * stride] += lanes[k];
+			}
+		}
+	}
+
+	void foldStereoNEON(float *out, const float *in, unsigned int frames, float gain) {
+		unsigned int i = 0;
+		for (; i + 4 <= frames; i += 4) {
+			// Load with deinterlacing, val[0] holds the left samples and val[1] the right ones
+			const float32x4x2_t x = vld2q_f32(in + 2 * i);
+			vst1q_f32(out + i, vmulq_n_f32(vaddq_f32(x.val[0], x.val[1]), gain));
+		}
+		foldStereoScalar(out + i, in + 2 * i, frames - i, gain);
+	}
+
+	void addFoldedStereoNEON(float *out, const float *in, unsigned int frames, float gain) {
+		unsigned int i = 0;
+		for (; i + 4 <= frames; i += 4) {
+			const float32x4x2_t x = vld2q_f32(in + 2 * i);
+			accumulateNEON(out + i, 1, vmulq_n_f32(vaddq_f32(x.val[0], x.val[1]), gain));
+		}
+		addFoldedStereoScalar(out + i, in + 2 * i, frames - i, gain);
+	}
+
+	void addScaledNEON(float *out, unsigned int stride, const float *in, unsigned int frames, float gain,
+					   float gainStep) {
+		const float laneIndices[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+		const float32x4_t lanes    = vld1q_f32(laneIndices);
+		unsigned int i             = 0;
+		for (; i + 4 <= frames; i += 4) {
+			const float32x4_t index = vaddq_f32(vdupq_n_f32(static_cast< float >(i)), lanes);
+			const float32x4_t ramp  = vaddq_f32(vdupq_n_f32(gain), vmulq_n_f32(index, gainStep));
+			accumulateNEON(out + i * stride, stride, vmulq_f32(vld1q_f32(in + i), ramp));
+		}
+		addScaledFrom(i, out, stride, in, frames, gain, gainStep);
+	}
+
+	void addPannedNEON(float *out, unsigned int stride, const float *in, unsigned int frames, float leftGain,
+					   float rightGain, float gain) {
+		unsigned int i = 0;
+		for (; i + 4 <= frames; i += 4) {
+			const float32x4x2_t x = vld2q_f32(in + 2 * i);
+			const float32x4_t panned =
+				vaddq_f32(vmulq_n_f32(x.val[0], leftGain), vmulq_n_f32(x.val[1], rightGain));
+			accumulateNEON(out + i * stride, stride, vmulq_n_f32(panned, gain));
+		}
+		addPannedScalar(out + i * stride, stride, in + 2 * i, frames - i, leftGain, rightGain, gain);
+	}
+
+	void addStereoNEON(float *out, unsigned int stride, const float *left, const float *right, unsigned int frames) {
+		unsigned int i = 0;
+		if (stride == 2) {
+			for (; i + 4 <= frames; i += 4) {
+				float32x4x2_t o = vld2q_f32(out + 2 * i);
+				o.val[0]        = vaddq_f32(o.val[0], vld1q_f32(left + i));
+				o.val[1]        = vaddq_f32(o.val[1], vld1q_f32(right + i));
+				vst2q_f32(out + 2 * i, o);
+			}
+		}
+		addStereoScalar(out + i * stride, stride, left + i, right + i, frames - i);
+	}
+
+	void clipNEON(float *buffer, unsigned int count) {
+		const float32x4_t low  = vdupq_n_f32(-1.0f);
+		const float32x4_t high = vdupq_n_f32(1.0f);
+		unsigned int i         = 0;
+		for (; i + 4 <= count; i += 4) {
+			vst1q_f32(buffer + i, vmaxq_f32(low, vminq_f32(vld1q_f32(buffer + i), high)));
+		}
+		clipScalar(buffer + i, count - i);
+	}
+
+	inline int16x4_t narrowNEON(const float *in) {
+		const float32x4_t scaled  = vmulq_n_f32(vld1q_f32(in), 32768.0f);
+		const float32x4_t clamped = vmaxq_f32(vdupq_n_f32(-32768.0f), vminq_f32(scaled, vdupq_n_f32(32767.0f)));
+		// Converts rounding towards zero, like the cast of the scalar kernel
+		return vmovn_s32(vcvtq_s32_f32(clamped));
+	}
+
+	void toShortNEON(short *out, const float *in, unsigned int count) {
+		unsigned int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			vst1q_s16(out + i, vcombine_s16(narrowNEON(in + i), narrowNEON(in + i + 4)));
+		}
+		toShortScalar(out + i, in + i, count - i);
+	}
+
+	void downmixFloatNEON(float *out, const float *in, unsigned int frames, unsigned int channels, float gain) {
+		unsigned int i = 0;
+		if (channels == 1) {
+			for (; i + 4 <= frames; i += 4) {
+				vst1q_f32(out + i, vmulq_n_f32(vld1q_f32(in + i), gain));
+			}
+		} else if (channels == 2) {
+			for (; i + 4 <= frames; i += 4) {
+				const float32x4x2_t x = vld2q_f32(in + 2 * i);
+				vst1q_f32(out + i, vmulq_n_f32(vaddq_f32(x.val[0], x.val[1]), gain));
+			}
+		}
+		downmixFloatScalar(out + i, in + i * channels, frames - i, channels, gain);
+	}
+
+	void downmixShortNEON(float *out, const short *in, unsigned int frames, unsigned int channels, float gain) {
+		unsigned int i = 0;
+		if (channels == 1) {
+			for (; i + 8 <= frames; i += 8) {
+				const int16x8_t x = vld1q_s16(in + i);
+				vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), gain));
+				vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), gain));
+			}
+		} else if (channels == 2) {
+			for (; i + 8 <= frames; i += 8) {
+				const int16x8x2_t x = vld2q_s16(in + 2 * i);
+				const int32x4_t low  = vaddl_s16(vget_low_s16(x.val[0]), vget_low_s16(x.val[1]));
+				const int32x4_t high = vaddl_s16(vget_high_s16(x.val[0]), vget_high_s16(x.val[1]));
+				vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(low), gain));
+				vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(high), gain));
+			}
+		}
+		downmixShortScalar(out + i, in + i * channels, frames - i, channels, gain);
+	}
+
+	const Kernels neonKernels = { foldStereoNEON, addFoldedStereoNEON, addScaledNEON,
+								  addPannedNEON,  addStereoNEON,       clipNEON,
+								  toShortNEON,    downmixFloatNEON,    downmixShortNEON };
+#else
+	InstructionSet detectInstructionSet() {
+		return InstructionSet::Scalar;
+	}
+#endif
+
+} // namespace
+
+InstructionSet instructionSet() {
+	static const InstructionSet set = detectInstructionSet();
+	return set;
+}
+
+const char *instructionSetName(InstructionSet set) {
+	switch (set) {
+		case InstructionSet::SSE2:
+			return "SSE2";
+		case InstructionSet::AVX2:
+			return "AVX2";
+		case InstructionSet::NEON:
+			return "NEON";
+		default:
+			return "scalar";
+	}
+}
+
+const Kernels *kernels(InstructionSet set) {
+	switch (set) {
+		case InstructionSet::Scalar:
+			return &scalarKernels;
+#if defined(MUMBLE_SIMD_X86)
+		case InstructionSet::SSE2:
+			return instructionSet() != InstructionSet::Scalar ? &sse2Kernels : nullptr;
+		case InstructionSet::AVX2:
+			return instructionSet() == InstructionSet::AVX2 ? &avx2Kernels : nullptr;
+#elif defined(MUMBLE_SIMD_NEON)
+		case InstructionSet::NEON:
+			return &neonKernels;
+#endif
+		default:
+			return nullptr;
+	}
+}
+
+const Kernels &active() {
+	static const Kernels *const selected = kernels(instructionSet());
+	return *selected;
+}
+
+} // namespace AudioKernels
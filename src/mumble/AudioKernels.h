@@ -0,0 +1,86 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_AUDIOKERNELS_H_
+#define MUMBLE_MUMBLE_AUDIOKERNELS_H_
+
+/// Vectorized inner loops of the audio mixers (AudioInput, AudioOutput and AudioOutputSpeech).
+///
+/// The fastest implementation the CPU supports (AVX2, SSE2 or NEON) is chosen the first time a kernel is used. Every
+/// implementation gives the same result as the scalar one, which serves as reference, up to the rounding of
+/// multiply-adds the compiler fuses. None of them allocates, so they can be used in AudioOutput::mix(). Output buffers
+/// may not overlap input buffers.
+namespace AudioKernels {
+
+/// Instruction sets the kernels can be run with
+enum class InstructionSet { Scalar, SSE2, AVX2, NEON };
+
+/// One implementation of every kernel. "stride" is the distance between two consecutive output samples, i.e. the
+/// number of channels of an interleaved output buffer.
+struct Kernels {
+	/// out[i] = (in[2i] + in[2i + 1]) * gain
+	void (*foldStereo)(float *out, const float *in, unsigned int frames, float gain);
+	/// out[i] += (in[2i] + in[2i + 1]) * gain
+	void (*addFoldedStereo)(float *out, const float *in, unsigned int frames, float gain);
+	/// out[i * stride] += in[i] * (gain + gainStep * i)
+	void (*addScaled)(float *out, unsigned int stride, const float *in, unsigned int frames, float gain,
+					  float gainStep);
+	/// out[i * stride] += (in[2i] * leftGain + in[2i + 1] * rightGain) * gain
+	void (*addPanned)(float *out, unsigned int stride, const float *in, unsigned int frames, float leftGain,
+					  float rightGain, float gain);
+	/// out[i * stride] += left[i], out[i * stride + 1] += right[i]
+	void (*addStereo)(float *out, unsigned int stride, const float *left, const float *right, unsigned int frames);
+	/// buffer[i] = clamp(buffer[i], -1, 1)
+	void (*clip)(float *buffer, unsigned int count);
+	/// out[i] = clamp(in[i] * 32768, -32768, 32767), rounded towards zero
+	void (*toShort)(short *out, const float *in, unsigned int count);
+	/// out[i] = (in[i * channels] + ... + in[i * channels + channels - 1]) * gain
+	void (*downmixFloat)(float *out, const float *in, unsigned int frames, unsigned int channels, float gain);
+	/// Same as downmixFloat, for 16 bit samples
+	void (*downmixShort)(float *out, const short *in, unsigned int frames, unsigned int channels, float gain);
+};
+
+/// @returns The instruction set the kernels run with on this CPU
+InstructionSet instructionSet();
+const char *instructionSetName(InstructionSet set);
+/// @returns The kernels implemented with the given instruction set, or nullptr if they have not been compiled in or
+/// this CPU does not support them
+const Kernels *kernels(InstructionSet set);
+/// @returns The kernels for instructionSet()
+const Kernels &active();
+
+inline void foldStereo(float *out, const float *in, unsigned int frames, float gain) {
+	active().foldStereo(out, in, frames, gain);
+}
+inline void addFoldedStereo(float *out, const float *in, unsigned int frames, float gain) {
+	active().addFoldedStereo(out, in, frames, gain);
+}
+inline void addScaled(float *out, unsigned int stride, const float *in, unsigned int frames, float gain,
+					  float gainStep = 0.0f) {
+	active().addScaled(out, stride, in, frames, gain, gainStep);
+}
+inline void addPanned(float *out, unsigned int stride, const float *in, unsigned int frames, float leftGain,
+					  float rightGain, float gain) {
+	active().addPanned(out, stride, in, frames, leftGain, rightGain, gain);
+}
+inline void addStereo(float *out, unsigned int stride, const float *left, const float *right, unsigned int frames) {
+	active().addStereo(out, stride, left, right, frames);
+}
+inline void clip(float *buffer, unsigned int count) {
+	active().clip(buffer, count);
+}
+inline void toShort(short *out, const float *in, unsigned int count) {
+	active().toShort(out, in, count);
+}
+inline void downmix(float *out, const float *in, unsigned int frames, unsigned int channels, float gain) {
+	active().downmixFloat(out, in, frames, channels, gain);
+}
+inline void downmix(float *out, const short *in, unsigned int frames, unsigned int channels, float gain) {
+	active().downmixShort(out, in, frames, channels, gain);
+}
+
+} // namespace AudioKernels
+
+#endif // MUMBLE_MUMBLE_AUDIOKERNELS_H_
@@ -5,23 +5,32 @@
 
 #include "AudioOutput.h"
 
+#include "AllocationTripwire.h"
 #include "AudioInput.h"
+#include "AudioKernels.h"
 #include "AudioOutputSample.h"
 #include "AudioOutputSpeech.h"
 #include "Channel.h"
 #include "ChannelListenerManager.h"
 #include "Log.h"
+#include "MainWindow.h"
 #include "PluginManager.h"
 #include "ServerHandler.h"
 #include "Timer.h"
 #include "User.h"
+#include "UserModel.h"
 #include "Utils.h"
 #include "VoiceRecorder.h"
 #include "Global.h"
 
+#include <QtCore/QStandardPaths>
+
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdio>
+#include <mutex>
+#include <thread>
 
 // Remember that we cannot use static member classes that are not pointers, as the constructor
 // for AudioOutputRegistrar() might be called before they are initialized, as the constructor
@@ -87,12 +96,46 @@ AudioOutput::AudioOutput() /* : envSources(5), envSourceBuffers(5) */ {
 	envManager.BeginSetup();
 	//freeEnv     = envManager.CreateEnvironment< BRTEnvironmentModel::CFreeFieldEnvironmentModel >("env");
 	envListener = envManager.CreateListenerModel< BRTListenerModel::CListenerHRTFModel> ("listenerModel");
+	ambisonicListener =
+		envManager.CreateListenerModel< BRTListenerModel::CListenerAmbisonicHRTFModel >("ambisonicListenerModel");
 	listener    = envManager.CreateListener< BRTBase::CListener >("listener");
 	//envListener->ConnectEnvironmentModel("env");
 	listener->ConnectListenerModel("listenerModel");
+	listener->ConnectListenerModel("ambisonicListenerModel");
 	envManager.EndSetup();
+	// Speakers start out with their own convolvers, see updateSpatialRendering()
+	ambisonicListener->DisableModel();
+	envListener->SetHRIRTolerance(Global::get().s.fHRIRTolerance);
 	newInstance = true;
 
+	// Speakers get their BRT sources from the pool when they start to talk and give them back when they stop or leave
+	sourcePool = std::make_unique< AudioOutputSourcePool >(
+		envManager,
+		std::vector< std::shared_ptr< BRTListenerModel::CListenerModelBase > >{ envListener, ambisonicListener },
+		BRTmutex);
+	// The listener has no HRTF yet, so setting its order does not build anything
+	requestedAmbisonicOrder = qBound(1, Global::get().s.iAmbisonicOrder, 3);
+	ambisonicListener->SetAmbisonicOrder(requestedAmbisonicOrder);
+	hrtfLoader = std::make_unique< HRTFLoader >(
+		HRTFRESAMPLINGSTEP, QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/HRTF"),
+		requestedAmbisonicOrder, ambisonicListener->GetAmbisonicNormalization());
+	if (Global::get().mw && Global::get().mw->pmModel) {
+		QObject::connect(Global::get().mw->pmModel, &UserModel::userRemoved, this, &AudioOutput::handleUserRemoved);
+	}
+
+	// Keep the render threads alive for the lifetime of the output so that mix() never has to spawn one.
+	// Leave two cores for the audio and GUI threads; the workers are only used on busy channels.
+	const unsigned int cores = std::thread::hardware_concurrency();
+	const int renderThreads =
+		cores > 2 ? static_cast< int >(std::min(cores - 2, static_cast< unsigned int >(BRTMAXRENDERTHREADS))) : 0;
+	envManager.SetRenderThreads(renderThreads, DEFAULT_MINIMUM_SOURCES_TO_FAN_OUT, BRTPINRENDERTHREADS);
+
+	// Room for a busy channel, so that mix() does not have to grow these in the common case
+	speakerSlots.reserve(32);
+	mixBuffers.reserve(64);
+	finishedBuffers.reserve(64);
+	recorderBufferPool.reserve(16);
+
 	//logFile = std::ofstream("speakerLog.txt");
 
 	//hrtf_loaded = std::make_shared< BRTServices::CHRTF >();
@@ -104,7 +147,9 @@ AudioOutput::~AudioOutput() {
 	wait();
 	wipe();
 
-	envListener->RemoveHRTF();
+	sourcePool->stop();
+	hrtfLoader->stop();
+	listener->RemoveHRTF();
 	hrtf_loaded.reset();
 	envManager.RemoveListener("listener");
 	globalParameters.SetSampleRate(DEFAULT_SAMPLE_RATE);
@@ -227,6 +272,9 @@ void AudioOutput::addFrameToBuffer(ClientUser *sender, const Mumble::Protocol::A
 
 		speech = new AudioOutputSpeech(sender, iMixerFreq, audioData.usedCodec, iBufferSize);
 		qmOutputs.replace(sender, speech);
+
+		// Binds one of the spare sources, so the speaker is spatialized from one of the next blocks on
+		sourcePool->requestSource(sender->uiSession);
 	}
 
 	speech->addFrameToBuffer(audioData);
@@ -238,6 +286,10 @@ void AudioOutput::handleInvalidatedBuffer(AudioOutputBuffer *buffer) {
 	QWriteLocker locker(&qrwlOutputs);
 	for (auto iter = qmOutputs.begin(); iter != qmOutputs.end(); ++iter) {
 		if (iter.value() == buffer) {
+			if (qobject_cast< AudioOutputSpeech * >(buffer)) {
+				// The speaker has stopped talking, so its source goes back to the spare ones
+				sourcePool->releaseSource(iter.key()->uiSession);
+			}
 			qmOutputs.erase(iter);
 			delete buffer;
 			break;
@@ -273,23 +325,282 @@ void AudioOutput::removeBuffer(AudioOutputBuffer *buffer) {
 	emit bufferInvalidated(buffer);
 }
 
-bool AudioOutput::setHRTF(std::string &newPath) {
-	std::shared_ptr< BRTServices::CHRTF > temp_hrtf_loaded = std::make_shared< BRTServices::CHRTF >();
-	bool result = sofaReader.ReadHRTFFromSofa(newPath, temp_hrtf_loaded, HRTFRESAMPLINGSTEP, BRTServices::TEXTRAPOLATION_METHOD::nearest_point);
+void AudioOutput::requestHRTF(const std::string &path) {
+	hrtfRequested = true;
+	hrtfPath      = path;
+	hrtfLoader->requestLoad(path);
+}
 
-	if (result) {
-		envListener->RemoveHRTF();
-		result &= envListener->SetHRTF(temp_hrtf_loaded);
-		if (!result)
-			envListener->SetHRTF(hrtf_loaded);
-		else
-			hrtf_loaded = temp_hrtf_loaded;
+unsigned int AudioOutput::configuredBinauralBlockSize() const {
+	const int blockSize = Global::get().s.iBinauralBlockSize;
+	return static_cast< unsigned int >(
+		qBound(BRTMINBLOCKSIZE, (blockSize > 0) ? blockSize : static_cast< int >(iFrameSize), BRTMAXBLOCKSIZE));
+}
+
+void AudioOutput::setBinauralBlockSize(unsigned int blockSize) {
+	binauralBlockSize = blockSize;
+	globalParameters.SetBufferSize(static_cast< int >(blockSize));
+	bufferProcessed.left  = CMonoBuffer< float >(blockSize);
+	bufferProcessed.right = CMonoBuffer< float >(blockSize);
+	binauralInput         = CMonoBuffer< float >(blockSize);
+
+	// The convolvers are set up for the new size with the next HRTF, rather than crossfading from the old one
+	envListener->ResetProcessorBuffers();
+	ambisonicListener->ResetProcessorBuffers();
+	if (!hrtfPath.empty()
+		&& (!hrtf_loaded || hrtf_loaded->GetHRIRPartitionedBufferSize() != static_cast< int >(blockSize))) {
+		requestHRTF(hrtfPath);
+	}
+
+	// Queued speech was meant for blocks of the old size
+	binauralFrameCount   = 0;
+	binauralSetupChanged = true;
+}
+
+void AudioOutput::resetBinauralFifos(unsigned int frameCount) {
+	binauralFrameCount    = frameCount;
+	binauralPendingFrames = 0;
+
+	// With blocks of N samples coming in and blocks of B samples rendered, up to B - gcd(N, B) samples of speech wait
+	// for the next block of the graph. Delaying the output by as much is enough for every block of the backend.
+	const unsigned int capacity = binauralBlockSize + frameCount;
+	binauralDelay.reset(binauralBlockSize);
+	const std::size_t delay = binauralDelay.serve(frameCount);
+	binauralLeft.reserve(capacity);
+	binauralRight.reserve(capacity);
+	binauralLeft.pushSilence(delay);
+	binauralRight.pushSilence(delay);
+	binauralOutput.left.resize(frameCount);
+	binauralOutput.right.resize(frameCount);
+
+	for (const std::unique_ptr< SpeakerSlot > &slot : speakerSlots) {
+		slot->queuedSource = nullptr;
+	}
+}
+
+void AudioOutput::adaptBinauralFifos(unsigned int frameCount) {
+	binauralFrameCount = frameCount;
+
+	// The output and the speech waiting for the graph always add up to the delay. The speech waiting is a multiple of
+	// the divisor common to B and every block size served since the reset, so mixing sizes may need a longer delay
+	// than any of them alone. Only grows the FIFOs if the blocks do.
+	const unsigned int capacity = binauralBlockSize + frameCount;
+	const std::size_t added     = binauralDelay.serve(frameCount);
+	binauralLeft.grow(capacity);
+	binauralRight.grow(capacity);
+	binauralLeft.pushSilence(added);
+	binauralRight.pushSilence(added);
+	if (binauralOutput.left.size() < frameCount) {
+		binauralOutput.left.resize(frameCount);
+		binauralOutput.right.resize(frameCount);
+	}
+
+	for (const std::unique_ptr< SpeakerSlot > &slot : speakerSlots) {
+		slot->pendingSpeech.grow(capacity);
+	}
+}
+
+void AudioOutput::renderBinaural(float *output, unsigned int frameCount, unsigned int nchan) {
+	// Every speaker with a source queues a block, silence if it is not talking, so that all queues hold the same
+	// stretch of time and one block of the graph takes the same samples from each of them
+	for (const std::unique_ptr< SpeakerSlot > &slot : speakerSlots) {
+		if (!slot->used || !slot->source) {
+			continue;
+		}
+		if (slot->queuedSource != slot->source) {
+			if (slot->pendingSpeech.capacity() < binauralBlockSize + frameCount) {
+				AllocationTripwire::Pause pause;
+				slot->pendingSpeech.reserve(binauralBlockSize + frameCount);
+			} else {
+				slot->pendingSpeech.clear();
+			}
+			slot->pendingSpeech.pushSilence(binauralPendingFrames);
+			slot->queuedSource   = slot->source;
+			binauralSetupChanged = true;
+		}
+		if (slot->speechQueued) {
+			slot->pendingSpeech.push(slot->monoBuffer.data(), frameCount);
+		} else {
+			slot->pendingSpeech.pushSilence(frameCount);
+		}
+		slot->speechQueued = false;
+	}
+	binauralPendingFrames += frameCount;
+
+	// An HRTF partitioned for another block size can not be used. Its replacement is on its way.
+	const bool hrtfReady =
+		hrtf_loaded && hrtf_loaded->GetHRIRPartitionedBufferSize() == static_cast< int >(binauralBlockSize);
+	while (binauralPendingFrames >= binauralBlockSize) {
+		for (const std::unique_ptr< SpeakerSlot > &slot : speakerSlots) {
+			if (slot->used && slot->source) {
+				slot->pendingSpeech.pop(binauralInput.data(), binauralBlockSize);
+				slot->source->SetBuffer(binauralInput);
+			}
+		}
+
+		if (hrtfReady) {
+			if (binauralSetupChanged) {
+				// The processors set up for what has changed, later blocks reuse their buffers
+				AllocationTripwire::Pause pause;
+				envManager.ProcessAll();
+				binauralSetupChanged = false;
+			} else {
+				envManager.ProcessAll();
+			}
+			listener->GetBuffers(bufferProcessed.left, bufferProcessed.right);
+			binauralLeft.push(bufferProcessed.left.data(), binauralBlockSize);
+			binauralRight.push(bufferProcessed.right.data(), binauralBlockSize);
+		} else {
+			binauralLeft.pushSilence(binauralBlockSize);
+			binauralRight.pushSilence(binauralBlockSize);
+		}
+		binauralPendingFrames -= binauralBlockSize;
+	}
+
+	binauralLeft.pop(binauralOutput.left.data(), frameCount);
+	binauralRight.pop(binauralOutput.right.data(), frameCount);
+	if (nchan >= 2) {
+		AudioKernels::addStereo(output, nchan, binauralOutput.left.data(), binauralOutput.right.data(), frameCount);
 	}
-	return result;
+}
+
+void AudioOutput::updateFrequencyDomainMixing(unsigned int frameCount) {
+	// The convolvers transform the block together with the end of the previous ones, up to twice the next power of
+	// two. What is left beyond twice the block is the room for delaying the output in the frequency domain.
+	const int blockSize = static_cast< int >(frameCount);
+	const int fftSize   = 2 * (Common::CalculateIsPowerOfTwo(blockSize) ? blockSize : Common::CalculateNextPowerOfTwo(blockSize));
+	const bool enable   = static_cast< unsigned int >(fftSize - 2 * blockSize) >= iMixerFreq * BRTMAXITDMS / 1000;
+
+	if (enable != envListener->IsFrequencyDomainMixingEnabled()) {
+		// Switching resets the convolution buffers of every source
+		AllocationTripwire::Pause pause;
+		if (enable) {
+			envListener->EnableFrequencyDomainMixing();
+		} else {
+			envListener->DisableFrequencyDomainMixing();
+		}
+		binauralSetupChanged = true;
+	}
+}
+
+void AudioOutput::updateRenderingTiers() {
+	const Settings &settings = Global::get().s;
+
+	tierRanking.clear();
+	if (tierRanking.capacity() < speakerSlots.size()) {
+		AllocationTripwire::Pause pause;
+		tierRanking.reserve(speakerSlots.size());
+	}
+
+	// Rank by the level at the listener. The distance is limited like the attenuation is, so that the speakers
+	// standing right next to the listener are not all ranked first regardless of their level.
+	const float minDistance = std::max(settings.fAudioMinDistance, 0.1f);
+	for (const std::unique_ptr< SpeakerSlot > &slot : speakerSlots) {
+		if (slot->used && slot->rendered && slot->source) {
+			slot->tierScore = slot->loudness / std::max(slot->distance, minDistance);
+			if (slot->renderingTier == BRTProcessing::TRenderingTier::Full) {
+				slot->tierScore *= BRTTIERHYSTERESIS * BRTTIERHYSTERESIS;
+			} else if (slot->renderingTier == BRTProcessing::TRenderingTier::Reduced) {
+				slot->tierScore *= BRTTIERHYSTERESIS;
+			}
+			tierRanking.push_back(slot.get());
+		}
+		slot->rendered = false;
+	}
+	std::sort(tierRanking.begin(), tierRanking.end(),
+			  [](const SpeakerSlot *lhs, const SpeakerSlot *rhs) { return lhs->tierScore > rhs->tierScore; });
+
+	const std::size_t fullSpeakers    = static_cast< std::size_t >(std::max(0, settings.iFullDetailSpeakers));
+	const std::size_t reducedSpeakers = static_cast< std::size_t >(std::max(0, settings.iReducedDetailSpeakers));
+	std::size_t rank                  = 0;
+	for (SpeakerSlot *slot : tierRanking) {
+		BRTProcessing::TRenderingTier tier;
+		if (!slot->audible) {
+			// Inaudible speakers do not take up any of the budget
+			tier = BRTProcessing::TRenderingTier::Culled;
+		} else {
+			if (rank < fullSpeakers) {
+				tier = BRTProcessing::TRenderingTier::Full;
+			} else if (rank < fullSpeakers + reducedSpeakers) {
+				tier = BRTProcessing::TRenderingTier::Reduced;
+			} else {
+				tier = BRTProcessing::TRenderingTier::Panning;
+			}
+			++rank;
+		}
+
+		if (tier != slot->renderingTier || slot->source != slot->tierSource) {
+			// The listener model looks up the processors of the source by its ID
+			AllocationTripwire::Pause pause;
+			envListener->SetSourceRenderingTier(slot->source->GetID(), tier);
+			slot->renderingTier  = tier;
+			slot->tierSource     = slot->source;
+			binauralSetupChanged = true;
+		}
+	}
+}
+
+void AudioOutput::updateSpatialRendering(std::size_t talkingSpeakers, unsigned int frameCount) {
+	const Settings &settings = Global::get().s;
+
+	const int order = qBound(1, settings.iAmbisonicOrder, 3);
+	if (order != requestedAmbisonicOrder) {
+		// The loader rebuilds the impulse responses of the current HRTF for the new order, which mix() switches to
+		// like to a new HRTF. Without an HRTF there is nothing to build and the listener takes the order right away.
+		AllocationTripwire::Pause pause;
+		requestedAmbisonicOrder = order;
+		hrtfLoader->requestAmbisonicOrder(order);
+		if (!hrtf_loaded) {
+			ambisonicListener->SetAmbisonicOrder(order);
+			binauralSetupChanged = true;
+		}
+	}
+
+	bool ambisonic = false;
+	switch (settings.srSpatialRendering) {
+		case Settings::SpatialRenderingPerSource:
+			break;
+		case Settings::SpatialRenderingAmbisonic:
+			ambisonic = true;
+			break;
+		case Settings::SpatialRenderingAutomatic:
+			if (talkingSpeakers > static_cast< std::size_t >(std::max(0, settings.iAmbisonicSpeakerThreshold))) {
+				ambisonicHoldSamples = 0;
+				ambisonic            = true;
+			} else if (ambisonicRendering) {
+				ambisonicHoldSamples += frameCount;
+				ambisonic = ambisonicHoldSamples < iMixerFreq * BRTAMBISONICHOLDMS / 1000;
+			}
+			break;
+	}
+
+	if (ambisonic == ambisonicRendering) {
+		return;
+	}
+
+	// The model taking over starts from clean convolution buffers, so that no stale tail is heard
+	AllocationTripwire::Pause pause;
+	if (ambisonic) {
+		envListener->DisableModel();
+		ambisonicListener->ResetProcessorBuffers();
+		ambisonicListener->EnableModel();
+	} else {
+		ambisonicListener->DisableModel();
+		envListener->ResetProcessorBuffers();
+		envListener->EnableModel();
+	}
+	ambisonicRendering   = ambisonic;
+	ambisonicHoldSamples = 0;
+	binauralSetupChanged = true;
 }
 
 void AudioOutput::removeUser(const ClientUser *user) {
 	removeBuffer(qmOutputs.value(user));
+	sourcePool->releaseSource(user->uiSession);
+}
+
+void AudioOutput::handleUserRemoved(unsigned int session) {
+	sourcePool->releaseSource(session);
 }
 
 void AudioOutput::removeToken(AudioOutputToken &token) {
@@ -455,20 +766,24 @@ void AudioOutput::initializeMixer(const unsigned int *chanmasks, bool forceheadp
 		Global::get().l->logOrDefer(Log::Warning, tr("Positional audio cannot work with mono output devices!"));
 	}
 	BRTmutex.lock();
-	if (globalParameters.GetSampleRate() != iMixerFreq) {
+	const bool sampleRateChanged = globalParameters.GetSampleRate() != iMixerFreq;
+	if (sampleRateChanged) {
 		globalParameters.SetSampleRate(iMixerFreq);
-		globalParameters.SetBufferSize(iFrameSize);
-
+	}
+	// Before the HRTF is requested, so that it is partitioned for the blocks of the graph right away. mix() never
+	// changes it, whatever block sizes the backend asks for.
+	if (configuredBinauralBlockSize() != binauralBlockSize) {
+		setBinauralBlockSize(configuredBinauralBlockSize());
+	}
+	if (sampleRateChanged) {
 		// for (int i = 0; i < envSourceBuffers.size(); i++) {
 		//	envSourceBuffers[i] = CMonoBuffer< float >(iFrameSize);
 		// }
-		bufferProcessed.left  = CMonoBuffer< float >(iFrameSize);
-		bufferProcessed.right = CMonoBuffer< float >(iFrameSize);
 		listenerRotationQuat  = { 0, 0, 0, 0 };
 
 		std::string sofa_path = "./3DTI_HRTF_IRC1008_256s_48000Hz.sofa";
 
-		setHRTF(sofa_path);
+		requestHRTF(sofa_path);
 	} else {
 		if (!initialized) {
 
@@ -488,10 +803,10 @@ void AudioOutput::initializeMixer(const unsigned int *chanmasks, bool forceheadp
 
 		}
 	}
-	if (envListener->GetHRTF()->GetFilename() == "") {
+	if (!hrtfRequested) {
 		std::string sofa_path = "./3DTI_HRTF_IRC1008_256s_48000Hz.sofa";
 
-		setHRTF(sofa_path);
+		requestHRTF(sofa_path);
 	}
 	BRTmutex.unlock();
 	/*} else {
@@ -509,24 +824,110 @@ void AudioOutput::initializeMixer(const unsigned int *chanmasks, bool forceheadp
 	for (std::vector< float > &columns : a)
 		columns = std::vector< float >(3);
 
+	// The graph is configured now, so spare sources can be wired. Speakers are bound as they start to talk.
+	sourcePool->start();
+
 }
 
-bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
+AudioOutput::SpeakerSlot *AudioOutput::findSpeakerSlot(unsigned int session) {
+	// A linear scan over a handful of slots is cheaper than hashing and never allocates
+	for (const std::unique_ptr< SpeakerSlot > &slot : speakerSlots) {
+		if (slot->used && slot->session == session) {
+			return slot.get();
+		}
+	}
+	return nullptr;
+}
+
+AudioOutput::SpeakerSlot *AudioOutput::createSpeakerSlot(unsigned int session, unsigned int frameCount) {
+	SpeakerSlot *slot = nullptr;
+	for (const std::unique_ptr< SpeakerSlot > &candidate : speakerSlots) {
+		if (!candidate->used) {
+			slot = candidate.get();
+			break;
+		}
+	}
+	if (!slot) {
+		speakerSlots.push_back(std::make_unique< SpeakerSlot >());
+		slot = speakerSlots.back().get();
+	}
+
+	slot->used     = true;
+	slot->session  = session;
+	slot->position = { 0, 0.0001f, 0 };
+	slot->source   = nullptr;
+	slot->monoBuffer.assign(frameCount, 0.0f);
+	slot->renderingTier = BRTProcessing::TRenderingTier::Full;
+	slot->tierSource    = nullptr;
+	slot->loudness      = 0.0f;
+	slot->rendered      = false;
 #ifdef USE_MANUAL_PLUGIN
-	positions.clear();
-	//instead of clear, fetch poisiton data from plugin?
+	slot->placed = false;
 #endif
 
-	// A list of buffers that have audio to contribute
-	QList< AudioOutputBuffer * > qlMix;
-	// A list of buffers that no longer have any audio to play and can thus be deleted
-	QList< AudioOutputBuffer * > qlDel;
+	return slot;
+}
+
+void AudioOutput::releaseSpeakerSlot(SpeakerSlot *slot) {
+	// Keep the storage of the buffers for the next speaker that gets this slot
+	slot->used         = false;
+	slot->source       = nullptr;
+	slot->speechQueued = false;
+	slot->queuedSource = nullptr;
+}
+
+void AudioOutput::updateSpeakerLevel(SpeakerSlot *slot, float distance, bool audible, unsigned int frameCount) {
+	float energy = 0.0f;
+	for (unsigned int i = 0; i < frameCount; ++i) {
+		energy += slot->monoBuffer[i] * slot->monoBuffer[i];
+	}
+	const float rms = std::sqrt(energy / static_cast< float >(std::max(frameCount, 1u)));
+
+	// One-pole smoothing, so that the gaps between words do not demote a speaker
+	const float smoothing = 1.0f
+							- std::exp(-static_cast< float >(frameCount) * 1000.0f
+									   / (BRTLOUDNESSSMOOTHINGMS * static_cast< float >(iMixerFreq)));
+	slot->loudness += smoothing * (rms - slot->loudness);
+	slot->distance = distance;
+	slot->audible  = audible;
+	slot->rendered = true;
+}
+
+boost::shared_array< float > AudioOutput::acquireRecorderBuffer(unsigned int frameCount) {
+	if (frameCount > recorderBufferFrames) {
+		// Buffers still queued in the recorder stay alive through their own references
+		AllocationTripwire::Pause pause;
+		recorderBufferPool.clear();
+		recorderBufferFrames = frameCount;
+	}
+
+	for (const boost::shared_array< float > &buffer : recorderBufferPool) {
+		// Only the pool holds a reference, so the recorder is done with this buffer
+		if (buffer.use_count() == 1) {
+			memset(buffer.get(), 0, sizeof(float) * frameCount);
+			return buffer;
+		}
+	}
+
+	AllocationTripwire::Pause pause;
+	recorderBufferPool.push_back(boost::shared_array< float >(new float[recorderBufferFrames]));
+	memset(recorderBufferPool.back().get(), 0, sizeof(float) * frameCount);
+	return recorderBufferPool.back();
+}
+
+bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
+	mixBuffers.clear();
+	finishedBuffers.clear();
 
 	if (Global::get().s.fVolume < 0.01f) {
+		sourcePool->endBlock();
 		return false;
 	}
 
-	BRTmutex.lock();
+	// The source pool only changes the graph right after endBlock(), one source at a time, so the lock is free by the
+	// time the next block starts. Should the pool still be at it, the block waits rather than dropping the speech of
+	// the spatialized speakers.
+	std::unique_lock< std::mutex > graphLock(BRTmutex);
 
 	const float adjustFactor = std::pow(10.f, -18.f / 20);
 	const float mul          = Global::get().s.fVolume;
@@ -539,39 +940,99 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 
 	qrwlOutputs.lockForRead();
 
+	// From here on the mixer, including the decoding of speech and the BRT graph, must not touch the heap once the set
+	// of speakers and the block size are stable. Setting up what is new or has grown is paused explicitly. The plugins,
+	// the voice recorder and sound files still allocate and are paused as well, so the tripwire does not cover them.
+	AllocationTripwire::Scope tripwire;
+
+	if (mixBuffers.capacity() < static_cast< std::size_t >(qmOutputs.size())) {
+		AllocationTripwire::Pause pause;
+		mixBuffers.reserve(2 * static_cast< std::size_t >(qmOutputs.size()));
+		finishedBuffers.reserve(2 * static_cast< std::size_t >(qmOutputs.size()));
+	}
+
+	// Free the slots of speakers whose source has been released by the pool since the last block
+	for (const std::unique_ptr< SpeakerSlot > &slot : speakerSlots) {
+		if (slot->used && slot->source && !sourcePool->findSource(slot->session)) {
+			releaseSpeakerSlot(slot.get());
+		}
+	}
+
+	// Switch to an HRTF the loader has finished in the background, together with the ambisonic impulse responses it
+	// has built from it. The convolvers crossfade into them over the next blocks and the loader frees the replaced
+	// ones, so none of the expensive work happens here.
+	HRTFLoader::Result loaded = hrtfLoader->takeLoaded();
+	if (loaded.hrtf) {
+		// Only pointers change hands, unless the impulse responses come with another order for the ambisonic encoders
+		AllocationTripwire::Pause pause;
+		binauralSetupChanged = true;
+		// The impulse responses may have been rebuilt for another order of the HRTF already set
+		const bool newHRTF = loaded.hrtf != hrtf_loaded;
+		HRTFLoader::Result replaced{ nullptr, ambisonicListener->GetAmbisonicIR() };
+		if (ambisonicListener->SetHRTF(loaded.hrtf, loaded.ambisonicIR)) {
+			if (newHRTF) {
+				envListener->SetHRTF(loaded.hrtf);
+				replaced.hrtf = std::move(hrtf_loaded);
+				hrtf_loaded   = std::move(loaded.hrtf);
+			}
+			hrtfLoader->retire(std::move(replaced));
+		} else {
+			qWarning("AudioOutput: The loaded HRTF does not match the output sample rate");
+			if (!newHRTF) {
+				loaded.hrtf.reset();
+			}
+			hrtfLoader->retire(std::move(loaded));
+		}
+	}
+
 	bool prioritySpeakerActive = false;
 
+#ifdef USE_MANUAL_PLUGIN
+	// Latest state published by the Manual plugin. It stays unchanged for the whole block, whatever the GUI thread
+	// does in the meantime.
+	const bool manualParametersChanged       = Manual::parameters.update();
+	const ManualParameters &manualParameters = Manual::parameters.front();
+#endif
+
 	// Get the users that are currently talking (and are thus serving as an audio source)
 	QMultiHash< const ClientUser *, AudioOutputBuffer * >::const_iterator it = qmOutputs.constBegin();
 	while (it != qmOutputs.constEnd()) {
 		AudioOutputBuffer *buffer = it.value();
-		if (!buffer->prepareSampleBuffer(frameCount)) {
-			qlDel.append(buffer);
+		bool hasAudio;
+		if (qobject_cast< AudioOutputSpeech * >(buffer)) {
+			// Decoding reuses its buffers and only pauses the tripwire where they grow
+			hasAudio = buffer->prepareSampleBuffer(frameCount);
+		} else {
+			// Sound files are read from disk as they are played
+			AllocationTripwire::Pause pause;
+			hasAudio = buffer->prepareSampleBuffer(frameCount);
+		}
+		if (!hasAudio) {
+			finishedBuffers.push_back(buffer);
 		} else {
 			AudioOutputSpeech *speech = qobject_cast< AudioOutputSpeech * >(buffer);
 			if (speech) {
 				//printf("\n %d", it.key()->iId);
 #ifdef USE_MANUAL_PLUGIN
-				if (!userPos.contains(it.key()->uiSession)) {
-					userPos.insert(it.key()->uiSession, { 0, 0.0001, 0 });
-					userBuffer.insert(it.key()->uiSession, CMonoBuffer< float >(frameCount));
-					
-					envManager.BeginSetup();
-					envSources.insert(it.key()->uiSession,
-									  envManager.CreateSoundSource< BRTSourceModel::CSourceSimpleModel >(
-										  (std::string("caller") + std::to_string(it.key()->uiSession))));
-					envListener->ConnectSoundSource(envSources[it.key()->uiSession]);
-					envManager.EndSetup();
+				SpeakerSlot *slot = findSpeakerSlot(it.key()->uiSession);
+				if (!slot) {
+					AllocationTripwire::Pause pause;
+					slot = createSpeakerSlot(it.key()->uiSession, frameCount);
 				}
+				// Null until the pool has handed over a wired source, in which case the speaker is skipped
+				slot->source = sourcePool->findSource(it.key()->uiSession);
 				if (ClientUser::c_qmUsers.contains(it.key()->uiSession)) {
-					const ClientUser *user = it.key();
-					Manual::spatializeSpeakers(it.key()->uiSession, (float *) userPos[it.key()->uiSession]);
-					Position3D newPos = userPos.value(it.key()->uiSession);
-					buffer->fPos[0]   = newPos.x;
-					buffer->fPos[1]   = newPos.y;
-					buffer->fPos[2]   = newPos.z;
-					userBuffer[user->uiSession].resize(frameCount);
-
+					if (const Position3D *position = manualParameters.findPosition(it.key()->uiSession)) {
+						slot->position = *position;
+						slot->placed   = true;
+					}
+					buffer->fPos[0] = slot->position.x;
+					buffer->fPos[1] = slot->position.y;
+					buffer->fPos[2] = slot->position.z;
+					if (slot->monoBuffer.size() != frameCount) {
+						AllocationTripwire::Pause pause;
+						slot->monoBuffer.resize(frameCount);
+					}
 				}
 
 				//logFile << "\n" << it.key()->qsName.toStdString().c_str();
@@ -586,7 +1047,7 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 				//}
 #endif
 			}
-			qlMix.append(buffer);
+			mixBuffers.push_back(buffer);
 
 			const ClientUser *user = it.key();
 			if (user && user->bPrioritySpeaker) {
@@ -597,31 +1058,28 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 	}
 
 #ifdef USE_MANUAL_PLUGIN
-	Manual::bufferLock.lock();
-	if (Manual::bufferToBeDeleted.size() > 0) {
-		for (int i = 0; i < Manual::bufferToBeDeleted.size(); i++) {
-			userPos.remove(Manual::bufferToBeDeleted[i]);
-			userBuffer.remove(Manual::bufferToBeDeleted[i]);
-			if (envSources[Manual::bufferToBeDeleted[i]]) {
-				envManager.BeginSetup();
-				envListener->DisconnectSoundSource(envSources[Manual::bufferToBeDeleted[i]]);
-				envManager.RemoveSoundSource(envSources[Manual::bufferToBeDeleted[i]]->GetID());
-				envManager.EndSetup();
-				envSources.remove(Manual::bufferToBeDeleted[i]);
+	if (manualParametersChanged) {
+		// Speakers the plugin has removed since the last snapshot
+		for (const std::unique_ptr< SpeakerSlot > &slot : speakerSlots) {
+			if (slot->used && slot->placed && !manualParameters.findPosition(slot->session)) {
+				releaseSpeakerSlot(slot.get());
 			}
 		}
-		Manual::bufferToBeDeleted.clear();
 	}
-	if (Manual::hrtfChanged) {
-		setHRTF(Manual::hrtfPath.toStdString());
-		Manual::hrtfChanged = false;
+	if (manualParameters.hrtfGeneration != manualHRTFGeneration) {
+		manualHRTFGeneration = manualParameters.hrtfGeneration;
+		if (!manualParameters.hrtfPath.empty()) {
+			AllocationTripwire::Pause pause;
+			requestHRTF(manualParameters.hrtfPath);
+		}
 	}
-	if (Manual::isMono && envListener->IsSpatializationEnabled()) {
+	if (manualParameters.isMono && envListener->IsSpatializationEnabled()) {
 		envListener->DisableSpatialization();
-	} else if (!Manual::isMono && !envListener->IsSpatializationEnabled()) {
+		binauralSetupChanged = true;
+	} else if (!manualParameters.isMono && !envListener->IsSpatializationEnabled()) {
 		envListener->EnableSpatialization();
+		binauralSetupChanged = true;
 	}
-	Manual::bufferLock.unlock();
 #endif
 
 	if (Global::get().prioritySpeakerActiveOverride) {
@@ -631,6 +1089,10 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 	// If the audio backend uses a float-array we can sample and mix the audio sources directly into the output.
 	// Otherwise we'll have to use an intermediate buffer which we will convert to an array of shorts later
 	static std::vector< float > fOutput;
+	if (fOutput.capacity() < iChannels * frameCount) {
+		AllocationTripwire::Pause pause;
+		fOutput.reserve(iChannels * frameCount);
+	}
 	fOutput.resize(iChannels * frameCount);
 	float *output = (eSampleFormat == SampleFloat) ? reinterpret_cast< float * >(outbuff) : fOutput.data();
 	memset(output, 0, sizeof(float) * frameCount * iChannels);
@@ -646,20 +1108,35 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 	//	}
 	//}
 
-	globalParameters.SetBufferSize(frameCount);
+	// The block size of the graph stays what initializeMixer() has set, the FIFOs adapt the blocks of the backend
+	// to it. Changing it here would reset the convolvers and reload the HRTF whenever the backend varies its blocks.
+	if (binauralFrameCount == 0) {
+		// Only allocates when the blocks grow
+		AllocationTripwire::Pause pause;
+		resetBinauralFifos(frameCount);
+	} else if (frameCount != binauralFrameCount) {
+		// Only allocates when the blocks grow
+		AllocationTripwire::Pause pause;
+		adaptBinauralFifos(frameCount);
+	}
+	updateFrequencyDomainMixing(binauralBlockSize);
+	updateSpatialRendering(mixBuffers.size(), frameCount);
 
 	//for (int i = 0; i < envSourceBuffers.size(); i++) {
 	//	envSourceBuffers[i].resize(frameCount);
 	//}
-	bufferProcessed.left.resize(frameCount);
-	bufferProcessed.right.resize(frameCount);
 	//////////////////////////////////////////
 
-	if (!qlMix.isEmpty() && !newInstance) {
+	if (!mixBuffers.empty() && !newInstance) {
 		// There are audio sources available -> mix those sources together and feed them into the audio backend
 		static std::vector< float > speaker;
-		speaker.resize(iChannels * 3);
 		static std::vector< float > svol;
+		if (svol.capacity() < iChannels) {
+			AllocationTripwire::Pause pause;
+			speaker.reserve(iChannels * 3);
+			svol.reserve(iChannels);
+		}
+		speaker.resize(iChannels * 3);
 		svol.resize(iChannels);
 
 		bool validListener = false;
@@ -667,15 +1144,21 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 		// Initialize recorder if recording is enabled
 		boost::shared_array< float > recbuff;
 		if (recorder) {
-			recbuff = boost::shared_array< float >(new float[frameCount]);
-			memset(recbuff.get(), 0, sizeof(float) * frameCount);
+			recbuff = acquireRecorderBuffer(frameCount);
 			recorder->prepareBufferAdds();
 		}
 
 		for (unsigned int i = 0; i < iChannels; ++i)
 			svol[i] = mul * fSpeakerVolume[i];
 
-		if (Global::get().s.bPositionalAudio && (iChannels > 1) && Global::get().pluginManager->fetchPositionalData()) {
+		bool positionalDataAvailable = false;
+		if (Global::get().s.bPositionalAudio && (iChannels > 1)) {
+			// Plugins are outside of the mixer's control
+			AllocationTripwire::Pause pause;
+			positionalDataAvailable = Global::get().pluginManager->fetchPositionalData();
+		}
+
+		if (positionalDataAvailable) {
 			// Calculate the positional audio effects if it is enabled
 
 			Vector3D cameraDir = Global::get().pluginManager->getPositionalData().getCameraDir();
@@ -790,7 +1273,7 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 		//for (CMonoBuffer< float > &sourceBuffer : envSourceBuffers)
 		//	sourceBuffer.ApplyGain(0);
 		int nBuffer = 0;
-		for (AudioOutputBuffer *buffer : qlMix) {
+		for (AudioOutputBuffer *buffer : mixBuffers) {
 			// Iterate through all audio sources and mix them together into the output (or the intermediate array)
 			float *RESTRICT pfBuffer = buffer->pfBuffer;
 			float volumeAdjustment   = 1;
@@ -836,8 +1319,11 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 			const int channels = (speech && speech->bStereo) ? 2 : 1;
 			// If user != nullptr, then the current audio is considered speech
 			assert(channels >= 0);
-			emit audioSourceFetched(pfBuffer, frameCount, static_cast< unsigned int >(channels), SAMPLE_RATE,
-									static_cast< bool >(user), user);
+			{
+				AllocationTripwire::Pause pause;
+				emit audioSourceFetched(pfBuffer, frameCount, static_cast< unsigned int >(channels), SAMPLE_RATE,
+										static_cast< bool >(user), user);
+			}
 
 			// If recording is enabled add the current audio source to the recording buffer
 			if (recorder) {
@@ -845,19 +1331,18 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 					if (speech->bStereo) {
 						// Mix down stereo to mono. TODO: stereo record support
 						// frame: for a stereo stream, the [LR] pair inside ...[LR]LRLRLR.... is a frame
-						for (unsigned int i = 0; i < frameCount; ++i) {
-							recbuff[i] += (pfBuffer[2 * i] / 2.0f + pfBuffer[2 * i + 1] / 2.0f) * volumeAdjustment;
-						}
+						AudioKernels::addFoldedStereo(recbuff.get(), pfBuffer, frameCount, volumeAdjustment / 2.0f);
 					} else {
-						for (unsigned int i = 0; i < frameCount; ++i) {
-							recbuff[i] += pfBuffer[i] * volumeAdjustment;
-						}
+						AudioKernels::addScaled(recbuff.get(), 1, pfBuffer, frameCount, volumeAdjustment);
 					}
 
 					if (!recorder->isInMixDownMode()) {
-						recorder->addBuffer(speech->p, recbuff, static_cast< int >(frameCount));
-						recbuff = boost::shared_array< float >(new float[frameCount]);
-						memset(recbuff.get(), 0, sizeof(float) * frameCount);
+						{
+							// The recorder queues the buffer in its own containers
+							AllocationTripwire::Pause pause;
+							recorder->addBuffer(speech->p, recbuff, static_cast< int >(frameCount));
+						}
+						recbuff = acquireRecorderBuffer(frameCount);
 					}
 
 					// Don't add the local audio to the real output
@@ -872,31 +1357,38 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 #ifdef USE_MANUAL_PLUGIN
 				if (user) {
 					// The coordinates in the plane are actually given by x and z instead of x and y (y is up)
-					positions.insert(user->uiSession, { buffer->fPos[0], buffer->fPos[2] });
+					if (SpeakerSlot *slot = findSpeakerSlot(user->uiSession)) {
+						slot->planePosition = { buffer->fPos[0], buffer->fPos[2] };
+					}
 				}
 #endif
 
-				if (speech) {
-					unsigned int userId = speech->p->uiSession;
+				SpeakerSlot *slot = speech ? findSpeakerSlot(speech->p->uiSession) : nullptr;
+				if (slot && slot->source) {
+					CMonoBuffer< float > &monoBuffer = slot->monoBuffer;
 					if (buffer->bStereo) {
 						// Linear-panning stereo stream according to the projection of fSpeaker vector on left-right
 						// direction.
 						// frame: for a stereo stream, the [LR] pair inside ...[LR]LRLRLR.... is a frame
-						for (unsigned int i = 0; i < frameCount; ++i)
-							//envSourceBuffers[j][i] = (pfBuffer[2 * i] + pfBuffer[2 * i + 1]);
-							userBuffer[userId][i] = (pfBuffer[2 * i] + pfBuffer[2 * i + 1]);
+						AudioKernels::foldStereo(monoBuffer.data(), pfBuffer, frameCount, 1.0f);
 					} else {
-						for (unsigned int i = 0; i < frameCount; ++i)
-							//envSourceBuffers[j][i] = pfBuffer[i]; // change later
-							userBuffer[userId][i] = pfBuffer[i];
+						std::copy(pfBuffer, pfBuffer + frameCount, monoBuffer.begin());
 					}
 
 					tempTransform.SetPosition(Common::CVector3(buffer->fPos[2], -buffer->fPos[0], buffer->fPos[1]));
-					envSources[userId]->SetSourceTransform(tempTransform);
+					slot->source->SetSourceTransform(tempTransform);
 					//envSources[j]->SetBuffer(envSourceBuffers[j]);
-					envSources[userId]->SetBuffer(userBuffer[userId]);
+					slot->speechQueued = true;
 					j++;
 
+					// Same audibility rule as for the speakers mixed without BRT below
+					const Position3D outputPos = { buffer->fPos[0], buffer->fPos[1], buffer->fPos[2] };
+					const float len =
+						(outputPos - Global::get().pluginManager->getPositionalData().getCameraPos()).norm();
+					const bool isAudible =
+						(Global::get().s.fAudioMaxDistVolume > 0) || (len < Global::get().s.fAudioMaxDistance);
+					updateSpeakerLevel(slot, len, isAudible, frameCount);
+
 
 				} else {
 					// If positional audio is enabled, calculate the respective audio effect here
@@ -917,12 +1409,15 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 									qWarning("Voice dir: %f %f %f", connectionVec.x, connectionVec.y, connectionVec.z);
 					*/
 					if (!buffer->pfVolume) {
+						// Once per buffer, on its first positional block
+						AllocationTripwire::Pause pause;
 						buffer->pfVolume = new float[nchan];
 						for (unsigned int s = 0; s < nchan; ++s)
 							buffer->pfVolume[s] = -1.0;
 					}
 
 					if (!buffer->piOffset) {
+						AllocationTripwire::Pause pause;
 						buffer->piOffset = std::make_unique< unsigned int[] >(nchan);
 						for (unsigned int s = 0; s < nchan; ++s) {
 							buffer->piOffset[s] = 0;
@@ -975,17 +1470,22 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 						   speaker[s*3+0], speaker[s*3+1], speaker[s*3+2], dot, len, channelVol);
 						*/
 						if ((old >= 0.00000001f) || (channelVol >= 0.00000001f)) {
-							for (unsigned int i = 0; i < frameCount; ++i) {
-								unsigned int currentOffset = static_cast< unsigned int >(
-									static_cast< float >(oldOffset) + incOffset * static_cast< float >(i));
-								if (speech && speech->bStereo) {
-									// Mix stereo user's stream into mono
-									// frame: for a stereo stream, the [LR] pair inside ...[LR]LRLRLR.... is a frame
-									o[i * nchan] += (pfBuffer[2 * i + currentOffset] / 2.0f
-													 + pfBuffer[2 * i + currentOffset + 1] / 2.0f)
-													* (old + inc * static_cast< float >(i));
-								} else {
-									o[i * nchan] += pfBuffer[i + currentOffset] * (old + inc * static_cast< float >(i));
+							if (offset == oldOffset && !(speech && speech->bStereo)) {
+								// A mono stream whose offset stays the same is mixed in one go
+								AudioKernels::addScaled(o, nchan, pfBuffer + offset, frameCount, old, inc);
+							} else {
+								for (unsigned int i = 0; i < frameCount; ++i) {
+									unsigned int currentOffset = static_cast< unsigned int >(
+										static_cast< float >(oldOffset) + incOffset * static_cast< float >(i));
+									if (speech && speech->bStereo) {
+										// Mix stereo user's stream into mono
+										// frame: for a stereo stream, the [LR] pair inside ...[LR]LRLRLR.... is a frame
+										o[i * nchan] += (pfBuffer[2 * i + currentOffset] / 2.0f
+														 + pfBuffer[2 * i + currentOffset + 1] / 2.0f)
+														* (old + inc * static_cast< float >(i));
+									} else {
+										o[i * nchan] += pfBuffer[i + currentOffset] * (old + inc * static_cast< float >(i));
+									}
 								}
 							}
 						}
@@ -994,25 +1494,23 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 			} else {
 
 
-				if (speech) {
-					unsigned int userId = speech->p->uiSession;
+				SpeakerSlot *slot = speech ? findSpeakerSlot(speech->p->uiSession) : nullptr;
+				if (slot && slot->source) {
+					CMonoBuffer< float > &monoBuffer = slot->monoBuffer;
 					if (buffer->bStereo) {
 						// Linear-panning stereo stream according to the projection of fSpeaker vector on left-right
 						// direction.
 						// frame: for a stereo stream, the [LR] pair inside ...[LR]LRLRLR.... is a frame
-						for (unsigned int i = 0; i < frameCount; ++i)
-							userBuffer[userId][i] = (pfBuffer[2 * i] + pfBuffer[2 * i + 1]);
-							//envSourceBuffers[j][i] = (pfBuffer[2 * i] + pfBuffer[2 * i + 1]);
+						AudioKernels::foldStereo(monoBuffer.data(), pfBuffer, frameCount, 1.0f);
 					} else {
-						for (unsigned int i = 0; i < frameCount; ++i)
-							userBuffer[userId][i] = pfBuffer[i]; // change later
-							//envSourceBuffers[j][i] = pfBuffer[i]; //change later
+						std::copy(pfBuffer, pfBuffer + frameCount, monoBuffer.begin());
 					}
 					tempTransform.SetPosition(Common::CVector3(0, 0, 0));
-					envSources[userId]->SetSourceTransform(tempTransform);
+					slot->source->SetSourceTransform(tempTransform);
 					//envSources[j]->SetBuffer(envSourceBuffers[j]);
-					envSources[userId]->SetBuffer(userBuffer[userId]);
+					slot->speechQueued = true;
 					j++;
+					updateSpeakerLevel(slot, 0.0f, true, frameCount);
 				
 				} else {
 
@@ -1026,13 +1524,10 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 							// Linear-panning stereo stream according to the projection of fSpeaker vector on left-right
 							// direction.
 							// frame: for a stereo stream, the [LR] pair inside ...[LR]LRLRLR.... is a frame
-							for (unsigned int i = 0; i < frameCount; ++i)
-								o[i * nchan] += (pfBuffer[2 * i] * fStereoPanningFactor[2 * s + 0]
-												 + pfBuffer[2 * i + 1] * fStereoPanningFactor[2 * s + 1])
-												* channelVol;
+							AudioKernels::addPanned(o, nchan, pfBuffer, frameCount, fStereoPanningFactor[2 * s + 0],
+													fStereoPanningFactor[2 * s + 1], channelVol);
 						} else {
-							for (unsigned int i = 0; i < frameCount; ++i)
-								o[i * nchan] += pfBuffer[i] * channelVol;
+							AudioKernels::addScaled(o, nchan, pfBuffer, frameCount, channelVol);
 						}
 					}
 				
@@ -1055,45 +1550,46 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 			Position3D ownPos = Global::get().pluginManager->getPositionalData().getCameraPos();
 			tempTransform.SetPosition(Common::CVector3(ownPos.z, -ownPos.x, ownPos.y));
 			listener->SetListenerTransform(tempTransform);
-		
+	
 		}
 
-		envManager.ProcessAll();
-		listener->GetBuffers(bufferProcessed.left, bufferProcessed.right);
-		float *RESTRICT o = output;
-		if (nchan >= 2) {
-			for (unsigned int i = 0; i < frameCount; ++i) {
-				o[i * nchan]       += bufferProcessed.left[i];
-				o[(i * nchan) + 1] += bufferProcessed.right[i];
-			}
-		}
+		updateRenderingTiers();
+		renderBinaural(output, frameCount, nchan);
 
 		if (recorder && recorder->isInMixDownMode()) {
+			AllocationTripwire::Pause pause;
 			recorder->addBuffer(nullptr, recbuff, static_cast< int >(frameCount));
 		}
+	} else {
+		// The graph is not run while nobody talks. What is still queued would only be heard once someone talks again.
+		resetBinauralFifos(frameCount);
 	}
 
 	bool pluginModifiedAudio = false;
-	emit audioOutputAboutToPlay(output, frameCount, nchan, SAMPLE_RATE, &pluginModifiedAudio);
+	{
+		AllocationTripwire::Pause pause;
+		emit audioOutputAboutToPlay(output, frameCount, nchan, SAMPLE_RATE, &pluginModifiedAudio);
+	}
 
-	if (pluginModifiedAudio || (!qlMix.isEmpty())) {
+	if (pluginModifiedAudio || (!mixBuffers.empty())) {
 		// Clip the output audio
 		if (eSampleFormat == SampleFloat)
-			for (unsigned int i = 0; i < frameCount * iChannels; i++)
-				output[i] = qBound(-1.0f, output[i], 1.0f);
+			AudioKernels::clip(output, frameCount * iChannels);
 		else
 			// Also convert the intermediate float array into an array of shorts before writing it to the outbuff
-			for (unsigned int i = 0; i < frameCount * iChannels; i++)
-				reinterpret_cast< short * >(outbuff)[i] =
-					static_cast< short >(qBound(-32768.f, (output[i] * 32768.f), 32767.f));
+			AudioKernels::toShort(reinterpret_cast< short * >(outbuff), output, frameCount * iChannels);
 	}
 	if (newInstance)
 		newInstance = false;
 	qrwlOutputs.unlock();
-	BRTmutex.unlock();
-	// Delete all AudioOutputBuffer that no longer provide any new audio
-	for (AudioOutputBuffer *buffer : qlDel) {
-		removeBuffer(buffer);
+	graphLock.unlock();
+	sourcePool->endBlock();
+	{
+		// Delete all AudioOutputBuffer that no longer provide any new audio
+		AllocationTripwire::Pause pause;
+		for (AudioOutputBuffer *buffer : finishedBuffers) {
+			removeBuffer(buffer);
+		}
 	}
 
 #ifdef USE_MANUAL_PLUGIN
@@ -1101,7 +1597,7 @@ bool AudioOutput::mix(void *outbuff, unsigned int frameCount) {
 #endif
 
 	// Return whether data has been written to the outbuff
-	return (pluginModifiedAudio || (!qlMix.isEmpty()));
+	return (pluginModifiedAudio || (!mixBuffers.empty()));
 }
 
 bool AudioOutput::isAlive() const {
@@ -8,10 +8,17 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QThread>
+#include <boost/shared_array.hpp>
 #include <boost/shared_ptr.hpp>
 #include "BRTLibrary.h"
 
+#include <memory>
+#include <vector>
+
+#include "AudioOutputSourcePool.h"
+#include "HRTFLoader.h"
 #include "MumbleProtocol.h"
+#include "SampleFifo.h"
 
 #ifdef USE_MANUAL_PLUGIN
 #	include "ManualPlugin.h"
@@ -83,13 +90,105 @@ private:
 	void removeBuffer(AudioOutputBuffer *);
 
 	#define HRTFRESAMPLINGSTEP 15
-	bool AudioOutput::setHRTF(std::string &newPath);
+	/// Upper bound for the BRT render threads spawned next to the audio thread.
+	#define BRTMAXRENDERTHREADS 7
+	/// Whether each BRT render thread is pinned to a core of its own. Off, because the cores are picked without
+	/// regard for the audio thread, which is not pinned, nor for the other programs running next to Mumble: a worker
+	/// stuck on a core busy with a game would hold up every block, where the scheduler would have moved it.
+	#define BRTPINRENDERTHREADS false
+	/// Longest ITD (in ms) the listener must be able to apply when the sources are mixed in the frequency domain
+	#define BRTMAXITDMS 1
+	/// How long (in ms) the talker count must stay at or below the threshold before automatic mode leaves the
+	/// ambisonic bus again, so that speakers pausing between sentences do not flip the mode back and forth
+	#define BRTAMBISONICHOLDMS 3000
+	/// Time constant (in ms) of the level the speakers are ranked by for the rendering tiers
+	#define BRTLOUDNESSSMOOTHINGMS 300
+	/// Advantage a speaker has in the ranking for every tier it is rendered above the cheapest ones, so that speakers
+	/// with similar levels do not keep swapping tiers
+	#define BRTTIERHYSTERESIS 1.5f
+	/// Bounds (in samples) of the block size the speakers are spatialized in, see Settings::iBinauralBlockSize
+	#define BRTMINBLOCKSIZE 32
+	#define BRTMAXBLOCKSIZE 4096
+	/// Starts loading the given SOFA file in the background. mix() switches to it once it is ready.
+	void requestHRTF(const std::string &path);
+	/// Mixes the sources in the frequency domain, with a single inverse FFT per ear, if the block size leaves room in
+	/// the FFTs for the ITD. Blocks whose size is a power of two leave none, so each source makes its own then.
+	void updateFrequencyDomainMixing(unsigned int frameCount);
+	/// Applies the spatial rendering settings: renders the speakers either with the per-source HRTF model or with the
+	/// ambisonic one. Only one of the two listener models is enabled, the other one outputs silence.
+	void updateSpatialRendering(std::size_t talkingSpeakers, unsigned int frameCount);
+	/// Ranks the speakers rendered in this block by their level at the listener and gives the best ranked ones the
+	/// most detailed rendering tiers, within the budgets from the settings. Inaudible speakers are culled.
+	void updateRenderingTiers();
+	/// @returns The block size the BRT graph renders in. It is fixed when the mixer is initialized, whatever block
+	/// 	sizes the backend asks for later on.
+	unsigned int configuredBinauralBlockSize() const;
+	/// Sets the BRT graph up for rendering blocks of the given size. The HRTF is reloaded if it has been partitioned
+	/// for another size, nothing is rendered until then.
+	void setBinauralBlockSize(unsigned int blockSize);
+	/// Starts the FIFOs between the blocks of the backend and those of the graph over. The output is delayed by just
+	/// enough that every block of the given size can be served.
+	void resetBinauralFifos(unsigned int frameCount);
+	/// Lets the FIFOs serve blocks of the given size from now on, without dropping what they hold. The delay of the
+	/// output only ever grows, up to one sample less than a block of the graph, which serves blocks of any size.
+	void adaptBinauralFifos(unsigned int frameCount);
+	/// Queues the speech of the current block for the BRT graph, renders as many blocks of the graph as there is
+	/// speech for and adds the binaural output of the current block to the first two channels. Silence is output for
+	/// the blocks of the graph rendered before there is an HRTF for its block size.
+	void renderBinaural(float *output, unsigned int frameCount, unsigned int nchan);
 	//FILE *stream;
 	//std::ofstream logFile;
 
+	/// Everything mix() needs for one speaking user. Slots are created the first time a session speaks
+	/// and are only ever recycled, never freed, so that mix() does not allocate once enough of them exist.
+	struct SpeakerSlot {
+		bool used            = false;
+		unsigned int session = 0;
+		Position3D position  = { 0, 0.0001f, 0 };
+		CMonoBuffer< float > monoBuffer;
+		/// Source bound to the session by the source pool in the current block, may be null
+		AudioOutputSourcePool::Source *source = nullptr;
+		/// Level of detail the source is rendered with, see updateRenderingTiers()
+		BRTProcessing::TRenderingTier renderingTier = BRTProcessing::TRenderingTier::Full;
+		/// Source the tier has been set on. A recycled source still has the tier of its previous speaker.
+		AudioOutputSourcePool::Source *tierSource = nullptr;
+		/// Smoothed RMS level of the speech
+		float loudness = 0.0f;
+		/// Distance to the listener in the current block
+		float distance = 0.0f;
+		bool audible   = true;
+		/// Whether the speech has been handed to the source in the current block
+		bool rendered = false;
+		/// Position in the ranking of updateRenderingTiers(), higher is better
+		float tierScore = 0.0f;
+		/// Whether monoBuffer holds the speech of the current block
+		bool speechQueued = false;
+		/// Speech waiting for the BRT graph, as many samples as binauralPendingFrames. See renderBinaural().
+		SampleFifo pendingSpeech;
+		/// Source pendingSpeech has been queued for. The queue starts over when the slot gets another source.
+		AudioOutputSourcePool::Source *queuedSource = nullptr;
+#ifdef USE_MANUAL_PLUGIN
+		Position2D planePosition = { 0, 0 };
+		/// Whether the Manual plugin has placed the speaker. The slot is released once it no longer does.
+		bool placed = false;
+#endif
+	};
+
+	/// @returns The slot of the given session or nullptr if it has none. Does not allocate.
+	SpeakerSlot *findSpeakerSlot(unsigned int session);
+	/// Assigns a slot, recycling an unused one if possible. Only allocates when all slots are in use.
+	SpeakerSlot *createSpeakerSlot(unsigned int session, unsigned int frameCount);
+	/// Marks the slot as unused. The BRT source itself is released by the source pool.
+	void releaseSpeakerSlot(SpeakerSlot *slot);
+	/// Updates the level of the speaker from the block just copied into its mono buffer and marks it as rendered
+	void updateSpeakerLevel(SpeakerSlot *slot, float distance, bool audible, unsigned int frameCount);
+	/// @returns A zeroed buffer for the voice recorder, taken from a pool of buffers the recorder is done with
+	boost::shared_array< float > acquireRecorderBuffer(unsigned int frameCount);
+
 private slots:
 	void handleInvalidatedBuffer(AudioOutputBuffer *);
 	void handlePositionedBuffer(AudioOutputBuffer *, float x, float y, float z);
+	void handleUserRemoved(unsigned int session);
 
 protected:
 	enum { SampleShort, SampleFloat } eSampleFormat = SampleFloat;
@@ -100,6 +199,7 @@ protected:
 	unsigned int iSampleSize                        = 0;
 	unsigned int iBufferSize                        = 0;
 	bool initialized                                = false;
+	/// Held by mix() while it uses the BRT graph and by the source pool while it changes it, between two blocks
 	std::mutex BRTmutex;
 	QReadWriteLock qrwlOutputs;
 	QMultiHash< const ClientUser *, AudioOutputBuffer * > qmOutputs;
@@ -107,25 +207,65 @@ protected:
 	Common::CGlobalParameters globalParameters;
 	BRTBase::CBRTManager envManager;
 	std::shared_ptr< BRTListenerModel::CListenerHRTFModel > envListener;
+	/// Encodes all speakers into one ambisonic bus, so the convolutions no longer grow with the number of speakers
+	std::shared_ptr< BRTListenerModel::CListenerAmbisonicHRTFModel > ambisonicListener;
+	bool ambisonicRendering = false;
+	/// Samples rendered through the ambisonic bus while automatic mode would have gone back to per-source rendering
+	unsigned int ambisonicHoldSamples = 0;
+	/// Ambisonic order last asked of the HRTF loader, which builds the impulse responses for it
+	int requestedAmbisonicOrder = 0;
 	std::shared_ptr< BRTBase::CListener > listener;
+	/// Creates and removes the speakers' BRT sources outside of mix()
+	std::unique_ptr< AudioOutputSourcePool > sourcePool;
 	//std::shared_ptr< BRTEnvironmentModel::CFreeFieldEnvironmentModel > freeEnv;
-	QHash<unsigned int, std::shared_ptr< BRTSourceModel::CSourceSimpleModel > > envSources;
 	Common::CTransform tempTransform;
 	//std::vector< CMonoBuffer< float > > envSourceBuffers;
 	QMultiHash< ClientUser *, bool > connectedUsers;
 	Common::CEarPair< CMonoBuffer< float > > bufferProcessed;
-	BRTReaders::CSOFAReader sofaReader;
+	/// Samples in a block of the BRT graph, see Settings::iBinauralBlockSize
+	unsigned int binauralBlockSize = 0;
+	/// Block size of the backend the binaural FIFOs have last served. 0 if they have to be started over.
+	unsigned int binauralFrameCount = 0;
+	/// Samples of silence the binaural output has been delayed by for the blocks served since resetBinauralFifos()
+	RechunkingDelay binauralDelay;
+	/// Speech queued in the slots that the graph has not rendered yet
+	unsigned int binauralPendingFrames = 0;
+	/// Binaural output rendered ahead of the backend
+	SampleFifo binauralLeft;
+	SampleFifo binauralRight;
+	/// One block of speech handed to a source
+	CMonoBuffer< float > binauralInput;
+	/// Binaural output of the current block of the backend
+	Common::CEarPair< CMonoBuffer< float > > binauralOutput;
+	/// Set whenever the graph is set up differently: a new source, HRTF, block size, tier or way of rendering. The
+	/// processors set up their buffers in the first block they render after that, which the tripwire does not cover.
+	bool binauralSetupChanged = true;
+	/// Reads SOFA files and builds the ambisonic impulse responses off the audio thread
+	std::unique_ptr< HRTFLoader > hrtfLoader;
+	/// HRTF currently set on the listener, only accessed by mix() once the mixer is initialized
 	std::shared_ptr< BRTServices::CHRTF > hrtf_loaded;
+	bool hrtfRequested = false;
+	/// SOFA file requested last. It is loaded again when the block size of the graph changes.
+	std::string hrtfPath;
+#ifdef USE_MANUAL_PLUGIN
+	/// Generation of the last HRTF selected in the Manual plugin that has been requested from the loader
+	unsigned int manualHRTFGeneration = 0;
+#endif
 	std::vector<float> listenerRotationQuat;
 	std::vector<std::vector<float>> a;
 	bool newInstance = false;
 
-	QHash< unsigned int, Position3D > userPos;
-	QHash< unsigned int, CMonoBuffer< float > > userBuffer;
-
-#ifdef USE_MANUAL_PLUGIN
-	QHash< unsigned int, Position2D > positions;
-#endif
+	/// Preallocated per-speaker state, see SpeakerSlot
+	std::vector< std::unique_ptr< SpeakerSlot > > speakerSlots;
+	/// Speakers rendered in the current block, ranked by updateRenderingTiers(). Kept as a member to reuse its storage.
+	std::vector< SpeakerSlot * > tierRanking;
+	/// Buffers with audio to contribute in the current mix() call. Kept as members to reuse their storage.
+	std::vector< AudioOutputBuffer * > mixBuffers;
+	/// Buffers that no longer have any audio to play and are deleted at the end of mix()
+	std::vector< AudioOutputBuffer * > finishedBuffers;
+	/// Buffers handed to the voice recorder. One is reused once the recorder has dropped its reference.
+	std::vector< boost::shared_array< float > > recorderBufferPool;
+	unsigned int recorderBufferFrames = 0;
 
 	void initializeMixer(const unsigned int *chanmasks, bool forceheadphone = false);
 	bool mix(void *output, unsigned int frameCount);
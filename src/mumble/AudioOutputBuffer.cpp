@@ -5,6 +5,8 @@
 
 #include "AudioOutputBuffer.h"
 
+#include "AllocationTripwire.h"
+
 AudioOutputBuffer::~AudioOutputBuffer() {
 	delete[] pfBuffer;
 	delete[] pfVolume;
@@ -12,6 +14,8 @@ AudioOutputBuffer::~AudioOutputBuffer() {
 
 void AudioOutputBuffer::resizeBuffer(unsigned int newsize) {
 	if (newsize > iBufferSize) {
+		// Only happens until the buffer has grown to what the audio backend asks for
+		AllocationTripwire::Pause pause;
 		float *n = new float[newsize];
 		if (pfBuffer) {
 			memcpy(n, pfBuffer, sizeof(float) * iBufferSize);
@@ -0,0 +1,277 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "AudioOutputSourcePool.h"
+
+#include <QtCore/QtGlobal>
+
+#include <chrono>
+#include <string>
+
+// How often the control thread looks for released sources while the audio thread still holds them
+#define RECLAIM_POLL_INTERVAL std::chrono::milliseconds(20)
+// How often the control thread looks at the block counter while it waits for a block boundary, in case it has missed
+// the notification
+#define BOUNDARY_POLL_INTERVAL std::chrono::milliseconds(1)
+// How long the control thread waits for a block boundary before it assumes that the audio thread is not mixing
+#define BOUNDARY_TIMEOUT std::chrono::milliseconds(100)
+
+AudioOutputSourcePool::AudioOutputSourcePool(
+	BRTBase::CBRTManager &manager, std::vector< std::shared_ptr< BRTListenerModel::CListenerModelBase > > listenerModels,
+	std::mutex &graphMutex)
+	: m_manager(manager), m_listenerModels(std::move(listenerModels)), m_graphMutex(graphMutex) {
+	m_retiredLanes.reserve(MAX_BOUND_SOURCES);
+	m_queue.reserve(MAX_BOUND_SOURCES);
+}
+
+AudioOutputSourcePool::~AudioOutputSourcePool() {
+	stop();
+}
+
+void AudioOutputSourcePool::start(unsigned int spareSources) {
+	if (m_thread.joinable()) {
+		return;
+	}
+
+	m_spareTarget   = spareSources;
+	m_stopRequested = false;
+	m_thread        = std::thread(&AudioOutputSourcePool::run, this);
+}
+
+void AudioOutputSourcePool::stop() {
+	if (m_thread.joinable()) {
+		{
+			std::lock_guard< std::mutex > lock(m_queueMutex);
+			m_stopRequested = true;
+		}
+		m_queueCondition.notify_one();
+		m_thread.join();
+		m_controlThreadID = std::thread::id();
+	}
+
+	for (unsigned int i = 0; i < MAX_BOUND_SOURCES; ++i) {
+		m_lanes[i].session.store(INVALID_SESSION);
+		m_lanes[i].source.store(nullptr);
+		if (m_laneOwners[i]) {
+			unwireSource(m_laneOwners[i]);
+			m_laneOwners[i].reset();
+		}
+	}
+	m_retiredLanes.clear();
+
+	for (const std::shared_ptr< Source > &source : m_spareSources) {
+		unwireSource(source);
+	}
+	m_spareSources.clear();
+}
+
+void AudioOutputSourcePool::requestSource(unsigned int session) {
+	{
+		std::lock_guard< std::mutex > lock(m_queueMutex);
+		m_queue.push_back({ Command::Type::Request, session });
+	}
+	m_queueCondition.notify_one();
+}
+
+void AudioOutputSourcePool::releaseSource(unsigned int session) {
+	{
+		std::lock_guard< std::mutex > lock(m_queueMutex);
+		m_queue.push_back({ Command::Type::Release, session });
+	}
+	m_queueCondition.notify_one();
+}
+
+AudioOutputSourcePool::Source *AudioOutputSourcePool::findSource(unsigned int session) const {
+	for (const Lane &lane : m_lanes) {
+		if (lane.session.load(std::memory_order_acquire) == session) {
+			// May be null if the lane is being released right now
+			return lane.source.load(std::memory_order_acquire);
+		}
+	}
+	return nullptr;
+}
+
+void AudioOutputSourcePool::endBlock() {
+	m_blockEpoch.fetch_add(1, std::memory_order_release);
+	m_boundaryCondition.notify_all();
+}
+
+void AudioOutputSourcePool::run() {
+	m_controlThreadID = std::this_thread::get_id();
+
+	std::vector< Command > commands;
+	commands.reserve(MAX_BOUND_SOURCES);
+
+	while (true) {
+		{
+			std::unique_lock< std::mutex > lock(m_queueMutex);
+			auto hasWork = [this]() { return m_stopRequested || !m_queue.empty(); };
+			if (m_retiredLanes.empty()) {
+				m_queueCondition.wait(lock, hasWork);
+			} else {
+				m_queueCondition.wait_for(lock, RECLAIM_POLL_INTERVAL, hasWork);
+			}
+			if (m_stopRequested) {
+				return;
+			}
+			commands.swap(m_queue);
+		}
+
+		for (const Command &command : commands) {
+			if (command.type == Command::Type::Request) {
+				bind(command.session);
+			} else {
+				release(command.session);
+			}
+		}
+		commands.clear();
+
+		reclaimRetiredLanes();
+		// Wire new sources only after the pending speakers have been served from the spare ones
+		refillSpares();
+	}
+}
+
+void AudioOutputSourcePool::bind(unsigned int session) {
+	int freeLane = -1;
+	for (unsigned int i = 0; i < MAX_BOUND_SOURCES; ++i) {
+		if (m_lanes[i].session.load(std::memory_order_relaxed) == session) {
+			// Already bound
+			return;
+		}
+		if (freeLane < 0 && !m_laneOwners[i]) {
+			freeLane = static_cast< int >(i);
+		}
+	}
+
+	if (freeLane < 0) {
+		qWarning("AudioOutputSourcePool: No free source lane for session %u", session);
+		return;
+	}
+
+	std::shared_ptr< Source > source;
+	if (!m_spareSources.empty()) {
+		source = std::move(m_spareSources.back());
+		m_spareSources.pop_back();
+	} else {
+		source = wireSource();
+		if (!source) {
+			return;
+		}
+	}
+
+	const unsigned int laneIndex = static_cast< unsigned int >(freeLane);
+	Lane &lane                   = m_lanes[laneIndex];
+	m_laneOwners[laneIndex]      = source;
+	// Publish the pointer before the session so that a reader matching the session sees the source
+	lane.source.store(source.get(), std::memory_order_release);
+	lane.session.store(session, std::memory_order_release);
+}
+
+void AudioOutputSourcePool::release(unsigned int session) {
+	for (unsigned int i = 0; i < MAX_BOUND_SOURCES; ++i) {
+		if (m_lanes[i].session.load(std::memory_order_relaxed) == session) {
+			m_lanes[i].session.store(INVALID_SESSION, std::memory_order_release);
+			m_lanes[i].source.store(nullptr, std::memory_order_release);
+			m_retiredLanes.push_back({ i, m_blockEpoch.load(std::memory_order_acquire) });
+			return;
+		}
+	}
+}
+
+void AudioOutputSourcePool::reclaimRetiredLanes() {
+	const std::uint64_t epoch = m_blockEpoch.load(std::memory_order_acquire);
+
+	auto it = m_retiredLanes.begin();
+	while (it != m_retiredLanes.end()) {
+		// The block that was running when the lane was released has finished once the epoch moved by two
+		if (epoch >= it->epoch + 2) {
+			std::shared_ptr< Source > &owner = m_laneOwners[it->lane];
+			if (m_spareSources.size() < 2 * m_spareTarget) {
+				// The source has been fed silence since, so its convolution tail has already drained
+				m_spareSources.push_back(std::move(owner));
+			} else {
+				unwireSource(owner);
+			}
+			owner.reset();
+			it = m_retiredLanes.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void AudioOutputSourcePool::refillSpares() {
+	while (m_spareSources.size() < m_spareTarget) {
+		{
+			// Don't delay new requests behind pre-warming
+			std::lock_guard< std::mutex > lock(m_queueMutex);
+			if (m_stopRequested || !m_queue.empty()) {
+				return;
+			}
+		}
+
+		std::shared_ptr< Source > source = wireSource();
+		if (!source) {
+			return;
+		}
+		m_spareSources.push_back(std::move(source));
+	}
+}
+
+void AudioOutputSourcePool::waitForBlockBoundary() {
+	if (std::this_thread::get_id() != m_controlThreadID) {
+		// Called by stop(), the audio thread is not mixing
+		return;
+	}
+
+	std::unique_lock< std::mutex > lock(m_boundaryMutex);
+	const std::uint64_t epoch = m_blockEpoch.load(std::memory_order_acquire);
+	auto blockFinished        = [this, epoch]() { return m_blockEpoch.load(std::memory_order_acquire) != epoch; };
+	const auto deadline       = std::chrono::steady_clock::now() + BOUNDARY_TIMEOUT;
+	// The audio thread notifies without the mutex, so a notification may come in between the check and the wait
+	while (!m_boundaryCondition.wait_for(lock, BOUNDARY_POLL_INTERVAL, blockFinished)) {
+		if (std::chrono::steady_clock::now() >= deadline) {
+			// Nothing is mixed at the moment. Should a block start during the edit, it waits for it.
+			return;
+		}
+	}
+}
+
+std::shared_ptr< AudioOutputSourcePool::Source > AudioOutputSourcePool::wireSource() {
+	waitForBlockBoundary();
+	std::lock_guard< std::mutex > lock(m_graphMutex);
+
+	m_manager.BeginSetup();
+	std::shared_ptr< Source > source =
+		m_manager.CreateSoundSource< Source >(std::string("pooled") + std::to_string(m_nextSourceID++));
+	for (std::size_t i = 0; source && i < m_listenerModels.size(); i++) {
+		if (!m_listenerModels[i]->ConnectSoundSource(source)) {
+			for (std::size_t j = 0; j < i; j++) {
+				m_listenerModels[j]->DisconnectSoundSource(source);
+			}
+			m_manager.RemoveSoundSource(source->GetID());
+			source.reset();
+		}
+	}
+	m_manager.EndSetup();
+
+	if (!source) {
+		qWarning("AudioOutputSourcePool: Failed to create a BRT sound source");
+	}
+	return source;
+}
+
+void AudioOutputSourcePool::unwireSource(const std::shared_ptr< Source > &source) {
+	waitForBlockBoundary();
+	std::lock_guard< std::mutex > lock(m_graphMutex);
+
+	m_manager.BeginSetup();
+	for (const std::shared_ptr< BRTListenerModel::CListenerModelBase > &listenerModel : m_listenerModels) {
+		listenerModel->DisconnectSoundSource(source);
+	}
+	m_manager.RemoveSoundSource(source->GetID());
+	m_manager.EndSetup();
+}
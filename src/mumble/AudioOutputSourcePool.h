@@ -0,0 +1,131 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_AUDIOOUTPUTSOURCEPOOL_H_
+#define MUMBLE_MUMBLE_AUDIOOUTPUTSOURCEPOOL_H_
+
+#include "BRTLibrary.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Owns the BRT sound sources used for the speakers and keeps all changes to the BRT graph off the audio thread.
+///
+/// A control thread keeps a few sources created and connected to the listener models ahead of time. When a user
+/// starts to talk one of them is bound to the user's session and published to the audio thread by atomically
+/// storing its pointer in a lane. When the user stops talking or leaves, the lane is cleared and the source goes
+/// back to the spare sources once the audio thread can no longer be using it. Binding and releasing only touch
+/// lanes. The graph itself is only changed right after the audio thread has finished a block, one source at a time, so
+/// the edit falls into the time until the next block and the audio thread does not have to wait for the graph mutex.
+class AudioOutputSourcePool {
+public:
+	using Source = BRTSourceModel::CSourceSimpleModel;
+
+	/// Maximum number of speakers that can have a source at the same time
+	static constexpr unsigned int MAX_BOUND_SOURCES = 64;
+	/// Number of wired sources kept ready for new speakers. Up to twice as many released ones are kept, so that
+	/// speakers taking turns do not make the pool wire and remove sources all the time.
+	static constexpr unsigned int DEFAULT_SPARE_SOURCES = 4;
+
+	/// @param manager The BRT manager owning the graph
+	/// @param listenerModels The listener models every source is connected to
+	/// @param graphMutex The mutex the audio thread holds while rendering the graph. The pool takes it to change the
+	/// graph, right after a call to endBlock().
+	AudioOutputSourcePool(BRTBase::CBRTManager &manager,
+						  std::vector< std::shared_ptr< BRTListenerModel::CListenerModelBase > > listenerModels,
+						  std::mutex &graphMutex);
+	~AudioOutputSourcePool();
+
+	AudioOutputSourcePool(const AudioOutputSourcePool &) = delete;
+	AudioOutputSourcePool &operator=(const AudioOutputSourcePool &) = delete;
+
+	/// Starts the control thread, which immediately starts to pre-warm spare sources. Does nothing if it is
+	/// already running. Must only be called once the graph's sample rate and HRTF have been set up.
+	///
+	/// @param spareSources The number of wired sources to keep ready
+	void start(unsigned int spareSources = DEFAULT_SPARE_SOURCES);
+	/// Stops the control thread and removes all sources from the graph. The audio thread must not be mixing.
+	void stop();
+
+	/// Asks for a source to be bound to the given session. Thread-safe and never waits for the graph.
+	void requestSource(unsigned int session);
+	/// Asks for the source of the given session to be released. Thread-safe and never waits for the graph.
+	void releaseSource(unsigned int session);
+
+	/// Must only be called from the audio thread. Never blocks nor allocates.
+	///
+	/// @returns The wired source bound to the given session or nullptr if there is none (yet)
+	Source *findSource(unsigned int session) const;
+	/// Must be called by the audio thread after every rendered block, once it has released the graph mutex. Released
+	/// sources are only recycled once the audio thread has finished the block it may have been using them in, and the
+	/// graph is only changed right after this call. Never blocks nor allocates.
+	void endBlock();
+
+private:
+	static constexpr unsigned int INVALID_SESSION = ~0u;
+
+	struct Lane {
+		std::atomic< unsigned int > session{ INVALID_SESSION };
+		std::atomic< Source * > source{ nullptr };
+	};
+
+	struct Command {
+		enum class Type { Request, Release } type;
+		unsigned int session;
+	};
+
+	struct RetiredLane {
+		unsigned int lane;
+		std::uint64_t epoch;
+	};
+
+	void run();
+	void bind(unsigned int session);
+	void release(unsigned int session);
+	void reclaimRetiredLanes();
+	void refillSpares();
+	/// Waits until the audio thread has finished a block, or for a while if it is not mixing
+	void waitForBlockBoundary();
+	/// Creates a new source and connects it to the listener models. Takes the graph mutex at a block boundary.
+	std::shared_ptr< Source > wireSource();
+	/// Disconnects the source from the listener models and removes it from the graph. Takes the graph mutex at a
+	/// block boundary.
+	void unwireSource(const std::shared_ptr< Source > &source);
+
+	BRTBase::CBRTManager &m_manager;
+	std::vector< std::shared_ptr< BRTListenerModel::CListenerModelBase > > m_listenerModels;
+	std::mutex &m_graphMutex;
+
+	/// Read by the audio thread, only written by the control thread
+	std::array< Lane, MAX_BOUND_SOURCES > m_lanes;
+	/// Incremented by the audio thread after every block
+	std::atomic< std::uint64_t > m_blockEpoch{ 0 };
+	/// Notified by the audio thread after every block, without taking the mutex
+	std::mutex m_boundaryMutex;
+	std::condition_variable m_boundaryCondition;
+
+	// Only accessed by the control thread (or after it has been joined)
+	std::array< std::shared_ptr< Source >, MAX_BOUND_SOURCES > m_laneOwners;
+	std::vector< RetiredLane > m_retiredLanes;
+	std::vector< std::shared_ptr< Source > > m_spareSources;
+	unsigned int m_spareTarget  = DEFAULT_SPARE_SOURCES;
+	std::uint64_t m_nextSourceID = 0;
+
+	std::thread m_thread;
+	/// Set by the control thread itself, so that it does not race with the assignment of m_thread
+	std::thread::id m_controlThreadID;
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueCondition;
+	std::vector< Command > m_queue;
+	bool m_stopRequested = false;
+};
+
+#endif // MUMBLE_MUMBLE_AUDIOOUTPUTSOURCEPOOL_H_
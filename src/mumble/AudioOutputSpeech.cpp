@@ -5,6 +5,7 @@
 
 #include "AudioOutputSpeech.h"
 
+#include "AllocationTripwire.h"
 #include "Audio.h"
 #include "ClientUser.h"
 #include "PacketDataStream.h"
@@ -114,6 +115,8 @@ AudioOutputSpeech::AudioOutputSpeech(ClientUser *user, unsigned int freq, Mumble
 	}
 
 	pfBuffer = new float[iBufferSize];
+	// As much as the audio caches hold before they grow
+	m_packet.reserve(512);
 
 	srs              = nullptr;
 	fResamplerBuffer = nullptr;
@@ -226,8 +229,7 @@ bool AudioOutputSpeech::prepareSampleBuffer(unsigned int frameCount) {
 	// we can not control exactly how many frames decoder returns
 	// so we need a buffer to keep unused frames
 	// shift the buffer, remove decoded and played frames
-	for (unsigned int i = iLastConsume; i < iBufferFilled; ++i)
-		pfBuffer[i - iLastConsume] = pfBuffer[i];
+	std::copy(pfBuffer + iLastConsume, pfBuffer + iBufferFilled, pfBuffer);
 
 	iBufferFilled -= iLastConsume;
 
@@ -253,6 +255,8 @@ bool AudioOutputSpeech::prepareSampleBuffer(unsigned int frameCount) {
 			memset(pOut, 0, iFrameSize * sizeof(float));
 		} else {
 			if (p == &LoopUser::lpLoopy) {
+				// Only used for testing the local loopback
+				AllocationTripwire::Pause pause;
 				LoopUser::lpLoopy.fetchFrames();
 			}
 
@@ -271,7 +275,7 @@ bool AudioOutputSpeech::prepareSampleBuffer(unsigned int frameCount) {
 				}
 			}
 
-			if (qlFrames.isEmpty()) {
+			if (!m_packetPending) {
 				QMutexLocker lock(&qmJitter);
 
 				JitterBufferPacket jbp;
@@ -294,9 +298,14 @@ bool AudioOutputSpeech::prepareSampleBuffer(unsigned int frameCount) {
 
 					assert(m_codec == Mumble::Protocol::AudioCodec::Opus);
 
-					// Copy audio data into qlFrames
-					qlFrames << QByteArray(reinterpret_cast< const char * >(cache.getAudioData().data()),
-										   static_cast< int >(cache.getAudioData().size()));
+					// Copy the audio data, so that the cache can be reused right away
+					const gsl::span< const Mumble::Protocol::byte > audioData = cache.getAudioData();
+					if (audioData.size() > m_packet.capacity()) {
+						AllocationTripwire::Pause pause;
+						m_packet.reserve(audioData.size());
+					}
+					m_packet.assign(audioData.begin(), audioData.end());
+					m_packetPending = true;
 
 					if (cache.containsPositionalInformation()) {
 						assert(cache.getPositionalInformation().size() == 3);
@@ -335,24 +344,25 @@ bool AudioOutputSpeech::prepareSampleBuffer(unsigned int frameCount) {
 				}
 			}
 
-			if (!qlFrames.isEmpty()) {
-				QByteArray qba = qlFrames.takeFirst();
+			if (m_packetPending) {
+				m_packetPending = false;
 
 				assert(m_codec == Mumble::Protocol::AudioCodec::Opus);
 
-				if (qba.isEmpty() || !(p && p->bLocalMute)) {
-					// If qba is empty, we have to let Opus know about the packet loss
+				if (m_packet.empty() || !(p && p->bLocalMute)) {
+					// If the packet is empty, we have to let Opus know about the packet loss
 					// Otherwise if the associated user is not locally muted, we want to decode the audio
 					// packet normally in order to be able to play it.
-					decodedSamples = opus_decode_float(
-						opusState, qba.isEmpty() ? nullptr : reinterpret_cast< const unsigned char * >(qba.constData()),
-						qba.size(), pOut, static_cast< int >(iAudioBufferSize), 0);
+					const unsigned char *packet =
+						m_packet.empty() ? nullptr : reinterpret_cast< const unsigned char * >(m_packet.data());
+					decodedSamples = opus_decode_float(opusState, packet, static_cast< opus_int32 >(m_packet.size()),
+													   pOut, static_cast< int >(iAudioBufferSize), 0);
 				} else {
 					// If the packet is non-empty, but the associated user is locally muted,
 					// we don't have to decode the packet. Instead it is enough to know how many
 					// samples it contained so that we can then mute the appropriate output length
 					decodedSamples = opus_packet_get_samples_per_frame(
-						reinterpret_cast< const unsigned char * >(qba.constData()), SAMPLE_RATE);
+						reinterpret_cast< const unsigned char * >(m_packet.data()), SAMPLE_RATE);
 				}
 
 				// The returned sample count we get from the Opus functions refer to samples per channel.
@@ -389,11 +399,11 @@ bool AudioOutputSpeech::prepareSampleBuffer(unsigned int frameCount) {
 					update = (pow < (fPowerMin + 0.01f * (fPowerMax - fPowerMin))); // Update jitter buffer when quiet.
 				}
 
-				if (qlFrames.isEmpty() && update) {
+				if (update) {
 					jitter_buffer_update_delay(jbJitter, nullptr, nullptr);
 				}
 
-				if (qlFrames.isEmpty() && bHasTerminator) {
+				if (bHasTerminator) {
 					nextalive = false;
 				}
 			} else {
@@ -478,7 +488,11 @@ bool AudioOutputSpeech::prepareSampleBuffer(unsigned int frameCount) {
 			ts = Settings::MutedTalking;
 		}
 
-		p->setTalking(ts);
+		if (ts != p->tsState) {
+			// Notifies the GUI through queued signals
+			AllocationTripwire::Pause pause;
+			p->setTalking(ts);
+		}
 	}
 
 	bool tmp   = bLastAlive;
@@ -56,7 +56,10 @@ protected:
 
 	OpusDecoder *opusState;
 
-	QList< QByteArray > qlFrames;
+	/// The packet taken from the jitter buffer that is decoded next. Its storage is reused for the next packets, so
+	/// that decoding does not allocate in the audio callback.
+	std::vector< Mumble::Protocol::byte > m_packet;
+	bool m_packetPending = false;
 
 public:
 	Mumble::Protocol::audio_context_t m_audioContext;
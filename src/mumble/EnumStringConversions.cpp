@@ -86,6 +86,11 @@
 	PROCESS(Settings::RecordingMode, RecordingMixdown, "Mixdown") \
 	PROCESS(Settings::RecordingMode, RecordingMultichannel, "Multichannel")
 
+#define SPATIAL_RENDERING_VALUES                                                \
+	PROCESS(Settings::SpatialRendering, SpatialRenderingAutomatic, "Automatic") \
+	PROCESS(Settings::SpatialRendering, SpatialRenderingPerSource, "PerSource") \
+	PROCESS(Settings::SpatialRendering, SpatialRenderingAmbisonic, "Ambisonic")
+
 #define SEARCH_USER_ACTION_VALUES                           \
 	PROCESS(Search::SearchDialog::UserAction, NONE, "None") \
 	PROCESS(Search::SearchDialog::UserAction, JOIN, "Join")
@@ -194,6 +199,9 @@
 	BEFORE_CODE(Settings::RecordingMode)               \
 	RECORDING_MODE_VALUES                              \
 	AFTER_CODE                                         \
+	BEFORE_CODE(Settings::SpatialRendering)            \
+	SPATIAL_RENDERING_VALUES                           \
+	AFTER_CODE                                         \
 	BEFORE_CODE(Search::SearchDialog::UserAction)      \
 	SEARCH_USER_ACTION_VALUES                          \
 	AFTER_CODE                                         \
@@ -260,6 +268,7 @@ PROCESS_ALL_ENUMS
 #undef LOG_MSG_TYPE_VALUES
 #undef SEARCH_CHANNEL_ACTION_VALUES
 #undef SEARCH_USER_ACTION_VALUES
+#undef SPATIAL_RENDERING_VALUES
 #undef RECORDING_MODE_VALUES
 #undef WINDOW_LAYOUT_VALUES
 #undef ALWAYS_ON_TOP_VALUES
@@ -29,6 +29,7 @@ const char *enumToString(Settings::AlwaysOnTopBehaviour e);
 const char *enumToString(QuitBehavior e);
 const char *enumToString(Settings::WindowLayout e);
 const char *enumToString(Settings::RecordingMode e);
+const char *enumToString(Settings::SpatialRendering e);
 const char *enumToString(Search::SearchDialog::UserAction e);
 const char *enumToString(Search::SearchDialog::ChannelAction e);
 const char *enumToString(Log::MsgType e);
@@ -54,6 +55,7 @@ void stringToEnum(const std::string &str, Settings::AlwaysOnTopBehaviour &e);
 void stringToEnum(const std::string &str, QuitBehavior &e);
 void stringToEnum(const std::string &str, Settings::WindowLayout &e);
 void stringToEnum(const std::string &str, Settings::RecordingMode &e);
+void stringToEnum(const std::string &str, Settings::SpatialRendering &e);
 void stringToEnum(const std::string &str, Search::SearchDialog::UserAction &e);
 void stringToEnum(const std::string &str, Search::SearchDialog::ChannelAction &e);
 void stringToEnum(const std::string &str, Log::MsgType &e);
@@ -0,0 +1,268 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "HRTFLoader.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QtGlobal>
+
+// How often the loader thread checks whether the audio thread has taken or retired an HRTF
+#define RETIRE_POLL_INTERVAL std::chrono::milliseconds(20)
+// How long a retired HRTF is kept alive, so that the convolvers can finish fading out of it
+#define RETIRE_GRACE_PERIOD std::chrono::milliseconds(500)
+
+HRTFLoader::HRTFLoader(int resamplingStep, const QString &cacheDirectory, int ambisonicOrder,
+					   BRTProcessing::TAmbisonicNormalization ambisonicNormalization)
+	: m_resamplingStep(resamplingStep), m_cacheDirectory(cacheDirectory),
+	  m_ambisonicNormalization(ambisonicNormalization), m_ambisonicOrder(ambisonicOrder) {
+	m_thread = std::thread(&HRTFLoader::run, this);
+}
+
+HRTFLoader::~HRTFLoader() {
+	stop();
+}
+
+void HRTFLoader::requestLoad(const std::string &path) {
+	{
+		std::lock_guard< std::mutex > lock(m_requestMutex);
+		m_requestedPath = path;
+		m_hasRequest    = true;
+	}
+	m_requestCondition.notify_one();
+}
+
+void HRTFLoader::requestAmbisonicOrder(int order) {
+	{
+		std::lock_guard< std::mutex > lock(m_requestMutex);
+		m_ambisonicOrder           = order;
+		m_hasAmbisonicOrderRequest = true;
+	}
+	m_requestCondition.notify_one();
+}
+
+void HRTFLoader::stop() {
+	if (m_thread.joinable()) {
+		{
+			std::lock_guard< std::mutex > lock(m_requestMutex);
+			m_stopRequested = true;
+		}
+		m_requestCondition.notify_one();
+		m_thread.join();
+	}
+
+	m_loaded = Result();
+	m_hasLoaded.store(false);
+	m_retired = Result();
+	m_hasRetired.store(false);
+	m_awaitingRetire = false;
+	m_current.reset();
+}
+
+HRTFLoader::Result HRTFLoader::takeLoaded() {
+	if (!m_hasLoaded.load(std::memory_order_acquire)) {
+		return Result();
+	}
+
+	Result result = std::move(m_loaded);
+	m_hasLoaded.store(false, std::memory_order_release);
+	return result;
+}
+
+void HRTFLoader::retire(Result replaced) {
+	// The loader thread does not publish anything else before it has dealt with this, so the slot is free
+	m_retired = std::move(replaced);
+	m_hasRetired.store(true, std::memory_order_release);
+}
+
+void HRTFLoader::run() {
+	std::string path;
+	bool rebuild       = false;
+	int ambisonicOrder = 0;
+
+	while (true) {
+		{
+			std::unique_lock< std::mutex > lock(m_requestMutex);
+			if (m_awaitingRetire) {
+				m_requestCondition.wait_for(lock, RETIRE_POLL_INTERVAL, [this]() { return m_stopRequested; });
+			} else {
+				m_requestCondition.wait(lock, [this]() {
+					return m_stopRequested || m_hasRequest || m_hasAmbisonicOrderRequest;
+				});
+			}
+			if (m_stopRequested) {
+				return;
+			}
+			// Only one HRTF is in flight at a time. Newer requests replace the waiting one meanwhile.
+			if (!m_awaitingRetire) {
+				if (m_hasRequest) {
+					path.swap(m_requestedPath);
+					m_hasRequest = false;
+				}
+				// A new HRTF is built for the latest order anyway
+				rebuild                    = m_hasAmbisonicOrderRequest && path.empty();
+				m_hasAmbisonicOrderRequest = false;
+				ambisonicOrder             = m_ambisonicOrder;
+			}
+		}
+
+		if (m_awaitingRetire) {
+			m_awaitingRetire = !releaseRetired();
+		} else if (!path.empty()) {
+			load(path, ambisonicOrder);
+			path.clear();
+		} else if (rebuild) {
+			rebuildAmbisonicIR(ambisonicOrder);
+			rebuild = false;
+		}
+	}
+}
+
+void HRTFLoader::load(const std::string &path, int ambisonicOrder) {
+	std::shared_ptr< BRTServices::CHRTF > hrtf = std::make_shared< BRTServices::CHRTF >();
+
+	BRTReaders::CHRTFCache::TKey key;
+	QString cacheFile;
+	if (!m_cacheDirectory.isEmpty()) {
+		key = cacheKey(QString::fromStdString(path));
+		if (!key.sofaHash.empty()) {
+			cacheFile = cachePath(key);
+		}
+	}
+
+	if (!cacheFile.isEmpty() && loadFromCache(cacheFile, hrtf, key)) {
+		// The same content may have been cached under another name
+		hrtf->SetFilename(path);
+	} else {
+		if (!m_sofaReader.ReadHRTFFromSofa(path, hrtf, m_resamplingStep,
+										   BRTServices::TEXTRAPOLATION_METHOD::nearest_point)) {
+			qWarning("HRTFLoader: Failed to load \"%s\": %s", path.c_str(), m_sofaReader.GetLastError().c_str());
+			return;
+		}
+
+		// The audio thread may have changed the block size since the key was made
+		if (!cacheFile.isEmpty() && hrtf->GetHRIRPartitionedBufferSize() == key.bufferSize) {
+			QDir().mkpath(m_cacheDirectory);
+			if (!BRTReaders::CHRTFCache::Save(cacheFile.toStdString(), *hrtf, key)) {
+				qWarning("HRTFLoader: Failed to write the cache file \"%s\"", qPrintable(cacheFile));
+			}
+		}
+	}
+
+	using BRTListenerModel::CListenerAmbisonicHRTFModel;
+	std::shared_ptr< BRTServices::CAmbisonicBIR > ambisonicIR =
+		CListenerAmbisonicHRTFModel::CreateAmbisonicIR(hrtf, ambisonicOrder, m_ambisonicNormalization);
+	if (!ambisonicIR) {
+		qWarning("HRTFLoader: Failed to build the ambisonic impulse responses of \"%s\"", path.c_str());
+		return;
+	}
+
+	m_current = hrtf;
+	publish({ std::move(hrtf), std::move(ambisonicIR) }, ambisonicOrder);
+}
+
+void HRTFLoader::rebuildAmbisonicIR(int ambisonicOrder) {
+	if (!m_current || ambisonicOrder == m_currentAmbisonicOrder) {
+		return;
+	}
+
+	// The audio thread convolves with the same HRTF meanwhile, which only reads it as well
+	using BRTListenerModel::CListenerAmbisonicHRTFModel;
+	std::shared_ptr< BRTServices::CAmbisonicBIR > ambisonicIR =
+		CListenerAmbisonicHRTFModel::CreateAmbisonicIR(m_current, ambisonicOrder, m_ambisonicNormalization);
+	if (!ambisonicIR) {
+		qWarning("HRTFLoader: Failed to build the ambisonic impulse responses of order %d", ambisonicOrder);
+		return;
+	}
+
+	publish({ m_current, std::move(ambisonicIR) }, ambisonicOrder);
+}
+
+void HRTFLoader::publish(Result result, int ambisonicOrder) {
+	m_currentAmbisonicOrder = ambisonicOrder;
+	m_loaded                = std::move(result);
+	m_awaitingRetire        = true;
+	m_hasLoaded.store(true, std::memory_order_release);
+}
+
+bool HRTFLoader::releaseRetired() {
+	if (!m_hasRetired.load(std::memory_order_acquire)) {
+		return false;
+	}
+
+	// The HRTF published last has been turned down, the current one is no longer known
+	if (m_retired.hrtf && m_retired.hrtf == m_current) {
+		m_current.reset();
+		m_currentAmbisonicOrder = 0;
+	}
+
+	if (m_retired.hrtf || m_retired.ambisonicIR) {
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (m_retiredSince == std::chrono::steady_clock::time_point()) {
+			m_retiredSince = now;
+		}
+		// A convolver still fading out of them may hold a reference for the duration of a block
+		if (now - m_retiredSince < RETIRE_GRACE_PERIOD || m_retired.hrtf.use_count() > 1
+			|| m_retired.ambisonicIR.use_count() > 1) {
+			return false;
+		}
+		m_retired      = Result();
+		m_retiredSince = std::chrono::steady_clock::time_point();
+	}
+
+	m_hasRetired.store(false, std::memory_order_release);
+	return true;
+}
+
+bool HRTFLoader::loadFromCache(const QString &cachePath, const std::shared_ptr< BRTServices::CHRTF > &hrtf,
+							   const BRTReaders::CHRTFCache::TKey &key) {
+	QFile file(cachePath);
+	if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	// The table is copied straight out of the mapping, without reading the file into a buffer first
+	uchar *data = file.map(0, file.size());
+	if (!data) {
+		return false;
+	}
+
+	const bool loaded = BRTReaders::CHRTFCache::Load(reinterpret_cast< const char * >(data),
+													 static_cast< std::size_t >(file.size()), hrtf, key);
+	file.unmap(data);
+
+	if (!loaded) {
+		qWarning("HRTFLoader: Ignoring the invalid cache file \"%s\"", qPrintable(cachePath));
+		file.close();
+		file.remove();
+	}
+	return loaded;
+}
+
+BRTReaders::CHRTFCache::TKey HRTFLoader::cacheKey(const QString &sofaPath) const {
+	BRTReaders::CHRTFCache::TKey key(std::string(), m_globalParameters.GetSampleRate(),
+									 m_globalParameters.GetBufferSize(), m_resamplingStep);
+
+	QFile file(sofaPath);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return key;
+	}
+
+	QCryptographicHash hash(QCryptographicHash::Sha256);
+	if (hash.addData(&file)) {
+		key.sofaHash = hash.result().toHex().toStdString();
+	}
+	return key;
+}
+
+QString HRTFLoader::cachePath(const BRTReaders::CHRTFCache::TKey &key) const {
+	return QDir(m_cacheDirectory)
+		.filePath(QString::fromLatin1("%1_%2_%3_%4.brthrtf")
+					  .arg(QString::fromStdString(key.sofaHash))
+					  .arg(key.samplingRate)
+					  .arg(key.bufferSize)
+					  .arg(key.resamplingStep));
+}
@@ -0,0 +1,118 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_HRTFLOADER_H_
+#define MUMBLE_MUMBLE_HRTFLOADER_H_
+
+#include "BRTLibrary.h"
+
+#include <QtCore/QString>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/// Reads SOFA files into fully set up HRTFs on a background thread, so that the audio thread never waits for
+/// the disk, for the resampling of the HRIR table or for the ambisonic impulse responses built from it.
+///
+/// The resampled table of every HRTF is kept in a cache directory, keyed by the content of the SOFA file and the
+/// audio configuration. Later loads of the same file map the cache instead of resampling again.
+///
+/// The audio thread picks up a finished HRTF with takeLoaded() and hands the one it replaced back with
+/// retire(). Retired HRTFs are destroyed by the loader thread once the convolvers can no longer be using them,
+/// because freeing a whole HRIR table is far too slow for the audio thread.
+///
+/// Every HRTF comes with the ambisonic impulse responses of the requested order. When the order changes, the
+/// impulse responses of the current HRTF are rebuilt and handed over the same way, together with that HRTF.
+class HRTFLoader {
+public:
+	/// An HRTF together with the ambisonic impulse responses built from it
+	struct Result {
+		std::shared_ptr< BRTServices::CHRTF > hrtf;
+		std::shared_ptr< BRTServices::CAmbisonicBIR > ambisonicIR;
+	};
+
+	/// @param resamplingStep Grid step (in degrees) the HRIRs are resampled to
+	/// @param cacheDirectory Directory for the resampled tables. Caching is disabled if it is empty.
+	/// @param ambisonicOrder Ambisonic order the impulse responses are built for until another one is requested
+	/// @param ambisonicNormalization Ambisonic normalization of the listener model the impulse responses are for
+	HRTFLoader(int resamplingStep, const QString &cacheDirectory, int ambisonicOrder,
+			   BRTProcessing::TAmbisonicNormalization ambisonicNormalization);
+	~HRTFLoader();
+
+	HRTFLoader(const HRTFLoader &) = delete;
+	HRTFLoader &operator=(const HRTFLoader &) = delete;
+
+	/// Asks for the given SOFA file to be loaded. If another request is still waiting, it is replaced. Thread-safe.
+	void requestLoad(const std::string &path);
+	/// Asks for the ambisonic impulse responses of the current HRTF and of all HRTFs loaded from now on to be built
+	/// for the given order. Thread-safe.
+	void requestAmbisonicOrder(int order);
+	/// Stops the loader thread and drops everything it still holds. Pending requests are discarded.
+	void stop();
+
+	/// Must only be called from the audio thread. Never blocks nor allocates.
+	///
+	/// @returns The HRTF and impulse responses that have been built since the last call. The HRTF is nullptr if
+	/// there are none. It is the current one if only the impulse responses have been rebuilt for another order.
+	Result takeLoaded();
+	/// Hands what is no longer set on the listener over to the loader thread, which destroys it.
+	/// Must be called from the audio thread exactly once after every result of takeLoaded() with an HRTF, with
+	/// what has been replaced or, if the new result could not be set, with the new one (but never with the HRTF
+	/// still in use). Passing nullptr for either is fine. Never blocks nor frees.
+	void retire(Result replaced);
+
+private:
+	void run();
+	void load(const std::string &path, int ambisonicOrder);
+	/// Rebuilds the ambisonic impulse responses of the current HRTF for the given order
+	void rebuildAmbisonicIR(int ambisonicOrder);
+	void publish(Result result, int ambisonicOrder);
+	/// @returns Whether the HRTF has been set up from a valid cache file
+	bool loadFromCache(const QString &cachePath, const std::shared_ptr< BRTServices::CHRTF > &hrtf,
+					   const BRTReaders::CHRTFCache::TKey &key);
+	/// @returns The cache key for the given SOFA file with the current audio configuration, or an empty hash if
+	/// the file can not be read
+	BRTReaders::CHRTFCache::TKey cacheKey(const QString &sofaPath) const;
+	QString cachePath(const BRTReaders::CHRTFCache::TKey &key) const;
+	/// @returns Whether the retired HRTF (if any) has been destroyed
+	bool releaseRetired();
+
+	const int m_resamplingStep;
+	const QString m_cacheDirectory;
+	const BRTProcessing::TAmbisonicNormalization m_ambisonicNormalization;
+	Common::CGlobalParameters m_globalParameters;
+	BRTReaders::CSOFAReader m_sofaReader;
+
+	/// Written by the loader thread, taken by the audio thread
+	Result m_loaded;
+	std::atomic< bool > m_hasLoaded{ false };
+	/// Written by the audio thread, taken by the loader thread
+	Result m_retired;
+	std::atomic< bool > m_hasRetired{ false };
+
+	// Only accessed by the loader thread (or after it has been joined)
+	/// Whether an HRTF has been published and the matching retire() has not been processed yet
+	bool m_awaitingRetire = false;
+	std::chrono::steady_clock::time_point m_retiredSince;
+	/// The HRTF published last, which the impulse responses are rebuilt from when the order changes
+	std::shared_ptr< BRTServices::CHRTF > m_current;
+	int m_currentAmbisonicOrder = 0;
+
+	std::thread m_thread;
+	std::mutex m_requestMutex;
+	std::condition_variable m_requestCondition;
+	std::string m_requestedPath;
+	int m_ambisonicOrder;
+	bool m_hasRequest               = false;
+	bool m_hasAmbisonicOrderRequest = false;
+	bool m_stopRequested            = false;
+};
+
+#endif // MUMBLE_MUMBLE_HRTFLOADER_H_
@@ -28,11 +28,10 @@ static int iElevation = 0;
 
 static const QString defaultContext  = QString::fromLatin1("Mumble");
 static const QString defaultIdentity = QString::fromLatin1("Agent47");
-std::vector< unsigned int > Manual::bufferToBeDeleted = {};
-std::mutex Manual::bufferLock;
+TripleBuffer< ManualParameters > Manual::parameters;
 QString Manual::hrtfPath;
-bool Manual::hrtfChanged = false;
-bool Manual::isMono      = false;
+unsigned int Manual::hrtfGeneration = 0;
+bool Manual::isMono                 = false;
 #define HALF_ROOM_SIZE 10.0
 #define ROOM_SIZE (HALF_ROOM_SIZE * 2)
 
@@ -142,13 +141,6 @@ void Manual::setSpeakerPositions(const QHash< unsigned int, Position2D > &positi
 	}
 }
 
-void Manual::spatializeSpeakers(unsigned int id, float *pos) {
-	if (mDlg) {
-		QMetaObject::invokeMethod(mDlg, "on_bufferEntry", Qt::QueuedConnection, Q_ARG(unsigned int, id),
-								  Q_ARG(float *, pos));
-	}
-}
-
 void Manual::onUserAdded(mumble_connection_t connection, mumble_userid_t userID) {
 
 	createUserUI(ClientUser::c_qmUsers[userID]);
@@ -223,6 +215,7 @@ void Manual::on_qdsbX_valueChanged(double d) {
 	selected_item->setPos(static_cast< float >((d / ROOM_SIZE) * visible_scene_rect.width()),
 						  (-qdsbZ->value() / ROOM_SIZE) * visible_scene_rect.height());
 	userPos[userItem[selected_item]].x = static_cast< float >(d);
+	publishParameters();
 }
 
 void Manual::on_qdsbY_valueChanged(double d) {
@@ -230,6 +223,7 @@ void Manual::on_qdsbY_valueChanged(double d) {
 		my.avatar_pos[1] = my.camera_pos[1] = static_cast< float >(d);
 	}
 	userPos[userItem[selected_item]].y  = static_cast< float >(d);
+	publishParameters();
 }
 
 void Manual::on_qdsbZ_valueChanged(double d) {
@@ -239,6 +233,7 @@ void Manual::on_qdsbZ_valueChanged(double d) {
 	selected_item->setPos((qdsbX->value() / ROOM_SIZE) * visible_scene_rect.width(), 
 		-static_cast< float >((d / ROOM_SIZE) * visible_scene_rect.height()));
 	userPos[userItem[selected_item]].z = static_cast< float >(d);
+	publishParameters();
 }
 
 void Manual::on_qsbAzimuth_valueChanged(int i) {
@@ -460,13 +455,22 @@ void Manual::on_qsbSilentUserDisplaytime_valueChanged(int value) {
 	Global::get().s.manualPlugin_silentUserDisplaytime = value;
 }
 
-void Manual::on_bufferEntry(unsigned int id, float *pos) {
-	if (userPos.contains(id)) {
-		Position3D newPos = userPos.value(id);
-		pos[0]        = newPos.x;
-		pos[1]        = newPos.y;
-		pos[2]        = newPos.z;
+void Manual::publishParameters() {
+	ManualParameters &next = parameters.back();
+
+	next.positions.clear();
+	for (auto it = userPos.cbegin(); it != userPos.cend(); ++it) {
+		next.positions.push_back({ it.key(), it.value() });
 	}
+	std::sort(next.positions.begin(), next.positions.end(),
+			  [](const ManualParameters::SpeakerPosition &lhs, const ManualParameters::SpeakerPosition &rhs) {
+				  return lhs.session < rhs.session;
+			  });
+	next.isMono         = isMono;
+	next.hrtfPath       = hrtfPath.toStdString();
+	next.hrtfGeneration = hrtfGeneration;
+
+	parameters.publish();
 }
 
 
@@ -475,10 +479,9 @@ void Manual::on_select_HRTF_pressed() {
 	QString hrtfNewPath =
 		QFileDialog::getOpenFileName(this, tr("Open SOFA file"), "", tr("*.sofa"));
 	if (hrtfNewPath != hrtfPath) {
-		bufferLock.lock();
 		hrtfPath = hrtfNewPath;
-		hrtfChanged = true;
-		bufferLock.unlock();
+		++hrtfGeneration;
+		publishParameters();
 	}
 
 }
@@ -652,6 +655,8 @@ void Manual::createUserUI(const ClientUser *client) {
 		Top_left_selector->addItem(client->qsName, client->uiSession);
 		Bottom_right_selector->addItem(client->qsName, client->uiSession);
 		Top_right_selector->addItem(client->qsName, client->uiSession);
+
+		publishParameters();
 	}
 }
 
@@ -685,9 +690,8 @@ void Manual::deleteUserUI(mumble_userid_t userID) {
 		userItem.remove(item);
 		delete item;
 
-		bufferLock.lock();
-		bufferToBeDeleted.push_back(userID);
-		bufferLock.unlock();
+		// The audio thread gives the speaker's slot back once it is no longer in the published positions
+		publishParameters();
 	}
 
 }
@@ -985,6 +989,8 @@ void Manual::updateScreenPositions(int spatializationIndex) {
 		default:
 			break;
 	}
+
+	publishParameters();
 }
 
 static int trylock() {
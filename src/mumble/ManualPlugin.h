@@ -14,10 +14,13 @@
 #include "LegacyPlugin.h"
 #include "ui_ManualPlugin.h"
 #include "ClientUser.h"
+#include "TripleBuffer.h"
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
-#include <mutex>
+#include <string>
+#include <vector>
 #include <qfiledialog.h>
 #include <Qosc>
 #include <QUdpSocket>
@@ -37,9 +40,35 @@ Q_DECLARE_METATYPE(PositionMap)
 
 using PositionMap3D = QHash< unsigned int, Position3D >;
 Q_DECLARE_METATYPE(PositionMap3D)
-Q_DECLARE_METATYPE(float *)
 Q_DECLARE_METATYPE(const ClientUser *)
 
+/// What the audio thread renders with from the manual plugin's UI. The UI publishes a complete copy whenever
+/// something changes, see Manual::parameters.
+struct ManualParameters {
+	struct SpeakerPosition {
+		unsigned int session;
+		Position3D position;
+	};
+
+	/// Speakers placed in the UI, sorted by session
+	std::vector< SpeakerPosition > positions;
+	/// Whether spatialization is turned off by the selected layout
+	bool isMono = false;
+	/// SOFA file picked in the UI, empty for the default one
+	std::string hrtfPath;
+	/// Incremented whenever another SOFA file is picked
+	unsigned int hrtfGeneration = 0;
+
+	/// Does not allocate.
+	///
+	/// @returns The position of the given speaker or nullptr if it has not been placed
+	const Position3D *findPosition(unsigned int session) const {
+		auto it = std::lower_bound(positions.begin(), positions.end(), session,
+								   [](const SpeakerPosition &entry, unsigned int key) { return entry.session < key; });
+		return (it != positions.end() && it->session == session) ? &it->position : nullptr;
+	}
+};
+
 /// A struct holding information about a stale entry in the
 /// manual plugin's position window
 struct StaleEntry {
@@ -55,15 +84,11 @@ public:
 	Manual(QWidget *parent = 0);
 
 	static void setSpeakerPositions(const QHash< unsigned int, Position2D > &positions);
-	static void spatializeSpeakers(unsigned int, float *pos);
 	void onUserAdded(mumble_connection_t connection, mumble_userid_t userID);
 	void onUserRemoved(mumble_connection_t connection, mumble_userid_t userID);
 
-	static std::vector< unsigned int > bufferToBeDeleted;
-	static std::mutex bufferLock;
-	static QString hrtfPath;
-	static bool hrtfChanged;
-	static bool isMono;
+	/// Written by the GUI thread (see publishParameters()), read by AudioOutput::mix() once per block
+	static TripleBuffer< ManualParameters > parameters;
 
 public slots:
 	void on_qpbUnhinge_pressed();
@@ -89,7 +114,6 @@ public slots:
 	void on_Bottom_right_selector_currentIndexChanged(int);
 	void on_Top_right_selector_currentIndexChanged(int);
 
-	void on_bufferEntry(unsigned int id, float *pos);
 	void on_speakerPositionUpdate(PositionMap positions);
 
 	void on_updateStaleSpeakers();
@@ -112,6 +136,14 @@ protected:
 	QHash< QGraphicsItem *, QGraphicsTextItem * > userName;
 	//add correlation between id and bufferpos
 
+	/// Kept across instances of the dialog, like the state the audio thread got from them
+	static QString hrtfPath;
+	static unsigned int hrtfGeneration;
+	static bool isMono;
+	/// Hands the speaker positions, the layout and the HRTF over to the audio thread. Must be called after
+	/// every change to any of them.
+	void publishParameters();
+
 	bool eventFilter(QObject *, QEvent *);
 	void changeEvent(QEvent *e);
 	void updateTopAndFront(int orientation, int azimut);
@@ -0,0 +1,138 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_SAMPLEFIFO_H_
+#define MUMBLE_MUMBLE_SAMPLEFIFO_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+/// First in, first out queue of samples over a ring of fixed capacity. It carries audio across blocks of different
+/// sizes, e.g. from the blocks the audio backend asks for to the fixed blocks a renderer works with.
+///
+/// Only reserve() and grow() allocate. Pushing more samples than there is room for or popping more than there are is
+/// a bug of the caller. Not thread-safe.
+class SampleFifo {
+public:
+	SampleFifo() = default;
+
+	/// Empties the queue and makes room for at least the given number of samples. Only allocates if the current
+	/// capacity is smaller.
+	void reserve(std::size_t capacity) {
+		if (capacity > m_ring.size()) {
+			m_ring.assign(capacity, 0.0f);
+		}
+		clear();
+	}
+	/// Makes room for at least the given number of samples, keeping the queued ones. Only allocates if the current
+	/// capacity is smaller.
+	void grow(std::size_t capacity) {
+		if (capacity <= m_ring.size()) {
+			return;
+		}
+		std::vector< float > ring(capacity, 0.0f);
+		const std::size_t size = m_size;
+		pop(ring.data(), size);
+		m_ring.swap(ring);
+		m_head = 0;
+		m_size = size;
+	}
+	/// Empties the queue without releasing its storage
+	void clear() {
+		m_head = 0;
+		m_size = 0;
+	}
+
+	std::size_t capacity() const { return m_ring.size(); }
+	std::size_t size() const { return m_size; }
+	std::size_t space() const { return m_ring.size() - m_size; }
+
+	/// Appends the given samples
+	void push(const float *samples, std::size_t count) {
+		assert(count <= space());
+		std::size_t tail = end();
+		while (count > 0) {
+			const std::size_t chunk = std::min(count, m_ring.size() - tail);
+			std::copy(samples, samples + chunk, m_ring.begin() + static_cast< std::ptrdiff_t >(tail));
+			samples += chunk;
+			count -= chunk;
+			m_size += chunk;
+			tail = 0;
+		}
+	}
+	/// Appends the given number of zeros
+	void pushSilence(std::size_t count) {
+		assert(count <= space());
+		std::size_t tail = end();
+		while (count > 0) {
+			const std::size_t chunk = std::min(count, m_ring.size() - tail);
+			std::fill_n(m_ring.begin() + static_cast< std::ptrdiff_t >(tail), chunk, 0.0f);
+			count -= chunk;
+			m_size += chunk;
+			tail = 0;
+		}
+	}
+	/// Removes the given number of samples from the front and copies them out
+	void pop(float *samples, std::size_t count) {
+		assert(count <= m_size);
+		while (count > 0) {
+			const std::size_t chunk = std::min(count, m_ring.size() - m_head);
+			std::copy_n(m_ring.begin() + static_cast< std::ptrdiff_t >(m_head), chunk, samples);
+			samples += chunk;
+			count -= chunk;
+			m_size -= chunk;
+			m_head = (m_head + chunk) % m_ring.size();
+		}
+	}
+
+private:
+	/// Position right after the last sample
+	std::size_t end() const { return m_ring.empty() ? 0 : (m_head + m_size) % m_ring.size(); }
+
+	std::vector< float > m_ring;
+	/// Position of the first sample
+	std::size_t m_head = 0;
+	std::size_t m_size = 0;
+};
+
+/// How much the output of a renderer working in quanta of a fixed size has to be delayed, so that the blocks of
+/// another size taken from it never find it empty. The speech waiting for the next quantum is always a multiple of
+/// the greatest common divisor of the quantum and of every block size served so far and less than a quantum. The
+/// output, which holds the rest of the delay, must hold at least as much.
+///
+/// The delay only ever grows, up to one sample less than a quantum, which serves blocks of any size.
+class RechunkingDelay {
+public:
+	/// Starts over for the given quantum, without any delay
+	void reset(std::size_t quantum) {
+		m_quantum = quantum;
+		m_divisor = quantum;
+		m_delay   = 0;
+	}
+
+	/// Takes a block of the given size into account
+	///
+	/// @returns The number of samples of silence that have to be added to the output before serving the block
+	std::size_t serve(std::size_t blockSize) {
+		m_divisor               = std::gcd(m_divisor, blockSize);
+		const std::size_t delay = m_quantum - m_divisor;
+		const std::size_t added = delay - m_delay;
+		m_delay                 = delay;
+		return added;
+	}
+
+	std::size_t delay() const { return m_delay; }
+
+private:
+	std::size_t m_quantum = 0;
+	/// Greatest common divisor of the quantum and of the blocks served since the last reset
+	std::size_t m_divisor = 0;
+	std::size_t m_delay   = 0;
+};
+
+#endif // MUMBLE_MUMBLE_SAMPLEFIFO_H_
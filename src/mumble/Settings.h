@@ -208,6 +208,7 @@ struct Settings {
 	enum AlwaysOnTopBehaviour { OnTopNever, OnTopAlways, OnTopInMinimal, OnTopInNormal };
 	enum ProxyType { NoProxy, HttpProxy, Socks5Proxy };
 	enum RecordingMode { RecordingMixdown, RecordingMultichannel };
+	enum SpatialRendering { SpatialRenderingAutomatic, SpatialRenderingPerSource, SpatialRenderingAmbisonic };
 
 	typedef QPair< QList< QSslCertificate >, QSslKey > KeyPair;
 
@@ -339,6 +340,28 @@ struct Settings {
 	float fAudioMaxDistance       = 15.0f;
 	float fAudioMaxDistVolume     = 0.0f;
 	float fAudioBloom             = 0.5f;
+
+	/// How the speakers are spatialized: with one HRTF convolution each, through a shared ambisonic bus that is
+	/// convolved once per ear and channel, or with the latter only while more than iAmbisonicSpeakerThreshold
+	/// speakers are talking.
+	SpatialRendering srSpatialRendering = SpatialRenderingAutomatic;
+	/// Order of the ambisonic bus (1 to 3). Higher orders localize better but cost more convolutions.
+	int iAmbisonicOrder = 1;
+	/// Number of talking speakers above which the ambisonic bus is used in automatic mode
+	int iAmbisonicSpeakerThreshold = 12;
+	/// Number of speakers spatialized with interpolated HRIRs and the near field effect when they are rendered one by
+	/// one. The loudest and closest speakers get them, the others are rendered more cheaply.
+	int iFullDetailSpeakers = 4;
+	/// Number of further speakers convolved with the nearest HRIRs only. All remaining speakers are just panned.
+	int iReducedDetailSpeakers = 8;
+	/// Angle (in degrees) a speaker can move relative to the listener before its HRIRs are looked up again. The
+	/// interpolated HRIRs are also computed at directions rounded to it, so that they can be cached. 0 disables both.
+	float fHRIRTolerance = 1.0f;
+	/// Number of samples the speakers are spatialized in at a time, whatever the audio backend asks for. Smaller
+	/// blocks lower the latency of the binaural output but cost more FFTs per second. 0 uses the frame size of the
+	/// mixer (10 ms). Clamped to 32..4096 and applied when the audio output starts.
+	int iBinauralBlockSize = 0;
+
 	/// Contains the settings for each individual plugin. The key in this map is the Hex-represented SHA-1
 	/// hash of the plugin's UTF-8 encoded absolute file-path on the hard-drive.
 	QHash< QString, PluginSetting > qhPluginSettings = {};
@@ -88,6 +88,13 @@ const SettingsKey POSITIONAL_MAX_DISTANCE_KEY      = { "maximum_distance" };
 const SettingsKey POSITIONAL_MIN_VOLUME_KEY        = { "minimum_volume" };
 const SettingsKey POSITIONAL_BLOOM_KEY             = { "bloom" };
 const SettingsKey POSITIONAL_TRANSMIT_POSITION_KEY = { "transmit_position" };
+const SettingsKey SPATIAL_RENDERING_KEY            = { "spatial_rendering" };
+const SettingsKey AMBISONIC_ORDER_KEY              = { "ambisonic_order" };
+const SettingsKey AMBISONIC_SPEAKER_THRESHOLD_KEY  = { "ambisonic_speaker_threshold" };
+const SettingsKey FULL_DETAIL_SPEAKERS_KEY         = { "full_detail_speakers" };
+const SettingsKey REDUCED_DETAIL_SPEAKERS_KEY      = { "reduced_detail_speakers" };
+const SettingsKey HRIR_TOLERANCE_KEY               = { "hrir_tolerance" };
+const SettingsKey BINAURAL_BLOCK_SIZE_KEY          = { "binaural_block_size" };
 
 // Network
 const SettingsKey JITTER_BUFFER_SIZE_KEY            = { "jitter_buffer_size" };
@@ -66,14 +66,21 @@
 	PROCESS(idle, UNDO_IDLE_ACTION_UPON_ACTIVITY, bUndoIdleActionUponActivity)
 
 
-#define POSITIONAL_AUDIO_SETTINGS                                                  \
-	PROCESS(positional_audio, ENABLE_POSITIONAL_AUDIO_KEY, bPositionalAudio)       \
-	PROCESS(positional_audio, POSITIONAL_MIN_DISTANCE_KEY, fAudioMinDistance)      \
-	PROCESS(positional_audio, POSITIONAL_MAX_DISTANCE_KEY, fAudioMaxDistance)      \
-	PROCESS(positional_audio, POSITIONAL_MIN_VOLUME_KEY, fAudioMaxDistVolume)      \
-	PROCESS(positional_audio, POSITIONAL_BLOOM_KEY, fAudioBloom)                   \
-	PROCESS(positional_audio, POSITIONAL_HEADPHONE_MODE_KEY, bPositionalHeadphone) \
-	PROCESS(positional_audio, POSITIONAL_TRANSMIT_POSITION_KEY, bTransmitPosition)
+#define POSITIONAL_AUDIO_SETTINGS                                                          \
+	PROCESS(positional_audio, ENABLE_POSITIONAL_AUDIO_KEY, bPositionalAudio)               \
+	PROCESS(positional_audio, POSITIONAL_MIN_DISTANCE_KEY, fAudioMinDistance)              \
+	PROCESS(positional_audio, POSITIONAL_MAX_DISTANCE_KEY, fAudioMaxDistance)              \
+	PROCESS(positional_audio, POSITIONAL_MIN_VOLUME_KEY, fAudioMaxDistVolume)              \
+	PROCESS(positional_audio, POSITIONAL_BLOOM_KEY, fAudioBloom)                           \
+	PROCESS(positional_audio, POSITIONAL_HEADPHONE_MODE_KEY, bPositionalHeadphone)         \
+	PROCESS(positional_audio, POSITIONAL_TRANSMIT_POSITION_KEY, bTransmitPosition)         \
+	PROCESS(positional_audio, SPATIAL_RENDERING_KEY, srSpatialRendering)                   \
+	PROCESS(positional_audio, AMBISONIC_ORDER_KEY, iAmbisonicOrder)                        \
+	PROCESS(positional_audio, AMBISONIC_SPEAKER_THRESHOLD_KEY, iAmbisonicSpeakerThreshold) \
+	PROCESS(positional_audio, FULL_DETAIL_SPEAKERS_KEY, iFullDetailSpeakers)               \
+	PROCESS(positional_audio, REDUCED_DETAIL_SPEAKERS_KEY, iReducedDetailSpeakers)         \
+	PROCESS(positional_audio, HRIR_TOLERANCE_KEY, fHRIRTolerance)                          \
+	PROCESS(positional_audio, BINAURAL_BLOCK_SIZE_KEY, iBinauralBlockSize)
 
 
 #define NETWORK_SETTINGS                                                     \
@@ -0,0 +1,63 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MUMBLE_TRIPLEBUFFER_H_
+#define MUMBLE_MUMBLE_TRIPLEBUFFER_H_
+
+#include <array>
+#include <atomic>
+
+/// Hands the latest value written by one thread over to another one, without locks and without either of them
+/// ever waiting. The writer fills in the back buffer and publishes it, the reader picks up the most recent
+/// publication and keeps reading it until it asks for a newer one.
+///
+/// Values published in between two updates of the reader are skipped, so this is meant for state (positions,
+/// settings) and not for events that must not be lost. Exactly one thread may write and one thread may read at a
+/// time. Nothing in here allocates, but copying T into the back buffer may.
+template< typename T > class TripleBuffer {
+public:
+	TripleBuffer() = default;
+	explicit TripleBuffer(const T &initial) : m_buffers{ { initial, initial, initial } } {}
+
+	TripleBuffer(const TripleBuffer &) = delete;
+	TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+	/// Writer only.
+	///
+	/// @returns The buffer to be published next. It holds an older value, so it has to be written in full.
+	T &back() { return m_buffers[m_back]; }
+	/// Writer only. Makes the back buffer the latest value and takes another one as the back buffer.
+	void publish() { m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+	/// Reader only. Picks up the latest published value, if there is one the reader has not seen yet.
+	///
+	/// @returns Whether front() holds a new value
+	bool update() {
+		if (!(m_middle.load(std::memory_order_relaxed) & FRESH)) {
+			return false;
+		}
+		m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+	/// Reader only.
+	///
+	/// @returns The value picked up by the last update(). It stays valid and unchanged until the next one.
+	const T &front() const { return m_buffers[m_front]; }
+
+private:
+	static constexpr unsigned int INDEX = 0x3;
+	/// Set on the middle buffer while it holds a value the reader has not picked up yet
+	static constexpr unsigned int FRESH = 0x4;
+
+	std::array< T, 3 > m_buffers;
+	/// Only accessed by the writer
+	unsigned int m_back = 0;
+	/// Index of the buffer in between, owned by neither side
+	std::atomic< unsigned int > m_middle{ 1 };
+	/// Only accessed by the reader
+	unsigned int m_front = 2;
+};
+
+#endif // MUMBLE_MUMBLE_TRIPLEBUFFER_H_
@@ -2181,7 +2181,7 @@ void Server::msgVoiceTarget(ServerUser *uSource, MumbleProto::VoiceTarget &msg)
 
 	QWriteLocker lock(&qrwlVoiceThread);
 
-	uSource->qmTargetCache.remove(target);
+	uSource->clearTargetCache(target);
 
 	int count = msg.targets_size();
 	if (count == 0) {
@@ -97,6 +97,9 @@ MetaParams::MetaParams() {
 	iChannelNestingLimit = 10;
 	iChannelCountLimit   = 1000;
 
+	iVoiceThreads = 1;
+	bIoUring      = false;
+
 	qrUserName    = QRegExp(QLatin1String("[ -=\\w\\[\\]\\{\\}\\(\\)\\@\\|\\.]+"));
 	qrChannelName = QRegExp(QLatin1String("[ -=\\w\\#\\[\\]\\{\\}\\(\\)\\@\\|]+"));
 
@@ -345,6 +348,9 @@ void MetaParams::read(QString fname) {
 	iChannelNestingLimit = typeCheckedFromSettings("channelnestinglimit", iChannelNestingLimit);
 	iChannelCountLimit   = typeCheckedFromSettings("channelcountlimit", iChannelCountLimit);
 
+	iVoiceThreads = typeCheckedFromSettings("voicethreads", iVoiceThreads);
+	bIoUring      = typeCheckedFromSettings("iouring", bIoUring);
+
 #ifdef Q_OS_UNIX
 	qsName = qsSettings->value("uname").toString();
 	if (geteuid() == 0) {
@@ -435,6 +441,8 @@ void MetaParams::read(QString fname) {
 	qmConfig.insert(QLatin1String("opusthreshold"), QString::number(iOpusThreshold));
 	qmConfig.insert(QLatin1String("channelnestinglimit"), QString::number(iChannelNestingLimit));
 	qmConfig.insert(QLatin1String("channelcountlimit"), QString::number(iChannelCountLimit));
+	qmConfig.insert(QLatin1String("voicethreads"), QString::number(iVoiceThreads));
+	qmConfig.insert(QLatin1String("iouring"), bIoUring ? QLatin1String("true") : QLatin1String("false"));
 	qmConfig.insert(QLatin1String("sslCiphers"), qsCiphers);
 	qmConfig.insert(QLatin1String("sslDHParams"), QString::fromLatin1(qbaDHParams.constData()));
 }
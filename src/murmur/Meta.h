@@ -46,6 +46,10 @@ public:
 	int iOpusThreshold;
 	int iChannelNestingLimit;
 	int iChannelCountLimit;
+	/// Number of threads receiving and forwarding voice for each virtual server. 0 means one per CPU core.
+	int iVoiceThreads;
+	/// If true the voice threads use io_uring instead of poll() and recvmmsg()/sendmmsg(), if supported
+	bool bIoUring;
 	/// If true the old SHA1 password hashing is used instead of PBKDF2
 	bool legacyPasswordHash;
 	/// Contains the default number of PBKDF2 iterations to use
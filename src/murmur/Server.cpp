@@ -26,6 +26,10 @@
 #	include "Zeroconf.h"
 #endif
 
+#ifdef USE_IO_URING
+#	include "UDPRing.h"
+#endif
+
 #include "Utils.h"
 
 #include <QtCore/QCoreApplication>
@@ -43,6 +47,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <string>
 #include <vector>
 
 #ifdef Q_OS_WIN
@@ -76,6 +81,13 @@ QSslSocket *SslServer::nextPendingSSLConnection() {
 	return qlSockets.takeFirst();
 }
 
+VoiceThread::VoiceThread(Server &server, VoiceThreadContext &context, QObject *p)
+	: QThread(p), m_server(server), m_context(context) {
+}
+
+void VoiceThread::run() {
+	m_server.runVoiceLoop(m_context);
+}
 
 Server::Server(int snum, QObject *p) : QThread(p) {
 	tracy::SetThreadName("Main");
@@ -120,6 +132,24 @@ Server::Server(int snum, QObject *p) : QThread(p) {
 	if (!bValid)
 		return;
 
+	unsigned int voiceThreads = static_cast< unsigned int >(
+		iVoiceThreads > 0 ? iVoiceThreads : std::max(1, QThread::idealThreadCount()));
+#if !defined(Q_OS_LINUX) || !defined(SO_REUSEPORT)
+	if (voiceThreads > 1) {
+		log("Server: More than one voice thread needs the SO_REUSEPORT load balancing of Linux, using one");
+		voiceThreads = 1;
+	}
+#endif
+#ifndef USE_IO_URING
+	if (bIoUring) {
+		log("Server: Built without io_uring support, the voice threads use poll()");
+	}
+#endif
+	for (unsigned int i = 0; i < voiceThreads; ++i) {
+		m_voiceThreadContexts.push_back(std::make_unique< VoiceThreadContext >());
+		m_voiceThreadContexts.back()->index = i;
+	}
+
 	foreach (SslServer *ss, qlServer) {
 		sockaddr_storage addr;
 #ifdef Q_OS_UNIX
@@ -131,80 +161,98 @@ Server::Server(int snum, QObject *p) : QThread(p) {
 #endif
 		memset(&addr, 0, sizeof(addr));
 		getsockname(tcpsock, reinterpret_cast< struct sockaddr * >(&addr), &len);
+		for (const std::unique_ptr< VoiceThreadContext > &context : m_voiceThreadContexts) {
 #ifdef Q_OS_UNIX
-		int sock = ::socket(addr.ss_family, SOCK_DGRAM, 0);
+			int sock = ::socket(addr.ss_family, SOCK_DGRAM, 0);
 #	ifdef Q_OS_LINUX
-		int sockopt = 1;
-		if (setsockopt(sock, IPPROTO_IP, IP_PKTINFO, &sockopt, sizeof(sockopt)))
-			log(QString("Failed to set IP_PKTINFO for %1").arg(addressToString(ss->serverAddress(), usPort)));
-		sockopt = 1;
-		if (setsockopt(sock, IPPROTO_IPV6, IPV6_RECVPKTINFO, &sockopt, sizeof(sockopt)))
-			log(QString("Failed to set IPV6_RECVPKTINFO for %1").arg(addressToString(ss->serverAddress(), usPort)));
+			int sockopt = 1;
+			if (setsockopt(sock, IPPROTO_IP, IP_PKTINFO, &sockopt, sizeof(sockopt)))
+				log(QString("Failed to set IP_PKTINFO for %1").arg(addressToString(ss->serverAddress(), usPort)));
+			sockopt = 1;
+			if (setsockopt(sock, IPPROTO_IPV6, IPV6_RECVPKTINFO, &sockopt, sizeof(sockopt)))
+				log(QString("Failed to set IPV6_RECVPKTINFO for %1")
+						.arg(addressToString(ss->serverAddress(), usPort)));
 #	endif
 #else
 #	ifndef SIO_UDP_CONNRESET
 #		define SIO_UDP_CONNRESET _WSAIOW(IOC_VENDOR, 12)
 #	endif
-		SOCKET sock           = ::WSASocket(addr.ss_family, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0, WSA_FLAG_OVERLAPPED);
-		DWORD dwBytesReturned = 0;
-		BOOL bNewBehaviour    = FALSE;
-		if (WSAIoctl(sock, SIO_UDP_CONNRESET, &bNewBehaviour, sizeof(bNewBehaviour), nullptr, 0, &dwBytesReturned,
-					 nullptr, nullptr)
-			== SOCKET_ERROR) {
-			log(QString("Failed to set SIO_UDP_CONNRESET: %1").arg(WSAGetLastError()));
-		}
+			SOCKET sock =
+				::WSASocket(addr.ss_family, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0, WSA_FLAG_OVERLAPPED);
+			DWORD dwBytesReturned = 0;
+			BOOL bNewBehaviour    = FALSE;
+			if (WSAIoctl(sock, SIO_UDP_CONNRESET, &bNewBehaviour, sizeof(bNewBehaviour), nullptr, 0, &dwBytesReturned,
+						 nullptr, nullptr)
+				== SOCKET_ERROR) {
+				log(QString("Failed to set SIO_UDP_CONNRESET: %1").arg(WSAGetLastError()));
+			}
 #endif
-		if (sock == INVALID_SOCKET) {
-			log("Failed to create UDP Socket");
-			bValid = false;
-			return;
-		} else {
-			if (addr.ss_family == AF_INET6) {
-				// Copy IPV6_V6ONLY attribute from tcp socket, it defaults to nonzero on Windows
-				// See https://msdn.microsoft.com/en-us/library/windows/desktop/ms738574%28v=vs.85%29.aspx
-				// This will fail for WindowsXP which is ok. Our TCP code will have split that up
-				// into two sockets.
-				int ipv6only     = 0;
-				socklen_t optlen = sizeof(ipv6only);
-				if (::getsockopt(tcpsock, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast< char * >(&ipv6only), &optlen)
-					== 0) {
-					if (::setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast< const char * >(&ipv6only),
-									 optlen)
-						== SOCKET_ERROR) {
-						log(QString("Failed to copy IPV6_V6ONLY socket attribute from tcp to udp socket"));
+			if (sock == INVALID_SOCKET) {
+				log("Failed to create UDP Socket");
+				bValid = false;
+				return;
+			} else {
+				if (addr.ss_family == AF_INET6) {
+					// Copy IPV6_V6ONLY attribute from tcp socket, it defaults to nonzero on Windows
+					// See https://msdn.microsoft.com/en-us/library/windows/desktop/ms738574%28v=vs.85%29.aspx
+					// This will fail for WindowsXP which is ok. Our TCP code will have split that up
+					// into two sockets.
+					int ipv6only     = 0;
+					socklen_t optlen = sizeof(ipv6only);
+					if (::getsockopt(tcpsock, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast< char * >(&ipv6only),
+									 &optlen)
+						== 0) {
+						if (::setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast< const char * >(&ipv6only),
+										 optlen)
+							== SOCKET_ERROR) {
+							log(QString("Failed to copy IPV6_V6ONLY socket attribute from tcp to udp socket"));
+						}
 					}
 				}
-			}
 
-			if (::bind(sock, reinterpret_cast< sockaddr * >(&addr), len) == SOCKET_ERROR) {
-				log(QString("Failed to bind UDP Socket to %1").arg(addressToString(ss->serverAddress(), usPort)));
-			} else {
-#ifdef Q_OS_UNIX
-				int val = 0xe0;
-				if (setsockopt(sock, IPPROTO_IP, IP_TOS, &val, sizeof(val))) {
-					val = 0x80;
-					if (setsockopt(sock, IPPROTO_IP, IP_TOS, &val, sizeof(val)))
-						log("Server: Failed to set TOS for UDP Socket");
+#if defined(Q_OS_LINUX) && defined(SO_REUSEPORT)
+				if (voiceThreads > 1) {
+					// Every voice thread binds a socket to the same address. The kernel picks the socket for a
+					// packet by a hash of the addresses, so all packets of a client end up in the same voice thread.
+					int reuse = 1;
+					if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)))
+						log(QString("Failed to set SO_REUSEPORT for %1")
+								.arg(addressToString(ss->serverAddress(), usPort)));
 				}
+#endif
+
+				if (::bind(sock, reinterpret_cast< sockaddr * >(&addr), len) == SOCKET_ERROR) {
+					log(QString("Failed to bind UDP Socket to %1").arg(addressToString(ss->serverAddress(), usPort)));
+				} else {
+#ifdef Q_OS_UNIX
+					int val = 0xe0;
+					if (setsockopt(sock, IPPROTO_IP, IP_TOS, &val, sizeof(val))) {
+						val = 0x80;
+						if (setsockopt(sock, IPPROTO_IP, IP_TOS, &val, sizeof(val)))
+							log("Server: Failed to set TOS for UDP Socket");
+					}
 #	if defined(SO_PRIORITY)
-				socklen_t optlen = sizeof(val);
-				if (getsockopt(sock, SOL_SOCKET, SO_PRIORITY, &val, &optlen) == 0) {
-					if (val == 0) {
-						val = 6;
-						setsockopt(sock, SOL_SOCKET, SO_PRIORITY, &val, sizeof(val));
+					socklen_t optlen = sizeof(val);
+					if (getsockopt(sock, SOL_SOCKET, SO_PRIORITY, &val, &optlen) == 0) {
+						if (val == 0) {
+							val = 6;
+							setsockopt(sock, SOL_SOCKET, SO_PRIORITY, &val, sizeof(val));
+						}
 					}
-				}
 #	endif
 #endif
+				}
+				QSocketNotifier *qsn = new QSocketNotifier(sock, QSocketNotifier::Read, this);
+				connect(qsn, SIGNAL(activated(int)), this, SLOT(udpActivated(int)));
+				qlUdpSocket << sock;
+				qlUdpNotifier << qsn;
+				context->qlUdpSocket << sock;
 			}
-			QSocketNotifier *qsn = new QSocketNotifier(sock, QSocketNotifier::Read, this);
-			connect(qsn, SIGNAL(activated(int)), this, SLOT(udpActivated(int)));
-			qlUdpSocket << sock;
-			qlUdpNotifier << qsn;
 		}
 	}
 
-	bValid = bValid && (qlServer.count() == qlBind.count()) && (qlUdpSocket.count() == qlBind.count());
+	bValid = bValid && (qlServer.count() == qlBind.count())
+			 && (qlUdpSocket.count() == qlBind.count() * static_cast< int >(voiceThreads));
 	if (!bValid)
 		return;
 
@@ -225,6 +273,9 @@ Server::Server(int snum, QObject *p) : QThread(p) {
 	for (unsigned int i = 1; i < iMaxUsers * 2; ++i)
 		qqIds.enqueue(i);
 
+	for (std::size_t i = 1; i < m_voiceThreadContexts.size(); ++i)
+		qlVoiceThreads << new VoiceThread(*this, *m_voiceThreadContexts[i], this);
+
 	connect(qtTimeout, SIGNAL(timeout()), this, SLOT(checkTimeout()));
 
 	getBans();
@@ -249,6 +300,8 @@ void Server::startThread() {
 		foreach (QSocketNotifier *qsn, qlUdpNotifier)
 			qsn->setEnabled(false);
 		start(QThread::HighestPriority);
+		foreach (VoiceThread *thread, qlVoiceThreads)
+			thread->start(QThread::HighestPriority);
 #ifdef Q_OS_LINUX
 		// QThread::HighestPriority == Same as everything else...
 		int policy;
@@ -279,6 +332,13 @@ void Server::stopThread() {
 		SetEvent(hNotify);
 #endif
 		wait();
+		foreach (VoiceThread *thread, qlVoiceThreads)
+			thread->wait();
+#ifdef Q_OS_UNIX
+		// The voice threads leave the byte in the socket so that every one of them sees it
+		while (::recv(aiNotify[0], &val, 1, MSG_DONTWAIT) == 1) {
+		};
+#endif
 
 		foreach (QSocketNotifier *qsn, qlUdpNotifier)
 			qsn->setEnabled(true);
@@ -354,6 +414,8 @@ void Server::readParams() {
 	iOpusThreshold                     = Meta::mp.iOpusThreshold;
 	iChannelNestingLimit               = Meta::mp.iChannelNestingLimit;
 	iChannelCountLimit                 = Meta::mp.iChannelCountLimit;
+	iVoiceThreads                      = Meta::mp.iVoiceThreads;
+	bIoUring                           = Meta::mp.bIoUring;
 
 	QString qsHost = getConf("host", QString()).toString();
 	if (!qsHost.isEmpty()) {
@@ -444,6 +506,9 @@ void Server::readParams() {
 	iChannelNestingLimit = getConf("channelnestinglimit", iChannelNestingLimit).toInt();
 	iChannelCountLimit   = getConf("channelcountlimit", iChannelCountLimit).toInt();
 
+	iVoiceThreads = getConf("voicethreads", iVoiceThreads).toInt();
+	bIoUring      = getConf("iouring", bIoUring).toBool();
+
 	qrUserName    = QRegExp(getConf("username", qrUserName.pattern()).toString());
 	qrChannelName = QRegExp(getConf("channelname", qrChannelName.pattern()).toString());
 
@@ -734,27 +799,60 @@ void Server::udpActivated(int socket) {
 }
 
 void Server::run() {
-	tracy::SetThreadName("Audio");
+	runVoiceLoop(*m_voiceThreadContexts.front());
+}
+
+#ifdef Q_OS_LINUX
+/// Sends the answer to an unencrypted ping from the local address the ping came in on, which the header it has been
+/// received with still holds
+static void sendPingReply(int sock, struct msghdr &msg, gsl::span< const Mumble::Protocol::byte > reply) {
+	// We are only reading from the buffer and thus the const_cast should be fine
+	msg.msg_iov[0].iov_base = const_cast< Mumble::Protocol::byte * >(reply.data());
+	msg.msg_iov[0].iov_len  = reply.size();
+	::sendmsg(sock, &msg, 0);
+}
+#endif
+
+void Server::runVoiceLoop(VoiceThreadContext &context) {
+	const std::string threadName = context.index == 0 ? "Audio" : "Audio " + std::to_string(context.index);
+	tracy::SetThreadName(threadName.c_str());
+
+#ifdef USE_IO_URING
+	if (bIoUring) {
+		UDPRing ring;
+		const std::vector< int > sockets(context.qlUdpSocket.begin(), context.qlUdpSocket.end());
+		if (ring.init(sockets, aiNotify[0]) && runVoiceRing(context, ring)) {
+			return;
+		}
+		qWarning("%d => io_uring is not available for voice thread %u, using poll()", iServerNum, context.index);
+	}
+#endif
 
+#ifdef Q_OS_LINUX
+	// Datagrams are received into and sent from the batches of the context
+	UDPSendBatch *sendBatch = &context.sendBatch;
+#else
 	qint32 len;
-#if defined(__LP64__)
+#	if defined(__LP64__)
 	unsigned char encbuff[Mumble::Protocol::MAX_UDP_PACKET_SIZE + 8];
 	unsigned char *encrypt = encbuff + 4;
-#else
+#	else
 	unsigned char encrypt[Mumble::Protocol::MAX_UDP_PACKET_SIZE];
+#	endif
+	sockaddr_storage from;
 #endif
-	unsigned char buffer[Mumble::Protocol::MAX_UDP_PACKET_SIZE];
 
-	sockaddr_storage from;
-	unsigned int nfds = static_cast< unsigned int >(qlUdpSocket.count());
+	unsigned int nfds = static_cast< unsigned int >(context.qlUdpSocket.count());
 
 #ifdef Q_OS_UNIX
+#	ifndef Q_OS_LINUX
 	socklen_t fromlen;
+#	endif
 	std::vector< struct pollfd > fds;
 	fds.resize(static_cast< std::size_t >(nfds + 1));
 
 	for (unsigned int i = 0; i < nfds; ++i) {
-		fds[i].fd      = qlUdpSocket.at(static_cast< int >(i));
+		fds[i].fd      = context.qlUdpSocket.at(static_cast< int >(i));
 		fds[i].events  = POLLIN;
 		fds[i].revents = 0;
 	}
@@ -769,7 +867,7 @@ void Server::run() {
 	std::vector< HANDLE > events;
 	events.resize(nfds + 1);
 	for (unsigned int i = 0; i < nfds; ++i) {
-		fds[i]    = qlUdpSocket.at(i);
+		fds[i]    = context.qlUdpSocket.at(i);
 		events[i] = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 		::WSAEventSelect(fds[i], events[i], FD_READ);
 	}
@@ -792,10 +890,7 @@ void Server::run() {
 		}
 
 		if (fds[nfds - 1].revents) {
-			// Drain pipe
-			unsigned char val;
-			while (::recv(aiNotify[0], &val, 1, MSG_DONTWAIT) == 1) {
-			};
+			// Not drained, the other voice threads have to see it as well. stopThread() drains it.
 			break;
 		}
 
@@ -823,188 +918,224 @@ void Server::run() {
 				SOCKET sock = fds[ret - WAIT_OBJECT_0];
 #endif
 
+#ifdef Q_OS_LINUX
+				const int received = context.receiveBatch.receive(sock);
+				for (int datagram = 0; datagram < received; ++datagram) {
+					const unsigned int index = static_cast< unsigned int >(datagram);
+
+					gsl::span< const Mumble::Protocol::byte > pingReply =
+						handleDatagram(context, sock, context.receiveBatch.data(index),
+									   static_cast< qint32 >(context.receiveBatch.length(index)),
+									   context.receiveBatch.from(index), sendBatch);
+					if (!pingReply.empty()) {
+						sendPingReply(sock, context.receiveBatch.header(index), pingReply);
+					}
+				}
+#else
 				fromlen = sizeof(from);
-#ifdef Q_OS_WIN
+#	ifdef Q_OS_WIN
 				len = ::recvfrom(sock, reinterpret_cast< char * >(encrypt), Mumble::Protocol::MAX_UDP_PACKET_SIZE, 0,
 								 reinterpret_cast< struct sockaddr * >(&from), &fromlen);
-#else
-#	ifdef Q_OS_LINUX
-				struct msghdr msg;
-				struct iovec iov[1];
-
-				iov[0].iov_base = encrypt;
-				iov[0].iov_len  = Mumble::Protocol::MAX_UDP_PACKET_SIZE;
-
-				uint8_t controldata[CMSG_SPACE(std::max(sizeof(struct in6_pktinfo), sizeof(struct in_pktinfo)))];
-
-				memset(&msg, 0, sizeof(msg));
-				msg.msg_name       = reinterpret_cast< struct sockaddr * >(&from);
-				msg.msg_namelen    = sizeof(from);
-				msg.msg_iov        = iov;
-				msg.msg_iovlen     = 1;
-				msg.msg_control    = controldata;
-				msg.msg_controllen = sizeof(controldata);
-
-				len = static_cast< qint32 >(::recvmsg(sock, &msg, MSG_TRUNC));
-				Q_UNUSED(fromlen);
 #	else
 				len = static_cast< qint32 >(::recvfrom(sock, encrypt, Mumble::Protocol::MAX_UDP_PACKET_SIZE, MSG_TRUNC,
 													   reinterpret_cast< struct sockaddr * >(&from), &fromlen));
 #	endif
-#endif
 
-				// Capture only the processing without the polling
-				ZoneScopedN(TracyConstants::UDP_PACKET_PROCESSING_ZONE);
-
-				if (len == 0) {
-					break;
-				} else if (len == SOCKET_ERROR) {
-					break;
-				} else if (len < 5) {
-					// 4 bytes crypt header + type + session
-					continue;
-				} else if (static_cast< unsigned int >(len) > Mumble::Protocol::MAX_UDP_PACKET_SIZE) {
-					// This will also catch the len == -1 case (indicating error)
-					static_assert(static_cast< unsigned int >(-1) > Mumble::Protocol::MAX_UDP_PACKET_SIZE,
-								  "Invalid assumption");
-					continue;
+				gsl::span< const Mumble::Protocol::byte > pingReply =
+					handleDatagram(context, sock, encrypt, len, from, nullptr);
+				if (!pingReply.empty()) {
+#	ifdef Q_OS_WIN
+					using size_type = int;
+#	else
+					using size_type = std::size_t;
+#	endif
+					::sendto(sock, reinterpret_cast< const char * >(pingReply.data()),
+							 static_cast< size_type >(pingReply.size()), 0,
+							 reinterpret_cast< struct sockaddr * >(&from), fromlen);
 				}
+#endif
+#ifdef Q_OS_UNIX
+				fds[i].revents = 0;
+#endif
+			}
+		}
+	}
+#ifdef Q_OS_WIN
+	for (unsigned int i = 0; i < nfds - 1; ++i) {
+		::WSAEventSelect(fds[i], nullptr, 0);
+		CloseHandle(events[i]);
+	}
+#endif
+}
 
-				QReadLocker rl(&qrwlVoiceThread);
+#ifdef USE_IO_URING
+bool Server::runVoiceRing(VoiceThreadContext &context, UDPRing &ring) {
+	context.sendBatch.setRing(&ring);
 
-				quint16 port = (from.ss_family == AF_INET6) ? (reinterpret_cast< sockaddr_in6 * >(&from)->sin6_port)
-															: (reinterpret_cast< sockaddr_in * >(&from)->sin_port);
-				const HostAddress &ha = HostAddress(from);
+	bool ok = true;
+	while (bRunning) {
+		FrameMarkNamed(TracyConstants::UDP_FRAME);
 
-				const QPair< HostAddress, quint16 > &key = QPair< HostAddress, quint16 >(ha, port);
+		const int received = ring.receive();
+		if (received < 0) {
+			ok = false;
+			break;
+		}
+		if (ring.isNotified()) {
+			// Not drained, the other voice threads have to see it as well. stopThread() drains it.
+			break;
+		}
 
-				ServerUser *u = qhPeerUsers.value(key);
+		for (int datagram = 0; datagram < received; ++datagram) {
+			const unsigned int index = static_cast< unsigned int >(datagram);
 
-				if (u) {
-					m_udpDecoder.setProtocolVersion(u->m_version);
-				} else {
-					m_udpDecoder.setProtocolVersion(Version::UNKNOWN);
-				}
-				// This may be a general ping requesting server details, unencrypted.
-				if (bAllowPing
-					&& m_udpDecoder.decodePing(
-						gsl::span< Mumble::Protocol::byte >(encrypt, static_cast< std::size_t >(len)))
-					&& m_udpDecoder.getMessageType() == Mumble::Protocol::UDPMessageType::Ping) {
-					ZoneScopedN(TracyConstants::PING_PROCESSING_ZONE);
+			gsl::span< const Mumble::Protocol::byte > pingReply =
+				handleDatagram(context, ring.socket(index), ring.data(index), static_cast< qint32 >(ring.length(index)),
+							   ring.from(index), &context.sendBatch);
+			if (!pingReply.empty()) {
+				sendPingReply(ring.socket(index), ring.header(index), pingReply);
+			}
+		}
+	}
 
-					gsl::span< const Mumble::Protocol::byte > encodedPing =
-						handlePing(m_udpDecoder, m_udpPingEncoder, true);
+	context.sendBatch.setRing(nullptr);
+	return ok;
+}
+#endif
 
-					if (!encodedPing.empty()) {
-#ifdef Q_OS_LINUX
-						// We are only reading from the buffer and thus the const_cast should be fine
-						iov[0].iov_base = const_cast< Mumble::Protocol::byte * >(encodedPing.data());
-						iov[0].iov_len  = encodedPing.size();
-						::sendmsg(sock, &msg, 0);
+#ifdef Q_OS_UNIX
+gsl::span< const Mumble::Protocol::byte > Server::handleDatagram(VoiceThreadContext &context, int sock,
 #else
-#	ifdef Q_OS_WIN
-						using size_type = int;
-#	else
-						using size_type = std::size_t;
-#	endif
-						::sendto(sock, reinterpret_cast< const char * >(encodedPing.data()),
-								 static_cast< size_type >(encodedPing.size()), 0,
-								 reinterpret_cast< struct sockaddr * >(&from), fromlen);
+gsl::span< const Mumble::Protocol::byte > Server::handleDatagram(VoiceThreadContext &context, SOCKET sock,
 #endif
-					}
+																 unsigned char *encrypt, qint32 len,
+																 const sockaddr_storage &from, UDPSendBatch *batch) {
+	unsigned char buffer[Mumble::Protocol::MAX_UDP_PACKET_SIZE];
+
+	// Capture only the processing without the polling
+	ZoneScopedN(TracyConstants::UDP_PACKET_PROCESSING_ZONE);
+
+	if (len == 0) {
+		return {};
+	} else if (len == SOCKET_ERROR) {
+		return {};
+	} else if (len < 5) {
+		// 4 bytes crypt header + type + session
+		return {};
+	} else if (static_cast< unsigned int >(len) > Mumble::Protocol::MAX_UDP_PACKET_SIZE) {
+		// This will also catch the len == -1 case (indicating error)
+		static_assert(static_cast< unsigned int >(-1) > Mumble::Protocol::MAX_UDP_PACKET_SIZE, "Invalid assumption");
+		return {};
+	}
+
+	QReadLocker rl(&qrwlVoiceThread);
+
+	quint16 port = (from.ss_family == AF_INET6) ? (reinterpret_cast< const sockaddr_in6 * >(&from)->sin6_port)
+												: (reinterpret_cast< const sockaddr_in * >(&from)->sin_port);
+	const HostAddress &ha = HostAddress(from);
+
+	const QPair< HostAddress, quint16 > &key = QPair< HostAddress, quint16 >(ha, port);
+
+	ServerUser *u = qhPeerUsers.value(key);
+
+	if (u) {
+		context.udpDecoder.setProtocolVersion(u->m_version);
+	} else {
+		context.udpDecoder.setProtocolVersion(Version::UNKNOWN);
+	}
+	// This may be a general ping requesting server details, unencrypted.
+	if (bAllowPing
+		&& context.udpDecoder.decodePing(gsl::span< Mumble::Protocol::byte >(encrypt, static_cast< std::size_t >(len)))
+		&& context.udpDecoder.getMessageType() == Mumble::Protocol::UDPMessageType::Ping) {
+		ZoneScopedN(TracyConstants::PING_PROCESSING_ZONE);
+
+		return handlePing(context.udpDecoder, context.udpPingEncoder, true);
+	}
+
 
-					continue;
+	if (u) {
+		if (!checkDecrypt(u, encrypt, buffer, static_cast< unsigned int >(len))) {
+			return {};
+		}
+	} else {
+		ZoneScopedN(TracyConstants::DECRYPT_UNKNOWN_PEER_ZONE);
+
+		// Unknown peer
+		foreach (ServerUser *usr, qhHostUsers.value(ha)) {
+			// checkDecrypt takes the User's qrwlCrypt lock.
+			if (checkDecrypt(usr, encrypt, buffer, static_cast< unsigned int >(len))) {
+				// Every time we relock, reverify users' existence.
+				// The main thread might delete the user while the lock isn't held.
+				unsigned int uiSession = usr->uiSession;
+				rl.unlock();
+				qrwlVoiceThread.lockForWrite();
+				if (qhUsers.contains(uiSession)) {
+					u             = usr;
+					u->sUdpSocket = sock;
+					memcpy(&u->saiUdpAddress, &from, sizeof(from));
+					qhHostUsers[from].remove(u);
+					qhPeerUsers.insert(key, u);
 				}
+				qrwlVoiceThread.unlock();
+				rl.relock();
+				if (u && !qhUsers.contains(uiSession))
+					u = nullptr;
+				break;
+			}
+		}
+		if (!u) {
+			return {};
+		}
+	}
+	len -= 4;
 
+	if (context.udpDecoder.decode(gsl::span< Mumble::Protocol::byte >(buffer, static_cast< std::size_t >(len)))) {
+		switch (context.udpDecoder.getMessageType()) {
+			case Mumble::Protocol::UDPMessageType::Audio: {
+				Mumble::Protocol::AudioData audioData = context.udpDecoder.getAudioData();
 
-				if (u) {
-					if (!checkDecrypt(u, encrypt, buffer, static_cast< unsigned int >(len))) {
-						continue;
-					}
-				} else {
-					ZoneScopedN(TracyConstants::DECRYPT_UNKNOWN_PEER_ZONE);
-
-					// Unknown peer
-					foreach (ServerUser *usr, qhHostUsers.value(ha)) {
-						if (checkDecrypt(
-								usr, encrypt, buffer,
-								static_cast< unsigned int >(len))) { // checkDecrypt takes the User's qrwlCrypt lock.
-							// Every time we relock, reverify users' existence.
-							// The main thread might delete the user while the lock isn't held.
-							unsigned int uiSession = usr->uiSession;
-							rl.unlock();
-							qrwlVoiceThread.lockForWrite();
-							if (qhUsers.contains(uiSession)) {
-								u             = usr;
-								u->sUdpSocket = sock;
-								memcpy(&u->saiUdpAddress, &from, sizeof(from));
-								qhHostUsers[from].remove(u);
-								qhPeerUsers.insert(key, u);
-							}
-							qrwlVoiceThread.unlock();
-							rl.relock();
-							if (u && !qhUsers.contains(uiSession))
-								u = nullptr;
-							break;
-						}
-					}
-					if (!u) {
-						continue;
-					}
+				// Allow all voice packets through by default.
+				bool ok = true;
+				// ...Unless we're in Opus mode. In Opus mode, only Opus packets are allowed.
+				if (bOpus && audioData.usedCodec != Mumble::Protocol::AudioCodec::Opus) {
+					ok = false;
 				}
-				len -= 4;
-
-				if (m_udpDecoder.decode(gsl::span< Mumble::Protocol::byte >(buffer, static_cast< std::size_t >(len)))) {
-					switch (m_udpDecoder.getMessageType()) {
-						case Mumble::Protocol::UDPMessageType::Audio: {
-							Mumble::Protocol::AudioData audioData = m_udpDecoder.getAudioData();
-
-							// Allow all voice packets through by default.
-							bool ok = true;
-							// ...Unless we're in Opus mode. In Opus mode, only Opus packets are allowed.
-							if (bOpus && audioData.usedCodec != Mumble::Protocol::AudioCodec::Opus) {
-								ok = false;
-							}
 
-							if (ok) {
-								u->aiUdpFlag = 1;
+				if (ok) {
+					u->aiUdpFlag = 1;
 
-								// Add session id
-								audioData.senderSession = u->uiSession;
+					// Add session id
+					audioData.senderSession = u->uiSession;
 
-								processMsg(u, audioData, m_udpAudioReceivers, m_udpAudioEncoder);
-							}
-							break;
-						}
-						case Mumble::Protocol::UDPMessageType::Ping: {
-							ZoneScopedN(TracyConstants::UDP_PING_PROCESSING_ZONE);
-
-							Mumble::Protocol::PingData pingData = m_udpDecoder.getPingData();
-							if (!pingData.requestAdditionalInformation && !pingData.containsAdditionalInformation) {
-								// At this point here, we only want to handle connectivity pings
-								gsl::span< const Mumble::Protocol::byte > encodedPing =
-									handlePing(m_udpDecoder, m_udpPingEncoder, false);
-
-								QByteArray cache;
-								sendMessage(*u, encodedPing.data(), static_cast< int >(encodedPing.size()), cache,
-											true);
-							}
-							break;
-						}
-					}
+					processMsg(u, audioData, context.audioReceivers, context.udpAudioEncoder, batch);
 				}
-#ifdef Q_OS_UNIX
-				fds[i].revents = 0;
-#endif
+				break;
+			}
+			case Mumble::Protocol::UDPMessageType::Ping: {
+				ZoneScopedN(TracyConstants::UDP_PING_PROCESSING_ZONE);
+
+				Mumble::Protocol::PingData pingData = context.udpDecoder.getPingData();
+				if (!pingData.requestAdditionalInformation && !pingData.containsAdditionalInformation) {
+					// At this point here, we only want to handle connectivity pings
+					gsl::span< const Mumble::Protocol::byte > encodedPing =
+						handlePing(context.udpDecoder, context.udpPingEncoder, false);
+
+					QByteArray cache;
+					sendMessage(*u, encodedPing.data(), static_cast< int >(encodedPing.size()), cache, true, batch);
+				}
+				break;
 			}
 		}
 	}
-#ifdef Q_OS_WIN
-	for (unsigned int i = 0; i < nfds - 1; ++i) {
-		::WSAEventSelect(fds[i], nullptr, 0);
-		CloseHandle(events[i]);
+
+#ifdef Q_OS_LINUX
+	if (batch) {
+		// Sent while the read lock still keeps the receivers, whose crypt states the batch holds, from being deleted
+		batch->flush();
 	}
 #endif
+
+	return {};
 }
 
 bool Server::checkDecrypt(ServerUser *u, const unsigned char *encrypt, unsigned char *plain, unsigned int len) {
@@ -1025,17 +1156,43 @@ bool Server::checkDecrypt(ServerUser *u, const unsigned char *encrypt, unsigned
 	return false;
 }
 
-void Server::sendMessage(ServerUser &u, const unsigned char *data, int len, QByteArray &cache, bool force) {
+void Server::sendMessage(ServerUser &u, const unsigned char *data, int len, QByteArray &cache, bool force,
+						 UDPSendBatch *batch) {
 	ZoneScoped;
 
+#ifndef Q_OS_LINUX
+	Q_UNUSED(batch);
+#endif
+
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
 	if ((u.aiUdpFlag.loadRelaxed() == 1 || force) && (u.sUdpSocket != INVALID_SOCKET)) {
 #else
 	// Qt 5.14 introduced QAtomicInteger::loadRelaxed() which deprecates QAtomicInteger::load()
 	if ((u.aiUdpFlag.load() == 1 || force) && (u.sUdpSocket != INVALID_SOCKET)) {
 #endif
+#ifdef Q_OS_LINUX
+		if (batch && static_cast< std::size_t >(len) + 4 <= UDPSendBatch::MAX_DATAGRAM_SIZE) {
+			// Encrypt right into the batch, which sends it together with the other datagrams the received one is
+			// forwarded as. The batch keeps the crypt state locked until then, so that the datagrams of this user leave
+			// in the order of their sequence numbers even if several voice threads forward to it.
+			unsigned char *buffer = batch->nextBuffer(u.qmCrypt);
+
+			if (!u.csCrypt->isValid()) {
+				return;
+			}
+
+			if (!u.csCrypt->encrypt(data, buffer, static_cast< unsigned int >(len))) {
+				return;
+			}
+
+			batch->push(u.sUdpSocket, u.saiUdpAddress, HostAddress(u.saiTcpLocalAddress),
+						static_cast< unsigned int >(len + 4));
+			return;
+		}
+#endif
 #if defined(__LP64__)
-		static std::vector< char > ebuffer;
+		// Called by every voice thread and by the main thread
+		thread_local std::vector< char > ebuffer;
 		ebuffer.resize(static_cast< std::size_t >(len + 4 + 16));
 		char *buffer = reinterpret_cast< char * >(
 			((reinterpret_cast< quint64 >(ebuffer.data()) + 8) & static_cast< quint64 >(~7)) + 4);
@@ -1044,17 +1201,16 @@ void Server::sendMessage(ServerUser &u, const unsigned char *data, int len, QByt
 		bufVec.resize(len + 4);
 		char *buffer    = bufVec.data();
 #endif
-		{
-			QMutexLocker wl(&u.qmCrypt);
+		// Held until the datagram is sent, so that no other thread sends the next sequence number to this user first
+		QMutexLocker wl(&u.qmCrypt);
 
-			if (!u.csCrypt->isValid()) {
-				return;
-			}
+		if (!u.csCrypt->isValid()) {
+			return;
+		}
 
-			if (!u.csCrypt->encrypt(reinterpret_cast< const unsigned char * >(data),
-									reinterpret_cast< unsigned char * >(buffer), static_cast< unsigned int >(len))) {
-				return;
-			}
+		if (!u.csCrypt->encrypt(reinterpret_cast< const unsigned char * >(data),
+								reinterpret_cast< unsigned char * >(buffer), static_cast< unsigned int >(len))) {
+			return;
 		}
 #ifdef Q_OS_WIN
 		DWORD dwFlow = 0;
@@ -1070,39 +1226,17 @@ void Server::sendMessage(ServerUser &u, const unsigned char *data, int len, QByt
 		iov[0].iov_len  = static_cast< unsigned int >(len + 4);
 
 		uint8_t controldata[CMSG_SPACE(std::max(sizeof(struct in6_pktinfo), sizeof(struct in_pktinfo)))];
-		memset(controldata, 0, sizeof(controldata));
 
 		memset(&msg, 0, sizeof(msg));
 		msg.msg_name    = reinterpret_cast< struct sockaddr * >(&u.saiUdpAddress);
 		msg.msg_namelen = static_cast< socklen_t >(
 			(u.saiUdpAddress.ss_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
-		msg.msg_iov        = iov;
-		msg.msg_iovlen     = 1;
-		msg.msg_control    = controldata;
-		msg.msg_controllen = CMSG_SPACE((u.saiUdpAddress.ss_family == AF_INET6) ? sizeof(struct in6_pktinfo)
-																				: sizeof(struct in_pktinfo));
-
-		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
-		HostAddress tcpha(u.saiTcpLocalAddress);
-		if (u.saiUdpAddress.ss_family == AF_INET6) {
-			cmsg->cmsg_level            = IPPROTO_IPV6;
-			cmsg->cmsg_type             = IPV6_PKTINFO;
-			cmsg->cmsg_len              = CMSG_LEN(sizeof(struct in6_pktinfo));
-			struct in6_pktinfo *pktinfo = reinterpret_cast< struct in6_pktinfo * >(CMSG_DATA(cmsg));
-			memset(pktinfo, 0, sizeof(*pktinfo));
-			memcpy(&pktinfo->ipi6_addr.s6_addr[0], tcpha.getByteRepresentation().data(),
-				   sizeof(pktinfo->ipi6_addr.s6_addr));
-		} else {
-			cmsg->cmsg_level           = IPPROTO_IP;
-			cmsg->cmsg_type            = IP_PKTINFO;
-			cmsg->cmsg_len             = CMSG_LEN(sizeof(struct in_pktinfo));
-			struct in_pktinfo *pktinfo = reinterpret_cast< struct in_pktinfo * >(CMSG_DATA(cmsg));
-			memset(pktinfo, 0, sizeof(*pktinfo));
-			if (tcpha.isV6())
-				return;
-			pktinfo->ipi_spec_dst.s_addr = tcpha.toIPv4();
-		}
+		msg.msg_iov     = iov;
+		msg.msg_iovlen  = 1;
+		msg.msg_control = controldata;
 
+		if (!setPacketInfo(msg, u.saiUdpAddress, HostAddress(u.saiTcpLocalAddress)))
+			return;
 
 		::sendmsg(u.sUdpSocket, &msg, 0);
 #else
@@ -1139,7 +1273,8 @@ void Server::addListener(QHash< ServerUser *, VolumeAdjustment > &listeners, Ser
 }
 
 void Server::processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, AudioReceiverBuffer &buffer,
-						Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > &encoder) {
+						Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > &encoder,
+						UDPSendBatch *batch) {
 	ZoneScoped;
 
 	// Note that in this function we never have to acquire a read-lock on qrwlVoiceThread
@@ -1180,7 +1315,7 @@ void Server::processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, Au
 		}
 
 		// Send audio to all users in the same channel
-		for (User *p : c->qlUsers) {
+		for (User *p : qAsConst(c->qlUsers)) {
 			ServerUser *pDst = static_cast< ServerUser * >(p);
 
 			buffer.addReceiver(*u, *pDst, Mumble::Protocol::AudioContext::NORMAL, audioData.containsPositionalData);
@@ -1206,7 +1341,7 @@ void Server::processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, Au
 					}
 
 					// Send audio to users in the linked channel
-					for (User *p : l->qlUsers) {
+					for (User *p : qAsConst(l->qlUsers)) {
 						ServerUser *pDst = static_cast< ServerUser * >(p);
 
 						buffer.addReceiver(*u, *pDst, Mumble::Protocol::AudioContext::NORMAL,
@@ -1220,10 +1355,11 @@ void Server::processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, Au
 		QSet< ServerUser * > direct;
 		QHash< ServerUser *, VolumeAdjustment > cachedListeners;
 
-		if (u->qmTargetCache.contains(static_cast< int >(audioData.targetOrContext))) {
+		const std::shared_ptr< const WhisperTargetCacheMap > targetCache = u->loadTargetCache();
+		if (targetCache->contains(static_cast< int >(audioData.targetOrContext))) {
 			ZoneScopedN(TracyConstants::AUDIO_WHISPER_CACHE_STORE);
 
-			const WhisperTargetCache &cache = u->qmTargetCache.value(static_cast< int >(audioData.targetOrContext));
+			const WhisperTargetCache &cache = targetCache->value(static_cast< int >(audioData.targetOrContext));
 			channel                         = cache.channelTargets;
 			direct                          = cache.directTargets;
 			cachedListeners                 = cache.listeningTargets;
@@ -1302,17 +1438,11 @@ void Server::processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, Au
 				}
 			}
 
-			unsigned int uiSession = u->uiSession;
-			qrwlVoiceThread.unlock();
-			qrwlVoiceThread.lockForWrite();
-
-			if (qhUsers.contains(uiSession))
-				u->qmTargetCache.insert(static_cast< int >(audioData.targetOrContext),
-										{ channel, direct, cachedListeners });
-			qrwlVoiceThread.unlock();
-			qrwlVoiceThread.lockForRead();
-			if (!qhUsers.contains(uiSession))
-				return;
+			// Publishing the result needs no write lock on qrwlVoiceThread. If the cache has changed since it has been
+			// loaded, e.g. because the main thread has cleared it, the result is dropped and computed anew next time.
+			auto newTargetCache = std::make_shared< WhisperTargetCacheMap >(*targetCache);
+			newTargetCache->insert(static_cast< int >(audioData.targetOrContext), { channel, direct, cachedListeners });
+			u->publishTargetCache(targetCache, std::move(newTargetCache));
 		}
 		// These users receive the audio because someone is shouting to their channel
 		for (ServerUser *pDst : channel) {
@@ -1387,7 +1517,7 @@ void Server::processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, Au
 			// Send encoded packet to all receivers of this range
 			for (auto it = currentRange.begin; it != currentRange.end; ++it) {
 				sendMessage(it->getReceiver(), encodedPacket.data(), static_cast< int >(encodedPacket.size()),
-							tcpCache);
+							tcpCache, false, batch);
 			}
 
 			// Find next range
@@ -2187,9 +2317,12 @@ void Server::clearACLCache(User *p) {
 }
 
 void Server::clearWhisperTargetCache() {
-	QWriteLocker lock(&qrwlVoiceThread);
+	// The caches are swapped atomically and the main thread owns qhUsers, so no lock is needed for the swap itself
+	foreach (ServerUser *u, qhUsers) { u->clearTargetCache(); }
 
-	foreach (ServerUser *u, qhUsers) { u->qmTargetCache.clear(); }
+	// A voice thread may still be routing with a cache it has loaded before the swap, which can list users that
+	// are about to be deleted (e.g. in connectionClosed()). Taking the write lock once waits for these to finish.
+	QWriteLocker lock(&qrwlVoiceThread);
 }
 
 QString Server::addressToString(const QHostAddress &adr, unsigned short port) {
@@ -24,6 +24,10 @@
 #include "Version.h"
 #include "VolumeAdjustment.h"
 
+#ifdef Q_OS_LINUX
+#	include "UDPBatch.h"
+#endif
+
 #ifndef Q_MOC_RUN
 #	include <boost/function.hpp>
 #endif
@@ -45,6 +49,9 @@
 #	include <QtNetwork/QSslDiffieHellmanParameters>
 #endif
 
+#include <memory>
+#include <vector>
+
 #ifdef Q_OS_WIN
 #	include <winsock2.h>
 #endif
@@ -78,6 +85,50 @@ public:
 
 #define EXEC_QEVENT (QEvent::User + 959)
 
+class Server;
+class UDPRing;
+class UDPSendBatch;
+
+/// Everything a voice thread of a Server works with. Each voice thread receives on its own UDP socket per bound
+/// address (with SO_REUSEPORT, the kernel keeps the packets of one client on the same socket) and decodes, routes
+/// and encodes with its own coders and receiver buffer. Voice threads only share the users, which they access as
+/// described at Server::qrwlVoiceThread.
+struct VoiceThreadContext {
+	unsigned int index = 0;
+#ifdef Q_OS_UNIX
+	QList< int > qlUdpSocket;
+#else
+	QList< SOCKET > qlUdpSocket;
+#endif
+
+	Mumble::Protocol::UDPDecoder< Mumble::Protocol::Role::Server > udpDecoder;
+	Mumble::Protocol::UDPPingEncoder< Mumble::Protocol::Role::Server > udpPingEncoder;
+	Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > udpAudioEncoder;
+	AudioReceiverBuffer audioReceivers;
+
+#ifdef Q_OS_LINUX
+	UDPReceiveBatch receiveBatch;
+	/// Collects what the voice thread sends while it handles the datagrams of one receiveBatch
+	UDPSendBatch sendBatch;
+#endif
+};
+
+/// Additional voice thread of a Server. The first voice thread is the Server (which is a QThread) itself.
+class VoiceThread : public QThread {
+private:
+	Q_OBJECT
+	Q_DISABLE_COPY(VoiceThread)
+
+protected:
+	Server &m_server;
+	VoiceThreadContext &m_context;
+
+	void run() Q_DECL_OVERRIDE;
+
+public:
+	VoiceThread(Server &server, VoiceThreadContext &context, QObject *parent = nullptr);
+};
+
 class ExecEvent : public QEvent {
 	Q_DISABLE_COPY(ExecEvent)
 
@@ -120,6 +171,8 @@ public:
 	int iMaxTextMessageLength;
 	int iMaxImageMessageLength;
 	int iOpusThreshold;
+	int iVoiceThreads;
+	bool bIoUring;
 	bool bAllowHTML;
 	QString qsPassword;
 	QString qsWelcomeText;
@@ -177,10 +230,10 @@ public:
 	ChannelListenerManager m_channelListenerManager;
 
 
+	// Used by the main thread, the voice threads have their own in their VoiceThreadContext
 	Mumble::Protocol::UDPDecoder< Mumble::Protocol::Role::Server > m_udpDecoder;
 	Mumble::Protocol::UDPDecoder< Mumble::Protocol::Role::Server > m_tcpTunnelDecoder;
 	Mumble::Protocol::UDPPingEncoder< Mumble::Protocol::Role::Server > m_udpPingEncoder;
-	Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > m_udpAudioEncoder;
 	Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > m_tcpAudioEncoder;
 
 	gsl::span< const Mumble::Protocol::byte >
@@ -207,9 +260,12 @@ private:
 	int iChannelNestingLimit;
 	int iChannelCountLimit;
 
-	AudioReceiverBuffer m_udpAudioReceivers;
 	AudioReceiverBuffer m_tcpAudioReceivers;
 
+	/// One per voice thread, the first one is used by the Server's own thread
+	std::vector< std::unique_ptr< VoiceThreadContext > > m_voiceThreadContexts;
+	QList< VoiceThread * > qlVoiceThreads;
+
 public slots:
 	void regSslError(const QList< QSslError > &);
 	void finished();
@@ -246,6 +302,8 @@ public:
 	QList< SslServer * > qlServer;
 	QTimer *qtTimeout;
 
+	// aiNotify (hNotify) wakes the voice threads up when they have to stop.
+	// qlUdpSocket holds the sockets of all of them.
 #ifdef Q_OS_UNIX
 	int aiNotify[2];
 	QList< int > qlUdpSocket;
@@ -300,6 +358,20 @@ public:
 	///    by itself, it DOES NOT hold a lock on qrwlVoiceThread.
 	///    That is because ownership of data guarantees that no
 	///    other thread can write to that data.
+	///
+	///  - The whisper target caches of the users are the
+	///    exception. Both the voice threads and the main
+	///    thread replace them by an atomic pointer swap
+	///    (see ServerUser::loadTargetCache()), so that the
+	///    voice threads never upgrade to a write lock. After
+	///    clearing them, the main thread still takes the
+	///    write lock once, so that no voice thread is left
+	///    routing with an old cache whose users it may be
+	///    about to delete.
+	///
+	/// A Server may have several voice threads (iVoiceThreads).
+	/// Each of them follows the rules above for the voice thread.
+	/// Their read locks do not exclude each other.
 	QReadWriteLock qrwlVoiceThread;
 	QHash< unsigned int, ServerUser * > qhUsers;
 	QHash< QPair< HostAddress, quint16 >, ServerUser * > qhPeerUsers;
@@ -316,9 +388,31 @@ public:
 
 	void addListener(QHash< ServerUser *, VolumeAdjustment > &listeners, ServerUser &user, const Channel &channel);
 	void processMsg(ServerUser *u, Mumble::Protocol::AudioData audioData, AudioReceiverBuffer &buffer,
-					Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > &encoder);
-	void sendMessage(ServerUser &u, const unsigned char *data, int len, QByteArray &cache, bool force = false);
+					Mumble::Protocol::UDPAudioEncoder< Mumble::Protocol::Role::Server > &encoder,
+					UDPSendBatch *batch = nullptr);
+	/// Sends the given data to the given user, over UDP if possible. If a batch is given, UDP datagrams are queued
+	/// in it instead of being sent right away, and the crypt state of the user stays locked until the batch is flushed.
+	void sendMessage(ServerUser &u, const unsigned char *data, int len, QByteArray &cache, bool force = false,
+					 UDPSendBatch *batch = nullptr);
 	void run();
+	/// Receives and forwards voice on the sockets of the given context until the Server stops its voice threads
+	void runVoiceLoop(VoiceThreadContext &context);
+#ifdef USE_IO_URING
+	/// runVoiceLoop() through io_uring. @returns false if the ring does not work, so that poll() has to take over.
+	bool runVoiceRing(VoiceThreadContext &context, UDPRing &ring);
+#endif
+	/// Decrypts a datagram a voice thread has received and forwards the audio or answers the ping in it. Datagrams to
+	/// send are queued in the given batch, if any, which is flushed before returning.
+	///
+	/// @returns The answer to an unencrypted server ping, which the caller has to send back from the local address
+	/// 	the ping came in on
+#ifdef Q_OS_UNIX
+	gsl::span< const Mumble::Protocol::byte > handleDatagram(VoiceThreadContext &context, int sock,
+#else
+	gsl::span< const Mumble::Protocol::byte > handleDatagram(VoiceThreadContext &context, SOCKET sock,
+#endif
+															 unsigned char *encrypt, qint32 len,
+															 const sockaddr_storage &from, UDPSendBatch *batch);
 
 	bool validateChannelName(const QString &name);
 	bool validateUserName(const QString &name);
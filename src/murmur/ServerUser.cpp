@@ -33,6 +33,36 @@ ServerUser::ServerUser(Server *p, QSslSocket *socket)
 	iLastPermissionCheck = -1;
 
 	bOpus = false;
+
+	m_targetCache = std::make_shared< const WhisperTargetCacheMap >();
+}
+
+std::shared_ptr< const WhisperTargetCacheMap > ServerUser::loadTargetCache() const {
+	return std::atomic_load(&m_targetCache);
+}
+
+bool ServerUser::publishTargetCache(std::shared_ptr< const WhisperTargetCacheMap > expected,
+									std::shared_ptr< const WhisperTargetCacheMap > cache) {
+	// The pointers serve as the versions of the cache: a new cache is always a new object, and expected keeps the
+	// old one alive, so its address can not come back
+	return std::atomic_compare_exchange_strong(&m_targetCache, &expected, std::move(cache));
+}
+
+void ServerUser::clearTargetCache(int target) {
+	if (target == -1) {
+		std::atomic_store(&m_targetCache, std::make_shared< const WhisperTargetCacheMap >());
+		return;
+	}
+
+	std::shared_ptr< const WhisperTargetCacheMap > current = loadTargetCache();
+	while (current->contains(target)) {
+		auto cache = std::make_shared< WhisperTargetCacheMap >(*current);
+		cache->remove(target);
+		if (publishTargetCache(current, std::move(cache))) {
+			break;
+		}
+		current = loadTargetCache();
+	}
 }
 
 
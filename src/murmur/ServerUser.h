@@ -21,6 +21,8 @@
 #include <QtCore/QElapsedTimer>
 #include <QtCore/QStringList>
 
+#include <memory>
+
 #ifdef Q_OS_WIN
 #	include <winsock2.h>
 #else
@@ -69,6 +71,10 @@ struct WhisperTargetCache {
 	QHash< ServerUser *, VolumeAdjustment > listeningTargets;
 };
 
+/// The resolved whisper targets of a user by target ID. A published map is never modified, a change publishes a new
+/// one in its place.
+using WhisperTargetCacheMap = QMap< int, WhisperTargetCache >;
+
 class Server;
 
 /// A simple implementation for rate-limiting.
@@ -145,7 +151,6 @@ public:
 	QStringList qslAccessTokens;
 
 	QMap< int, WhisperTarget > qmTargets;
-	QMap< int, WhisperTargetCache > qmTargetCache;
 	QMap< QString, QString > qmWhisperRedirect;
 
 	LeakyBucket leakyBucket;
@@ -162,6 +167,22 @@ public:
 	struct sockaddr_storage saiUdpAddress;
 	struct sockaddr_storage saiTcpLocalAddress;
 	ServerUser(Server *parent, QSslSocket *socket);
+
+	/// @returns The current whisper target cache. It is never modified and stays valid for as long as the returned
+	/// 	pointer is held, so that the voice threads can read it without taking qrwlVoiceThread for write.
+	std::shared_ptr< const WhisperTargetCacheMap > loadTargetCache() const;
+	/// Publishes the given cache in place of the one that has been loaded as expected. Fails if another cache has
+	/// been published since, e.g. because the main thread has cleared it, as the given one may be stale then.
+	///
+	/// @returns Whether the cache has been published
+	bool publishTargetCache(std::shared_ptr< const WhisperTargetCacheMap > expected,
+							std::shared_ptr< const WhisperTargetCacheMap > cache);
+	/// Drops the cache of the given target, or the whole cache if target is -1
+	void clearTargetCache(int target = -1);
+
+private:
+	/// Only ever accessed through the atomic operations for std::shared_ptr
+	std::shared_ptr< const WhisperTargetCacheMap > m_targetCache;
 };
 
 #endif
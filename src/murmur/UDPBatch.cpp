@@ -0,0 +1,172 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "UDPBatch.h"
+
+#ifdef USE_IO_URING
+#	include "UDPRing.h"
+#endif
+
+#include <tracy/Tracy.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+bool setPacketInfo(struct msghdr &msg, const sockaddr_storage &to, const HostAddress &from) {
+	msg.msg_controllen =
+		CMSG_SPACE((to.ss_family == AF_INET6) ? sizeof(struct in6_pktinfo) : sizeof(struct in_pktinfo));
+	memset(msg.msg_control, 0, msg.msg_controllen);
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	if (to.ss_family == AF_INET6) {
+		cmsg->cmsg_level            = IPPROTO_IPV6;
+		cmsg->cmsg_type             = IPV6_PKTINFO;
+		cmsg->cmsg_len              = CMSG_LEN(sizeof(struct in6_pktinfo));
+		struct in6_pktinfo *pktinfo = reinterpret_cast< struct in6_pktinfo * >(CMSG_DATA(cmsg));
+		memcpy(&pktinfo->ipi6_addr.s6_addr[0], from.getByteRepresentation().data(),
+			   sizeof(pktinfo->ipi6_addr.s6_addr));
+	} else {
+		if (from.isV6())
+			return false;
+		cmsg->cmsg_level             = IPPROTO_IP;
+		cmsg->cmsg_type              = IP_PKTINFO;
+		cmsg->cmsg_len               = CMSG_LEN(sizeof(struct in_pktinfo));
+		struct in_pktinfo *pktinfo   = reinterpret_cast< struct in_pktinfo * >(CMSG_DATA(cmsg));
+		pktinfo->ipi_spec_dst.s_addr = from.toIPv4();
+	}
+	return true;
+}
+
+UDPSendBatch::UDPSendBatch() : m_datagrams(MAX_DATAGRAMS), m_headers(MAX_DATAGRAMS), m_sockets(MAX_DATAGRAMS) {
+	memset(m_headers.data(), 0, m_headers.size() * sizeof(struct mmsghdr));
+	m_cryptLocks.reserve(MAX_DATAGRAMS);
+	for (unsigned int i = 0; i < MAX_DATAGRAMS; ++i) {
+		Datagram &datagram    = m_datagrams[i];
+		struct msghdr &msg    = m_headers[i].msg_hdr;
+		datagram.iov.iov_base = datagram.data + 4;
+		msg.msg_name          = &datagram.to;
+		msg.msg_iov           = &datagram.iov;
+		msg.msg_iovlen        = 1;
+		msg.msg_control       = datagram.control;
+	}
+}
+
+unsigned char *UDPSendBatch::nextBuffer(QMutex &cryptLock) {
+	if (m_count == MAX_DATAGRAMS || m_cryptLocks.size() == MAX_DATAGRAMS) {
+		flush();
+	}
+
+	if (std::find(m_cryptLocks.begin(), m_cryptLocks.end(), &cryptLock) == m_cryptLocks.end()) {
+		if (!cryptLock.tryLock()) {
+			// The holder may be another voice thread waiting for one of ours. Waiting with none held breaks the cycle.
+			flush();
+			cryptLock.lock();
+		}
+		m_cryptLocks.push_back(&cryptLock);
+	}
+
+	return m_datagrams[m_count].data + 4;
+}
+
+void UDPSendBatch::push(int socket, const sockaddr_storage &to, const HostAddress &from, unsigned int length) {
+	Datagram &datagram = m_datagrams[m_count];
+	struct msghdr &msg = m_headers[m_count].msg_hdr;
+
+	memcpy(&datagram.to, &to, sizeof(to));
+	msg.msg_namelen = static_cast< socklen_t >((to.ss_family == AF_INET6) ? sizeof(struct sockaddr_in6)
+																		  : sizeof(struct sockaddr_in));
+	datagram.iov.iov_len = length;
+	if (!setPacketInfo(msg, to, from)) {
+		return;
+	}
+
+	m_sockets[m_count] = socket;
+	++m_count;
+}
+
+void UDPSendBatch::flush() {
+	ZoneScoped;
+
+	sendQueued();
+
+	// Only now that the datagrams are on their way may the next sequence numbers of their receivers be sent
+	for (QMutex *cryptLock : m_cryptLocks) {
+		cryptLock->unlock();
+	}
+	m_cryptLocks.clear();
+}
+
+void UDPSendBatch::sendQueued() {
+#ifdef USE_IO_URING
+	if (m_ring) {
+		if (!m_ring->send(m_headers.data(), m_sockets.data(), m_count)) {
+			// Nothing more goes to a ring that has failed once
+			m_ring = nullptr;
+		}
+		m_count = 0;
+		return;
+	}
+#endif
+
+	unsigned int first = 0;
+	while (first < m_count) {
+		// One sendmmsg() sends from one socket only, so send each run of datagrams for the same socket on its own
+		unsigned int end = first + 1;
+		while (end < m_count && m_sockets[end] == m_sockets[first]) {
+			++end;
+		}
+
+		unsigned int next = first;
+		while (next < end) {
+			const int sent = ::sendmmsg(m_sockets[first], &m_headers[next], end - next, 0);
+			if (sent > 0) {
+				next += static_cast< unsigned int >(sent);
+			} else if (sent < 0 && errno == EINTR) {
+				continue;
+			} else {
+				// The datagram at "next" failed to send. Drop it and carry on with the following ones.
+				++next;
+			}
+		}
+
+		first = end;
+	}
+
+	m_count = 0;
+}
+
+UDPReceiveBatch::UDPReceiveBatch() : m_datagrams(MAX_DATAGRAMS), m_headers(MAX_DATAGRAMS) {
+	memset(m_headers.data(), 0, m_headers.size() * sizeof(struct mmsghdr));
+	for (unsigned int i = 0; i < MAX_DATAGRAMS; ++i) {
+		struct msghdr &msg = m_headers[i].msg_hdr;
+		msg.msg_name       = &m_datagrams[i].from;
+		msg.msg_iov        = &m_datagrams[i].iov;
+		msg.msg_iovlen     = 1;
+		msg.msg_control    = m_datagrams[i].control;
+	}
+}
+
+int UDPReceiveBatch::receive(int socket) {
+	ZoneScoped;
+
+	for (unsigned int i = 0; i < MAX_DATAGRAMS; ++i) {
+		// The kernel overwrites the lengths, and a reply to a ping reuses the header with a different payload
+		struct msghdr &msg          = m_headers[i].msg_hdr;
+		m_datagrams[i].iov.iov_base = m_datagrams[i].data + 4;
+		m_datagrams[i].iov.iov_len  = Mumble::Protocol::MAX_UDP_PACKET_SIZE;
+		msg.msg_namelen             = sizeof(sockaddr_storage);
+		msg.msg_controllen          = sizeof(m_datagrams[i].control);
+		msg.msg_flags               = 0;
+	}
+
+	int received;
+	do {
+		// MSG_TRUNC makes the lengths those of the datagrams, even if they did not fit
+		received = ::recvmmsg(socket, m_headers.data(), MAX_DATAGRAMS, MSG_TRUNC | MSG_WAITFORONE, nullptr);
+	} while (received < 0 && errno == EINTR);
+
+	return received;
+}
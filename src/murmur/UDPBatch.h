@@ -0,0 +1,128 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MURMUR_UDPBATCH_H_
+#define MUMBLE_MURMUR_UDPBATCH_H_
+
+// Batched UDP I/O with recvmmsg() and sendmmsg(). Linux only.
+
+#include "HostAddress.h"
+#include "MumbleProtocol.h"
+
+#include <QtCore/QMutex>
+
+#include <cstdint>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#ifdef USE_IO_URING
+class UDPRing;
+#endif
+
+/// Adds the IP_PKTINFO (IPV6_PKTINFO) control message to the given message, so that a datagram to the given address
+/// is sent from the given local address. The control buffer of the message must have room for either of them.
+///
+/// @returns Whether a datagram to this address can be sent from this local address
+bool setPacketInfo(struct msghdr &msg, const sockaddr_storage &to, const HostAddress &from);
+
+/// Datagrams to be sent with as few sendmmsg() calls as possible. A voice thread queues everything one received
+/// datagram is forwarded as and flushes it before it handles the next one, or earlier if the batch is full.
+///
+/// The batch keeps the crypt state of every receiver it has a datagram for locked until it is flushed. Another voice
+/// thread forwarding to the same receiver in the meantime would otherwise encrypt the next sequence number and send it
+/// first.
+class UDPSendBatch {
+public:
+	/// Number of datagrams (and of locked receivers) after which the batch is flushed
+	static constexpr unsigned int MAX_DATAGRAMS = 64;
+	/// Size of the largest datagram that can be queued
+	static constexpr std::size_t MAX_DATAGRAM_SIZE = Mumble::Protocol::MAX_UDP_PACKET_SIZE + 16;
+
+	UDPSendBatch();
+
+	/// Locks the given crypt state until the next flush(), unless the batch holds it already. If another thread holds
+	/// it, the batch is flushed before waiting for it, so that two batches never wait for each other.
+	///
+	/// @param cryptLock The lock of the crypt state the next datagram is encrypted with
+	/// @returns The buffer for the next datagram. Flushes the batch first if it is full. Like the buffer of
+	/// 	Server::sendMessage, the payload following the 4 byte crypt header is 8 byte aligned.
+	unsigned char *nextBuffer(QMutex &cryptLock);
+	/// Queues the datagram written to nextBuffer()
+	///
+	/// @param socket The socket to send the datagram from
+	/// @param to The address to send it to
+	/// @param from The local address to send it from
+	/// @param length The size of the datagram
+	void push(int socket, const sockaddr_storage &to, const HostAddress &from, unsigned int length);
+	/// Sends all queued datagrams and unlocks the crypt states locked for them. A datagram that fails to send is
+	/// dropped, as sendmsg() would. Has to be called before the receivers may be deleted.
+	void flush();
+#ifdef USE_IO_URING
+	/// Makes flush() submit the datagrams to the given ring instead of calling sendmmsg(). nullptr switches back.
+	void setRing(UDPRing *ring) { m_ring = ring; }
+#endif
+
+	bool isEmpty() const { return m_count == 0; }
+
+private:
+	struct Datagram {
+		alignas(8) unsigned char data[MAX_DATAGRAM_SIZE + 8];
+		struct iovec iov;
+		sockaddr_storage to;
+		alignas(struct cmsghdr) std::uint8_t control[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+	};
+
+	/// Sends the queued datagrams, with the crypt states still locked
+	void sendQueued();
+
+	std::vector< Datagram > m_datagrams;
+	/// Kept apart from the datagrams, as sendmmsg() wants the headers of one call next to each other
+	std::vector< struct mmsghdr > m_headers;
+	std::vector< int > m_sockets;
+	/// Crypt states locked for the queued datagrams
+	std::vector< QMutex * > m_cryptLocks;
+	unsigned int m_count = 0;
+#ifdef USE_IO_URING
+	UDPRing *m_ring = nullptr;
+#endif
+};
+
+/// Datagrams received with one recvmmsg() call
+class UDPReceiveBatch {
+public:
+	static constexpr unsigned int MAX_DATAGRAMS = 32;
+
+	UDPReceiveBatch();
+
+	/// Receives the datagrams waiting on the given socket, waiting for at least one
+	///
+	/// @returns The number of received datagrams, -1 on error
+	int receive(int socket);
+
+	/// @returns The received datagram. Like the buffer of Server::run used to be, the payload following the 4 byte
+	/// 	crypt header is 8 byte aligned.
+	unsigned char *data(unsigned int index) { return m_datagrams[index].data + 4; }
+	/// @returns The size of the received datagram. It is larger than the buffer if the datagram has been truncated.
+	unsigned int length(unsigned int index) const { return m_headers[index].msg_len; }
+	sockaddr_storage &from(unsigned int index) { return m_datagrams[index].from; }
+	/// @returns The header the datagram has been received with. It carries the local address the datagram has been
+	/// 	sent to, so that a reply can be sent with it from the same address.
+	struct msghdr &header(unsigned int index) { return m_headers[index].msg_hdr; }
+
+private:
+	struct Datagram {
+		alignas(8) unsigned char data[Mumble::Protocol::MAX_UDP_PACKET_SIZE + 8];
+		struct iovec iov;
+		sockaddr_storage from;
+		alignas(struct cmsghdr) std::uint8_t control[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+	};
+
+	std::vector< Datagram > m_datagrams;
+	std::vector< struct mmsghdr > m_headers;
+};
+
+#endif // MUMBLE_MURMUR_UDPBATCH_H_
@@ -0,0 +1,220 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include "UDPRing.h"
+
+#include <tracy/Tracy.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+
+namespace {
+/// Distance between two buffers, keeping every buffer 8 byte aligned
+constexpr std::size_t bufferStride(std::size_t size) {
+	return (size + 7) & ~static_cast< std::size_t >(7);
+}
+} // namespace
+
+UDPRing::UDPRing() {
+	memset(&m_receiveHeader, 0, sizeof(m_receiveHeader));
+}
+
+UDPRing::~UDPRing() {
+	if (m_bufferRing) {
+		io_uring_free_buf_ring(&m_receiveRing, m_bufferRing, BUFFER_COUNT, BUFFER_GROUP);
+	}
+	if (m_receiveRingReady) {
+		io_uring_queue_exit(&m_receiveRing);
+	}
+	if (m_sendRingReady) {
+		io_uring_queue_exit(&m_sendRing);
+	}
+}
+
+bool UDPRing::init(const std::vector< int > &sockets, int notifySocket) {
+	// Every buffer may complete before receive() reaps them
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags      = IORING_SETUP_CQSIZE;
+	params.cq_entries = 2 * BUFFER_COUNT;
+	if (io_uring_queue_init_params(static_cast< unsigned int >(sockets.size()) + 1, &m_receiveRing, &params) < 0) {
+		return false;
+	}
+	m_receiveRingReady = true;
+
+	if (io_uring_queue_init(64, &m_sendRing, 0) < 0) {
+		return false;
+	}
+	m_sendRingReady = true;
+
+	int ret      = 0;
+	m_bufferRing = io_uring_setup_buf_ring(&m_receiveRing, BUFFER_COUNT, BUFFER_GROUP, 0, &ret);
+	if (!m_bufferRing) {
+		return false;
+	}
+
+	const std::size_t stride = bufferStride(BUFFER_SIZE);
+	m_bufferStorage.assign(BUFFER_COUNT * stride / sizeof(std::uint64_t), 0);
+	m_usedBuffers.reserve(BUFFER_COUNT);
+	for (unsigned short i = 0; i < BUFFER_COUNT; ++i) {
+		m_usedBuffers.push_back(i);
+	}
+	recycle();
+
+	m_receiveHeader.msg_namelen    = sizeof(sockaddr_storage);
+	m_receiveHeader.msg_controllen = CONTROL_SIZE;
+
+	m_sockets = sockets;
+	m_datagrams.resize(BUFFER_COUNT);
+	for (unsigned int i = 0; i < m_sockets.size(); ++i) {
+		armReceive(i);
+	}
+
+	struct io_uring_sqe *sqe = io_uring_get_sqe(&m_receiveRing);
+	io_uring_prep_poll_add(sqe, notifySocket, POLLIN);
+	io_uring_sqe_set_data64(sqe, NOTIFY);
+
+	return true;
+}
+
+void UDPRing::armReceive(unsigned int socketIndex) {
+	// The submission queue has room for one entry per socket and the poll, and every socket has one armed at most
+	struct io_uring_sqe *sqe = io_uring_get_sqe(&m_receiveRing);
+	io_uring_prep_recvmsg_multishot(sqe, m_sockets[socketIndex], &m_receiveHeader, MSG_TRUNC);
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	sqe->buf_group = BUFFER_GROUP;
+	io_uring_sqe_set_data64(sqe, socketIndex);
+}
+
+void UDPRing::recycle() {
+	const std::size_t stride = bufferStride(BUFFER_SIZE);
+	const int mask           = io_uring_buf_ring_mask(BUFFER_COUNT);
+	int offset               = 0;
+	for (unsigned short buffer : m_usedBuffers) {
+		unsigned char *address = reinterpret_cast< unsigned char * >(m_bufferStorage.data()) + buffer * stride;
+		io_uring_buf_ring_add(m_bufferRing, address, static_cast< unsigned int >(BUFFER_SIZE), buffer, mask, offset++);
+	}
+	io_uring_buf_ring_advance(m_bufferRing, offset);
+	m_usedBuffers.clear();
+}
+
+int UDPRing::receive() {
+	recycle();
+	m_count = 0;
+
+	// Submits the receives re-armed in the previous round and waits, with one system call
+	const int ret = io_uring_submit_and_wait(&m_receiveRing, 1);
+	if (ret < 0) {
+		return (ret == -EINTR) ? 0 : -1;
+	}
+
+	ZoneScoped;
+
+	const std::size_t stride = bufferStride(BUFFER_SIZE);
+	bool failed              = false;
+	unsigned int seen        = 0;
+	unsigned int head;
+	struct io_uring_cqe *cqe;
+	io_uring_for_each_cqe(&m_receiveRing, head, cqe) {
+		++seen;
+
+		if (cqe->user_data == NOTIFY) {
+			m_notified = true;
+			continue;
+		}
+
+		const unsigned int socketIndex = static_cast< unsigned int >(cqe->user_data);
+		if (cqe->flags & IORING_CQE_F_BUFFER) {
+			m_usedBuffers.push_back(static_cast< unsigned short >(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+		}
+		if (!(cqe->flags & IORING_CQE_F_MORE)) {
+			// The kernel has stopped receiving on this socket, e.g. because it ran out of buffers
+			if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP) {
+				failed = true;
+			} else {
+				armReceive(socketIndex);
+			}
+		}
+		if (cqe->res < 0 || !(cqe->flags & IORING_CQE_F_BUFFER)) {
+			continue;
+		}
+
+		unsigned char *buffer =
+			reinterpret_cast< unsigned char * >(m_bufferStorage.data()) + m_usedBuffers.back() * stride;
+		struct io_uring_recvmsg_out *out = io_uring_recvmsg_validate(buffer, cqe->res, &m_receiveHeader);
+		if (!out || m_count == m_datagrams.size()) {
+			continue;
+		}
+
+		Datagram &datagram = m_datagrams[m_count++];
+		datagram.socket    = m_sockets[socketIndex];
+		datagram.data      = static_cast< unsigned char * >(io_uring_recvmsg_payload(out, &m_receiveHeader));
+		datagram.length    = out->payloadlen;
+
+		const std::size_t namelen = std::min< std::size_t >(out->namelen, sizeof(sockaddr_storage));
+		memset(&datagram.from, 0, sizeof(datagram.from));
+		memcpy(&datagram.from, io_uring_recvmsg_name(out), namelen);
+
+		// The control messages follow the address. They carry the local address for replies.
+		const std::size_t controllen = std::min< std::size_t >(out->controllen, CONTROL_SIZE);
+		const unsigned char *control =
+			static_cast< const unsigned char * >(io_uring_recvmsg_name(out)) + m_receiveHeader.msg_namelen;
+		memcpy(datagram.control, control, controllen);
+
+		memset(&datagram.header, 0, sizeof(datagram.header));
+		datagram.header.msg_name       = &datagram.from;
+		datagram.header.msg_namelen    = static_cast< socklen_t >(namelen);
+		datagram.header.msg_iov        = &datagram.iov;
+		datagram.header.msg_iovlen     = 1;
+		datagram.header.msg_control    = controllen > 0 ? datagram.control : nullptr;
+		datagram.header.msg_controllen = controllen;
+	}
+	io_uring_cq_advance(&m_receiveRing, seen);
+
+	return failed ? -1 : static_cast< int >(m_count);
+}
+
+bool UDPRing::send(struct mmsghdr *headers, const int *sockets, unsigned int count) {
+	ZoneScoped;
+
+	unsigned int next = 0;
+	while (next < count) {
+		unsigned int queued = 0;
+		struct io_uring_sqe *sqe;
+		while (next + queued < count && (sqe = io_uring_get_sqe(&m_sendRing))) {
+			io_uring_prep_sendmsg(sqe, sockets[next + queued], &headers[next + queued].msg_hdr, 0);
+			++queued;
+		}
+
+		int ret;
+		do {
+			ret = io_uring_submit_and_wait(&m_sendRing, queued);
+		} while (ret == -EINTR);
+		if (ret < 0) {
+			return false;
+		}
+
+		// The buffers of the datagrams are only reused once all of them have completed
+		unsigned int completed = 0;
+		while (completed < queued) {
+			struct io_uring_cqe *cqe;
+			ret = io_uring_wait_cqe(&m_sendRing, &cqe);
+			if (ret == -EINTR) {
+				continue;
+			} else if (ret < 0) {
+				return false;
+			}
+			io_uring_cqe_seen(&m_sendRing, cqe);
+			++completed;
+		}
+
+		next += queued;
+	}
+
+	return true;
+}
@@ -0,0 +1,111 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#ifndef MUMBLE_MURMUR_UDPRING_H_
+#define MUMBLE_MURMUR_UDPRING_H_
+
+// io_uring backend of the voice threads. Only built with the io-uring CMake option (USE_IO_URING).
+
+#include "MumbleProtocol.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <liburing.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/// Receives the datagrams of a voice thread's sockets through one io_uring and sends its UDPSendBatch through
+/// another one.
+///
+/// Every socket has a multishot recvmsg armed, which picks its buffers from a ring of buffers provided to the kernel.
+/// Waiting for datagrams and re-arming is one io_uring_enter() per round, and the payloads are used right where the
+/// kernel has put them. Everything one datagram is forwarded as is submitted together, with one io_uring_enter().
+///
+/// Needs Linux 6.0 (multishot recvmsg). Not thread-safe, each voice thread has its own.
+class UDPRing {
+public:
+	UDPRing();
+	~UDPRing();
+
+	/// Sets the rings up
+	///
+	/// @param sockets The UDP sockets to receive from
+	/// @param notifySocket A socket that becomes readable when the voice thread has to stop
+	/// @returns Whether io_uring is usable
+	bool init(const std::vector< int > &sockets, int notifySocket);
+
+	/// Gives the buffers of the previous round back to the kernel and waits for datagrams
+	///
+	/// @returns The number of received datagrams, -1 if the ring does not work (e.g. because the kernel does not
+	/// 	support multishot recvmsg)
+	int receive();
+	/// @returns Whether the notify socket has become readable. It is not read from.
+	bool isNotified() const { return m_notified; }
+
+	int socket(unsigned int index) const { return m_datagrams[index].socket; }
+	/// @returns The received datagram, in the buffer the kernel has put it in. The payload following the 4 byte crypt
+	/// 	header is 8 byte aligned.
+	unsigned char *data(unsigned int index) { return m_datagrams[index].data; }
+	/// @returns The size of the received datagram. It is larger than MAX_UDP_PACKET_SIZE if it has been truncated.
+	unsigned int length(unsigned int index) const { return m_datagrams[index].length; }
+	sockaddr_storage &from(unsigned int index) { return m_datagrams[index].from; }
+	/// @returns A header to reply with from the local address the datagram has been sent to
+	struct msghdr &header(unsigned int index) { return m_datagrams[index].header; }
+
+	/// Sends the given datagrams with one submission. Datagrams that fail to send are dropped.
+	///
+	/// @returns false if the ring does not work, in which case it is unknown which of the datagrams have been sent
+	bool send(struct mmsghdr *headers, const int *sockets, unsigned int count);
+
+private:
+	/// Number of buffers the kernel can receive into before it has to wait for receive() to give them back
+	static constexpr unsigned int BUFFER_COUNT = 256;
+	/// Room for the control messages of a datagram. The 4 extra bytes align the payload after the crypt header.
+	static constexpr std::size_t CONTROL_SIZE = CMSG_SPACE(sizeof(struct in6_pktinfo)) + 4;
+	/// A received datagram in a buffer: io_uring_recvmsg_out, address, control messages and payload
+	static constexpr std::size_t BUFFER_SIZE =
+		sizeof(struct io_uring_recvmsg_out) + sizeof(sockaddr_storage) + CONTROL_SIZE
+		+ Mumble::Protocol::MAX_UDP_PACKET_SIZE;
+	static constexpr unsigned short BUFFER_GROUP = 0;
+	/// user_data of the poll on the notify socket. Receives have the index of their socket.
+	static constexpr std::uint64_t NOTIFY = ~static_cast< std::uint64_t >(0);
+
+	static_assert((sizeof(struct io_uring_recvmsg_out) + sizeof(sockaddr_storage) + CONTROL_SIZE + 4) % 8 == 0,
+				  "The payload after the crypt header has to be aligned");
+
+	struct Datagram {
+		int socket;
+		unsigned char *data;
+		unsigned int length;
+		sockaddr_storage from;
+		alignas(struct cmsghdr) std::uint8_t control[CONTROL_SIZE];
+		struct iovec iov;
+		struct msghdr header;
+	};
+
+	void armReceive(unsigned int socketIndex);
+	void recycle();
+
+	struct io_uring m_receiveRing;
+	struct io_uring m_sendRing;
+	bool m_receiveRingReady = false;
+	bool m_sendRingReady    = false;
+
+	struct io_uring_buf_ring *m_bufferRing = nullptr;
+	std::vector< std::uint64_t > m_bufferStorage;
+	/// Buffers handed out by the last receive(), given back by the next one
+	std::vector< unsigned short > m_usedBuffers;
+
+	/// Layout of the buffers of the multishot recvmsg
+	struct msghdr m_receiveHeader;
+	std::vector< int > m_sockets;
+
+	std::vector< Datagram > m_datagrams;
+	unsigned int m_count = 0;
+	bool m_notified      = false;
+};
+
+#endif // MUMBLE_MURMUR_UDPRING_H_
@@ -0,0 +1,95 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include <QtCore>
+#include <QtTest>
+
+#include "AllocationTripwire.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/// The counters are read outside of the armed scopes, as QtTest's macros may allocate themselves.
+class TestAllocationTripwire : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void init();
+	void allocationOutsideScopeIsIgnored();
+	void allocationInsideScopeIsCounted();
+	void reusingReservedStorageIsAllowed();
+	void pauseDisarmsScope();
+	void otherThreadsAreNotArmed();
+};
+
+void TestAllocationTripwire::initTestCase() {
+	QVERIFY(AllocationTripwire::isEnabled());
+	AllocationTripwire::setFatal(false);
+}
+
+void TestAllocationTripwire::init() {
+	AllocationTripwire::resetViolationCount();
+}
+
+void TestAllocationTripwire::allocationOutsideScopeIsIgnored() {
+	std::unique_ptr< int[] > data(new int[64]);
+	QCOMPARE(AllocationTripwire::violationCount(), static_cast< std::uint64_t >(0));
+}
+
+void TestAllocationTripwire::allocationInsideScopeIsCounted() {
+	std::unique_ptr< int[] > data;
+	{
+		AllocationTripwire::Scope scope;
+		data.reset(new int[64]);
+	}
+	QVERIFY(AllocationTripwire::violationCount() >= 1);
+}
+
+void TestAllocationTripwire::reusingReservedStorageIsAllowed() {
+	std::vector< float > buffer;
+	buffer.reserve(128);
+	{
+		AllocationTripwire::Scope scope;
+		for (int i = 0; i < 128; i++) {
+			buffer.push_back(static_cast< float >(i));
+		}
+		buffer.clear();
+		buffer.resize(128);
+	}
+	QCOMPARE(AllocationTripwire::violationCount(), static_cast< std::uint64_t >(0));
+}
+
+void TestAllocationTripwire::pauseDisarmsScope() {
+	std::unique_ptr< int[] > data;
+	{
+		AllocationTripwire::Scope scope;
+		AllocationTripwire::Pause pause;
+		data.reset(new int[64]);
+	}
+	QCOMPARE(AllocationTripwire::violationCount(), static_cast< std::uint64_t >(0));
+}
+
+void TestAllocationTripwire::otherThreadsAreNotArmed() {
+	std::unique_ptr< int[] > data;
+	{
+		AllocationTripwire::Scope scope;
+		AllocationTripwire::Pause pause;
+		std::thread worker([&data]() { data.reset(new int[64]); });
+		worker.join();
+	}
+	QCOMPARE(AllocationTripwire::violationCount(), static_cast< std::uint64_t >(0));
+
+	std::thread worker([&data]() {
+		AllocationTripwire::Scope scope;
+		data.reset(new int[32]);
+	});
+	worker.join();
+	QVERIFY(AllocationTripwire::violationCount() >= 1);
+}
+
+QTEST_MAIN(TestAllocationTripwire)
+#include "TestAllocationTripwire.moc"
@@ -0,0 +1,217 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include <QtCore>
+#include <QtTest>
+
+#include "AudioKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using AudioKernels::InstructionSet;
+using AudioKernels::Kernels;
+
+/// Compares every vectorized implementation this CPU supports against the scalar reference, for lengths that
+/// leave every possible remainder after the vectorized part.
+class TestAudioKernels : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void activeIsAvailable();
+	void foldStereo();
+	void addScaled();
+	void addPanned();
+	void addStereo();
+	void clip();
+	void toShort();
+	void downmix();
+
+private:
+	static constexpr unsigned int maxFrames = 40;
+
+	std::vector< float > randomSamples(std::size_t count, float range = 1.5f);
+	static bool sameSamples(const std::vector< float > &actual, const std::vector< float > &expected);
+
+	const Kernels *m_scalar = nullptr;
+	std::vector< const Kernels * > m_vectorized;
+	std::mt19937 m_random;
+};
+
+std::vector< float > TestAudioKernels::randomSamples(std::size_t count, float range) {
+	std::uniform_real_distribution< float > distribution(-range, range);
+	std::vector< float > samples(count);
+	for (float &sample : samples) {
+		sample = distribution(m_random);
+	}
+	return samples;
+}
+
+/// The compiler may fuse the multiplications and additions of the scalar kernels, so results may differ in the last bit
+bool TestAudioKernels::sameSamples(const std::vector< float > &actual, const std::vector< float > &expected) {
+	return std::equal(actual.begin(), actual.end(), expected.begin(), expected.end(), [](float a, float b) {
+		return std::abs(a - b) <= 1e-6f * std::max(1.0f, std::abs(b));
+	});
+}
+
+void TestAudioKernels::initTestCase() {
+	m_scalar = AudioKernels::kernels(InstructionSet::Scalar);
+	QVERIFY(m_scalar);
+
+	for (InstructionSet set : { InstructionSet::SSE2, InstructionSet::AVX2, InstructionSet::NEON }) {
+		if (const Kernels *kernels = AudioKernels::kernels(set)) {
+			qInfo("Testing the %s kernels", AudioKernels::instructionSetName(set));
+			m_vectorized.push_back(kernels);
+		}
+	}
+}
+
+void TestAudioKernels::activeIsAvailable() {
+	QCOMPARE(&AudioKernels::active(), AudioKernels::kernels(AudioKernels::instructionSet()));
+}
+
+void TestAudioKernels::foldStereo() {
+	for (const Kernels *kernels : m_vectorized) {
+		for (unsigned int frames = 0; frames <= maxFrames; ++frames) {
+			const std::vector< float > in = randomSamples(2 * frames);
+			const std::vector< float > initial = randomSamples(frames);
+
+			std::vector< float > expected = initial;
+			std::vector< float > actual   = initial;
+			m_scalar->foldStereo(expected.data(), in.data(), frames, 0.7f);
+			kernels->foldStereo(actual.data(), in.data(), frames, 0.7f);
+			QVERIFY(sameSamples(actual, expected));
+
+			expected = initial;
+			actual   = initial;
+			m_scalar->addFoldedStereo(expected.data(), in.data(), frames, 0.35f);
+			kernels->addFoldedStereo(actual.data(), in.data(), frames, 0.35f);
+			QVERIFY(sameSamples(actual, expected));
+		}
+	}
+}
+
+void TestAudioKernels::addScaled() {
+	for (const Kernels *kernels : m_vectorized) {
+		for (unsigned int stride : { 1u, 2u, 3u, 6u }) {
+			for (unsigned int frames = 0; frames <= maxFrames; ++frames) {
+				const std::vector< float > in = randomSamples(frames);
+				std::vector< float > expected = randomSamples(frames * stride);
+				std::vector< float > actual   = expected;
+
+				// A ramp, as for a changing volume, and a constant gain
+				m_scalar->addScaled(expected.data(), stride, in.data(), frames, 0.2f, 0.013f);
+				kernels->addScaled(actual.data(), stride, in.data(), frames, 0.2f, 0.013f);
+				m_scalar->addScaled(expected.data(), stride, in.data(), frames, 0.9f, 0.0f);
+				kernels->addScaled(actual.data(), stride, in.data(), frames, 0.9f, 0.0f);
+				QVERIFY(sameSamples(actual, expected));
+			}
+		}
+	}
+}
+
+void TestAudioKernels::addPanned() {
+	for (const Kernels *kernels : m_vectorized) {
+		for (unsigned int stride : { 1u, 2u, 3u, 6u }) {
+			for (unsigned int frames = 0; frames <= maxFrames; ++frames) {
+				const std::vector< float > in = randomSamples(2 * frames);
+				std::vector< float > expected = randomSamples(frames * stride);
+				std::vector< float > actual   = expected;
+
+				m_scalar->addPanned(expected.data(), stride, in.data(), frames, 0.25f, 0.75f, 1.3f);
+				kernels->addPanned(actual.data(), stride, in.data(), frames, 0.25f, 0.75f, 1.3f);
+				QVERIFY(sameSamples(actual, expected));
+			}
+		}
+	}
+}
+
+void TestAudioKernels::addStereo() {
+	for (const Kernels *kernels : m_vectorized) {
+		for (unsigned int stride : { 2u, 3u, 6u }) {
+			for (unsigned int frames = 0; frames <= maxFrames; ++frames) {
+				const std::vector< float > left  = randomSamples(frames);
+				const std::vector< float > right = randomSamples(frames);
+				std::vector< float > expected    = randomSamples(frames * stride);
+				std::vector< float > actual      = expected;
+
+				m_scalar->addStereo(expected.data(), stride, left.data(), right.data(), frames);
+				kernels->addStereo(actual.data(), stride, left.data(), right.data(), frames);
+				QVERIFY(sameSamples(actual, expected));
+			}
+		}
+	}
+}
+
+void TestAudioKernels::clip() {
+	for (const Kernels *kernels : m_vectorized) {
+		for (unsigned int count = 0; count <= maxFrames; ++count) {
+			std::vector< float > expected = randomSamples(count, 3.0f);
+			std::vector< float > actual   = expected;
+
+			m_scalar->clip(expected.data(), count);
+			kernels->clip(actual.data(), count);
+			QVERIFY(sameSamples(actual, expected));
+			for (float sample : actual) {
+				QVERIFY(sample >= -1.0f && sample <= 1.0f);
+			}
+		}
+	}
+}
+
+void TestAudioKernels::toShort() {
+	for (const Kernels *kernels : m_vectorized) {
+		for (unsigned int count = 0; count <= maxFrames; ++count) {
+			// Some samples beyond full scale, which must saturate
+			std::vector< float > in = randomSamples(count, 1.2f);
+			if (count >= 2) {
+				in[0] = 1.0f;
+				in[1] = -1.0f;
+			}
+			std::vector< short > expected(count);
+			std::vector< short > actual(count);
+
+			m_scalar->toShort(expected.data(), in.data(), count);
+			kernels->toShort(actual.data(), in.data(), count);
+			QVERIFY(actual == expected);
+			if (count >= 2) {
+				QCOMPARE(actual[0], static_cast< short >(32767));
+				QCOMPARE(actual[1], static_cast< short >(-32768));
+			}
+		}
+	}
+}
+
+void TestAudioKernels::downmix() {
+	std::uniform_int_distribution< int > distribution(-32768, 32767);
+	for (const Kernels *kernels : m_vectorized) {
+		for (unsigned int channels = 1; channels <= 8; ++channels) {
+			for (unsigned int frames = 0; frames <= maxFrames; ++frames) {
+				const std::vector< float > in = randomSamples(frames * channels);
+				std::vector< float > expected(frames);
+				std::vector< float > actual(frames);
+
+				const float gain = 1.0f / static_cast< float >(channels);
+				m_scalar->downmixFloat(expected.data(), in.data(), frames, channels, gain);
+				kernels->downmixFloat(actual.data(), in.data(), frames, channels, gain);
+				QVERIFY(sameSamples(actual, expected));
+
+				std::vector< short > shortIn(frames * channels);
+				for (short &sample : shortIn) {
+					sample = static_cast< short >(distribution(m_random));
+				}
+				const float shortGain = 1.0f / (32768.0f * static_cast< float >(channels));
+				m_scalar->downmixShort(expected.data(), shortIn.data(), frames, channels, shortGain);
+				kernels->downmixShort(actual.data(), shortIn.data(), frames, channels, shortGain);
+				QVERIFY(sameSamples(actual, expected));
+			}
+		}
+	}
+}
+
+QTEST_MAIN(TestAudioKernels)
+#include "TestAudioKernels.moc"
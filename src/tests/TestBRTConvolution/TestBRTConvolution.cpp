@@ -0,0 +1,294 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include <QtCore>
+#include <QtTest>
+
+#include <Common/AddDelayExpansionMethod.hpp>
+#include <Common/Buffer.hpp>
+#include <Common/FFTCalculator.hpp>
+#include <ProcessingModules/FrequencyDomainMixer.hpp>
+#include <ProcessingModules/StereoUniformPartitionedConvolution.hpp>
+#include <ProcessingModules/UniformPartitionedConvolution.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using BRTProcessing::CFrequencyDomainMixer;
+using BRTProcessing::CStereoUniformPartitionedConvolution;
+using BRTProcessing::CUniformPartitionedConvolution;
+using TPartitioned = std::vector< CMonoBuffer< float > >;
+
+/// Checks the shortcuts the binaural output takes in the BRT convolvers against the straightforward way of getting the
+/// same signal: one transform of the input for both ears against one convolver per ear, the interaural delays applied
+/// to the spectra and mixed before a single inverse FFT against delaying and mixing the time signals, and a source
+/// whose convolution is skipped once it has been drained against one convolved all the time.
+class TestBRTConvolution : public QObject {
+	Q_OBJECT
+private slots:
+	void stereoMatchesMono();
+	void frequencyDomainMixMatchesTimeDomainDelay();
+	void drainedSourceMatchesContinuous();
+
+private:
+	/// A power of two, where the input is transformed with exactly one previous block, and a size that is not, where
+	/// the transform holds more of the previous blocks and leaves room for the delays in the frequency domain
+	static constexpr int blockSizes[] = { 512, 480 };
+	/// Enough blocks for every input to go through all the subfilters a few times
+	static constexpr int blockCount = 16;
+	/// Impulse responses are two and a half blocks long, so that the last subfilter is partly empty
+	static constexpr int subfilterCount = 3;
+
+	struct ImpulseResponses {
+		TPartitioned left;
+		TPartitioned right;
+	};
+
+	CMonoBuffer< float > randomSignal(int size);
+	/// Impulse responses with a decaying noise, split into subfilters of B samples and transformed as the HRTF service
+	/// does
+	ImpulseResponses randomImpulseResponses(int blockSize);
+	static TPartitioned partition(const CMonoBuffer< float > &impulseResponse, int blockSize);
+	static void compare(const char *what, int blockSize, int block, const CMonoBuffer< float > &actual,
+						const CMonoBuffer< float > &expected);
+
+	std::mt19937 m_random;
+};
+
+CMonoBuffer< float > TestBRTConvolution::randomSignal(int size) {
+	std::uniform_real_distribution< float > distribution(-1.0f, 1.0f);
+	CMonoBuffer< float > signal(size);
+	for (float &value : signal) {
+		value = distribution(m_random);
+	}
+	return signal;
+}
+
+TestBRTConvolution::ImpulseResponses TestBRTConvolution::randomImpulseResponses(int blockSize) {
+	const int length = (subfilterCount - 1) * blockSize + blockSize / 2;
+
+	ImpulseResponses impulseResponses;
+	for (TPartitioned *ear : { &impulseResponses.left, &impulseResponses.right }) {
+		CMonoBuffer< float > impulseResponse = randomSignal(length);
+		for (int i = 0; i < length; ++i) {
+			impulseResponse[i] *= std::exp(-3.0f * i / length);
+		}
+		*ear = partition(impulseResponse, blockSize);
+	}
+	return impulseResponses;
+}
+
+TPartitioned TestBRTConvolution::partition(const CMonoBuffer< float > &impulseResponse, int blockSize) {
+	TPartitioned subfilters;
+	for (std::size_t start = 0; start < impulseResponse.size(); start += blockSize) {
+		// Zero padded to twice the block size
+		CMonoBuffer< float > block(2 * blockSize, 0.0f);
+		const std::size_t end = std::min(start + blockSize, impulseResponse.size());
+		std::copy(impulseResponse.begin() + start, impulseResponse.begin() + end, block.begin());
+
+		CMonoBuffer< float > subfilter;
+		Common::CFFTCalculator::CalculateFFT(block, subfilter);
+		subfilters.push_back(subfilter);
+	}
+	return subfilters;
+}
+
+void TestBRTConvolution::compare(const char *what, int blockSize, int block, const CMonoBuffer< float > &actual,
+								 const CMonoBuffer< float > &expected) {
+	QCOMPARE(actual.size(), expected.size());
+
+	// Both sides go through single precision FFTs of different inputs, they only agree to a small fraction of the
+	// largest samples
+	float peak = 1.0f;
+	for (float sample : expected) {
+		peak = std::max(peak, std::abs(sample));
+	}
+	const float tolerance = 1e-5f * peak;
+
+	for (std::size_t i = 0; i < expected.size(); ++i) {
+		if (std::abs(actual[i] - expected[i]) > tolerance) {
+			QFAIL(qPrintable(QString::fromLatin1("%1 differs at sample %2 of block %3 (B = %4): %5 instead of %6")
+								 .arg(QLatin1String(what))
+								 .arg(i)
+								 .arg(block)
+								 .arg(blockSize)
+								 .arg(actual[i])
+								 .arg(expected[i])));
+		}
+	}
+}
+
+void TestBRTConvolution::stereoMatchesMono() {
+	for (int blockSize : blockSizes) {
+		// The impulse responses change every block, the tails of the previous inputs keep those they came in with
+		const std::vector< ImpulseResponses > impulseResponses = { randomImpulseResponses(blockSize),
+																   randomImpulseResponses(blockSize),
+																   randomImpulseResponses(blockSize) };
+		const int spectrumSize = static_cast< int >(impulseResponses[0].left[0].size());
+
+		CStereoUniformPartitionedConvolution stereo;
+		CUniformPartitionedConvolution left;
+		CUniformPartitionedConvolution right;
+		stereo.Setup(blockSize, spectrumSize, subfilterCount);
+		left.Setup(blockSize, spectrumSize, subfilterCount, true);
+		right.Setup(blockSize, spectrumSize, subfilterCount, true);
+		QCOMPARE(stereo.GetSpectrumSize(), spectrumSize);
+
+		CMonoBuffer< float > stereoLeft;
+		CMonoBuffer< float > stereoRight;
+		CMonoBuffer< float > monoLeft;
+		CMonoBuffer< float > monoRight;
+		for (int block = 0; block < blockCount; ++block) {
+			const CMonoBuffer< float > input       = randomSignal(blockSize);
+			const ImpulseResponses &blockResponses = impulseResponses[block % impulseResponses.size()];
+
+			stereo.ProcessUPConvolutionWithMemory(input, blockResponses.left, blockResponses.right, stereoLeft,
+												  stereoRight);
+			left.ProcessUPConvolutionWithMemory(input, blockResponses.left, monoLeft);
+			right.ProcessUPConvolutionWithMemory(input, blockResponses.right, monoRight);
+
+			compare("Left ear", blockSize, block, stereoLeft, monoLeft);
+			compare("Right ear", blockSize, block, stereoRight, monoRight);
+		}
+	}
+}
+
+void TestBRTConvolution::frequencyDomainMixMatchesTimeDomainDelay() {
+	// Only a block size that is not a power of two leaves room for delays in the frequency domain
+	const int blockSize = 480;
+
+	struct Source {
+		ImpulseResponses impulseResponses;
+		int leftDelay;
+		int rightDelay;
+		CStereoUniformPartitionedConvolution frequencyDomain;
+		CStereoUniformPartitionedConvolution timeDomain;
+		CMonoBuffer< float > leftSpectrum;
+		CMonoBuffer< float > rightSpectrum;
+		CMonoBuffer< float > leftDelayBuffer;
+		CMonoBuffer< float > rightDelayBuffer;
+	};
+
+	// No delay, delays on either ear and the largest one
+	std::vector< Source > sources(3);
+	CFrequencyDomainMixer mixer;
+	const int delays[][2] = { { 0, 0 }, { 23, 0 }, { 7, -1 } };
+	for (std::size_t i = 0; i < sources.size(); ++i) {
+		Source &source          = sources[i];
+		source.impulseResponses = randomImpulseResponses(blockSize);
+		const int spectrumSize  = static_cast< int >(source.impulseResponses.left[0].size());
+		source.frequencyDomain.Setup(blockSize, spectrumSize, subfilterCount);
+		source.timeDomain.Setup(blockSize, spectrumSize, subfilterCount);
+		const int maxDelay = source.frequencyDomain.GetMaxFrequencyDomainDelay();
+		QVERIFY(maxDelay > 0);
+
+		source.leftDelay  = delays[i][0];
+		source.rightDelay = delays[i][1] < 0 ? maxDelay : delays[i][1];
+		source.leftSpectrum.assign(spectrumSize, 0.0f);
+		source.rightSpectrum.assign(spectrumSize, 0.0f);
+		// The delay lines start at the delay of the source, as the HRTF convolver starts them, so that the expansion
+		// method only delays and does not stretch
+		source.leftDelayBuffer.assign(source.leftDelay, 0.0f);
+		source.rightDelayBuffer.assign(source.rightDelay, 0.0f);
+		mixer.AddContributor(&source.leftSpectrum, &source.rightSpectrum);
+	}
+
+	CMonoBuffer< float > mixedLeft;
+	CMonoBuffer< float > mixedRight;
+	CMonoBuffer< float > expectedLeft;
+	CMonoBuffer< float > expectedRight;
+	CMonoBuffer< float > withoutDelayLeft;
+	CMonoBuffer< float > withoutDelayRight;
+	CMonoBuffer< float > delayedLeft;
+	CMonoBuffer< float > delayedRight;
+	for (int block = 0; block < blockCount; ++block) {
+		mixedLeft.assign(blockSize, 0.0f);
+		mixedRight.assign(blockSize, 0.0f);
+		expectedLeft.assign(blockSize, 0.0f);
+		expectedRight.assign(blockSize, 0.0f);
+
+		for (std::size_t i = 0; i < sources.size(); ++i) {
+			Source &source                   = sources[i];
+			const CMonoBuffer< float > input = randomSignal(blockSize);
+
+			std::fill(source.leftSpectrum.begin(), source.leftSpectrum.end(), 0.0f);
+			std::fill(source.rightSpectrum.begin(), source.rightSpectrum.end(), 0.0f);
+			QVERIFY(source.frequencyDomain.AccumulateUPConvolutionWithMemory(
+				input, source.impulseResponses.left, source.impulseResponses.right, source.leftDelay, source.rightDelay,
+				source.leftSpectrum, source.rightSpectrum));
+			mixer.Add(static_cast< int >(i), blockSize);
+
+			source.timeDomain.ProcessUPConvolutionWithMemory(input, source.impulseResponses.left,
+															 source.impulseResponses.right, withoutDelayLeft,
+															 withoutDelayRight);
+			Common::CAddDelayExpansionMethod::ProcessAddDelay_ExpansionMethod(withoutDelayLeft, delayedLeft,
+																			  source.leftDelayBuffer, source.leftDelay);
+			Common::CAddDelayExpansionMethod::ProcessAddDelay_ExpansionMethod(
+				withoutDelayRight, delayedRight, source.rightDelayBuffer, source.rightDelay);
+			expectedLeft += delayedLeft;
+			expectedRight += delayedRight;
+		}
+		mixer.MixInto(mixedLeft, mixedRight);
+
+		compare("Left mix", blockSize, block, mixedLeft, expectedLeft);
+		compare("Right mix", blockSize, block, mixedRight, expectedRight);
+	}
+}
+
+void TestBRTConvolution::drainedSourceMatchesContinuous() {
+	for (int blockSize : blockSizes) {
+		const ImpulseResponses impulseResponses = randomImpulseResponses(blockSize);
+		const int spectrumSize                  = static_cast< int >(impulseResponses.left[0].size());
+
+		CStereoUniformPartitionedConvolution continuous;
+		CStereoUniformPartitionedConvolution skipping;
+		continuous.Setup(blockSize, spectrumSize, subfilterCount);
+		skipping.Setup(blockSize, spectrumSize, subfilterCount);
+		const int tailBlocks = skipping.GetTailBlocks();
+		QVERIFY(tailBlocks > subfilterCount);
+		// The delays in the frequency domain must not outlast the tail
+		const int leftDelay  = skipping.GetMaxFrequencyDomainDelay();
+		const int rightDelay = 0;
+
+		// Sound, a silence long enough for some blocks to be skipped, then sound again
+		const int soundBlocks   = 4;
+		const int silenceBlocks = tailBlocks + 3;
+
+		CMonoBuffer< float > continuousLeft;
+		CMonoBuffer< float > continuousRight;
+		CMonoBuffer< float > skippingLeft;
+		CMonoBuffer< float > skippingRight;
+		int silentInputBlocks = 0;
+		int skippedBlocks     = 0;
+		for (int block = 0; block < 2 * soundBlocks + silenceBlocks; ++block) {
+			const bool silent                = block >= soundBlocks && block < soundBlocks + silenceBlocks;
+			const CMonoBuffer< float > input = silent ? CMonoBuffer< float >(blockSize, 0.0f) : randomSignal(blockSize);
+
+			continuous.ProcessUPConvolutionWithMemory(input, impulseResponses.left, impulseResponses.right, leftDelay,
+													  rightDelay, continuousLeft, continuousRight);
+
+			// What the HRTF convolver does: nothing once the last sound has left the convolution, and carry on from
+			// where it stopped when the sound comes back
+			silentInputBlocks = silent ? silentInputBlocks + 1 : 0;
+			if (silentInputBlocks >= tailBlocks) {
+				skippingLeft.assign(blockSize, 0.0f);
+				skippingRight.assign(blockSize, 0.0f);
+				++skippedBlocks;
+			} else {
+				skipping.ProcessUPConvolutionWithMemory(input, impulseResponses.left, impulseResponses.right, leftDelay,
+														rightDelay, skippingLeft, skippingRight);
+			}
+
+			compare("Left ear", blockSize, block, skippingLeft, continuousLeft);
+			compare("Right ear", blockSize, block, skippingRight, continuousRight);
+		}
+		QCOMPARE(skippedBlocks, silenceBlocks - tailBlocks + 1);
+	}
+}
+
+QTEST_MAIN(TestBRTConvolution)
+#include "TestBRTConvolution.moc"
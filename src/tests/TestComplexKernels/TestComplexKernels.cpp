@@ -0,0 +1,164 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include <QtCore>
+#include <QtTest>
+
+#include <Common/ComplexKernels.hpp>
+
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using Common::CComplexKernels;
+using TInstructionSet = CComplexKernels::TInstructionSet;
+
+/// Compares every vectorized complex multiply-accumulate of the BRT convolvers this CPU supports against the scalar
+/// reference, for lengths that leave every possible remainder after the vectorized part and for buffers that are not
+/// aligned to the vector width.
+class TestComplexKernels : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void activeIsAvailable();
+	void multiplyAccumulate();
+	void multiplyAccumulateUnaligned();
+
+private:
+	/// Enough complex numbers for two full AVX-512 iterations and every remainder
+	static constexpr std::size_t maxComplexCount = 3 * 8;
+	/// Floats around the buffers that must be left untouched, a full AVX-512 vector
+	static constexpr std::size_t guardFloats = 16;
+
+	struct Kernel {
+		TInstructionSet instructionSet;
+		CComplexKernels::TMultiplyAccumulate multiplyAccumulate;
+	};
+
+	std::vector< float > randomSpectrum(std::size_t floatCount);
+	/// Checks one call of the kernel on buffers starting the given number of floats into their storage
+	void compare(const Kernel &kernel, std::size_t complexCount, std::size_t offset);
+	static const char *name(TInstructionSet instructionSet);
+
+	std::vector< Kernel > m_vectorized;
+	std::mt19937 m_random;
+};
+
+std::vector< float > TestComplexKernels::randomSpectrum(std::size_t floatCount) {
+	std::uniform_real_distribution< float > distribution(-2.0f, 2.0f);
+	std::vector< float > spectrum(floatCount);
+	for (float &value : spectrum) {
+		value = distribution(m_random);
+	}
+	return spectrum;
+}
+
+const char *TestComplexKernels::name(TInstructionSet instructionSet) {
+	switch (instructionSet) {
+		case TInstructionSet::SSE2:
+			return "SSE2";
+		case TInstructionSet::AVX2:
+			return "AVX2";
+		case TInstructionSet::AVX512:
+			return "AVX-512";
+		case TInstructionSet::NEON:
+			return "NEON";
+		default:
+			return "scalar";
+	}
+}
+
+void TestComplexKernels::compare(const Kernel &kernel, std::size_t complexCount, std::size_t offset) {
+	const std::size_t floatCount = 2 * complexCount;
+	const std::size_t storage    = offset + floatCount + guardFloats;
+	const std::vector< float > x = randomSpectrum(storage);
+	const std::vector< float > h = randomSpectrum(storage);
+	const std::vector< float > y = randomSpectrum(storage);
+
+	std::vector< float > expected = y;
+	std::vector< float > actual   = y;
+	CComplexKernels::MultiplyAccumulateScalar(x.data() + offset, h.data() + offset, expected.data() + offset,
+											  complexCount);
+	kernel.multiplyAccumulate(x.data() + offset, h.data() + offset, actual.data() + offset, complexCount);
+
+	// What is around the buffers must not be touched
+	for (std::size_t i = 0; i < offset; ++i) {
+		QCOMPARE(actual[i], y[i]);
+	}
+	for (std::size_t i = offset + floatCount; i < storage; ++i) {
+		QCOMPARE(actual[i], y[i]);
+	}
+
+	// A fused multiply-add rounds once where the scalar kernel rounds twice. Where the terms cancel, this is more
+	// than one unit in the last place of the result, but never more than a few of the largest term.
+	for (std::size_t i = 0; i < complexCount; ++i) {
+		const std::size_t re = offset + 2 * i;
+		const std::size_t im = re + 1;
+		const double a       = x[re];
+		const double b       = x[im];
+		const double c       = h[re];
+		const double d       = h[im];
+
+		const double reMagnitude = std::abs(static_cast< double >(y[re])) + std::abs(a * c) + std::abs(b * d);
+		const double imMagnitude = std::abs(static_cast< double >(y[im])) + std::abs(a * d) + std::abs(b * c);
+		if (std::abs(static_cast< double >(actual[re]) - expected[re]) > 4 * FLT_EPSILON * reMagnitude
+			|| std::abs(static_cast< double >(actual[im]) - expected[im]) > 4 * FLT_EPSILON * imMagnitude) {
+			QFAIL(qPrintable(QString::fromLatin1("%1 kernel differs at %2 of %3 (offset %4): "
+												 "(%5, %6) instead of (%7, %8)")
+								 .arg(QLatin1String(name(kernel.instructionSet)))
+								 .arg(i)
+								 .arg(complexCount)
+								 .arg(offset)
+								 .arg(actual[re])
+								 .arg(actual[im])
+								 .arg(expected[re])
+								 .arg(expected[im])));
+		}
+	}
+}
+
+void TestComplexKernels::initTestCase() {
+	QVERIFY(CComplexKernels::GetMultiplyAccumulate(TInstructionSet::Scalar));
+
+	for (TInstructionSet instructionSet :
+		 { TInstructionSet::SSE2, TInstructionSet::AVX2, TInstructionSet::AVX512, TInstructionSet::NEON }) {
+		if (CComplexKernels::TMultiplyAccumulate kernel = CComplexKernels::GetMultiplyAccumulate(instructionSet)) {
+			qInfo("Testing the %s kernel", name(instructionSet));
+			m_vectorized.push_back({ instructionSet, kernel });
+		}
+	}
+}
+
+void TestComplexKernels::activeIsAvailable() {
+	QCOMPARE(QLatin1String(CComplexKernels::GetInstructionSetName()),
+			 QLatin1String(name(CComplexKernels::GetInstructionSet())));
+	QVERIFY(CComplexKernels::GetMultiplyAccumulate(CComplexKernels::GetInstructionSet()));
+}
+
+void TestComplexKernels::multiplyAccumulate() {
+	for (const Kernel &kernel : m_vectorized) {
+		for (std::size_t complexCount = 0; complexCount <= maxComplexCount; ++complexCount) {
+			compare(kernel, complexCount, 0);
+		}
+		// A spectrum as long as those of the convolvers, with a remainder
+		compare(kernel, 1024 + 3, 0);
+	}
+}
+
+void TestComplexKernels::multiplyAccumulateUnaligned() {
+	for (const Kernel &kernel : m_vectorized) {
+		// Every misalignment relative to a 64 byte vector, including odd ones that split a complex number across
+		// vectors of the storage
+		for (std::size_t offset = 1; offset < 16; ++offset) {
+			for (std::size_t complexCount = 0; complexCount <= maxComplexCount; ++complexCount) {
+				compare(kernel, complexCount, offset);
+			}
+		}
+	}
+}
+
+QTEST_MAIN(TestComplexKernels)
+#include "TestComplexKernels.moc"
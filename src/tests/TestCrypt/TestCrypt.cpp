@@ -19,6 +19,8 @@ private slots:
 	void cleanupTestCase();
 	void testvectors();
 	void authcrypt();
+	void longPackets();
+	void rekey();
 	void xexstarAttack();
 	void ivrecovery();
 	void reverserecovery();
@@ -214,6 +216,74 @@ void TestCrypt::authcrypt() {
 	}
 }
 
+// Packets with more blocks than are handed to AES at once
+void TestCrypt::longPackets() {
+	const unsigned char rawkey[AES_BLOCK_SIZE] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+												   0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+	const unsigned char nonce[AES_BLOCK_SIZE]  = { 0xff, 0xee, 0xdd, 0xcc, 0xbb, 0xaa, 0x99, 0x88,
+                                                  0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11, 0x00 };
+	std::string rawkey_str                     = std::string(reinterpret_cast< const char * >(rawkey), AES_BLOCK_SIZE);
+	std::string nonce_str                      = std::string(reinterpret_cast< const char * >(nonce), AES_BLOCK_SIZE);
+	CryptStateOCB2 cs;
+	cs.setKey(rawkey_str, nonce_str, nonce_str);
+
+	for (unsigned int len = 128; len <= 1024; len += 13) {
+		std::vector< unsigned char > src;
+		src.resize(len);
+		for (unsigned int i = 0; i < len; i++)
+			src[i] = static_cast< unsigned char >(i * 7 + 1);
+
+		unsigned char enctag[AES_BLOCK_SIZE];
+		unsigned char dectag[AES_BLOCK_SIZE];
+		std::vector< unsigned char > encrypted;
+		encrypted.resize(len);
+		std::vector< unsigned char > decrypted;
+		decrypted.resize(len);
+
+		QVERIFY(cs.ocb_encrypt(src.data(), encrypted.data(), len, nonce, enctag));
+		QVERIFY(cs.ocb_decrypt(encrypted.data(), decrypted.data(), len, nonce, dectag));
+
+		for (int i = 0; i < AES_BLOCK_SIZE; i++)
+			QCOMPARE(enctag[i], dectag[i]);
+
+		for (unsigned int i = 0; i < len; i++)
+			QCOMPARE(src[i], decrypted[i]);
+	}
+}
+
+// The AES contexts have to follow a key that changes after the first packets
+void TestCrypt::rekey() {
+	const unsigned char nonce[AES_BLOCK_SIZE] = { 0xff, 0xee, 0xdd, 0xcc, 0xbb, 0xaa, 0x99, 0x88,
+												  0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11, 0x00 };
+	const unsigned char msg[]                 = "It was a funky funky town!";
+	const unsigned int len                    = sizeof(msg);
+
+	CryptStateOCB2 enc, dec;
+	enc.genKey();
+	dec.setKey(enc.getRawKey(), enc.getDecryptIV(), enc.getEncryptIV());
+
+	unsigned char enctag[AES_BLOCK_SIZE];
+	unsigned char dectag[AES_BLOCK_SIZE];
+	std::vector< unsigned char > encrypted;
+	encrypted.resize(len);
+	std::vector< unsigned char > decrypted;
+	decrypted.resize(len);
+
+	QVERIFY(enc.ocb_encrypt(msg, encrypted.data(), len, nonce, enctag));
+
+	enc.genKey();
+	dec.setRawKey(enc.getRawKey());
+
+	// The packet of the old key does not authenticate under the new one
+	QVERIFY(dec.ocb_decrypt(encrypted.data(), decrypted.data(), len, nonce, dectag));
+	QVERIFY(memcmp(enctag, dectag, AES_BLOCK_SIZE) != 0);
+
+	QVERIFY(enc.ocb_encrypt(msg, encrypted.data(), len, nonce, enctag));
+	QVERIFY(dec.ocb_decrypt(encrypted.data(), decrypted.data(), len, nonce, dectag));
+	QVERIFY(memcmp(enctag, dectag, AES_BLOCK_SIZE) == 0);
+	QVERIFY(memcmp(msg, decrypted.data(), len) == 0);
+}
+
 // Test prevention of the attack described in section 4.1 of https://eprint.iacr.org/2019/311
 void TestCrypt::xexstarAttack() {
 	const unsigned char rawkey[AES_BLOCK_SIZE] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
@@ -0,0 +1,236 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include <QtCore>
+#include <QtTest>
+
+#include "SampleFifo.h"
+
+#include <algorithm>
+#include <vector>
+
+class TestSampleFifo : public QObject {
+	Q_OBJECT
+private slots:
+	void emptyAfterReserve();
+	void firstInFirstOut();
+	void wrapsAround();
+	void silence();
+	void reserveKeepsLargerStorage();
+	void growKeepsSamples();
+	void rechunksBlocks();
+	void rechunksVaryingBlocks();
+	void rechunksMixedBlockSizes();
+	void delayStopsOneSampleShortOfAQuantum();
+
+private:
+	/// Feeds the given blocks through the FIFOs, delayed by RechunkingDelay, and checks that the output never runs dry
+	void rechunk(std::size_t quantum, const std::vector< std::size_t > &blocks, int rounds);
+};
+
+void TestSampleFifo::emptyAfterReserve() {
+	SampleFifo fifo;
+	QCOMPARE(fifo.capacity(), static_cast< std::size_t >(0));
+
+	fifo.reserve(16);
+	QCOMPARE(fifo.capacity(), static_cast< std::size_t >(16));
+	QCOMPARE(fifo.size(), static_cast< std::size_t >(0));
+	QCOMPARE(fifo.space(), static_cast< std::size_t >(16));
+}
+
+void TestSampleFifo::firstInFirstOut() {
+	SampleFifo fifo;
+	fifo.reserve(8);
+
+	const float in[] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f };
+	fifo.push(in, 5);
+	QCOMPARE(fifo.size(), static_cast< std::size_t >(5));
+
+	float out[5] = {};
+	fifo.pop(out, 2);
+	QCOMPARE(out[0], 1.0f);
+	QCOMPARE(out[1], 2.0f);
+	fifo.pop(out, 3);
+	QCOMPARE(out[0], 3.0f);
+	QCOMPARE(out[2], 5.0f);
+	QCOMPARE(fifo.size(), static_cast< std::size_t >(0));
+}
+
+void TestSampleFifo::wrapsAround() {
+	SampleFifo fifo;
+	fifo.reserve(4);
+
+	float next = 0.0f;
+	float expected = 0.0f;
+	float sample;
+	for (int i = 0; i < 10; i++) {
+		// Three in, three out, so that the ring wraps at a different position every time
+		for (int j = 0; j < 3; j++) {
+			fifo.push(&next, 1);
+			next += 1.0f;
+		}
+		std::vector< float > out(3);
+		fifo.pop(out.data(), 3);
+		for (float value : out) {
+			QCOMPARE(value, expected);
+			expected += 1.0f;
+		}
+	}
+
+	const float block[] = { 10.0f, 11.0f, 12.0f, 13.0f };
+	fifo.push(block, 4);
+	QCOMPARE(fifo.space(), static_cast< std::size_t >(0));
+	for (float value : block) {
+		fifo.pop(&sample, 1);
+		QCOMPARE(sample, value);
+	}
+}
+
+void TestSampleFifo::silence() {
+	SampleFifo fifo;
+	fifo.reserve(6);
+
+	const float in[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	fifo.push(in, 4);
+	float out[4] = {};
+	fifo.pop(out, 4);
+
+	// Overwrites what the previous samples have left in the ring
+	fifo.pushSilence(4);
+	fifo.push(in, 1);
+	float silence[5] = { -1.0f, -1.0f, -1.0f, -1.0f, -1.0f };
+	fifo.pop(silence, 5);
+	for (int i = 0; i < 4; i++) {
+		QCOMPARE(silence[i], 0.0f);
+	}
+	QCOMPARE(silence[4], 1.0f);
+}
+
+void TestSampleFifo::reserveKeepsLargerStorage() {
+	SampleFifo fifo;
+	fifo.reserve(32);
+	const float in[] = { 1.0f, 2.0f };
+	fifo.push(in, 2);
+
+	fifo.reserve(8);
+	QCOMPARE(fifo.capacity(), static_cast< std::size_t >(32));
+	QCOMPARE(fifo.size(), static_cast< std::size_t >(0));
+}
+
+void TestSampleFifo::growKeepsSamples() {
+	SampleFifo fifo;
+	fifo.reserve(4);
+
+	// Wrapped around, so that the samples have to be moved to the front of the new ring
+	const float in[] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f };
+	float out[5]     = {};
+	fifo.push(in, 3);
+	fifo.pop(out, 2);
+	fifo.push(in + 3, 2);
+
+	fifo.grow(2);
+	QCOMPARE(fifo.capacity(), static_cast< std::size_t >(4));
+	fifo.grow(16);
+	QCOMPARE(fifo.capacity(), static_cast< std::size_t >(16));
+	QCOMPARE(fifo.size(), static_cast< std::size_t >(3));
+
+	fifo.push(in, 2);
+	fifo.pop(out, 5);
+	QCOMPARE(out[0], 3.0f);
+	QCOMPARE(out[1], 4.0f);
+	QCOMPARE(out[2], 5.0f);
+	QCOMPARE(out[3], 1.0f);
+	QCOMPARE(out[4], 2.0f);
+}
+
+void TestSampleFifo::rechunk(std::size_t quantum, const std::vector< std::size_t > &blocks, int rounds) {
+	// Blocks of a backend turned into quanta of a renderer and back, like the binaural path of AudioOutput does: the
+	// output is delayed by what RechunkingDelay asks for before every block
+	const std::size_t largest = *std::max_element(blocks.begin(), blocks.end());
+
+	SampleFifo input;
+	SampleFifo output;
+	RechunkingDelay delay;
+	input.reserve(quantum + largest);
+	output.reserve(quantum + largest);
+	delay.reset(quantum);
+
+	std::vector< float > in(largest);
+	std::vector< float > chunk(quantum);
+	std::vector< float > out(largest);
+	float written       = 1.0f;
+	float expected      = 1.0f;
+	std::size_t silence = 0;
+	for (int i = 0; i < rounds; i++) {
+		for (std::size_t block : blocks) {
+			output.pushSilence(delay.serve(block));
+			QVERIFY(delay.delay() < quantum);
+
+			for (std::size_t j = 0; j < block; j++) {
+				in[j] = written;
+				written += 1.0f;
+			}
+			input.push(in.data(), block);
+
+			while (input.size() >= quantum) {
+				input.pop(chunk.data(), quantum);
+				output.push(chunk.data(), quantum);
+			}
+
+			// What is waiting for the next quantum and the output always add up to the delay
+			QCOMPARE(input.size() + output.size(), delay.delay() + block);
+			QVERIFY(output.size() >= block);
+			output.pop(out.data(), block);
+
+			// The samples come out in order, with the silence of the delay in between
+			for (std::size_t j = 0; j < block; j++) {
+				if (out[j] == 0.0f) {
+					++silence;
+				} else {
+					QCOMPARE(out[j], expected);
+					expected += 1.0f;
+				}
+			}
+		}
+	}
+	// Nothing has been lost: what has not been played yet is still queued, along with the rest of the silence
+	QVERIFY(silence <= delay.delay());
+	QCOMPARE(static_cast< std::size_t >(written - expected), input.size() + output.size() - (delay.delay() - silence));
+}
+
+void TestSampleFifo::rechunksBlocks() {
+	rechunk(128, { 441 }, 100);
+}
+
+void TestSampleFifo::rechunksVaryingBlocks() {
+	// Backends like JACK ask for blocks of varying sizes
+	rechunk(256, { 480, 1, 479, 256, 1024, 7, 300 }, 50);
+}
+
+void TestSampleFifo::rechunksMixedBlockSizes() {
+	// 160 alone needs a delay of 320 and 240 alone one of 240, but 240 after 160 leaves 400 samples waiting
+	RechunkingDelay delay;
+	delay.reset(480);
+	QCOMPARE(delay.serve(160), static_cast< std::size_t >(320));
+	QCOMPARE(delay.serve(240), static_cast< std::size_t >(80));
+	QCOMPARE(delay.delay(), static_cast< std::size_t >(400));
+	QCOMPARE(delay.serve(160), static_cast< std::size_t >(0));
+
+	rechunk(480, { 160, 240 }, 20);
+	rechunk(480, { 160, 160, 240, 480, 960 }, 20);
+}
+
+void TestSampleFifo::delayStopsOneSampleShortOfAQuantum() {
+	RechunkingDelay delay;
+	delay.reset(256);
+	QCOMPARE(delay.serve(256), static_cast< std::size_t >(0));
+	QCOMPARE(delay.serve(512), static_cast< std::size_t >(0));
+	QCOMPARE(delay.serve(7), static_cast< std::size_t >(255));
+	QCOMPARE(delay.serve(1), static_cast< std::size_t >(0));
+	QCOMPARE(delay.delay(), static_cast< std::size_t >(255));
+}
+
+QTEST_MAIN(TestSampleFifo)
+#include "TestSampleFifo.moc"
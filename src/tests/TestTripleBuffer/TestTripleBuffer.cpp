@@ -0,0 +1,114 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include <QtCore>
+#include <QtTest>
+
+#include "TripleBuffer.h"
+
+#include <array>
+#include <thread>
+
+/// Large enough that a torn copy would show up as a mix of two publications
+struct Snapshot {
+	unsigned int sequence = 0;
+	std::array< unsigned int, 64 > values{};
+};
+
+class TestTripleBuffer : public QObject {
+	Q_OBJECT
+private slots:
+	void initialValue();
+	void updatePicksUpPublication();
+	void latestPublicationWins();
+	void frontIsStableUntilUpdate();
+	void concurrentPublications();
+};
+
+void TestTripleBuffer::initialValue() {
+	TripleBuffer< int > buffer(7);
+	QCOMPARE(buffer.front(), 7);
+	QVERIFY(!buffer.update());
+	QCOMPARE(buffer.front(), 7);
+}
+
+void TestTripleBuffer::updatePicksUpPublication() {
+	TripleBuffer< int > buffer(0);
+	buffer.back() = 1;
+	buffer.publish();
+
+	QVERIFY(buffer.update());
+	QCOMPARE(buffer.front(), 1);
+	QVERIFY(!buffer.update());
+	QCOMPARE(buffer.front(), 1);
+}
+
+void TestTripleBuffer::latestPublicationWins() {
+	TripleBuffer< int > buffer(0);
+	for (int i = 1; i <= 5; i++) {
+		buffer.back() = i;
+		buffer.publish();
+	}
+
+	QVERIFY(buffer.update());
+	QCOMPARE(buffer.front(), 5);
+	QVERIFY(!buffer.update());
+}
+
+void TestTripleBuffer::frontIsStableUntilUpdate() {
+	TripleBuffer< int > buffer(0);
+	buffer.back() = 1;
+	buffer.publish();
+	QVERIFY(buffer.update());
+
+	// The writer cycles through the two buffers it owns without touching the reader's
+	for (int i = 2; i <= 10; i++) {
+		buffer.back() = i;
+		buffer.publish();
+		QCOMPARE(buffer.front(), 1);
+	}
+
+	QVERIFY(buffer.update());
+	QCOMPARE(buffer.front(), 10);
+}
+
+void TestTripleBuffer::concurrentPublications() {
+	constexpr unsigned int publications = 200000;
+
+	TripleBuffer< Snapshot > buffer;
+
+	std::thread writer([&buffer]() {
+		for (unsigned int i = 1; i <= publications; i++) {
+			Snapshot &next = buffer.back();
+			next.sequence  = i;
+			next.values.fill(i);
+			buffer.publish();
+		}
+	});
+
+	// QtTest's macros are not thread-safe, so only the reader checks
+	unsigned int last = 0;
+	bool consistent   = true;
+	bool ordered      = true;
+	while (last < publications) {
+		if (!buffer.update()) {
+			continue;
+		}
+		const Snapshot &current = buffer.front();
+		for (unsigned int value : current.values) {
+			consistent = consistent && value == current.sequence;
+		}
+		ordered = ordered && current.sequence > last;
+		last    = current.sequence;
+	}
+	writer.join();
+
+	QVERIFY(consistent);
+	QVERIFY(ordered);
+	QVERIFY(!buffer.update());
+}
+
+QTEST_MAIN(TestTripleBuffer)
+#include "TestTripleBuffer.moc"
@@ -0,0 +1,142 @@
+// Copyright 2023 The Mumble Developers. All rights reserved.
+// Use of this source code is governed by a BSD-style license
+// that can be found in the LICENSE file at the root of the
+// Mumble source tree or at <https://www.mumble.info/LICENSE>.
+
+#include <QtCore>
+#include <QtNetwork/QHostAddress>
+#include <QtTest>
+
+#include "HostAddress.h"
+#include "UDPBatch.h"
+
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/// Sends batches over the loopback interface and receives them again
+class TestUDPBatch : public QObject {
+	Q_OBJECT
+private slots:
+	void init();
+	void cleanup();
+	void roundTrip();
+	void flushesWhenFull();
+	void dropsUnreachableSource();
+
+private:
+	static int bindLoopback(sockaddr_storage &address);
+	/// Receives until the given number of datagrams has arrived, checking that the n-th one carries n in its first byte
+	void receiveAll(UDPReceiveBatch &batch, unsigned int count);
+
+	int m_sender   = -1;
+	int m_receiver = -1;
+	sockaddr_storage m_senderAddress;
+	sockaddr_storage m_receiverAddress;
+};
+
+int TestUDPBatch::bindLoopback(sockaddr_storage &address) {
+	memset(&address, 0, sizeof(address));
+	sockaddr_in *in     = reinterpret_cast< sockaddr_in * >(&address);
+	in->sin_family      = AF_INET;
+	in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	const int sock = ::socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock < 0) {
+		return -1;
+	}
+	int sockopt   = 1;
+	socklen_t len = sizeof(address);
+	if (::setsockopt(sock, IPPROTO_IP, IP_PKTINFO, &sockopt, sizeof(sockopt))
+		|| ::bind(sock, reinterpret_cast< sockaddr * >(&address), sizeof(sockaddr_in))
+		|| ::getsockname(sock, reinterpret_cast< sockaddr * >(&address), &len)) {
+		::close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+void TestUDPBatch::receiveAll(UDPReceiveBatch &batch, unsigned int count) {
+	unsigned int next = 0;
+	while (next < count) {
+		const int received = batch.receive(m_receiver);
+		QVERIFY(received > 0);
+		QVERIFY(next + static_cast< unsigned int >(received) <= count);
+
+		for (unsigned int i = 0; i < static_cast< unsigned int >(received); ++i) {
+			QCOMPARE(batch.length(i), 10 + next % 7);
+			QCOMPARE(batch.data(i)[0], static_cast< unsigned char >(next));
+
+			const sockaddr_in *from = reinterpret_cast< const sockaddr_in * >(&batch.from(i));
+			QCOMPARE(from->sin_port, reinterpret_cast< const sockaddr_in * >(&m_senderAddress)->sin_port);
+			++next;
+		}
+	}
+}
+
+void TestUDPBatch::init() {
+	m_sender   = bindLoopback(m_senderAddress);
+	m_receiver = bindLoopback(m_receiverAddress);
+	QVERIFY(m_sender >= 0);
+	QVERIFY(m_receiver >= 0);
+}
+
+void TestUDPBatch::cleanup() {
+	::close(m_sender);
+	::close(m_receiver);
+}
+
+void TestUDPBatch::roundTrip() {
+	UDPSendBatch sendBatch;
+	UDPReceiveBatch receiveBatch;
+	QVERIFY(sendBatch.isEmpty());
+
+	for (unsigned int i = 0; i < 5; ++i) {
+		unsigned char *buffer = sendBatch.nextBuffer();
+		// The payload after the crypt header is aligned for the encryption
+		QCOMPARE(reinterpret_cast< quintptr >(buffer + 4) % 8, static_cast< quintptr >(0));
+		memset(buffer, 0xAA, 10 + i % 7);
+		buffer[0] = static_cast< unsigned char >(i);
+		sendBatch.push(m_sender, m_receiverAddress, HostAddress(m_senderAddress), 10 + i % 7);
+	}
+	QVERIFY(!sendBatch.isEmpty());
+
+	sendBatch.flush();
+	QVERIFY(sendBatch.isEmpty());
+
+	receiveAll(receiveBatch, 5);
+	QCOMPARE(reinterpret_cast< quintptr >(receiveBatch.data(0) + 4) % 8, static_cast< quintptr >(0));
+	QCOMPARE(receiveBatch.data(0)[1], static_cast< unsigned char >(0xAA));
+}
+
+void TestUDPBatch::flushesWhenFull() {
+	UDPSendBatch sendBatch;
+	UDPReceiveBatch receiveBatch;
+
+	const unsigned int count = UDPSendBatch::MAX_DATAGRAMS + 3;
+	for (unsigned int i = 0; i < count; ++i) {
+		unsigned char *buffer = sendBatch.nextBuffer();
+		memset(buffer, 0, 10 + i % 7);
+		buffer[0] = static_cast< unsigned char >(i);
+		sendBatch.push(m_sender, m_receiverAddress, HostAddress(m_senderAddress), 10 + i % 7);
+	}
+	sendBatch.flush();
+
+	// More than one receive batch worth
+	receiveAll(receiveBatch, count);
+}
+
+void TestUDPBatch::dropsUnreachableSource() {
+	UDPSendBatch sendBatch;
+
+	// An IPv4 datagram can not be sent from an IPv6 address
+	sendBatch.nextBuffer();
+	sendBatch.push(m_sender, m_receiverAddress, HostAddress(QHostAddress(QHostAddress::LocalHostIPv6)), 10);
+	QVERIFY(sendBatch.isEmpty());
+}
+
+QTEST_MAIN(TestUDPBatch)
+#include "TestUDPBatch.moc"